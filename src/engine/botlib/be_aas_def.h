@@ -121,10 +121,15 @@ typedef struct aas_settings_s
 	qboolean        sv_allowladders;
 } aas_settings_t;
 
+//routing cache types
+#define CACHETYPE_PORTAL        0
+#define CACHETYPE_AREA          1
+
 //routing cache
 typedef struct aas_routingcache_s
 {
 	int             size;		//size of the routing cache
+	int             type;		//CACHETYPE_PORTAL or CACHETYPE_AREA
 	float           time;		//last time accessed or updated
 	int             cluster;	//cluster the cache is for
 	int             areanum;	//area the cache is created for
@@ -132,6 +137,7 @@ typedef struct aas_routingcache_s
 	float           starttraveltime;	//travel time to start with
 	int             travelflags;	//combinations of the travel flags
 	struct aas_routingcache_s *prev, *next;
+	struct aas_routingcache_s *time_prev, *time_next;	//LRU list, oldest first
 	unsigned char  *reachabilities;	//reachabilities used for routing
 	unsigned short int traveltimes[1];	//travel time for every area (variable sized)
 } aas_routingcache_t;
@@ -157,6 +163,15 @@ typedef struct aas_reversedlink_s
 	struct aas_reversedlink_s *next;	//next link
 } aas_reversedlink_t;
 
+//route from the start area of a batched travel time query to a cluster portal
+typedef struct aas_portalroute_s
+{
+	int             query;		//query the route was found in
+	int             status;		//1 = portal reachable, 0 = not reachable, -1 = no routing cache this frame
+	int             traveltime;	//travel time to the portal including the travel time through it
+	int             reachnum;	//reachability used to leave the start area
+} aas_portalroute_t;
+
 //reversed area reachability
 typedef struct aas_reversedreachability_s
 {
@@ -251,8 +266,18 @@ typedef struct aas_s
 	//array of size numclusters with cluster cache
 	aas_routingcache_t ***clusterareacache;
 	aas_routingcache_t **portalcache;
+	//evictable routing cache in least recently used order
+	aas_routingcache_t *oldestcache;
+	aas_routingcache_t *newestcache;
+	//routing cache statistics (reset every frame)
+	int             framecachehits;
+	int             framecachemisses;
+	int             framecacheevictions;
 	//maximum travel time through portals
 	int            *portalmaxtraveltimes;
+	//routes to the cluster portals shared by the goals of batched travel time queries
+	aas_portalroute_t *portalroutes;
+	int             portalroutequery;
 	// Ridah, pointer to Route-Table information
 	aas_rt_t       *routetable;
 	//hide travel times
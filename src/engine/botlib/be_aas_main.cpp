@@ -326,6 +326,11 @@ int AAS_StartFrame(float time)
 		AAS_UpdateTeamDeath();
 		//
 		(*aasworld).frameroutingupdates = 0;
+		//report and reset the routing cache statistics
+		if((*aasworld).initialized)
+		{
+			AAS_RoutingCacheFrame();
+		}
 		//
 		/* Ridah, disabled for speed
 		   if (LibVarGetValue("showcacheupdates"))
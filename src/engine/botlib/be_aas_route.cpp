@@ -124,7 +124,9 @@ void AAS_RoutingInfo(void)
 {
 	botimport.Print(PRT_MESSAGE, "%d area cache updates\n", numareacacheupdates);
 	botimport.Print(PRT_MESSAGE, "%d portal cache updates\n", numportalcacheupdates);
-	botimport.Print(PRT_MESSAGE, "%d bytes routing cache\n", routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d bytes routing cache (%d max)\n", routingcachesize, max_routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d cache hits, %d misses, %d evictions this frame\n",
+					aasworld->framecachehits, aasworld->framecachemisses, aasworld->framecacheevictions);
 }								//end of the function AAS_RoutingInfo
 #endif							//ROUTING_DEBUG
 //===========================================================================
@@ -220,6 +222,25 @@ float AAS_RoutingTime(void)
 	return AAS_Time();
 }								//end of the function AAS_RoutingTime
 
+//===========================================================================
+// area cache leading towards a portal is needed by the portal routing
+// and is never evicted, so it is kept out of the LRU list
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+static qboolean AAS_CacheEvictable(aas_routingcache_t * cache)
+{
+	if(cache->type == CACHETYPE_AREA && aasworld->areasettings[cache->areanum].cluster < 0)
+	{
+		return qfalse;
+	}
+	return qtrue;
+}								//end of the function AAS_CacheEvictable
+
+void            AAS_UnlinkCache(aas_routingcache_t * cache);
+
 //===========================================================================
 //
 // Parameter:           -
@@ -228,6 +249,7 @@ float AAS_RoutingTime(void)
 //===========================================================================
 void AAS_FreeRoutingCache(aas_routingcache_t * cache)
 {
+	AAS_UnlinkCache(cache);
 	routingcachesize -= cache->size;
 	AAS_RoutingFreeMemory(cache);
 }								//end of the function AAS_FreeRoutingCache
@@ -736,136 +758,121 @@ void AAS_InitPortalMaxTravelTimes(void)
 	}							//end for
 }								//end of the function AAS_InitPortalMaxTravelTimes
 
-/*
 //===========================================================================
 //
-// Parameter:			-
-// Returns:				-
-// Changes Globals:		-
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
 //===========================================================================
-void AAS_UnlinkCache(aas_routingcache_t *cache)
+void AAS_UnlinkCache(aas_routingcache_t * cache)
 {
-	if (cache->time_next) cache->time_next->time_prev = cache->time_prev;
-	else newestcache = cache->time_prev;
-	if (cache->time_prev) cache->time_prev->time_next = cache->time_next;
-	else oldestcache = cache->time_next;
+	//area cache leading towards a portal is never in the LRU list
+	if(!AAS_CacheEvictable(cache))
+	{
+		return;
+	}
+	if(cache->time_next)
+	{
+		cache->time_next->time_prev = cache->time_prev;
+	}
+	else
+	{
+		aasworld->newestcache = cache->time_prev;
+	}
+	if(cache->time_prev)
+	{
+		cache->time_prev->time_next = cache->time_next;
+	}
+	else
+	{
+		aasworld->oldestcache = cache->time_next;
+	}
 	cache->time_next = NULL;
 	cache->time_prev = NULL;
-} //end of the function AAS_UnlinkCache
+}								//end of the function AAS_UnlinkCache
+
 //===========================================================================
 //
-// Parameter:			-
-// Returns:				-
-// Changes Globals:		-
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
 //===========================================================================
-void AAS_LinkCache(aas_routingcache_t *cache)
+void AAS_LinkCache(aas_routingcache_t * cache)
 {
-	if (newestcache)
+	if(!AAS_CacheEvictable(cache))
 	{
-		newestcache->time_next = cache;
-		cache->time_prev = cache;
-	} //end if
+		return;
+	}
+	if(aasworld->newestcache)
+	{
+		aasworld->newestcache->time_next = cache;
+		cache->time_prev = aasworld->newestcache;
+	}							//end if
 	else
 	{
-		oldestcache = cache;
+		aasworld->oldestcache = cache;
 		cache->time_prev = NULL;
-	} //end else
+	}							//end else
 	cache->time_next = NULL;
-	newestcache = cache;
-} //end of the function AAS_LinkCache*/
+	aasworld->newestcache = cache;
+}								//end of the function AAS_LinkCache
+
 //===========================================================================
+// moves the cache to the newest end of the LRU list
 //
 // Parameter:           -
 // Returns:             -
 // Changes Globals:     -
 //===========================================================================
+void AAS_TouchCache(aas_routingcache_t * cache)
+{
+	cache->time = AAS_RoutingTime();
+	if(cache == aasworld->newestcache || !AAS_CacheEvictable(cache))
+	{
+		return;
+	}
+	AAS_UnlinkCache(cache);
+	AAS_LinkCache(cache);
+}								//end of the function AAS_TouchCache
+
+//===========================================================================
+// frees the least recently used routing cache
+//
+// Parameter:           -
+// Returns:             qtrue if a cache was freed
+// Changes Globals:     -
+//===========================================================================
 int AAS_FreeOldestCache(void)
 {
-	int             i, j, bestcluster, bestarea, freed;
-	float           besttime;
-	aas_routingcache_t *cache, *bestcache;
-
-	freed = qfalse;
-	besttime = 999999999;
-	bestcache = NULL;
-	bestcluster = 0;
-	bestarea = 0;
-	//refresh cluster cache
-	for(i = 0; i < aasworld->numclusters; i++)
+	int             clusterareanum;
+	aas_routingcache_t *cache;
+
+	cache = aasworld->oldestcache;
+	if(!cache)
 	{
-		for(j = 0; j < aasworld->clusters[i].numareas; j++)
-		{
-			for(cache = aasworld->clusterareacache[i][j]; cache; cache = cache->next)
-			{
-				//never remove cache leading towards a portal
-				if(aasworld->areasettings[cache->areanum].cluster < 0)
-				{
-					continue;
-				}
-				//if this cache is older than the cache we found so far
-				if(cache->time < besttime)
-				{
-					bestcache = cache;
-					bestcluster = i;
-					bestarea = j;
-					besttime = cache->time;
-				}				//end if
-			}					//end for
-		}						//end for
-	}							//end for
-	if(bestcache)
+		return qfalse;
+	}
+	//unlink the cache from the cluster area or portal cache lists
+	if(cache->prev)
 	{
-		cache = bestcache;
-		if(cache->prev)
-		{
-			cache->prev->next = cache->next;
-		}
-		else
-		{
-			aasworld->clusterareacache[bestcluster][bestarea] = cache->next;
-		}
-		if(cache->next)
-		{
-			cache->next->prev = cache->prev;
-		}
-		AAS_FreeRoutingCache(cache);
-		freed = qtrue;
-	}							//end if
-	besttime = 999999999;
-	bestcache = NULL;
-	bestarea = 0;
-	for(i = 0; i < aasworld->numareas; i++)
+		cache->prev->next = cache->next;
+	}
+	else if(cache->type == CACHETYPE_AREA)
 	{
-		//refresh portal cache
-		for(cache = aasworld->portalcache[i]; cache; cache = cache->next)
-		{
-			if(cache->time < besttime)
-			{
-				bestcache = cache;
-				bestarea = i;
-				besttime = cache->time;
-			}					//end if
-		}						//end for
-	}							//end for
-	if(bestcache)
+		clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+		aasworld->clusterareacache[cache->cluster][clusterareanum] = cache->next;
+	}
+	else
 	{
-		cache = bestcache;
-		if(cache->prev)
-		{
-			cache->prev->next = cache->next;
-		}
-		else
-		{
-			aasworld->portalcache[bestarea] = cache->next;
-		}
-		if(cache->next)
-		{
-			cache->next->prev = cache->prev;
-		}
-		AAS_FreeRoutingCache(cache);
-		freed = qtrue;
-	}							//end if
-	return freed;
+		aasworld->portalcache[cache->areanum] = cache->next;
+	}
+	if(cache->next)
+	{
+		cache->next->prev = cache->prev;
+	}
+	AAS_FreeRoutingCache(cache);
+	aasworld->framecacheevictions++;
+	return qtrue;
 }								//end of the function AAS_FreeOldestCache
 
 //===========================================================================
@@ -1140,16 +1147,60 @@ typedef struct routecacheheader_s
 	int             areacrc;
 	int             clustercrc;
 	int             reachcrc;
+	int             contentcrc;		//area settings, portals and BSP entities the vis was built against
 	int             numportalcache;
 	int             numareacache;
 } routecacheheader_t;
 
 #define RCID                        ( ( 'C' << 24 ) + ( 'R' << 16 ) + ( 'E' << 8 ) + 'M' )
-#define RCVERSION                   16
+#define RCVERSION                   18	// 17: LRU links in aas_routingcache_t, 18: contentcrc
 
 void            AAS_DecompressVis(byte * in, int numareas, byte * decompressed);
 int             AAS_CompressVis(byte * vis, int numareas, byte * dest);
 
+//===========================================================================
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+static void AAS_ContinueCRC(unsigned short *crc, const void *data, int length)
+{
+	const byte     *p = (const byte *)data;
+	int             i;
+
+	for(i = 0; i < length; i++)
+	{
+		CRC_ProcessByte(crc, p[i]);
+	}							//end for
+}								//end of the function AAS_ContinueCRC
+
+//===========================================================================
+// checksum of the data the route cache depends on besides the areas,
+// clusters and reachabilities, a changed BSP entity lump (doors, movers)
+// changes the visibility traces
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+int AAS_RouteCacheContentCRC(void)
+{
+	unsigned short  crc;
+	char           *entities;
+
+	CRC_Init(&crc);
+	AAS_ContinueCRC(&crc, aasworld->areasettings, aasworld->numareasettings * sizeof(aas_areasettings_t));
+	AAS_ContinueCRC(&crc, aasworld->portals, aasworld->numportals * sizeof(aas_portal_t));
+	AAS_ContinueCRC(&crc, aasworld->portalindex, aasworld->portalindexsize * sizeof(aas_portalindex_t));
+	entities = botimport.BSPEntityData();
+	if(entities)
+	{
+		AAS_ContinueCRC(&crc, entities, strlen(entities));
+	}
+	return CRC_Value(crc);
+}								//end of the function AAS_RouteCacheContentCRC
+
 void AAS_WriteRouteCache(void)
 {
 	int             i, j, numportalcache, numareacache, size;
@@ -1200,6 +1251,7 @@ void AAS_WriteRouteCache(void)
 		CRC_ProcessString((unsigned char *)aasworld->clusters, sizeof(aas_cluster_t) * aasworld->numclusters);
 	routecacheheader.reachcrc =
 		CRC_ProcessString((unsigned char *)aasworld->reachability, sizeof(aas_reachability_t) * aasworld->reachabilitysize);
+	routecacheheader.contentcrc = AAS_RouteCacheContentCRC();
 	routecacheheader.numportalcache = numportalcache;
 	routecacheheader.numareacache = numareacache;
 	//write the header
@@ -1260,9 +1312,11 @@ aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
 	cache = (aas_routingcache_t *) AAS_RoutingGetMemory(size);
 	cache->size = size;
 	botimport.FS_Read((unsigned char *)cache + sizeof(size), size - sizeof(size), fp);
+	routingcachesize += size;
 
 	if(1 != LittleLong(1))
 	{
+		cache->type = LittleLong(cache->type);
 		cache->time = LittleFloat(cache->time);
 		cache->cluster = LittleLong(cache->cluster);
 		cache->areanum = LittleLong(cache->areanum);
@@ -1354,6 +1408,12 @@ int AAS_ReadRouteCache(void)
 		//AAS_Error("route cache dump reachability CRC incorrect\n");
 		return qfalse;
 	}							//end if
+	if(routecacheheader.contentcrc != AAS_RouteCacheContentCRC())
+	{
+		botimport.FS_FCloseFile(fp);
+		botimport.Print(PRT_MESSAGE, "%s is out of date, rebuilding\n", filename);
+		return qfalse;
+	}							//end if
 #endif
 	//read all the portal cache
 	for(i = 0; i < routecacheheader.numportalcache; i++)
@@ -1366,6 +1426,8 @@ int AAS_ReadRouteCache(void)
 			aasworld->portalcache[cache->areanum]->prev = cache;
 		}
 		aasworld->portalcache[cache->areanum] = cache;
+		cache->type = CACHETYPE_PORTAL;
+		AAS_LinkCache(cache);
 	}							//end for
 	//read all the cluster area cache
 	for(i = 0; i < routecacheheader.numareacache; i++)
@@ -1379,6 +1441,8 @@ int AAS_ReadRouteCache(void)
 			aasworld->clusterareacache[cache->cluster][clusterareanum]->prev = cache;
 		}
 		aasworld->clusterareacache[cache->cluster][clusterareanum] = cache;
+		cache->type = CACHETYPE_AREA;
+		AAS_LinkCache(cache);
 	}							//end for
 	// read the visareas
 	aasworld->areavisibility = (byte **) GetClearedMemory(aasworld->numareas * sizeof(byte *));
@@ -1422,14 +1486,23 @@ void AAS_InitRouting(void)
 	AAS_CalculateAreaTravelTimes();
 	//calculate the maximum travel times through portals
 	AAS_InitPortalMaxTravelTimes();
+	//routes to the cluster portals shared by the goals of batched queries
+	aasworld->portalroutes = (aas_portalroute_t *) AAS_RoutingGetMemory(aasworld->numportals * sizeof(aas_portalroute_t));
+	aasworld->portalroutequery = 0;
 	//
 #ifdef ROUTING_DEBUG
 	numareacacheupdates = 0;
 	numportalcacheupdates = 0;
 #endif							//ROUTING_DEBUG
 	//
+	aasworld->oldestcache = NULL;
+	aasworld->newestcache = NULL;
+	aasworld->framecachehits = 0;
+	aasworld->framecachemisses = 0;
+	aasworld->framecacheevictions = 0;
 	routingcachesize = 0;
 	max_routingcachesize = 1024 * (int)LibVarValue("max_routingcache", DEFAULT_MAX_ROUTINGCACHESIZE);
+	LibVarSetNotModified("max_routingcache");
 	max_frameroutingupdates = (int)LibVarGetValue("bot_frameroutingupdates");
 	//
 	// enable this for quick testing of maps without enemies
@@ -1455,6 +1528,35 @@ void AAS_InitRouting(void)
 	}
 }								//end of the function AAS_InitRouting
 
+//===========================================================================
+// picks up a changed routing cache budget and reports and resets the
+// routing cache statistics of the current world
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     max_routingcachesize
+//===========================================================================
+void AAS_RoutingCacheFrame(void)
+{
+	if(LibVarChanged("max_routingcache"))
+	{
+		max_routingcachesize = 1024 * (int)LibVarGetValue("max_routingcache");
+		LibVarSetNotModified("max_routingcache");
+	}							//end if
+	if(aasworld->framecachehits || aasworld->framecachemisses || aasworld->framecacheevictions)
+	{
+		if(LibVarGetValue("bot_routingcachestats"))
+		{
+			botimport.Print(PRT_MESSAGE, "routing cache: %d hits, %d misses, %d evictions, %d of %d KB\n",
+							aasworld->framecachehits, aasworld->framecachemisses, aasworld->framecacheevictions,
+							routingcachesize >> 10, max_routingcachesize >> 10);
+		}						//end if
+	}							//end if
+	aasworld->framecachehits = 0;
+	aasworld->framecachemisses = 0;
+	aasworld->framecacheevictions = 0;
+}								//end of the function AAS_RoutingCacheFrame
+
 //===========================================================================
 //
 // Parameter:           -
@@ -1467,6 +1569,8 @@ void AAS_FreeRoutingCaches(void)
 	AAS_FreeAllClusterAreaCache();
 	// free all the existing portal cache
 	AAS_FreeAllPortalCache();
+	aasworld->oldestcache = NULL;
+	aasworld->newestcache = NULL;
 	// free all the existing area visibility data
 	AAS_FreeAreaVisibility();
 	// free cached travel times within areas
@@ -1481,6 +1585,12 @@ void AAS_FreeRoutingCaches(void)
 		AAS_RoutingFreeMemory(aasworld->portalmaxtraveltimes);
 	}
 	aasworld->portalmaxtraveltimes = NULL;
+	// free the portal routes of batched queries
+	if(aasworld->portalroutes)
+	{
+		AAS_RoutingFreeMemory(aasworld->portalroutes);
+	}
+	aasworld->portalroutes = NULL;
 	// free reversed reachability links
 	if(aasworld->reversedreachability)
 	{
@@ -1761,12 +1871,14 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 	//if there was no cache
 	if(!cache)
 	{
+		aasworld->framecachemisses++;
 		//NOTE: the number of routing updates is limited per frame
 		if(!forceUpdate && (aasworld->frameroutingupdates > max_frameroutingupdates))
 		{
 			return NULL;
 		}						//end if
 		cache = AAS_AllocRoutingCache(aasworld->clusters[clusternum].numreachabilityareas);
+		cache->type = CACHETYPE_AREA;
 		cache->cluster = clusternum;
 		cache->areanum = areanum;
 		VectorCopy(aasworld->areas[areanum].center, cache->origin);
@@ -1779,10 +1891,15 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 			clustercache->prev = cache;
 		}
 		aasworld->clusterareacache[clusternum][clusterareanum] = cache;
+		AAS_LinkCache(cache);
 		AAS_UpdateAreaRoutingCache(cache);
 	}							//end if
+	else
+	{
+		aasworld->framecachehits++;
+	}							//end else
 	//the cache has been accessed
-	cache->time = AAS_RoutingTime();
+	AAS_TouchCache(cache);
 	return cache;
 }								//end of the function AAS_GetAreaRoutingCache
 
@@ -1912,7 +2029,9 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 	//if the portal routing isn't cached
 	if(!cache)
 	{
+		aasworld->framecachemisses++;
 		cache = AAS_AllocRoutingCache(aasworld->numportals);
+		cache->type = CACHETYPE_PORTAL;
 		cache->cluster = clusternum;
 		cache->areanum = areanum;
 		VectorCopy(aasworld->areas[areanum].center, cache->origin);
@@ -1926,23 +2045,119 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 			aasworld->portalcache[areanum]->prev = cache;
 		}
 		aasworld->portalcache[areanum] = cache;
+		AAS_LinkCache(cache);
 		//update the cache
 		AAS_UpdatePortalRoutingCache(cache);
 	}							//end if
+	else
+	{
+		aasworld->framecachehits++;
+	}							//end else
 	//the cache has been accessed
-	cache->time = AAS_RoutingTime();
+	AAS_TouchCache(cache);
 	return cache;
 }								//end of the function AAS_GetPortalRoutingCache
 
 //===========================================================================
+// returns the route from the area to a portal of its cluster: 1 if the
+// portal can be reached, 0 if it can't and -1 if the routing cache isn't
+// available this frame. The travel time includes the largest travel time
+// through the portal area and the travel time from the origin.
+// With a query number the result is kept for the rest of that batched query
 //
 // Parameter:           -
 // Returns:             -
 // Changes Globals:     -
 //===========================================================================
-int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum)
+static int AAS_AreaRouteToPortal(int areanum, vec3_t origin, int clusternum, int clusterareanum, int portalnum,
+								 int travelflags, int query, int *traveltime, int *reachnum)
 {
-	int             clusternum, goalclusternum, portalnum, i, clusterareanum, bestreachnum;
+	int             t;
+	aas_portal_t   *portal;
+	aas_portalroute_t *route;
+	aas_routingcache_t *areacache;
+	aas_reachability_t *reach;
+
+	route = NULL;
+	if(query)
+	{
+		route = &aasworld->portalroutes[portalnum];
+		if(route->query == query)
+		{
+			*traveltime = route->traveltime;
+			*reachnum = route->reachnum;
+			return route->status;
+		}
+		route->query = query;
+		route->status = 0;
+	}							//end if
+	//
+	portal = aasworld->portals + portalnum;
+	// if the area in disabled
+	if(aasworld->areasettings[portal->areanum].areaflags & AREA_DISABLED)
+	{
+		return 0;
+	}
+	// if there is no reachability out of the area
+	if(!aasworld->areasettings[portal->areanum].numreachableareas)
+	{
+		return 0;
+	}
+	//get the cache of the portal area
+	areacache = AAS_GetAreaRoutingCache(clusternum, portal->areanum, travelflags, qfalse);
+	// RF, this may be NULL if we were unable to calculate the cache this frame
+	if(!areacache)
+	{
+		if(route)
+		{
+			route->status = -1;
+		}
+		return -1;
+	}
+	//if the portal is NOT reachable from this area
+	if(!areacache->traveltimes[clusterareanum])
+	{
+		return 0;
+	}
+	t = areacache->traveltimes[clusterareanum];
+	//FIXME: add the exact travel time through the actual portal area
+	//NOTE: for now we just add the largest travel time through the area portal
+	//      because we can't directly calculate the exact travel time
+	//      to be more specific we don't know which reachability is used to travel
+	//      into the portal area when coming from the current area
+	t += aasworld->portalmaxtraveltimes[portalnum];
+	//
+	*reachnum = aasworld->areasettings[areanum].firstreachablearea + areacache->reachabilities[clusterareanum];
+
+//botimport.Print(PRT_MESSAGE, "portal reachability: %i\n", (int)areacache->reachabilities[clusterareanum] );
+
+	if(origin)
+	{
+		reach = aasworld->reachability + *reachnum;
+		t += AAS_AreaTravelTime(areanum, origin, reach->start);
+	}							//end if
+	*traveltime = t;
+	if(route)
+	{
+		route->status = 1;
+		route->traveltime = t;
+		route->reachnum = *reachnum;
+	}							//end if
+	return 1;
+}								//end of the function AAS_AreaRouteToPortal
+
+//===========================================================================
+// the query number is non zero when the route is part of a batched query
+// from the same area and origin with the same travel flags
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+static int AAS_AreaRouteToGoalAreaQuery(int areanum, vec3_t origin, int goalareanum, int travelflags, int query,
+										int *traveltime, int *reachnum)
+{
+	int             clusternum, goalclusternum, portalnum, i, clusterareanum, bestreachnum, status, portaltime;
 	unsigned short int t, besttime;
 	aas_portal_t   *portal;
 	aas_cluster_t  *cluster;
@@ -1996,6 +2211,11 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	{
 		travelflags |= TFL_DONOTENTER_LARGE;
 	}							//end if
+	//the routes to the portals of a batched query are only valid for its travel flags
+	if(AAS_AreaDoNotEnter(goalareanum) || AAS_AreaDoNotEnterLarge(goalareanum))
+	{
+		query = 0;
+	}							//end if
 	//
 	clusternum = aasworld->areasettings[areanum].cluster;
 	goalclusternum = aasworld->areasettings[goalareanum].cluster;
@@ -2098,49 +2318,19 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 			continue;
 		}
 		//
-		portal = aasworld->portals + portalnum;
-		// if the area in disabled
-		if(aasworld->areasettings[portal->areanum].areaflags & AREA_DISABLED)
-		{
-			continue;
-		}
-		// if there is no reachability out of the area
-		if(!aasworld->areasettings[portal->areanum].numreachableareas)
-		{
-			continue;
-		}
-		//get the cache of the portal area
-		areacache = AAS_GetAreaRoutingCache(clusternum, portal->areanum, travelflags, qfalse);
-		// RF, this may be NULL if we were unable to calculate the cache this frame
-		if(!areacache)
+		status = AAS_AreaRouteToPortal(areanum, origin, clusternum, clusterareanum, portalnum, travelflags, query,
+									   &portaltime, reachnum);
+		if(status < 0)
 		{
 			return qfalse;
 		}
-		//if the portal is NOT reachable from this area
-		if(!areacache->traveltimes[clusterareanum])
+		if(!status)
 		{
 			continue;
 		}
 		//total travel time is the travel time the portal area is from
 		//the goal area plus the travel time towards the portal area
-		t = portalcache->traveltimes[portalnum] + areacache->traveltimes[clusterareanum];
-		//FIXME: add the exact travel time through the actual portal area
-		//NOTE: for now we just add the largest travel time through the area portal
-		//      because we can't directly calculate the exact travel time
-		//      to be more specific we don't know which reachability is used to travel
-		//      into the portal area when coming from the current area
-		t += aasworld->portalmaxtraveltimes[portalnum];
-		//
-		// Ridah, needs to be up here
-		*reachnum = aasworld->areasettings[areanum].firstreachablearea + areacache->reachabilities[clusterareanum];
-
-//botimport.Print(PRT_MESSAGE, "portal reachability: %i\n", (int)areacache->reachabilities[clusterareanum] );
-
-		if(origin)
-		{
-			reach = aasworld->reachability + *reachnum;
-			t += AAS_AreaTravelTime(areanum, origin, reach->start);
-		}						//end if
+		t = portalcache->traveltimes[portalnum] + portaltime;
 		//if the time is better than the one already found
 		if(!besttime || t < besttime)
 		{
@@ -2156,6 +2346,17 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 	*reachnum = bestreachnum;
 	*traveltime = besttime;
 	return qtrue;
+}								//end of the function AAS_AreaRouteToGoalAreaQuery
+
+//===========================================================================
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *reachnum)
+{
+	return AAS_AreaRouteToGoalAreaQuery(areanum, origin, goalareanum, travelflags, 0, traveltime, reachnum);
 }								//end of the function AAS_AreaRouteToGoalArea
 
 //===========================================================================
@@ -2175,6 +2376,51 @@ int AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, in
 	return 0;
 }								//end of the function AAS_AreaTravelTimeToGoalArea
 
+//===========================================================================
+// returns the travel times from the area to many goal areas, the same times
+// AAS_AreaTravelTimeToGoalArea returns for each of them. The goals still
+// use their own area and portal routing caches, because those keep a
+// single travel time per area which depends on the goal. What the goals
+// share is the route from the area to each portal of its cluster, which
+// is looked up once per query instead of once per goal
+//
+// Parameter:           -
+// Returns:             number of goals reached
+// Changes Globals:     -
+//===========================================================================
+int AAS_AreaTravelTimesToGoalAreas(int areanum, vec3_t origin, int *goalareas, int numgoals, int travelflags,
+								   int *traveltimes)
+{
+	int             i, reachnum, numreached;
+
+	if(!aasworld->initialized)
+	{
+		memset(traveltimes, 0, numgoals * sizeof(int));
+		return 0;
+	}							//end if
+	//start a new query, clear the portal routes when the query number wraps
+	aasworld->portalroutequery++;
+	if(aasworld->portalroutequery <= 0)
+	{
+		memset(aasworld->portalroutes, 0, aasworld->numportals * sizeof(aas_portalroute_t));
+		aasworld->portalroutequery = 1;
+	}							//end if
+	numreached = 0;
+	for(i = 0; i < numgoals; i++)
+	{
+		if(!AAS_AreaRouteToGoalAreaQuery(areanum, origin, goalareas[i], travelflags, aasworld->portalroutequery,
+										 &traveltimes[i], &reachnum))
+		{
+			traveltimes[i] = 0;
+		}
+		if(traveltimes[i])
+		{
+			numreached++;
+		}
+	}							//end for
+	return numreached;
+}								//end of the function AAS_AreaTravelTimesToGoalAreas
+
 //===========================================================================
 //
 // Parameter:           -
@@ -2505,6 +2751,68 @@ int AAS_AreaVisible(int srcarea, int destarea)
 	return aasworld->decompressedvis[destarea];
 }								//end of the function AAS_AreaVisible
 
+//shared state of the visibility build, rows are built independently
+typedef struct aas_visbuild_s
+{
+	byte           *validareas;
+	byte           *areaTable;
+	int             numAreaBits;
+	vec3_t          mins, maxs;
+	vec3_t          endpos;
+} aas_visbuild_t;
+
+//===========================================================================
+// builds the upper triangle (j > i) of row i of the area visibility table
+// only writes row i, so rows can be built on several threads at once
+//
+// Parameter:           -
+// Returns:             -
+// Changes Globals:     -
+//===========================================================================
+static void AAS_CreateVisibilityRow(int i, void *data)
+{
+	aas_visbuild_t *vb = (aas_visbuild_t *) data;
+	bsp_trace_t     trace;
+	byte           *row;
+	int             j;
+
+	if(i < 1 || !vb->validareas[i])
+	{
+		return;
+	}
+
+	row = vb->areaTable + i * vb->numAreaBits;
+	row[i >> 3] |= (1 << (i & 7));
+
+	for(j = i + 1; j < aasworld->numareas; j++)
+	{
+		if(!vb->validareas[j])
+		{
+			continue;
+		}
+
+		// RF, check PVS first, since it's much faster
+		if(!AAS_inPVS(aasworld->areawaypoints[i], aasworld->areawaypoints[j]))
+		{
+			continue;
+		}
+
+		trace = AAS_Trace(aasworld->areawaypoints[i], NULL, NULL, aasworld->areawaypoints[j], -1, CONTENTS_SOLID);
+		if(trace.startsolid && trace.ent < ENTITYNUM_WORLD)
+		{
+			//NOTE: retraces from the area center to the end of the last waypoint trace
+			trace =
+				AAS_Trace(aasworld->areas[i].center, vb->mins, vb->maxs, vb->endpos, trace.ent,
+						  CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_MONSTERCLIP);
+		}
+
+		if(trace.fraction >= 1)
+		{
+			row[j >> 3] |= (1 << (j & 7));
+		}
+	}
+}								//end of the function AAS_CreateVisibilityRow
+
 //===========================================================================
 // just center to center visibility checking...
 // FIXME: implement a correct full vis
@@ -2523,6 +2831,7 @@ void AAS_CreateVisibility(qboolean waypointsOnly)
 	int             numvalid = 0;
 	byte           *areaTable = NULL;
 	int             numAreas, numAreaBits;
+	aas_visbuild_t  vb;
 
 	numAreas = aasworld->numareas;
 	numAreaBits = ((numAreas + 8) >> 3);
@@ -2585,6 +2894,26 @@ void AAS_CreateVisibility(qboolean waypointsOnly)
 
 	buf = (byte *) GetClearedMemory(numAreas * 2 * sizeof(byte));	// in case it ends up bigger than the decompressedvis, which is rare but possible
 
+	// trace every valid area pair once, spread over worker threads when the engine has them
+	vb.validareas = validareas;
+	vb.areaTable = areaTable;
+	vb.numAreaBits = numAreaBits;
+	VectorCopy(mins, vb.mins);
+	VectorCopy(maxs, vb.maxs);
+	VectorCopy(endpos, vb.endpos);
+	if(botimport.ParallelFor)
+	{
+		botimport.ParallelFor(numAreas, AAS_CreateVisibilityRow, &vb);
+	}
+	else
+	{
+		for(i = 1; i < numAreas; i++)
+		{
+			AAS_CreateVisibilityRow(i, &vb);
+		}
+	}
+
+	// mirror the table and compress the rows, memory is only allocated here
 	for(i = 1; i < numAreas; i++)
 	{
 		if(!validareas[i])
@@ -2594,55 +2923,14 @@ void AAS_CreateVisibility(qboolean waypointsOnly)
 
 		for(j = 1; j < numAreas; j++)
 		{
-			aasworld->decompressedvis[j] = 0;
-			if(i == j)
-			{
-				aasworld->decompressedvis[j] = 1;
-				if(areaTable)
-				{
-					areaTable[(i * numAreaBits) + (j >> 3)] |= (1 << (j & 7));
-				}
-				continue;
-			}
-
-			if(!validareas[j])
-			{
-				continue;
-			}
-
-			// if we have already checked this combination, copy the result
-			if(areaTable && (i > j))
+			if(j < i)
 			{
 				// use the reverse result stored in the table
-				if(areaTable[(j * numAreaBits) + (i >> 3)] & (1 << (i & 7)))
-				{
-					aasworld->decompressedvis[j] = 1;
-				}
-				// done, move to the next area
-				continue;
-			}
-
-			// RF, check PVS first, since it's much faster
-			if(!AAS_inPVS(aasworld->areawaypoints[i], aasworld->areawaypoints[j]))
-			{
-				continue;
+				aasworld->decompressedvis[j] = (areaTable[(j * numAreaBits) + (i >> 3)] & (1 << (i & 7))) ? 1 : 0;
 			}
-
-			trace = AAS_Trace(aasworld->areawaypoints[i], NULL, NULL, aasworld->areawaypoints[j], -1, CONTENTS_SOLID);
-			if(trace.startsolid && trace.ent < ENTITYNUM_WORLD)
+			else
 			{
-				trace =
-					AAS_Trace(aasworld->areas[i].center, mins, maxs, endpos, trace.ent,
-							  CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_MONSTERCLIP);
-			}
-
-			if(trace.fraction >= 1)
-			{
-				if(areaTable)
-				{
-					areaTable[(i * numAreaBits) + (j >> 3)] |= (1 << (j & 7));
-				}
-				aasworld->decompressedvis[j] = 1;
+				aasworld->decompressedvis[j] = (areaTable[(i * numAreaBits) + (j >> 3)] & (1 << (j & 7))) ? 1 : 0;
 			}
 		}
 
@@ -2652,10 +2940,9 @@ void AAS_CreateVisibility(qboolean waypointsOnly)
 		totalsize += size;
 	}
 
-	if(areaTable)
-	{
-		FreeMemory(areaTable);
-	}
+	FreeMemory(areaTable);
+	FreeMemory(buf);
+	FreeMemory(validareas);
 
 	botimport.Print(PRT_MESSAGE, "AAS_CreateVisibility: compressed vis size = %i\n", totalsize);
 }
@@ -56,6 +56,9 @@ void            AAS_CreateAllRoutingCache(void);
 
 //
 void            AAS_RoutingInfo(void);
+
+//applies routing cache budget changes and resets the per frame cache statistics
+void            AAS_RoutingCacheFrame(void);
 #endif							//AASINTERN
 
 //returns the travel flag for the given travel type
@@ -79,6 +82,10 @@ unsigned short int AAS_AreaTravelTime(int areanum, vec3_t start, vec3_t end);
 //returns the travel time from the area to the goal area using the given travel flags
 int             AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags);
 
+//travel times from the area to many goal areas, the same as AAS_AreaTravelTimeToGoalArea, returns the number of goals reached
+int             AAS_AreaTravelTimesToGoalAreas(int areanum, vec3_t origin, int *goalareas, int numgoals, int travelflags,
+											   int *traveltimes);
+
 void            AAS_InitTeamDeath(void);
 void            AAS_RecordTeamDeathArea(vec3_t srcpos, int srcarea, int team, int teamCount, int travelflags);
 void            AAS_UpdateTeamDeath(void);
@@ -68,6 +68,8 @@ Maryland 20850 USA.
 #define AVOIDDROPPED_TIME       5
 //
 #define TRAVELTIME_SCALE        0.01
+//maximum number of goal areas in one batched travel time query
+#define MAX_BATCHGOALS          256
 
 //location in the map "target_location"
 typedef struct maplocation_s
@@ -103,6 +105,8 @@ typedef struct levelitem_s
 	vec3_t          goalorigin;	//goal origin within the area
 	int             entitynum;	//entity number
 	float           timeout;	//item is removed after this time
+	float           weight;		//weight for the bot choosing a goal, 0 if the item isn't wanted
+	int             traveltime;	//travel time from the bot, filled in by BotLevelItemTravelTimes
 	struct levelitem_s *prev, *next;
 } levelitem_t;
 
@@ -183,6 +187,9 @@ campspot_t     *campspots = NULL;
 //int g_gametype;
 qboolean        g_singleplayer;
 
+//batched item travel times: 0 = off, 1 = on, 2 = on and compare with the routing cache
+libvar_t       *bot_batchtraveltimes;
+
 // END      Arnout changes, 28-08-2002.
 
 // Rafael gameskill
@@ -1228,6 +1235,74 @@ int BotGetSecondGoal(int goalstate, bot_goal_t * goal)
 	return qtrue;
 }								//end of the function BotGetSecondGoal
 
+//===========================================================================
+//
+// Parameter:               -
+// Returns:                 -
+// Changes Globals:     -
+//===========================================================================
+static void BotBatchItemTravelTimes(int areanum, vec3_t origin, int travelflags, levelitem_t ** items, int *goalareas,
+									int numgoals)
+{
+	int             i, t, traveltimes[MAX_BATCHGOALS], mismatches;
+
+	AAS_AreaTravelTimesToGoalAreas(areanum, origin, goalareas, numgoals, travelflags, traveltimes);
+	mismatches = 0;
+	for(i = 0; i < numgoals; i++)
+	{
+		items[i]->traveltime = traveltimes[i];
+		if(bot_batchtraveltimes->value >= 2)
+		{
+			t = AAS_AreaTravelTimeToGoalArea(areanum, origin, goalareas[i], travelflags);
+			if(t != traveltimes[i])
+			{
+				mismatches++;
+			}
+		}						//end if
+	}							//end for
+	if(mismatches)
+	{
+		botimport.Print(PRT_MESSAGE, "%d of %d batched item travel times differ from the routing cache\n", mismatches,
+						numgoals);
+	}							//end if
+}								//end of the function BotBatchItemTravelTimes
+
+//===========================================================================
+// fills in the travel time from the area to all wanted level items
+// with one batched routing query per MAX_BATCHGOALS items
+//
+// Parameter:               -
+// Returns:                 -
+// Changes Globals:     -
+//===========================================================================
+void BotLevelItemTravelTimes(int areanum, vec3_t origin, int travelflags)
+{
+	int             goalareas[MAX_BATCHGOALS], numgoals;
+	levelitem_t    *items[MAX_BATCHGOALS], *li;
+
+	numgoals = 0;
+	for(li = levelitems; li; li = li->next)
+	{
+		li->traveltime = 0;
+		if(!li->goalareanum || li->weight <= 0)
+		{
+			continue;
+		}
+		items[numgoals] = li;
+		goalareas[numgoals] = li->goalareanum;
+		numgoals++;
+		if(numgoals >= MAX_BATCHGOALS)
+		{
+			BotBatchItemTravelTimes(areanum, origin, travelflags, items, goalareas, numgoals);
+			numgoals = 0;
+		}						//end if
+	}							//end for
+	if(numgoals)
+	{
+		BotBatchItemTravelTimes(areanum, origin, travelflags, items, goalareas, numgoals);
+	}							//end if
+}								//end of the function BotLevelItemTravelTimes
+
 //===========================================================================
 // pops a new long term goal on the goal stack in the goalstate
 //
@@ -1237,7 +1312,7 @@ int BotGetSecondGoal(int goalstate, bot_goal_t * goal)
 //===========================================================================
 int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelflags)
 {
-	int             areanum, t, weightnum;
+	int             areanum, t, weightnum, batch;
 	float           weight, bestweight, avoidtime;
 	iteminfo_t     *iteminfo;
 	itemconfig_t   *ic;
@@ -1282,6 +1357,7 @@ int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 	//go through the items in the level
 	for(li = levelitems; li; li = li->next)
 	{
+		li->weight = 0;
 // START    Arnout changes, 28-08-2002.
 // removed gametype, added single player
 		//if (g_gametype == GT_SINGLE_PLAYER) {
@@ -1331,21 +1407,34 @@ int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 			weight += 1000;
 		}
 #endif							//DROPPEDWEIGHT
-		if(weight > 0)
+		li->weight = weight;
+	}							//end for
+	//get the travel times to the wanted items at once
+	batch = bot_batchtraveltimes && bot_batchtraveltimes->value;
+	if(batch)
+	{
+		BotLevelItemTravelTimes(areanum, origin, travelflags);
+	}
+	//go through the wanted items
+	for(li = levelitems; li; li = li->next)
+	{
+		if(li->weight <= 0)
 		{
-			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
-			//if the goal is reachable
-			if(t > 0)
-			{
-				weight /= (float)t *TRAVELTIME_SCALE;
+			continue;
+		}
+		weight = li->weight;
+		//get the travel time towards the goal area
+		t = batch ? li->traveltime : AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
+		//if the goal is reachable
+		if(t > 0)
+		{
+			weight /= (float)t *TRAVELTIME_SCALE;
 
-				//
-				if(weight > bestweight)
-				{
-					bestweight = weight;
-					bestitem = li;
-				}				//end if
+			//
+			if(weight > bestweight)
+			{
+				bestweight = weight;
+				bestitem = li;
 			}					//end if
 		}						//end if
 	}							//end for
@@ -1420,7 +1509,7 @@ int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 //===========================================================================
 int BotChooseNBGItem(int goalstate, vec3_t origin, int *inventory, int travelflags, bot_goal_t * ltg, float maxtime)
 {
-	int             areanum, t, weightnum, ltg_time;
+	int             areanum, t, weightnum, ltg_time, batch;
 	float           weight, bestweight, avoidtime;
 	iteminfo_t     *iteminfo;
 	itemconfig_t   *ic;
@@ -1474,6 +1563,7 @@ int BotChooseNBGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 	//go through the items in the level
 	for(li = levelitems; li; li = li->next)
 	{
+		li->weight = 0;
 // START    Arnout changes, 28-08-2002.
 // removed gametype, added single player
 		if(g_singleplayer)
@@ -1522,30 +1612,43 @@ int BotChooseNBGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 			weight += 1000;
 		}
 #endif							//DROPPEDWEIGHT
-		if(weight > 0)
+		li->weight = weight;
+	}							//end for
+	//get the travel times to the wanted items at once
+	batch = bot_batchtraveltimes && bot_batchtraveltimes->value;
+	if(batch)
+	{
+		BotLevelItemTravelTimes(areanum, origin, travelflags);
+	}
+	//go through the wanted items
+	for(li = levelitems; li; li = li->next)
+	{
+		if(li->weight <= 0)
 		{
-			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
-			//if the goal is reachable
-			if(t > 0 && t < maxtime)
-			{
-				weight /= (float)t *TRAVELTIME_SCALE;
+			continue;
+		}
+		weight = li->weight;
+		//get the travel time towards the goal area
+		t = batch ? li->traveltime : AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
+		//if the goal is reachable
+		if(t > 0 && t < maxtime)
+		{
+			weight /= (float)t *TRAVELTIME_SCALE;
 
-				//
-				if(weight > bestweight)
+			//
+			if(weight > bestweight)
+			{
+				t = 0;
+				if(ltg && !li->timeout)
 				{
-					t = 0;
-					if(ltg && !li->timeout)
-					{
-						//get the travel time from the goal to the long term goal
-						t = AAS_AreaTravelTimeToGoalArea(li->goalareanum, li->goalorigin, ltg->areanum, travelflags);
-					}			//end if
-					//if the travel back is possible and doesn't take too long
-					if(t <= ltg_time)
-					{
-						bestweight = weight;
-						bestitem = li;
-					}			//end if
+					//get the travel time from the goal to the long term goal
+					t = AAS_AreaTravelTimeToGoalArea(li->goalareanum, li->goalorigin, ltg->areanum, travelflags);
+				}				//end if
+				//if the travel back is possible and doesn't take too long
+				if(t <= ltg_time)
+				{
+					bestweight = weight;
+					bestitem = li;
 				}				//end if
 			}					//end if
 		}						//end if
@@ -1815,6 +1918,7 @@ int BotSetupGoalAI(qboolean singleplayer)
 //  g_gametype = LibVarValue("g_gametype", "0");
 	g_singleplayer = singleplayer;
 // END  Arnout changes, 28-08-2002.
+	bot_batchtraveltimes = LibVar("bot_batchtraveltimes", "1");
 	//item configuration file
 	parser.SetBaseFolder("botfiles");
 	filename = LibVarString("itemconfig", "items.c");
@@ -1853,6 +1957,7 @@ void BotShutdownGoalAI(void)
 	freelevelitems = NULL;
 	levelitems = NULL;
 	numlevelitems = 0;
+	bot_batchtraveltimes = NULL;
 
 	BotFreeInfoEntities();
 
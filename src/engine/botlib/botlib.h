@@ -240,6 +240,10 @@ typedef struct botlib_import_s
 
 	// Gordon: direct hookup into rendering, stop using this silly debugpoly faff
 	void            (*BotDrawPolygon) (int color, int numPoints, float *points);
+
+	//run func for every index in [0, count) spread over worker threads, returns when all are done
+	//the work may only trace, check contents and PVS and write memory it owns, may be NULL
+	void            (*ParallelFor) (int count, void (*func) (int index, void *data), void *data);
 } botlib_import_t;
 
 typedef struct aas_export_s
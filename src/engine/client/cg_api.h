@@ -248,7 +248,8 @@ typedef enum {
 	CG_R_ANIMNUMFRAMES,
 	CG_R_ANIMFRAMERATE,
 #endif
-	CG_COMPLETE_CALLBACK
+	CG_COMPLETE_CALLBACK,
+	CG_CM_MODELBOUNDS
 } cgameImport_t;
 
 typedef enum {
@@ -345,6 +346,7 @@ void trap_UpdateScreen(void);
 void trap_CM_LoadMap(const char *mapname);
 int trap_CM_NumInlineModels(void);
 clipHandle_t trap_CM_InlineModel(int index);
+void trap_CM_ModelBounds(clipHandle_t model, vec3_t mins, vec3_t maxs);
 clipHandle_t trap_CM_TempBoxModel(const vec3_t mins, const vec3_t maxs);
 clipHandle_t trap_CM_TempCapsuleModel(const vec3_t mins, const vec3_t maxs);
 int trap_CM_PointContents(const vec3_t p, clipHandle_t model);
@@ -739,6 +739,9 @@ intptr_t CL_CgameSystemCalls(intptr_t * args) {
 			return CM_NumInlineModels();
 		case CG_CM_INLINEMODEL:
 			return CM_InlineModel(args[1]);
+		case CG_CM_MODELBOUNDS:
+			CM_ModelBounds(args[1], (float*)VMA(2), (float*)VMA(3));
+			return 0;
 		case CG_CM_TEMPBOXMODEL:
 			return CM_TempBoxModel((float*)VMA(1), (float*)VMA(2), qfalse);
 		case CG_CM_TEMPCAPSULEMODEL:
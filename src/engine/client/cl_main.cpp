@@ -38,6 +38,7 @@ Maryland 20850 USA.
 #include "../idLib/precompiled.h"
 #include "client.h"
 #include <limits.h>
+#include <setjmp.h>
 
 #ifdef ET_MYSQL
 #include "../database/database.h"
@@ -137,6 +138,7 @@ convar_t         *j_up_axis;
 convar_t         *cl_activeAction;
 
 convar_t         *cl_autorecord;
+convar_t         *cl_demoKeyframeInterval;
 
 convar_t         *cl_motdString;
 
@@ -245,6 +247,8 @@ void            CL_LoadTranslations_f(void);
 void            CL_WriteWaveClose(void);
 void            CL_WavStopRecord_f(void);
 
+void            CL_DownloadsComplete(void);
+
 void CL_PurgeCache( void ) {
 	cls.doCachePurge = qtrue;
 }
@@ -756,6 +760,475 @@ CLIENT SIDE DEMO RECORDING
 =======================================================================
 */
 
+/*
+=======================================================================
+
+Demo keyframes
+
+Recorded demos carry a keyframe every cl_demoKeyframeInterval seconds so
+playback can jump into the middle of them.  A keyframe is a gamestate
+followed by the snapshots that later messages may still delta from, all
+stored as regular demo messages behind the end marker of the message
+stream, so older clients never see them.  The index of the keyframes and
+a trailer that locates it close the file:
+
+  <messages> (-1,-1) { <gamestate> <snapshots> (-1,-1) } <index> <trailer>
+
+Each index entry holds the server time of the keyframe, where it starts
+and where the message stream goes on after it.
+
+=======================================================================
+*/
+
+#define DEMO_INDEX_MAGIC	(('I'<<24)+('F'<<16)+('K'<<8)+'D')	// "DKFI"
+#define MAX_DEMO_KEYFRAMES	2048
+
+typedef struct
+{
+	int             serverTime;
+	int             offset;			// file offset of the keyframe messages
+	int             resume;			// file offset of the message following the keyframe
+} demoKeyframe_t;
+
+typedef struct
+{
+	int             numKeyframes;
+	int             startTime;
+	int             endTime;
+	demoKeyframe_t  keyframes[MAX_DEMO_KEYFRAMES];
+} demoIndex_t;
+
+typedef struct
+{
+	int             numKeyframes;
+	int             startTime;
+	int             endTime;
+	int             indexOffset;
+	int             magic;
+} demoTrailer_t;
+
+static demoIndex_t demoRecordIndex;
+static demoIndex_t demoPlayIndex;
+
+// the keyframes are collected in a file of their own while recording
+static fileHandle_t demoKeyframeFile;
+static char     demoKeyframeName[MAX_OSPATH];
+static int      demoKeyframeInterval;
+static int      demoNextKeyframeTime;
+
+/*
+====================
+CL_WriteDemoBlock
+
+Writes a message to a demo file, prefixed by its sequence and length
+====================
+*/
+static void CL_WriteDemoBlock(fileHandle_t f, int sequence, const msg_t * msg)
+{
+	int             swlen;
+
+	swlen = LittleLong(sequence);
+	FS_Write(&swlen, 4, f);
+
+	swlen = LittleLong(msg->cursize);
+	FS_Write(&swlen, 4, f);
+	FS_Write(msg->data, msg->cursize, f);
+}
+
+/*
+====================
+CL_WriteGamestate
+
+Writes the current gamestate as a complete server message
+====================
+*/
+static void CL_WriteGamestate(msg_t * buf, int serverCommandSequence)
+{
+	int             i;
+	entityState_t  *ent;
+	entityState_t   nullstate;
+	char           *s;
+
+	MSG_Bitstream(buf);
+
+	// NOTE, MRE: all server->client messages now acknowledge
+	MSG_WriteLong(buf, clc.reliableSequence);
+
+	MSG_WriteByte(buf, svc_gamestate);
+	MSG_WriteLong(buf, serverCommandSequence);
+
+	// configstrings
+	for(i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		if(!cl.gameState.stringOffsets[i])
+		{
+			continue;
+		}
+		s = cl.gameState.stringData + cl.gameState.stringOffsets[i];
+		MSG_WriteByte(buf, svc_configstring);
+		MSG_WriteShort(buf, i);
+		MSG_WriteBigString(buf, s);
+	}
+
+	// baselines
+	memset(&nullstate, 0, sizeof(nullstate));
+	for(i = 0; i < MAX_GENTITIES; i++)
+	{
+		ent = &cl.entityBaselines[i];
+		if(!ent->number)
+		{
+			continue;
+		}
+		MSG_WriteByte(buf, svc_baseline);
+		MSG_WriteDeltaEntity(buf, &nullstate, ent, qtrue);
+	}
+
+	MSG_WriteByte(buf, svc_EOF);
+
+	// finished writing the gamestate stuff
+
+	// write the client num
+	MSG_WriteLong(buf, clc.clientNum);
+	// write the checksum feed
+	MSG_WriteLong(buf, clc.checksumFeed);
+
+	// finished writing the client packet
+	MSG_WriteByte(buf, svc_EOF);
+}
+
+/*
+====================
+CL_WriteSnapshotEntities
+
+Delta compresses the entities of a received snapshot against an older
+one the same way the server does
+====================
+*/
+static void CL_WriteSnapshotEntities(msg_t * msg, const clSnapshot_t * from, const clSnapshot_t * to)
+{
+	entityState_t  *oldent, *newent;
+	int             oldindex, newindex, oldnum, newnum, fromNumEntities;
+
+	fromNumEntities = from ? from->numEntities : 0;
+
+	newent = NULL;
+	oldent = NULL;
+	newindex = 0;
+	oldindex = 0;
+	while(newindex < to->numEntities || oldindex < fromNumEntities)
+	{
+		if(newindex >= to->numEntities)
+		{
+			newnum = 9999;
+		}
+		else
+		{
+			newent = &cl.parseEntities[(to->parseEntitiesNum + newindex) & (MAX_PARSE_ENTITIES - 1)];
+			newnum = newent->number;
+		}
+
+		if(oldindex >= fromNumEntities)
+		{
+			oldnum = 9999;
+		}
+		else
+		{
+			oldent = &cl.parseEntities[(from->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES - 1)];
+			oldnum = oldent->number;
+		}
+
+		if(newnum == oldnum)
+		{
+			MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			oldindex++;
+			newindex++;
+			continue;
+		}
+
+		if(newnum < oldnum)
+		{
+			MSG_WriteDeltaEntity(msg, &cl.entityBaselines[newnum], newent, qtrue);
+			newindex++;
+			continue;
+		}
+
+		MSG_WriteDeltaEntity(msg, oldent, NULL, qtrue);
+		oldindex++;
+	}
+
+	MSG_WriteBits(msg, (MAX_GENTITIES - 1), GENTITYNUM_BITS);	// end of packetentities
+}
+
+/*
+====================
+CL_WriteDemoKeyframe
+
+Called after each recorded net message, writes a keyframe of the state
+it left the client in when one is due
+====================
+*/
+static void CL_WriteDemoKeyframe(void)
+{
+	msg_t           buf;
+	byte            bufData[MAX_MSGLEN];
+	clSnapshot_t   *snap, *prev;
+	demoKeyframe_t *keyframe;
+	int             i, messageNum, offset;
+	qboolean        first;
+
+	if(!demoKeyframeFile)
+	{
+		return;
+	}
+
+	// only keyframe right after a snapshot, so the keyframe is the
+	// complete state the next message in the stream builds on
+	if(!cl.snap.valid || cl.snap.messageNum != clc.serverMessageSequence)
+	{
+		return;
+	}
+
+	if(!demoRecordIndex.startTime)
+	{
+		demoRecordIndex.startTime = cl.snap.serverTime;
+		demoNextKeyframeTime = cl.snap.serverTime + demoKeyframeInterval;
+	}
+	demoRecordIndex.endTime = cl.snap.serverTime;
+
+	// the server time starts over on a new map
+	if(cl.snap.serverTime < demoNextKeyframeTime - demoKeyframeInterval)
+	{
+		demoNextKeyframeTime = cl.snap.serverTime;
+	}
+
+	if(cl.snap.serverTime < demoNextKeyframeTime || demoRecordIndex.numKeyframes >= MAX_DEMO_KEYFRAMES)
+	{
+		return;
+	}
+	demoNextKeyframeTime = cl.snap.serverTime + demoKeyframeInterval;
+
+	offset = FS_FTell(demoKeyframeFile);
+
+	// the gamestate up to the last executed command, the rest are resent
+	// in front of the first snapshot
+	MSG_Init(&buf, bufData, sizeof(bufData));
+	CL_WriteGamestate(&buf, clc.lastExecutedServerCommand);
+	if(buf.overflowed)
+	{
+		return;
+	}
+
+	first = qtrue;
+	prev = NULL;
+	for(messageNum = cl.snap.messageNum - PACKET_BACKUP + 1; messageNum <= cl.snap.messageNum; messageNum++)
+	{
+		snap = &cl.snapshots[messageNum & PACKET_MASK];
+		if(!snap->valid || snap->messageNum != messageNum ||
+		   cl.parseEntitiesNum - snap->parseEntitiesNum > MAX_PARSE_ENTITIES - 128)
+		{
+			continue;
+		}
+
+		if(first)
+		{
+			CL_WriteDemoBlock(demoKeyframeFile, messageNum - 1, &buf);
+			first = qfalse;
+		}
+
+		MSG_Init(&buf, bufData, sizeof(bufData));
+		MSG_Bitstream(&buf);
+		MSG_WriteLong(&buf, clc.reliableSequence);
+
+		if(!prev)
+		{
+			for(i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++)
+			{
+				MSG_WriteByte(&buf, svc_serverCommand);
+				MSG_WriteLong(&buf, i);
+				MSG_WriteString(&buf, CL_GetReliableServerCommand(i));
+			}
+		}
+
+		MSG_WriteByte(&buf, svc_snapshot);
+		MSG_WriteLong(&buf, snap->serverTime);
+		MSG_WriteByte(&buf, prev ? messageNum - prev->messageNum : 0);
+		MSG_WriteByte(&buf, snap->snapFlags);
+		MSG_WriteByte(&buf, sizeof(snap->areamask));
+		MSG_WriteData(&buf, snap->areamask, sizeof(snap->areamask));
+		MSG_WriteDeltaPlayerstate(&buf, prev ? &prev->ps : NULL, &snap->ps);
+		CL_WriteSnapshotEntities(&buf, prev, snap);
+		MSG_WriteByte(&buf, svc_EOF);
+
+		// a keyframe that doesn't fit is left out of the index
+		if(buf.overflowed)
+		{
+			break;
+		}
+		CL_WriteDemoBlock(demoKeyframeFile, messageNum, &buf);
+		prev = snap;
+	}
+
+	i = -1;
+	FS_Write(&i, 4, demoKeyframeFile);
+	FS_Write(&i, 4, demoKeyframeFile);
+
+	if(!prev || buf.overflowed)
+	{
+		return;
+	}
+
+	keyframe = &demoRecordIndex.keyframes[demoRecordIndex.numKeyframes++];
+	keyframe->serverTime = cl.snap.serverTime;
+	keyframe->offset = offset;
+	keyframe->resume = FS_FTell(clc.demofile);
+}
+
+/*
+====================
+CL_FinishDemoKeyframes
+
+Appends the keyframes and their index to the demo being stopped
+====================
+*/
+static void CL_FinishDemoKeyframes(void)
+{
+	demoTrailer_t   trailer;
+	demoKeyframe_t  keyframe;
+	fileHandle_t    f;
+	byte            buffer[16384];
+	int             i, len, base, r;
+
+	if(!demoKeyframeFile)
+	{
+		return;
+	}
+
+	FS_FCloseFile(demoKeyframeFile);
+	demoKeyframeFile = 0;
+
+	len = FS_FOpenFileRead(demoKeyframeName, &f, qtrue);
+	if(!f || !demoRecordIndex.numKeyframes)
+	{
+		if(f)
+		{
+			FS_FCloseFile(f);
+		}
+		FS_HomeRemove(demoKeyframeName);
+		return;
+	}
+
+	// copy the keyframes behind the end of the message stream
+	base = FS_FTell(clc.demofile);
+	while(len > 0)
+	{
+		r = FS_Read(buffer, MIN(len, (int)sizeof(buffer)), f);
+		if(r <= 0)
+		{
+			break;
+		}
+		FS_Write(buffer, r, clc.demofile);
+		len -= r;
+	}
+	FS_FCloseFile(f);
+	FS_HomeRemove(demoKeyframeName);
+
+	if(len > 0)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: couldn't copy the demo keyframes, the demo can't be seeked\n");
+		return;
+	}
+
+	trailer.indexOffset = LittleLong(FS_FTell(clc.demofile));
+	for(i = 0; i < demoRecordIndex.numKeyframes; i++)
+	{
+		keyframe.serverTime = LittleLong(demoRecordIndex.keyframes[i].serverTime);
+		keyframe.offset = LittleLong(base + demoRecordIndex.keyframes[i].offset);
+		keyframe.resume = LittleLong(demoRecordIndex.keyframes[i].resume);
+		FS_Write(&keyframe, sizeof(keyframe), clc.demofile);
+	}
+
+	trailer.numKeyframes = LittleLong(demoRecordIndex.numKeyframes);
+	trailer.startTime = LittleLong(demoRecordIndex.startTime);
+	trailer.endTime = LittleLong(demoRecordIndex.endTime);
+	trailer.magic = LittleLong(DEMO_INDEX_MAGIC);
+	FS_Write(&trailer, sizeof(trailer), clc.demofile);
+
+	Com_Printf("Wrote %i demo keyframes.\n", demoRecordIndex.numKeyframes);
+}
+
+/*
+====================
+CL_ReadDemoIndex
+
+Reads the keyframe index from the end of a demo, leaves the file at its start
+====================
+*/
+static void CL_ReadDemoIndex(fileHandle_t f, int length)
+{
+	demoTrailer_t   trailer;
+	demoKeyframe_t *keyframe;
+	int             i;
+
+	Com_Memset(&demoPlayIndex, 0, sizeof(demoPlayIndex));
+
+	if(length < (int)sizeof(trailer))
+	{
+		return;
+	}
+
+	FS_Seek(f, length - sizeof(trailer), FS_SEEK_SET);
+	if(FS_Read(&trailer, sizeof(trailer), f) == sizeof(trailer) && LittleLong(trailer.magic) == DEMO_INDEX_MAGIC)
+	{
+		demoPlayIndex.numKeyframes = LittleLong(trailer.numKeyframes);
+		demoPlayIndex.startTime = LittleLong(trailer.startTime);
+		demoPlayIndex.endTime = LittleLong(trailer.endTime);
+		trailer.indexOffset = LittleLong(trailer.indexOffset);
+
+		if(demoPlayIndex.numKeyframes <= 0 || demoPlayIndex.numKeyframes > MAX_DEMO_KEYFRAMES ||
+		   trailer.indexOffset + demoPlayIndex.numKeyframes * (int)sizeof(demoKeyframe_t) != length - (int)sizeof(trailer))
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: ignoring the broken keyframe index of the demo\n");
+			Com_Memset(&demoPlayIndex, 0, sizeof(demoPlayIndex));
+		}
+		else
+		{
+			FS_Seek(f, trailer.indexOffset, FS_SEEK_SET);
+			FS_Read(demoPlayIndex.keyframes, demoPlayIndex.numKeyframes * sizeof(demoKeyframe_t), f);
+			for(i = 0, keyframe = demoPlayIndex.keyframes; i < demoPlayIndex.numKeyframes; i++, keyframe++)
+			{
+				keyframe->serverTime = LittleLong(keyframe->serverTime);
+				keyframe->offset = LittleLong(keyframe->offset);
+				keyframe->resume = LittleLong(keyframe->resume);
+			}
+		}
+	}
+
+	FS_Seek(f, 0, FS_SEEK_SET);
+}
+
+/*
+====================
+CL_FindDemoKeyframe
+
+Returns the last keyframe at or before the given server time
+====================
+*/
+static const demoKeyframe_t *CL_FindDemoKeyframe(int serverTime)
+{
+	const demoKeyframe_t *best;
+	int             i;
+
+	best = NULL;
+	for(i = 0; i < demoPlayIndex.numKeyframes; i++)
+	{
+		if(demoPlayIndex.keyframes[i].serverTime <= serverTime)
+		{
+			best = &demoPlayIndex.keyframes[i];
+		}
+	}
+	return best;
+}
+
 /*
 ====================
 CL_WriteDemoMessage
@@ -801,6 +1274,7 @@ void CL_StopRecord_f(void)
 	len = -1;
 	FS_Write(&len, 4, clc.demofile);
 	FS_Write(&len, 4, clc.demofile);
+	CL_FinishDemoKeyframes();
 	FS_FCloseFile(clc.demofile);
 	clc.demofile = 0;
 
@@ -898,12 +1372,9 @@ void CL_Record_f(void)
 
 void CL_Record(const char *name)
 {
-	int             i;
 	msg_t           buf;
 	byte            bufData[MAX_MSGLEN];
-	entityState_t  *ent;
-	entityState_t   nullstate;
-	char           *s;
+	char            keyframeName[MAX_OSPATH];
 	int             len;
 
 	// open the demo file
@@ -916,6 +1387,20 @@ void CL_Record(const char *name)
 		return;
 	}
 
+	// the keyframes go to a file of their own until the demo is stopped
+	Com_Memset(&demoRecordIndex, 0, sizeof(demoRecordIndex));
+	demoKeyframeInterval = cl_demoKeyframeInterval->integer * 1000;
+	if(demoKeyframeInterval > 0)
+	{
+		COM_StripExtension3(name, keyframeName, sizeof(keyframeName));
+		Com_sprintf(demoKeyframeName, sizeof(demoKeyframeName), "%s.kf.dm_%d", keyframeName, com_protocol->integer);
+		demoKeyframeFile = FS_FOpenFileWrite(demoKeyframeName);
+		if(!demoKeyframeFile)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: couldn't open %s, the demo won't be seekable\n", demoKeyframeName);
+		}
+	}
+
 	clc.demorecording = qtrue;
 	Cvar_Set("cl_demorecording", "1");	// fretn
 	Q_strncpyz(clc.demoName, demoName, sizeof(clc.demoName));
@@ -927,51 +1412,7 @@ void CL_Record(const char *name)
 
 	// write out the gamestate message
 	MSG_Init(&buf, bufData, sizeof(bufData));
-	MSG_Bitstream(&buf);
-
-	// NOTE, MRE: all server->client messages now acknowledge
-	MSG_WriteLong(&buf, clc.reliableSequence);
-
-	MSG_WriteByte(&buf, svc_gamestate);
-	MSG_WriteLong(&buf, clc.serverCommandSequence);
-
-	// configstrings
-	for(i = 0; i < MAX_CONFIGSTRINGS; i++)
-	{
-		if(!cl.gameState.stringOffsets[i])
-		{
-			continue;
-		}
-		s = cl.gameState.stringData + cl.gameState.stringOffsets[i];
-		MSG_WriteByte(&buf, svc_configstring);
-		MSG_WriteShort(&buf, i);
-		MSG_WriteBigString(&buf, s);
-	}
-
-	// baselines
-	memset(&nullstate, 0, sizeof(nullstate));
-	for(i = 0; i < MAX_GENTITIES; i++)
-	{
-		ent = &cl.entityBaselines[i];
-		if(!ent->number)
-		{
-			continue;
-		}
-		MSG_WriteByte(&buf, svc_baseline);
-		MSG_WriteDeltaEntity(&buf, &nullstate, ent, qtrue);
-	}
-
-	MSG_WriteByte(&buf, svc_EOF);
-
-	// finished writing the gamestate stuff
-
-	// write the client num
-	MSG_WriteLong(&buf, clc.clientNum);
-	// write the checksum feed
-	MSG_WriteLong(&buf, clc.checksumFeed);
-
-	// finished writing the client packet
-	MSG_WriteByte(&buf, svc_EOF);
+	CL_WriteGamestate(&buf, clc.serverCommandSequence);
 
 	// write it to the demo file
 	len = LittleLong(clc.serverMessageSequence - 1);
@@ -998,8 +1439,18 @@ CL_DemoCompleted
 =================
 */
 
+static qboolean demoAnalyzing;	// demo_analyze reads the demos back to back
+
 void CL_DemoCompleted(void)
 {
+	if(demoAnalyzing)
+	{
+		FS_FCloseFile(clc.demofile);
+		clc.demofile = 0;
+		clc.demoplaying = qfalse;
+		return;
+	}
+
 	if(cl_timedemo && cl_timedemo->integer)
 	{
 		int             time;
@@ -1029,6 +1480,8 @@ void CL_DemoCompleted(void)
 CL_ReadDemoMessage
 =================
 */
+static int      demoStartTime;	// server time of the first snapshot of the demo being played
+
 
 void CL_ReadDemoMessage(void)
 {
@@ -1043,6 +1496,16 @@ void CL_ReadDemoMessage(void)
 		return;
 	}
 
+	if(clc.demoServerDemo)
+	{
+		CL_ReadServerDemoMessage();
+		if(!demoStartTime && cl.snap.valid)
+		{
+			demoStartTime = cl.snap.serverTime;
+		}
+		return;
+	}
+
 	// get the sequence number
 	r = FS_Read(&s, 4, clc.demofile);
 	if(r != 4)
@@ -1067,286 +1530,833 @@ void CL_ReadDemoMessage(void)
 	buf.cursize = LittleLong(buf.cursize);
 	if(buf.cursize == -1)
 	{
+		// the end of a keyframe, go on with the message stream
+		if(clc.demoResumeOffset)
+		{
+			FS_Seek(clc.demofile, clc.demoResumeOffset, FS_SEEK_SET);
+			clc.demoResumeOffset = 0;
+			CL_ReadDemoMessage();
+			return;
+		}
 		CL_DemoCompleted();
 		return;
 	}
-	if(buf.cursize > buf.maxsize)
+	if(buf.cursize > buf.maxsize)
+	{
+		Com_Error(ERR_DROP, "CL_ReadDemoMessage: demoMsglen > MAX_MSGLEN");
+	}
+	r = FS_Read(buf.data, buf.cursize, clc.demofile);
+	if(r != buf.cursize)
+	{
+		Com_Printf("Demo file was truncated.\n");
+		CL_DemoCompleted();
+		return;
+	}
+
+	clc.lastPacketTime = cls.realtime;
+	buf.readcount = 0;
+	CL_ParseServerMessage(&buf);
+
+	if(!demoStartTime && cl.snap.valid)
+	{
+		demoStartTime = cl.snap.serverTime;
+	}
+}
+
+/*
+====================
+
+  Wave file saving functions
+
+  FIXME: make this actually work
+
+====================
+*/
+
+/*
+==================
+CL_DemoFilename
+==================
+*/
+void CL_WavFilename(int number, char *fileName)
+{
+	if(number < 0 || number > 9999)
+	{
+		Com_sprintf(fileName, MAX_OSPATH, "wav9999");	// fretn - removed .tga
+		return;
+	}
+
+	Com_sprintf(fileName, MAX_OSPATH, "wav%04i", number);
+}
+
+typedef struct wav_hdr_s
+{
+	unsigned int    ChunkID;	// big endian
+	unsigned int    ChunkSize;	// little endian
+	unsigned int    Format;		// big endian
+
+	unsigned int    Subchunk1ID;	// big endian
+	unsigned int    Subchunk1Size;	// little endian
+	unsigned short  AudioFormat;	// little endian
+	unsigned short  NumChannels;	// little endian
+	unsigned int    SampleRate;	// little endian
+	unsigned int    ByteRate;	// little endian
+	unsigned short  BlockAlign;	// little endian
+	unsigned short  BitsPerSample;	// little endian
+
+	unsigned int    Subchunk2ID;	// big endian
+	unsigned int    Subchunk2Size;	// little indian ;)
+
+	unsigned int    NumSamples;
+} wav_hdr_t;
+
+wav_hdr_t       hdr;
+
+static void CL_WriteWaveHeader(void)
+{
+	memset(&hdr, 0, sizeof(hdr));
+
+	hdr.ChunkID = 0x46464952;	// "RIFF"
+	hdr.ChunkSize = 0;			// total filesize - 8 bytes
+	hdr.Format = 0x45564157;	// "WAVE"
+
+	hdr.Subchunk1ID = 0x20746d66;	// "fmt "
+	hdr.Subchunk1Size = 16;		// 16 = pcm
+	hdr.AudioFormat = 1;		// 1 = linear quantization
+	hdr.NumChannels = 2;		// 2 = stereo
+
+	hdr.SampleRate = dma.speed;
+
+	hdr.BitsPerSample = 16;		// 16bits
+
+	// SampleRate * NumChannels * BitsPerSample/8
+	hdr.ByteRate = hdr.SampleRate * hdr.NumChannels * (hdr.BitsPerSample / 8);
+
+	// NumChannels * BitsPerSample/8
+	hdr.BlockAlign = hdr.NumChannels * (hdr.BitsPerSample / 8);
+
+	hdr.Subchunk2ID = 0x61746164;	// "data"
+
+	hdr.Subchunk2Size = 0;		// NumSamples * NumChannels * BitsPerSample/8
+
+	// ...
+	FS_Write(&hdr.ChunkID, 44, clc.wavefile);
+}
+
+static char     wavName[MAX_QPATH];	// compiler bug workaround
+void CL_WriteWaveOpen()
+{
+	// we will just save it as a 16bit stereo 22050kz pcm file
+
+	char            name[MAX_OSPATH];
+	int             len;
+	char           *s;
+
+	if(Cmd_Argc() > 2)
+	{
+		Com_Printf("wav_record <wavname>\n");
+		return;
+	}
+
+	if(clc.waverecording)
+	{
+		Com_Printf("Already recording a wav file\n");
+		return;
+	}
+
+	// yes ... no ? leave it up to them imo
+	//if (cl_avidemo.integer)
+	//  return;
+
+	if(Cmd_Argc() == 2)
+	{
+		s = Cmd_Argv(1);
+		Q_strncpyz(wavName, s, sizeof(wavName));
+		Com_sprintf(name, sizeof(name), "wav/%s.wav", wavName);
+	}
+	else
+	{
+		int             number;
+
+		// I STOLE THIS
+		for(number = 0; number <= 9999; number++)
+		{
+			CL_WavFilename(number, wavName);
+			Com_sprintf(name, sizeof(name), "wav/%s.wav", wavName);
+
+			len = FS_FileExists(name);
+			if(len <= 0)
+			{
+				break;			// file doesn't exist
+			}
+		}
+	}
+
+	Com_Printf("recording to %s.\n", name);
+	clc.wavefile = FS_FOpenFileWrite(name);
+
+	if(!clc.wavefile)
+	{
+		Com_Printf("ERROR: couldn't open %s for writing.\n", name);
+		return;
+	}
+
+	CL_WriteWaveHeader();
+	clc.wavetime = -1;
+
+	clc.waverecording = qtrue;
+
+	Cvar_Set("cl_waverecording", "1");
+	Cvar_Set("cl_wavefilename", wavName);
+	Cvar_Set("cl_waveoffset", "0");
+}
+
+void CL_WriteWaveClose()
+{
+	Com_Printf("Stopped recording\n");
+
+	hdr.Subchunk2Size = hdr.NumSamples * hdr.NumChannels * (hdr.BitsPerSample / 8);
+	hdr.ChunkSize = 36 + hdr.Subchunk2Size;
+
+	FS_Seek(clc.wavefile, 4, FS_SEEK_SET);
+	FS_Write(&hdr.ChunkSize, 4, clc.wavefile);
+	FS_Seek(clc.wavefile, 40, FS_SEEK_SET);
+	FS_Write(&hdr.Subchunk2Size, 4, clc.wavefile);
+
+	// and we're outta here
+	FS_FCloseFile(clc.wavefile);
+	clc.wavefile = 0;
+}
+
+/*
+====================
+CL_CompleteDemoName
+====================
+*/
+static void CL_CompleteDemoName( char *args, int argNum )
+{
+	if( argNum == 2 )
+	{
+		char demoExt[ 16 ];
+
+		Com_sprintf( demoExt, sizeof( demoExt ), ".dm_%d", com_protocol->integer );
+		Field_CompleteFilename( "demos", demoExt, qtrue );
+	}
+}
+
+
+
+static char     demoPlayPath[MAX_OSPATH];
+static char     demoPlayArg[MAX_QPATH];
+static int      demoPlayPov;	// client a server demo is played from, -1 for the first one
+
+/*
+====================
+CL_StartDemoPlayback
+
+(Re)starts playing the demo from demoPlayPath.  With a seek time the demo
+is fast forwarded to the first snapshot at or after it, beginning at the
+closest keyframe when useIndex is set.  Returns the number of messages
+that were read, or -1 if the demo ended first.
+====================
+*/
+static int CL_StartDemoPlayback(int seekTime, qboolean useIndex, qboolean loadCGame)
+{
+	const demoKeyframe_t *keyframe;
+	int             numMessages, i;
+
+	if(clc.waverecording)
+	{
+		CL_WriteWaveClose();
+		clc.waverecording = qfalse;
+	}
+
+	CL_Disconnect(qtrue);
+
+	FS_FOpenFileRead(demoPlayPath, &clc.demofile, qtrue);
+	if(!clc.demofile)
+	{
+		Com_Error(ERR_DROP, "couldn't open %s", demoPlayPath);
+		return -1;
+	}
+	Q_strncpyz(clc.demoName, demoPlayArg, sizeof(clc.demoName));
+	CL_OpenServerDemo(demoPlayPov);
+
+	cls.state = CA_CONNECTED;
+	clc.demoplaying = qtrue;
+
+	if(!seekTime && Cvar_VariableValue("cl_wavefilerecord"))
+	{
+		CL_WriteWaveOpen();
+	}
+
+	Q_strncpyz(cls.servername, demoPlayArg, sizeof(cls.servername));
+
+	numMessages = 0;
+	if(!seekTime)
+	{
+		// read demo messages until connected
+		while(cls.state >= CA_CONNECTED && cls.state < CA_PRIMED)
+		{
+			CL_ReadDemoMessage();
+			numMessages++;
+		}
+		// don't get the first snapshot this frame, to prevent the long
+		// time from the gamestate load from messing causing a time skip
+		clc.firstDemoFrameSkipped = qfalse;
+		return numMessages;
+	}
+
+	keyframe = useIndex ? CL_FindDemoKeyframe(seekTime) : NULL;
+	if(keyframe)
+	{
+		FS_Seek(clc.demofile, keyframe->offset, FS_SEEK_SET);
+		clc.demoResumeOffset = keyframe->resume;
+	}
+
+	// parse without a cgame, executing the server commands right away so
+	// the configstrings stay current
+	clc.demoSeekTime = seekTime;
+	while(!cl.snap.valid || cl.snap.serverTime < seekTime)
+	{
+		CL_ReadDemoMessage();
+		if(!clc.demoplaying)
+		{
+			return -1;
+		}
+		numMessages++;
+
+		for(i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++)
+		{
+			CL_GetServerCommand(i);
+		}
+		clc.lastExecutedServerCommand = clc.serverCommandSequence;
+	}
+	clc.demoSeekTime = 0;
+
+	if(loadCGame)
+	{
+		CL_DownloadsComplete();
+		clc.firstDemoFrameSkipped = qfalse;
+	}
+	return numMessages;
+}
+
+/*
+====================
+CL_OpenDemoFile
+
+Looks for a client or server demo of the current or the previous protocol
+====================
+*/
+static int CL_OpenDemoFile(const char *arg, char *name, int nameSize, fileHandle_t * f)
+{
+	static const char *demoExtensions[] = { "dm", "svdm" };
+	char            extension[32];
+	int             prot_ver, len, i;
+
+	*f = 0;
+	len = 0;
+	prot_ver = com_protocol->integer - 1;
+	while(prot_ver <= com_protocol->integer && !*f)
+	{
+		for(i = 0; i < (int)ARRAY_LEN(demoExtensions) && !*f; i++)
+		{
+			Com_sprintf(extension, sizeof(extension), ".%s_%d", demoExtensions[i], prot_ver);
+			if(!Q_stricmp(arg + strlen(arg) - strlen(extension), extension))
+			{
+				Com_sprintf(name, nameSize, "demos/%s", arg);
+			}
+			else
+			{
+				Com_sprintf(name, nameSize, "demos/%s%s", arg, extension);
+			}
+			len = FS_FOpenFileRead(name, f, qtrue);
+		}
+		prot_ver++;
+	}
+	return len;
+}
+
+/*
+====================
+CL_PlayDemo_f
+
+demo <demoname> [clientnum]
+
+The client number picks the view a server demo is played from
+====================
+*/
+void CL_PlayDemo_f(void)
+{
+	char            name[MAX_OSPATH];
+	char           *arg;
+	int             len;
+
+	if(Cmd_Argc() != 2 && Cmd_Argc() != 3)
+	{
+		Com_Printf("playdemo <demoname> [clientnum]\n");
+		return;
+	}
+	demoPlayPov = Cmd_Argc() == 3 ? atoi(Cmd_Argv(2)) : -1;
+
+	// make sure a local server is killed
+	Cvar_Set("sv_killserver", "1");
+
+	CL_Disconnect(qtrue);
+
+
+//  CL_FlushMemory();   //----(SA)  MEM NOTE: in missionpack, this is moved to CL_DownloadsComplete
+
+
+	// open the demo file
+	arg = Cmd_Argv(1);
+	len = CL_OpenDemoFile(arg, name, sizeof(name), &clc.demofile);
+	if(!clc.demofile)
+	{
+		Com_Error(ERR_DROP, "couldn't open %s", name);
+		return;
+	}
+
+	// look for the keyframes of a seekable demo
+	CL_ReadDemoIndex(clc.demofile, len);
+	FS_FCloseFile(clc.demofile);
+	clc.demofile = 0;
+
+	Q_strncpyz(demoPlayPath, name, sizeof(demoPlayPath));
+	Q_strncpyz(demoPlayArg, arg, sizeof(demoPlayArg));
+	demoStartTime = demoPlayIndex.startTime;
+
+	Con_Close();
+
+	CL_StartDemoPlayback(0, qfalse, qtrue);
+}
+
+/*
+====================
+CL_ParseDemoTime
+
+Turns a demo_seek argument into a server time
+====================
+*/
+static int CL_ParseDemoTime(const char *s)
+{
+	const char     *colon;
+	float           seconds;
+
+	if(*s == '+' || *s == '-')
+	{
+		return cl.snap.serverTime + (int)(atof(s) * 1000);
+	}
+
+	colon = strchr(s, ':');
+	if(colon)
+	{
+		seconds = atoi(s) * 60 + atof(colon + 1);
+	}
+	else
+	{
+		seconds = atof(s);
+	}
+	return demoStartTime + (int)(seconds * 1000);
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demo_seek <[+|-]seconds|mm:ss>
+====================
+*/
+void CL_DemoSeek_f(void)
+{
+	const demoKeyframe_t *keyframe;
+	int             seekTime, start, numMessages, time;
+
+	if(Cmd_Argc() != 2)
+	{
+		Com_Printf("demo_seek <[+|-]seconds|mm:ss>\n");
+		return;
+	}
+
+	if(!clc.demoplaying || cls.state != CA_ACTIVE)
+	{
+		Com_Printf("Not playing a demo.\n");
+		return;
+	}
+
+	seekTime = CL_ParseDemoTime(Cmd_Argv(1));
+	if(seekTime < demoStartTime)
+	{
+		seekTime = demoStartTime;
+	}
+	if(demoPlayIndex.numKeyframes && seekTime > demoPlayIndex.endTime)
 	{
-		Com_Error(ERR_DROP, "CL_ReadDemoMessage: demoMsglen > MAX_MSGLEN");
+		seekTime = demoPlayIndex.endTime;
 	}
-	r = FS_Read(buf.data, buf.cursize, clc.demofile);
-	if(r != buf.cursize)
+	seekTime = MAX(seekTime, 1);
+
+	keyframe = CL_FindDemoKeyframe(seekTime);
+
+	start = Sys_Milliseconds();
+	numMessages = CL_StartDemoPlayback(seekTime, qtrue, qtrue);
+	if(numMessages < 0)
 	{
-		Com_Printf("Demo file was truncated.\n");
-		CL_DemoCompleted();
 		return;
 	}
 
-	clc.lastPacketTime = cls.realtime;
-	buf.readcount = 0;
-	CL_ParseServerMessage(&buf);
+	time = (cl.snap.serverTime - demoStartTime) / 1000;
+	Com_Printf("demo_seek: %i:%02i reached in %i msec, %i messages read from %s\n", time / 60, time % 60,
+			   Sys_Milliseconds() - start, numMessages, keyframe ? "a keyframe" : "the start");
 }
 
 /*
 ====================
+CL_DemoSeekBench_f
 
-  Wave file saving functions
-
-  FIXME: make this actually work
-
+Fast forwards to the end of the demo with and without the keyframes
 ====================
 */
-
-/*
-==================
-CL_DemoFilename
-==================
-*/
-void CL_WavFilename(int number, char *fileName)
+void CL_DemoSeekBench_f(void)
 {
-	if(number < 0 || number > 9999)
+	int             returnTime, start, indexTime, fullTime, indexMessages, fullMessages;
+
+	if(!clc.demoplaying || cls.state != CA_ACTIVE)
 	{
-		Com_sprintf(fileName, MAX_OSPATH, "wav9999");	// fretn - removed .tga
+		Com_Printf("Not playing a demo.\n");
 		return;
 	}
 
-	Com_sprintf(fileName, MAX_OSPATH, "wav%04i", number);
-}
-
-typedef struct wav_hdr_s
-{
-	unsigned int    ChunkID;	// big endian
-	unsigned int    ChunkSize;	// little endian
-	unsigned int    Format;		// big endian
-
-	unsigned int    Subchunk1ID;	// big endian
-	unsigned int    Subchunk1Size;	// little endian
-	unsigned short  AudioFormat;	// little endian
-	unsigned short  NumChannels;	// little endian
-	unsigned int    SampleRate;	// little endian
-	unsigned int    ByteRate;	// little endian
-	unsigned short  BlockAlign;	// little endian
-	unsigned short  BitsPerSample;	// little endian
-
-	unsigned int    Subchunk2ID;	// big endian
-	unsigned int    Subchunk2Size;	// little indian ;)
-
-	unsigned int    NumSamples;
-} wav_hdr_t;
+	if(!demoPlayIndex.numKeyframes)
+	{
+		Com_Printf("The demo has no keyframes.\n");
+		return;
+	}
 
-wav_hdr_t       hdr;
+	returnTime = MAX(cl.snap.serverTime, 1);
 
-static void CL_WriteWaveHeader(void)
-{
-	memset(&hdr, 0, sizeof(hdr));
+	start = Sys_Milliseconds();
+	indexMessages = CL_StartDemoPlayback(demoPlayIndex.endTime, qtrue, qfalse);
+	indexTime = Sys_Milliseconds() - start;
+	if(indexMessages < 0)
+	{
+		return;
+	}
 
-	hdr.ChunkID = 0x46464952;	// "RIFF"
-	hdr.ChunkSize = 0;			// total filesize - 8 bytes
-	hdr.Format = 0x45564157;	// "WAVE"
+	start = Sys_Milliseconds();
+	fullMessages = CL_StartDemoPlayback(demoPlayIndex.endTime, qfalse, qfalse);
+	fullTime = Sys_Milliseconds() - start;
+	if(fullMessages < 0)
+	{
+		return;
+	}
 
-	hdr.Subchunk1ID = 0x20746d66;	// "fmt "
-	hdr.Subchunk1Size = 16;		// 16 = pcm
-	hdr.AudioFormat = 1;		// 1 = linear quantization
-	hdr.NumChannels = 2;		// 2 = stereo
+	Com_Printf("seek to the end with keyframes: %i msec, %i messages\n", indexTime, indexMessages);
+	Com_Printf("seek to the end from the start: %i msec, %i messages\n", fullTime, fullMessages);
 
-	hdr.SampleRate = dma.speed;
+	CL_StartDemoPlayback(returnTime, qtrue, qtrue);
+}
 
-	hdr.BitsPerSample = 16;		// 16bits
+/*
+=======================================================================
 
-	// SampleRate * NumChannels * BitsPerSample/8
-	hdr.ByteRate = hdr.SampleRate * hdr.NumChannels * (hdr.BitsPerSample / 8);
+Demo analysis
 
-	// NumChannels * BitsPerSample/8
-	hdr.BlockAlign = hdr.NumChannels * (hdr.BitsPerSample / 8);
+demo_analyze reads demos as fast as they parse, through the regular
+message parsing but without a cgame, renderer or sound, and writes what
+happens in them to analysis/<demo>.jsonl, one JSON object per line:
 
-	hdr.Subchunk2ID = 0x61746164;	// "data"
+  {"type":"gamestate","message":N,"serverId":N,"map":"..."}
+  {"type":"command","time":T,"sequence":N,"text":"..."}
+  {"type":"snapshot","time":T,"message":N,"clientNum":N,"origin":[x,y,z],
+   "weapon":N,"stats":[...],"entities":N}
+  {"type":"event","time":T,"entity":N,"event":N,"parm":N,"origin":[x,y,z]}
 
-	hdr.Subchunk2Size = 0;		// NumSamples * NumChannels * BitsPerSample/8
+Events are the pmove events of the player and the entities, and the
+freestanding event entities, each reported once when it shows up.
 
-	// ...
-	FS_Write(&hdr.ChunkID, 44, clc.wavefile);
-}
+=======================================================================
+*/
 
-static char     wavName[MAX_QPATH];	// compiler bug workaround
-void CL_WriteWaveOpen()
+typedef struct
 {
-	// we will just save it as a 16bit stereo 22050kz pcm file
+	fileHandle_t    file;
+	int             serverId;
+	int             lastMessageNum;
+	int             playerEventSequence;
+	int             eventSequences[MAX_GENTITIES];
+	int             eventTypes[MAX_GENTITIES];	// eType of the event entities seen in the last snapshot
+	int             numSnapshots;
+	int             numEvents;
+} demoAnalysis_t;
 
-	char            name[MAX_OSPATH];
-	int             len;
-	char           *s;
+static demoAnalysis_t demoAnalysis;
 
-	if(Cmd_Argc() > 2)
-	{
-		Com_Printf("wav_record <wavname>\n");
-		return;
-	}
+extern jmp_buf  abortframe;
+extern char     com_errorMessage[];
 
-	if(clc.waverecording)
-	{
-		Com_Printf("Already recording a wav file\n");
-		return;
-	}
+/*
+====================
+CL_JSONString
 
-	// yes ... no ? leave it up to them imo
-	//if (cl_avidemo.integer)
-	//  return;
+Quotes and escapes a string for the analysis output
+====================
+*/
+static const char *CL_JSONString(const char *in)
+{
+	static char     out[MAX_STRING_CHARS * 2];
+	char           *o;
 
-	if(Cmd_Argc() == 2)
-	{
-		s = Cmd_Argv(1);
-		Q_strncpyz(wavName, s, sizeof(wavName));
-		Com_sprintf(name, sizeof(name), "wav/%s.wav", wavName);
-	}
-	else
+	o = out;
+	*o++ = '"';
+	for(; *in && o < out + sizeof(out) - 8; in++)
 	{
-		int             number;
-
-		// I STOLE THIS
-		for(number = 0; number <= 9999; number++)
+		if(*in == '"' || *in == '\\')
 		{
-			CL_WavFilename(number, wavName);
-			Com_sprintf(name, sizeof(name), "wav/%s.wav", wavName);
-
-			len = FS_FileExists(name);
-			if(len <= 0)
-			{
-				break;			// file doesn't exist
-			}
+			*o++ = '\\';
+			*o++ = *in;
+		}
+		else if((byte)*in < ' ' || (byte)*in >= 0x80)
+		{
+			// the strings are bytes rather than UTF-8, each one becomes the code point of the same value
+			o += Com_sprintf(o, 7, "\\u%04x", (byte)*in);
+		}
+		else
+		{
+			*o++ = *in;
 		}
 	}
+	*o++ = '"';
+	*o = '\0';
 
-	Com_Printf("recording to %s.\n", name);
-	clc.wavefile = FS_FOpenFileWrite(name);
-
-	if(!clc.wavefile)
-	{
-		Com_Printf("ERROR: couldn't open %s for writing.\n", name);
-		return;
-	}
-
-	CL_WriteWaveHeader();
-	clc.wavetime = -1;
-
-	clc.waverecording = qtrue;
-
-	Cvar_Set("cl_waverecording", "1");
-	Cvar_Set("cl_wavefilename", wavName);
-	Cvar_Set("cl_waveoffset", "0");
+	return out;
 }
 
-void CL_WriteWaveClose()
+/*
+====================
+CL_AnalyzeEvent
+====================
+*/
+static void CL_AnalyzeEvent(int entityNum, int event, int parm, const vec3_t origin)
 {
-	Com_Printf("Stopped recording\n");
+	demoAnalysis.numEvents++;
+	FS_Printf(demoAnalysis.file, "{\"type\":\"event\",\"time\":%i,\"entity\":%i,\"event\":%i,\"parm\":%i,"
+			  "\"origin\":[%.1f,%.1f,%.1f]}\n", cl.snap.serverTime, entityNum, event, parm, origin[0], origin[1], origin[2]);
+}
 
-	hdr.Subchunk2Size = hdr.NumSamples * hdr.NumChannels * (hdr.BitsPerSample / 8);
-	hdr.ChunkSize = 36 + hdr.Subchunk2Size;
+/*
+====================
+CL_AnalyzeSequencedEvents
 
-	FS_Seek(clc.wavefile, 4, FS_SEEK_SET);
-	FS_Write(&hdr.ChunkSize, 4, clc.wavefile);
-	FS_Seek(clc.wavefile, 40, FS_SEEK_SET);
-	FS_Write(&hdr.Subchunk2Size, 4, clc.wavefile);
+Reports the events added to a pmove event queue since the last snapshot
+====================
+*/
+static void CL_AnalyzeSequencedEvents(int entityNum, int *lastSequence, int sequence, const int *events,
+									  const int *parms, const vec3_t origin)
+{
+	int             i;
 
-	// and we're outta here
-	FS_FCloseFile(clc.wavefile);
-	clc.wavefile = 0;
+	// the sequence starts over when an entity is reused
+	if(sequence < *lastSequence || sequence - *lastSequence > MAX_EVENTS)
+	{
+		*lastSequence = sequence - MAX_EVENTS;
+	}
+	for(i = MAX(*lastSequence, 0); i < sequence; i++)
+	{
+		CL_AnalyzeEvent(entityNum, events[i & (MAX_EVENTS - 1)], parms[i & (MAX_EVENTS - 1)], origin);
+	}
+	*lastSequence = sequence;
 }
 
 /*
 ====================
-CL_CompleteDemoName
+CL_AnalyzeMessage
+
+Reports what the last parsed demo message changed
 ====================
 */
-static void CL_CompleteDemoName( char *args, int argNum )
+static void CL_AnalyzeMessage(void)
 {
-	if( argNum == 2 )
+	entityState_t  *es;
+	playerState_t  *ps;
+	int             eventTypes[MAX_GENTITIES];
+	int             i;
+
+	// a new gamestate wipes the client state
+	if(cl.serverId != demoAnalysis.serverId || cl.snap.messageNum < demoAnalysis.lastMessageNum)
 	{
-		char demoExt[ 16 ];
+		demoAnalysis.serverId = cl.serverId;
+		demoAnalysis.lastMessageNum = 0;
+		demoAnalysis.playerEventSequence = 0;
+		Com_Memset(demoAnalysis.eventSequences, 0, sizeof(demoAnalysis.eventSequences));
+		Com_Memset(demoAnalysis.eventTypes, 0, sizeof(demoAnalysis.eventTypes));
 
-		Com_sprintf( demoExt, sizeof( demoExt ), ".dm_%d", com_protocol->integer );
-		Field_CompleteFilename( "demos", demoExt, qtrue );
+		FS_Printf(demoAnalysis.file, "{\"type\":\"gamestate\",\"message\":%i,\"serverId\":%i,\"map\":%s}\n",
+				  clc.serverMessageSequence, cl.serverId,
+				  CL_JSONString(Info_ValueForKey(cl.gameState.stringData + cl.gameState.stringOffsets[CS_SERVERINFO], "mapname")));
 	}
-}
 
+	for(i = clc.lastExecutedServerCommand + 1; i <= clc.serverCommandSequence; i++)
+	{
+		FS_Printf(demoAnalysis.file, "{\"type\":\"command\",\"time\":%i,\"sequence\":%i,\"text\":%s}\n",
+				  cl.snap.serverTime, i, CL_JSONString(CL_GetReliableServerCommand(i)));
+		CL_GetServerCommand(i);
+	}
+	clc.lastExecutedServerCommand = clc.serverCommandSequence;
+
+	if(!cl.snap.valid || cl.snap.messageNum <= demoAnalysis.lastMessageNum)
+	{
+		return;
+	}
+	demoAnalysis.lastMessageNum = cl.snap.messageNum;
+	demoAnalysis.numSnapshots++;
+
+	ps = &cl.snap.ps;
+	FS_Printf(demoAnalysis.file, "{\"type\":\"snapshot\",\"time\":%i,\"message\":%i,\"clientNum\":%i,"
+			  "\"origin\":[%.1f,%.1f,%.1f],\"weapon\":%i,\"stats\":[", cl.snap.serverTime, cl.snap.messageNum,
+			  ps->clientNum, ps->origin[0], ps->origin[1], ps->origin[2], ps->weapon);
+	for(i = 0; i < MAX_STATS; i++)
+	{
+		FS_Printf(demoAnalysis.file, i ? ",%i" : "%i", ps->stats[i]);
+	}
+	FS_Printf(demoAnalysis.file, "],\"entities\":%i}\n", cl.snap.numEntities);
+
+	CL_AnalyzeSequencedEvents(ps->clientNum, &demoAnalysis.playerEventSequence, ps->eventSequence, ps->events,
+							  ps->eventParms, ps->origin);
+
+	Com_Memset(eventTypes, 0, sizeof(eventTypes));
+	for(i = 0; i < cl.snap.numEntities; i++)
+	{
+		es = &cl.parseEntities[(cl.snap.parseEntitiesNum + i) & (MAX_PARSE_ENTITIES - 1)];
+
+		// event entities stay around for a few snapshots
+		if(es->eType >= ET_EVENTS)
+		{
+			eventTypes[es->number] = es->eType;
+			if(demoAnalysis.eventTypes[es->number] != es->eType)
+			{
+				CL_AnalyzeEvent(es->number, es->eType - ET_EVENTS, es->eventParm, es->pos.trBase);
+			}
+			continue;
+		}
 
+		if(es->number != ps->clientNum)
+		{
+			CL_AnalyzeSequencedEvents(es->number, &demoAnalysis.eventSequences[es->number], es->eventSequence, es->events,
+									  es->eventParms, es->pos.trBase);
+		}
+	}
+	Com_Memcpy(demoAnalysis.eventTypes, eventTypes, sizeof(eventTypes));
+}
 
 /*
 ====================
-CL_PlayDemo_f
+CL_AnalyzeDemo_f
 
-demo <demoname>
+demo_analyze <demoname> [demoname...]
 
+This is a client command, the demos are parsed by the full client and
+a dedicated server can't analyze them. A demo that fails to parse ends
+in a Com_Error, which stops that demo and goes on with the next one.
 ====================
 */
-void CL_PlayDemo_f(void)
+void CL_AnalyzeDemo_f(void)
 {
-	char            name[MAX_OSPATH], extension[32];
-	char           *arg;
-	int             prot_ver;
+	char            name[MAX_OSPATH], outName[MAX_OSPATH];
+	jmp_buf         savedAbortFrame;
+	volatile int    i, totalTime, totalSnapshots, numDemos;
+	int             start, time;
 
-	if(Cmd_Argc() != 2)
+	if(Cmd_Argc() < 2)
 	{
-		Com_Printf("playdemo <demoname>\n");
+		Com_Printf("demo_analyze <demoname> [demoname...]\n");
 		return;
 	}
 
 	// make sure a local server is killed
 	Cvar_Set("sv_killserver", "1");
 
-	CL_Disconnect(qtrue);
-
+	totalTime = 0;
+	totalSnapshots = 0;
+	numDemos = 0;
+	for(i = 1; i < Cmd_Argc(); i++)
+	{
+		CL_Disconnect(qfalse);
 
-//  CL_FlushMemory();   //----(SA)  MEM NOTE: in missionpack, this is moved to CL_DownloadsComplete
+		CL_OpenDemoFile(Cmd_Argv(i), name, sizeof(name), &clc.demofile);
+		if(!clc.demofile)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: couldn't open %s\n", name);
+			continue;
+		}
 
+		COM_StripExtension3(COM_SkipPath(name), outName, sizeof(outName));
+		Com_Memset(&demoAnalysis, 0, sizeof(demoAnalysis));
+		demoAnalysis.file = FS_FOpenFileWrite(va("analysis/%s.jsonl", outName));
+		if(!demoAnalysis.file)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: couldn't write analysis/%s.jsonl\n", outName);
+			FS_FCloseFile(clc.demofile);
+			clc.demofile = 0;
+			continue;
+		}
 
-	// open the demo file
-	arg = Cmd_Argv(1);
-	prot_ver = com_protocol->integer - 1;
-	while(prot_ver <= com_protocol->integer && !clc.demofile)
-	{
-		Com_sprintf(extension, sizeof(extension), ".dm_%d", prot_ver);
-		if(!Q_stricmp(arg + strlen(arg) - strlen(extension), extension))
+		// an error while parsing drops back here instead of out of the frame
+		Com_Memcpy(savedAbortFrame, abortframe, sizeof(jmp_buf));
+		if(setjmp(abortframe))
 		{
-			Com_sprintf(name, sizeof(name), "demos/%s", arg);
+			// Com_Error already disconnected, which closed the demo
+			Com_Memcpy(abortframe, savedAbortFrame, sizeof(jmp_buf));
+			demoAnalyzing = qfalse;
+			clc.demoSeekTime = 0;
+			FS_FCloseFile(demoAnalysis.file);
+
+			Com_Printf(S_COLOR_YELLOW "WARNING: analysis of %s stopped after %i snapshots: %s\n", name,
+					   demoAnalysis.numSnapshots, com_errorMessage);
+			continue;
 		}
-		else
+
+		Q_strncpyz(clc.demoName, Cmd_Argv(i), sizeof(clc.demoName));
+		CL_OpenServerDemo(-1);
+		cls.state = CA_CONNECTED;
+		clc.demoplaying = qtrue;
+
+		// read to the end as a fast forward that never gets there
+		clc.demoSeekTime = INT_MAX;
+		demoAnalyzing = qtrue;
+
+		start = Sys_Milliseconds();
+		while(clc.demoplaying)
 		{
-			Com_sprintf(name, sizeof(name), "demos/%s.dm_%d", arg, prot_ver);
+			CL_ReadDemoMessage();
+			if(clc.demoplaying)
+			{
+				CL_AnalyzeMessage();
+			}
 		}
-		FS_FOpenFileRead(name, &clc.demofile, qtrue);
-		prot_ver++;
-	}
-	if(!clc.demofile)
-	{
-		Com_Error(ERR_DROP, "couldn't open %s", name);
-		return;
-	}
-	Q_strncpyz(clc.demoName, Cmd_Argv(1), sizeof(clc.demoName));
+		time = Sys_Milliseconds() - start;
 
-	Con_Close();
+		Com_Memcpy(abortframe, savedAbortFrame, sizeof(jmp_buf));
+		demoAnalyzing = qfalse;
+		clc.demoSeekTime = 0;
+		cls.state = CA_DISCONNECTED;
 
-	cls.state = CA_CONNECTED;
-	clc.demoplaying = qtrue;
+		FS_FCloseFile(demoAnalysis.file);
 
-	if(Cvar_VariableValue("cl_wavefilerecord"))
-	{
-		CL_WriteWaveOpen();
+		Com_Printf("%s: %i snapshots, %i events in %i msec, %.0f snapshots/sec\n", name, demoAnalysis.numSnapshots,
+				   demoAnalysis.numEvents, time, demoAnalysis.numSnapshots * 1000.0f / MAX(time, 1));
+		totalTime += time;
+		totalSnapshots += demoAnalysis.numSnapshots;
+		numDemos++;
 	}
 
-	Q_strncpyz(cls.servername, Cmd_Argv(1), sizeof(cls.servername));
+	CL_Disconnect(qfalse);
 
-	// read demo messages until connected
-	while(cls.state >= CA_CONNECTED && cls.state < CA_PRIMED)
+	if(numDemos > 1)
 	{
-		CL_ReadDemoMessage();
+		Com_Printf("%i demos: %i snapshots in %i msec, %.0f snapshots/sec\n", numDemos, totalSnapshots, totalTime,
+				   totalSnapshots * 1000.0f / MAX(totalTime, 1));
 	}
-	// don't get the first snapshot this frame, to prevent the long
-	// time from the gamestate load from messing causing a time skip
-	clc.firstDemoFrameSkipped = qfalse;
-//  if (clc.waverecording) {
-//      CL_WriteWaveClose();
-//      clc.waverecording = qfalse;
-//  }
 }
 
 /*
@@ -1657,6 +2667,7 @@ void CL_Disconnect(qboolean showMainMenu)
 		FS_FCloseFile(clc.demofile);
 		clc.demofile = 0;
 	}
+	CL_FreeServerDemo();
 
 	if(uivm && showMainMenu)
 	{
@@ -2786,6 +3797,12 @@ void CL_DownloadsComplete(void)
 	char           *fs_write_path;
 	char           *fn;
 
+	// a demo that is being fast forwarded loads the cgame once it got there
+	if(clc.demoplaying && clc.demoSeekTime)
+	{
+		return;
+	}
+
 	// DHM - Nerve :: Auto-update (not finished yet)
 	if(autoupdateStarted)
 	{
@@ -3611,6 +4628,7 @@ void CL_PacketEvent( netadr_t from, msg_t *msg ) {
 
 	if ( clc.demorecording && !clc.demowaiting ) {
 		CL_WriteDemoMessage( msg, headerBytes );
+		CL_WriteDemoKeyframe();
 	}
 }
 
@@ -4523,6 +5541,11 @@ void CL_InitRef(const char *renderer)
 	ri.IN_Restart = IN_Restart;
 
 	ri.FS_FCloseFile = FS_FCloseFile;
+	ri.FS_HomeRemove = FS_HomeRemove;
+	ri.FS_HomeReadFile = FS_HomeReadFile;
+	ri.FS_HomeWriteFile = FS_HomeWriteFile;
+	ri.FS_HomeListFiles = FS_HomeListFiles;
+	ri.FS_LoadedPakChecksums = FS_LoadedPakChecksums;
 
 	// Dushan
 	ri.ftol = Q_ftol;
@@ -4786,6 +5809,8 @@ void CL_Init(void)
 	rcon_client_password = Cvar_Get("rconPassword", "", CVAR_TEMP, "test");
 	cl_activeAction = Cvar_Get("activeAction", "", CVAR_TEMP, "test");
 	cl_autorecord = Cvar_Get("cl_autorecord", "0", CVAR_TEMP, "test");
+	cl_demoKeyframeInterval = Cvar_Get("cl_demoKeyframeInterval", "10", CVAR_ARCHIVE,
+		"seconds between the keyframes recorded demos can be seeked to, 0 records plain demos");
 
 	cl_timedemo = Cvar_Get("timedemo", "0", 0, "test");
 	cl_forceavidemo = Cvar_Get("cl_forceavidemo", "0", 0, "test");
@@ -5030,6 +6055,10 @@ void CL_Init(void)
 	Cmd_AddCommand("record", CL_Record_f, "^1Records a demo.");
 	Cmd_AddCommand("demo", CL_PlayDemo_f, "^1Play demo.");
 	Cmd_SetCommandCompletionFunc( "demo", CL_CompleteDemoName );
+	Cmd_AddCommand("demo_seek", CL_DemoSeek_f, "^1Jump to a time of the demo being played (demo_seek [+|-]seconds or mm:ss).");
+	Cmd_AddCommand("demo_seekBench", CL_DemoSeekBench_f, "^1Time seeking to the end of the demo with and without its keyframes.");
+	Cmd_AddCommand("demo_analyze", CL_AnalyzeDemo_f, "^1Write the snapshots and events of demos to analysis/<demo>.jsonl without playing them.");
+	Cmd_SetCommandCompletionFunc( "demo_analyze", CL_CompleteDemoName );
 	Cmd_AddCommand("cinematic", CL_PlayCinematic_f, "^1Play the OpenWolf movie RoQ files (cinematic intro.RoQ).");
 	Cmd_AddCommand("stoprecord", CL_StopRecord_f, "^1Stop recording a demo.");
 	Cmd_AddCommand("connect", CL_Connect_f, "^1Connect to server (connect xx.xxx.xx.xx) or (connect serverURL.com).");
@@ -5147,6 +6176,9 @@ void CL_Shutdown(void) {
 	Cmd_RemoveCommand("disconnect");
 	Cmd_RemoveCommand("record");
 	Cmd_RemoveCommand("demo");
+	Cmd_RemoveCommand("demo_seek");
+	Cmd_RemoveCommand("demo_seekBench");
+	Cmd_RemoveCommand("demo_analyze");
 	Cmd_RemoveCommand("cinematic");
 	Cmd_RemoveCommand("stoprecord");
 	Cmd_RemoveCommand("connect");
@@ -5185,29 +6217,34 @@ void CL_Shutdown(void) {
 
 static void CL_SetServerInfo(serverInfo_t * server, const char *info, int ping)
 {
+	static infoCache_t cache;
+
 	if(server)
 	{
 		if(info)
 		{
-			server->clients = atoi(Info_ValueForKey(info, "clients"));
-			Q_strncpyz(server->hostName, Info_ValueForKey(info, "hostname"), MAX_NAME_LENGTH);
-			server->load = atoi(Info_ValueForKey(info, "serverload"));
-			Q_strncpyz(server->mapName, Info_ValueForKey(info, "mapname"), MAX_NAME_LENGTH);
-			server->maxClients = atoi(Info_ValueForKey(info, "sv_maxclients"));
-			Q_strncpyz(server->game, Info_ValueForKey(info, "game"), MAX_NAME_LENGTH);
-			server->gameType = atoi(Info_ValueForKey(info, "gametype"));
-			server->netType = atoi(Info_ValueForKey(info, "nettype"));
-			server->minPing = atoi(Info_ValueForKey(info, "minping"));
-			server->maxPing = atoi(Info_ValueForKey(info, "maxping"));
-			server->allowAnonymous = atoi(Info_ValueForKey(info, "sv_allowAnonymous"));
-			server->friendlyFire = atoi(Info_ValueForKey(info, "friendlyFire"));	// NERVE - SMF
-			server->maxlives = atoi(Info_ValueForKey(info, "maxlives"));	// NERVE - SMF
-			server->needpass = atoi(Info_ValueForKey(info, "needpass"));	// NERVE - SMF
-			server->punkbuster = atoi(Info_ValueForKey(info, "punkbuster"));	// DHM - Nerve
-			Q_strncpyz(server->gameName, Info_ValueForKey(info, "gamename"), MAX_NAME_LENGTH);	// Arnout
-			server->antilag = atoi(Info_ValueForKey(info, "g_antilag"));
-			server->weaprestrict = atoi(Info_ValueForKey(info, "weaprestrict"));
-			server->balancedteams = atoi(Info_ValueForKey(info, "balancedteams"));
+			// the packet buffer is reused, so always parse it again
+			Info_CacheParse(&cache, info);
+
+			server->clients = atoi(Info_CacheValueForKey(&cache, info, "clients"));
+			Q_strncpyz(server->hostName, Info_CacheValueForKey(&cache, info, "hostname"), MAX_NAME_LENGTH);
+			server->load = atoi(Info_CacheValueForKey(&cache, info, "serverload"));
+			Q_strncpyz(server->mapName, Info_CacheValueForKey(&cache, info, "mapname"), MAX_NAME_LENGTH);
+			server->maxClients = atoi(Info_CacheValueForKey(&cache, info, "sv_maxclients"));
+			Q_strncpyz(server->game, Info_CacheValueForKey(&cache, info, "game"), MAX_NAME_LENGTH);
+			server->gameType = atoi(Info_CacheValueForKey(&cache, info, "gametype"));
+			server->netType = atoi(Info_CacheValueForKey(&cache, info, "nettype"));
+			server->minPing = atoi(Info_CacheValueForKey(&cache, info, "minping"));
+			server->maxPing = atoi(Info_CacheValueForKey(&cache, info, "maxping"));
+			server->allowAnonymous = atoi(Info_CacheValueForKey(&cache, info, "sv_allowAnonymous"));
+			server->friendlyFire = atoi(Info_CacheValueForKey(&cache, info, "friendlyFire"));	// NERVE - SMF
+			server->maxlives = atoi(Info_CacheValueForKey(&cache, info, "maxlives"));	// NERVE - SMF
+			server->needpass = atoi(Info_CacheValueForKey(&cache, info, "needpass"));	// NERVE - SMF
+			server->punkbuster = atoi(Info_CacheValueForKey(&cache, info, "punkbuster"));	// DHM - Nerve
+			Q_strncpyz(server->gameName, Info_CacheValueForKey(&cache, info, "gamename"), MAX_NAME_LENGTH);	// Arnout
+			server->antilag = atoi(Info_CacheValueForKey(&cache, info, "g_antilag"));
+			server->weaprestrict = atoi(Info_CacheValueForKey(&cache, info, "weaprestrict"));
+			server->balancedteams = atoi(Info_CacheValueForKey(&cache, info, "balancedteams"));
 		}
 		server->ping = ping;
 	}
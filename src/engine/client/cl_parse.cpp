@@ -582,17 +582,19 @@ gamestate, and possibly during gameplay.
 void            CL_PurgeCache(void);
 void CL_SystemInfoChanged(void)
 {
+	static infoCache_t info;
 	char           *systemInfo;
 	const char     *s, *t;
 	char            key[BIG_INFO_KEY];
 	char            value[BIG_INFO_VALUE];
 
 	systemInfo = cl.gameState.stringData + cl.gameState.stringOffsets[CS_SYSTEMINFO];
+	Info_CacheParse(&info, systemInfo);
 	// NOTE TTimo:
 	// when the serverId changes, any further messages we send to the server will use this new serverId
 	// show_bug.cgi?id=475
 	// in some cases, outdated cp commands might get sent with this news serverId
-	cl.serverId = atoi(Info_ValueForKey(systemInfo, "sv_serverid"));
+	cl.serverId = atoi(Info_CacheValueForKey(&info, systemInfo, "sv_serverid"));
 
 	memset(&entLastVisible, 0, sizeof(entLastVisible));
 
@@ -602,11 +604,11 @@ void CL_SystemInfoChanged(void)
 	}
 	
 #ifdef USE_VOIP
-	s = Info_ValueForKey( systemInfo, "sv_voip" );
+	s = Info_CacheValueForKey( &info, systemInfo, "sv_voip" );
 	clc.voipEnabled = (qboolean)atoi(s);
 #endif	
 
-	s = Info_ValueForKey(systemInfo, "sv_cheats");
+	s = Info_CacheValueForKey(&info, systemInfo, "sv_cheats");
 	//sv_cheats = (qboolean)atoi(s);		//bani
 	if(atoi(s) == 0)
 	{
@@ -614,12 +616,12 @@ void CL_SystemInfoChanged(void)
 	}
 
 	// check pure server string
-	s = Info_ValueForKey(systemInfo, "sv_paks");
-	t = Info_ValueForKey(systemInfo, "sv_pakNames");
+	s = Info_CacheValueForKey(&info, systemInfo, "sv_paks");
+	t = Info_CacheValueForKey(&info, systemInfo, "sv_pakNames");
 	FS_PureServerSetLoadedPaks(s, t);
 
-	s = Info_ValueForKey(systemInfo, "sv_referencedPaks");
-	t = Info_ValueForKey(systemInfo, "sv_referencedPakNames");
+	s = Info_CacheValueForKey(&info, systemInfo, "sv_referencedPaks");
+	t = Info_CacheValueForKey(&info, systemInfo, "sv_referencedPakNames");
 	FS_PureServerSetReferencedPaks(s, t);
 
 	// scan through all the variables in the systeminfo and locally set cvars to match
@@ -679,6 +681,13 @@ void CL_ParseGamestate(msg_t * msg)
 	// a gamestate always marks a server command sequence
 	clc.serverCommandSequence = MSG_ReadLong(msg);
 
+	// while a demo is fast forwarded the commands before the gamestate
+	// are gone, and there is no cgame that could execute them
+	if(clc.demoSeekTime)
+	{
+		clc.lastExecutedServerCommand = clc.serverCommandSequence;
+	}
+
 	// parse all the configstrings and baselines
 	cl.gameState.dataCount = 1;	// leave a 0 at the beginning for uninitialized configstrings
 	while(1)
@@ -1174,6 +1183,12 @@ void CL_ParseBinaryMessage(msg_t * msg)
 		return;
 	}
 
+	// no cgame while a demo is fast forwarded
+	if(clc.demoSeekTime)
+	{
+		return;
+	}
+
 	CL_CGameBinaryMessageReceived((char *)&msg->data[msg->readcount], size, cl.snap.serverTime);
 }
 
@@ -0,0 +1,590 @@
+/*
+===========================================================================
+
+OpenWolf GPL Source Code
+Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company. 
+
+This file is part of the OpenWolf GPL Source Code (OpenWolf Source Code).  
+
+OpenWolf Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenWolf Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenWolf Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the OpenWolf Source Code is also subject to certain additional terms. 
+You should have received a copy of these additional terms immediately following the 
+terms and conditions of the GNU General Public License which accompanied the OpenWolf 
+Source Code.  If not, please request a copy in writing from id Software at the address 
+below.
+
+If you have questions concerning this license or the applicable additional terms, you 
+may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, 
+Maryland 20850 USA.
+
+===========================================================================
+*/
+
+
+// cl_svdemo.c -- plays server side demos from the view of one client
+
+#include "../idLib/precompiled.h"
+#include "client.h"
+
+/*
+=============================================================================
+
+A server side demo holds the playerstates of all clients and every entity
+of the game.  Playback rebuilds the messages the server would have sent
+the chosen client from it and hands them to the normal message parsing,
+so the rest of the client doesn't know it isn't a client demo.
+
+Nothing is culled by the PVS, the areamask marks every area as visible.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	int             pov;						// client the demo is played from, -1 until the first frame
+	int             maxClients;
+	int             messageNum;
+	int             serverCommandSequence;
+
+	entityState_t   baselines[MAX_GENTITIES];
+
+	qboolean        psValid[MAX_CLIENTS];
+	playerState_t   ps[MAX_CLIENTS];
+	entityState_t   entities[2][MAX_GENTITIES];	// everything in this and the last frame
+	int             numEntities[2];
+	int             current;
+
+	byte            filterType[MAX_GENTITIES];
+	int             filterValue[MAX_GENTITIES][2];
+
+	// the last snapshot sent to the client, for delta compression
+	int             snapMessageNum;
+	playerState_t   snapPs;
+	entityState_t   snapEntities[2][MAX_GENTITIES];
+	int             numSnapEntities[2];
+	int             snapCurrent;
+
+	byte            block[SVDEMO_BLOCKLEN];
+} serverDemo_t;
+
+static serverDemo_t *serverDemo;
+
+
+/*
+====================
+CL_OpenServerDemo
+
+Checks the demo file for the server demo header and starts playing it
+from the view of the given client, -1 picks the first one in the game
+====================
+*/
+qboolean CL_OpenServerDemo(int pov)
+{
+	int             header[3];
+
+	if(FS_Read(header, sizeof(header), clc.demofile) != sizeof(header) || LittleLong(header[0]) != SVDEMO_MAGIC)
+	{
+		FS_Seek(clc.demofile, 0, FS_SEEK_SET);
+		clc.demoServerDemo = qfalse;
+		return qfalse;
+	}
+
+	if(LittleLong(header[1]) != com_protocol->integer)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: server demo of protocol %i\n", LittleLong(header[1]));
+	}
+
+	if(!serverDemo)
+	{
+		serverDemo = (serverDemo_t *) Z_Malloc(sizeof(*serverDemo));
+	}
+	Com_Memset(serverDemo, 0, sizeof(*serverDemo));
+
+	serverDemo->maxClients = LittleLong(header[2]);
+	if(serverDemo->maxClients < 1 || serverDemo->maxClients > MAX_CLIENTS)
+	{
+		Com_Error(ERR_DROP, "CL_OpenServerDemo: bad maxclients %i", serverDemo->maxClients);
+	}
+	if(pov >= serverDemo->maxClients)
+	{
+		Com_Error(ERR_DROP, "CL_OpenServerDemo: no client %i in a game of %i", pov, serverDemo->maxClients);
+	}
+	serverDemo->pov = pov;
+
+	clc.demoServerDemo = qtrue;
+	return qtrue;
+}
+
+/*
+====================
+CL_FreeServerDemo
+====================
+*/
+void CL_FreeServerDemo(void)
+{
+	if(serverDemo)
+	{
+		Z_Free(serverDemo);
+		serverDemo = NULL;
+	}
+	clc.demoServerDemo = qfalse;
+}
+
+/*
+====================
+CL_ServerDemoCommand
+====================
+*/
+static void CL_ServerDemoCommand(msg_t * out, const char *cmd)
+{
+	MSG_WriteByte(out, svc_serverCommand);
+	MSG_WriteLong(out, ++serverDemo->serverCommandSequence);
+	MSG_WriteString(out, cmd);
+}
+
+/*
+====================
+CL_ServerDemoGamestate
+====================
+*/
+static void CL_ServerDemoGamestate(msg_t * in, msg_t * out)
+{
+	entityState_t   nullstate;
+	int             checksumFeed, i, newnum;
+
+	checksumFeed = MSG_ReadLong(in);
+
+	MSG_WriteByte(out, svc_gamestate);
+	MSG_WriteLong(out, serverDemo->serverCommandSequence);
+
+	while(1)
+	{
+		i = MSG_ReadShort(in);
+		if(i < 0 || i >= MAX_CONFIGSTRINGS)
+		{
+			break;
+		}
+		MSG_WriteByte(out, svc_configstring);
+		MSG_WriteShort(out, i);
+		MSG_WriteBigString(out, MSG_ReadBigString(in));
+	}
+
+	Com_Memset(&nullstate, 0, sizeof(nullstate));
+	Com_Memset(serverDemo->baselines, 0, sizeof(serverDemo->baselines));
+	while(1)
+	{
+		newnum = MSG_ReadBits(in, GENTITYNUM_BITS);
+		if(newnum == MAX_GENTITIES - 1)
+		{
+			break;
+		}
+		MSG_ReadDeltaEntity(in, &nullstate, &serverDemo->baselines[newnum], newnum);
+
+		MSG_WriteByte(out, svc_baseline);
+		MSG_WriteDeltaEntity(out, &nullstate, &serverDemo->baselines[newnum], qtrue);
+	}
+	MSG_WriteByte(out, svc_EOF);
+
+	MSG_WriteLong(out, serverDemo->pov >= 0 ? serverDemo->pov : 0);
+	MSG_WriteLong(out, checksumFeed);
+
+	// a new map, nothing to delta from
+	serverDemo->numEntities[serverDemo->current] = 0;
+	serverDemo->snapMessageNum = 0;
+	serverDemo->numSnapEntities[serverDemo->snapCurrent] = 0;
+}
+
+/*
+====================
+CL_ServerDemoConfigstring
+
+Turns a configstring change into the commands the server sends for it
+====================
+*/
+static void CL_ServerDemoConfigstring(msg_t * in, msg_t * out)
+{
+	char            buf[MAX_STRING_CHARS];
+	const char     *cmd;
+	char           *s;
+	int             index, len, sent, remaining, maxChunkSize;
+
+	index = MSG_ReadShort(in);
+	s = MSG_ReadBigString(in);
+
+	maxChunkSize = MAX_STRING_CHARS - 24;
+	len = strlen(s);
+	if(len < maxChunkSize)
+	{
+		CL_ServerDemoCommand(out, va("cs %i \"%s\"\n", index, s));
+		return;
+	}
+
+	// big configstrings come in pieces
+	sent = 0;
+	remaining = len;
+	while(remaining > 0)
+	{
+		if(sent == 0)
+		{
+			cmd = "bcs0";
+		}
+		else if(remaining < maxChunkSize)
+		{
+			cmd = "bcs2";
+		}
+		else
+		{
+			cmd = "bcs1";
+		}
+		Q_strncpyz(buf, &s[sent], maxChunkSize);
+
+		CL_ServerDemoCommand(out, va("%s %i \"%s\"\n", cmd, index, buf));
+
+		sent += (maxChunkSize - 1);
+		remaining -= (maxChunkSize - 1);
+	}
+}
+
+/*
+====================
+CL_ServerDemoReadEntities
+
+Rebuilds the full entity list of a frame from its delta
+====================
+*/
+static void CL_ServerDemoReadEntities(msg_t * in)
+{
+	entityState_t  *from, *to;
+	int             numFrom, numTo, oldindex, oldnum, newnum;
+
+	from = serverDemo->entities[serverDemo->current];
+	numFrom = serverDemo->numEntities[serverDemo->current];
+	serverDemo->current ^= 1;
+	to = serverDemo->entities[serverDemo->current];
+	numTo = 0;
+
+	oldindex = 0;
+	oldnum = numFrom ? from[0].number : 99999;
+	while(1)
+	{
+		newnum = MSG_ReadBits(in, GENTITYNUM_BITS);
+		if(newnum == MAX_GENTITIES - 1)
+		{
+			break;
+		}
+		if(in->readcount > in->cursize)
+		{
+			Com_Error(ERR_DROP, "CL_ServerDemoReadEntities: end of message");
+		}
+
+		// entities that didn't change
+		while(oldnum < newnum)
+		{
+			to[numTo++] = from[oldindex++];
+			oldnum = oldindex < numFrom ? from[oldindex].number : 99999;
+		}
+
+		if(oldnum == newnum)
+		{
+			MSG_ReadDeltaEntity(in, &from[oldindex++], &to[numTo], newnum);
+			oldnum = oldindex < numFrom ? from[oldindex].number : 99999;
+		}
+		else
+		{
+			MSG_ReadDeltaEntity(in, &serverDemo->baselines[newnum], &to[numTo], newnum);
+		}
+
+		// removed entities come back as MAX_GENTITIES - 1
+		if(to[numTo].number != MAX_GENTITIES - 1)
+		{
+			numTo++;
+		}
+	}
+
+	while(oldindex < numFrom)
+	{
+		to[numTo++] = from[oldindex++];
+	}
+	serverDemo->numEntities[serverDemo->current] = numTo;
+}
+
+/*
+====================
+CL_ServerDemoVisible
+
+Applies the single client and client mask flags of an entity
+====================
+*/
+static qboolean CL_ServerDemoVisible(int number, int clientNum)
+{
+	switch (serverDemo->filterType[number])
+	{
+		case SVDEMO_FILTER_SINGLE:
+			return (qboolean)(serverDemo->filterValue[number][0] == clientNum);
+
+		case SVDEMO_FILTER_NOTSINGLE:
+			return (qboolean)(serverDemo->filterValue[number][0] != clientNum);
+
+		case SVDEMO_FILTER_MASK:
+			if(clientNum >= 32)
+			{
+				return (qboolean)((serverDemo->filterValue[number][1] & (1 << (clientNum - 32))) != 0);
+			}
+			return (qboolean)((serverDemo->filterValue[number][0] & (1 << clientNum)) != 0);
+
+		default:
+			return qtrue;
+	}
+}
+
+/*
+====================
+CL_ServerDemoFrame
+
+Reads a frame and writes the snapshot of it the pov client would get
+====================
+*/
+static void CL_ServerDemoFrame(msg_t * in, msg_t * out)
+{
+	playerState_t  *ps, *oldPs;
+	entityState_t  *entities, *snapEntities, *oldEntities;
+	int             serverTime, snapFlags, numEntities, numSnapEntities, numOldEntities;
+	int             i, number, type, deltaNum;
+
+	serverTime = MSG_ReadLong(in);
+	snapFlags = MSG_ReadByte(in);
+
+	for(i = 0; i < serverDemo->maxClients; i++)
+	{
+		if(!MSG_ReadBits(in, 1))
+		{
+			serverDemo->psValid[i] = qfalse;
+			continue;
+		}
+		MSG_ReadDeltaPlayerstate(in, serverDemo->psValid[i] ? &serverDemo->ps[i] : NULL, &serverDemo->ps[i]);
+		serverDemo->psValid[i] = qtrue;
+	}
+
+	CL_ServerDemoReadEntities(in);
+	entities = serverDemo->entities[serverDemo->current];
+	numEntities = serverDemo->numEntities[serverDemo->current];
+
+	Com_Memset(serverDemo->filterType, 0, sizeof(serverDemo->filterType));
+	while(1)
+	{
+		number = MSG_ReadBits(in, GENTITYNUM_BITS);
+		if(number == MAX_GENTITIES - 1)
+		{
+			break;
+		}
+		type = MSG_ReadByte(in);
+		serverDemo->filterType[number] = type;
+		if(type == SVDEMO_FILTER_MASK)
+		{
+			serverDemo->filterValue[number][0] = MSG_ReadLong(in);
+			serverDemo->filterValue[number][1] = MSG_ReadLong(in);
+		}
+		else
+		{
+			serverDemo->filterValue[number][0] = MSG_ReadByte(in);
+		}
+	}
+
+	// play from the first client in the game when none was asked for
+	if(serverDemo->pov < 0)
+	{
+		for(i = 0; i < serverDemo->maxClients; i++)
+		{
+			if(serverDemo->psValid[i])
+			{
+				serverDemo->pov = i;
+				Com_Printf("Playing the server demo from the view of client %i.\n", i);
+				break;
+			}
+		}
+	}
+	if(serverDemo->pov < 0 || !serverDemo->psValid[serverDemo->pov])
+	{
+		return;
+	}
+	ps = &serverDemo->ps[serverDemo->pov];
+
+	// delta from the last snapshot as long as the client still has it
+	if(serverDemo->snapMessageNum && serverDemo->messageNum - serverDemo->snapMessageNum < PACKET_BACKUP)
+	{
+		deltaNum = serverDemo->messageNum - serverDemo->snapMessageNum;
+		oldPs = &serverDemo->snapPs;
+		oldEntities = serverDemo->snapEntities[serverDemo->snapCurrent];
+		numOldEntities = serverDemo->numSnapEntities[serverDemo->snapCurrent];
+	}
+	else
+	{
+		deltaNum = 0;
+		oldPs = NULL;
+		oldEntities = NULL;
+		numOldEntities = 0;
+	}
+
+	serverDemo->snapCurrent ^= 1;
+	snapEntities = serverDemo->snapEntities[serverDemo->snapCurrent];
+	numSnapEntities = 0;
+	for(i = 0; i < numEntities; i++)
+	{
+		if(CL_ServerDemoVisible(entities[i].number, ps->clientNum))
+		{
+			snapEntities[numSnapEntities++] = entities[i];
+		}
+	}
+	serverDemo->numSnapEntities[serverDemo->snapCurrent] = numSnapEntities;
+
+	MSG_WriteByte(out, svc_snapshot);
+	MSG_WriteLong(out, serverTime);
+	MSG_WriteByte(out, deltaNum);
+	MSG_WriteByte(out, snapFlags);
+
+	// every area is visible
+	MSG_WriteByte(out, MAX_MAP_AREA_BYTES);
+	for(i = 0; i < MAX_MAP_AREA_BYTES; i++)
+	{
+		MSG_WriteByte(out, 0);
+	}
+
+	MSG_WriteDeltaPlayerstate(out, oldPs, ps);
+
+	// same walk as SV_EmitPacketEntities
+	i = 0;
+	number = 0;
+	while(i < numSnapEntities || number < numOldEntities)
+	{
+		int             newnum = i < numSnapEntities ? snapEntities[i].number : 9999;
+		int             oldnum = number < numOldEntities ? oldEntities[number].number : 9999;
+
+		if(newnum == oldnum)
+		{
+			MSG_WriteDeltaEntity(out, &oldEntities[number], &snapEntities[i], qfalse);
+			i++;
+			number++;
+		}
+		else if(newnum < oldnum)
+		{
+			MSG_WriteDeltaEntity(out, &serverDemo->baselines[newnum], &snapEntities[i], qtrue);
+			i++;
+		}
+		else
+		{
+			MSG_WriteDeltaEntity(out, &oldEntities[number], NULL, qtrue);
+			number++;
+		}
+	}
+	MSG_WriteBits(out, (MAX_GENTITIES - 1), GENTITYNUM_BITS);
+
+	serverDemo->snapPs = *ps;
+	serverDemo->snapMessageNum = serverDemo->messageNum;
+}
+
+/*
+====================
+CL_ReadServerDemoMessage
+
+Reads one block of a server demo and parses the message made from it
+====================
+*/
+void CL_ReadServerDemoMessage(void)
+{
+	msg_t           in, out;
+	byte            outData[MAX_MSGLEN];
+	int             len, cmd, target;
+	char           *s;
+
+	if(FS_Read(&len, 4, clc.demofile) != 4)
+	{
+		CL_DemoCompleted();
+		return;
+	}
+	len = LittleLong(len);
+	if(len <= 0 || len > SVDEMO_BLOCKLEN)
+	{
+		Com_Error(ERR_DROP, "CL_ReadServerDemoMessage: bad block length %i", len);
+	}
+
+	MSG_Init(&in, serverDemo->block, sizeof(serverDemo->block));
+	if(FS_Read(in.data, len, clc.demofile) != len)
+	{
+		Com_Printf("Demo file was truncated.\n");
+		CL_DemoCompleted();
+		return;
+	}
+	in.cursize = len;
+	MSG_Bitstream(&in);
+
+	serverDemo->messageNum++;
+
+	MSG_Init(&out, outData, sizeof(outData));
+	MSG_Bitstream(&out);
+	MSG_WriteLong(&out, clc.reliableSequence);
+
+	while(1)
+	{
+		if(in.readcount > in.cursize)
+		{
+			Com_Error(ERR_DROP, "CL_ReadServerDemoMessage: read past end of block");
+		}
+
+		cmd = MSG_ReadByte(&in);
+		if(cmd == svdm_EOF)
+		{
+			break;
+		}
+
+		switch (cmd)
+		{
+			case svdm_gamestate:
+				CL_ServerDemoGamestate(&in, &out);
+				break;
+
+			case svdm_configstring:
+				CL_ServerDemoConfigstring(&in, &out);
+				break;
+
+			case svdm_serverCommand:
+				target = MSG_ReadByte(&in);
+				s = MSG_ReadString(&in);
+				if(target == SVDEMO_BROADCAST || target == serverDemo->pov)
+				{
+					CL_ServerDemoCommand(&out, s);
+				}
+				break;
+
+			case svdm_frame:
+				CL_ServerDemoFrame(&in, &out);
+				break;
+
+			default:
+				Com_Error(ERR_DROP, "CL_ReadServerDemoMessage: illegible block");
+				break;
+		}
+	}
+	MSG_WriteByte(&out, svc_EOF);
+
+	if(out.overflowed)
+	{
+		Com_Error(ERR_DROP, "CL_ReadServerDemoMessage: message overflowed");
+	}
+
+	clc.serverMessageSequence = serverDemo->messageNum;
+	clc.lastPacketTime = cls.realtime;
+	MSG_BeginReading(&out);
+	CL_ParseServerMessage(&out);
+}
@@ -245,6 +245,9 @@ typedef struct {
 	qboolean				demowaiting;												// don't record until a non-delta message is received
 	qboolean				firstDemoFrameSkipped;
 	fileHandle_t			demofile;
+	int						demoResumeOffset;											// where the demo goes on after the keyframe being read
+	int						demoSeekTime;												// fast forwarding to this server time, the cgame isn't loaded yet
+	qboolean				demoServerDemo;												// playing a server side demo from one client's view
 
 #if defined(USE_VOIP)
 	qboolean				voipEnabled;
@@ -546,6 +549,7 @@ void            CL_GetChallengePacket(void);
 void            CL_Vid_Restart_f(void);
 void            CL_Snd_Restart_f(void);
 void            CL_NextDemo(void);
+void            CL_DemoCompleted(void);
 void            CL_ReadDemoMessage(void);
 void            CL_StartDemoLoop( void );
 demoState_t     CL_DemoState( void );
@@ -671,6 +675,13 @@ void            CL_SystemInfoChanged(void);
 void            CL_ParseServerMessage(msg_t * msg);
 char           *CL_GetReliableServerCommand( int index );
 
+//
+// cl_svdemo.c
+//
+qboolean        CL_OpenServerDemo(int pov);
+void            CL_FreeServerDemo(void);
+void            CL_ReadServerDemoMessage(void);
+
 //====================================================================
 
 void            CL_UpdateInfoPacket(netadr_t from);	// DHM - Nerve
@@ -758,6 +769,7 @@ void			Cin_OGM_Shutdown(void);
 //
 void            CL_InitCGame(void);
 void            CL_ShutdownCGame(void);
+qboolean        CL_GetServerCommand(int serverCommandNumber);
 qboolean        CL_GameCommand(void);
 qboolean 		CL_GameConsoleText(void);
 void            CL_CGameRendering(stereoFrame_t stereo);
@@ -707,13 +707,11 @@ int idParser::ExpandBuiltinDefine( idToken *deftoken, define_t *define, idToken
 		case BUILTIN_DATE: {
 			t = time(NULL);
 			curtime = ctime(&t);
+			// "Mmm dd yyyy", ctime returns a static buffer
 			(*token) = "\"";
-			token->Append( curtime+4 );
-			token[7] = '\0';
-			token->Append( curtime+20 );
-			token[10] = '\0';
+			token->Append( curtime+4, 7 );
+			token->Append( curtime+20, 4 );
 			token->Append( "\"" );
-			free(curtime);
 			token->type = TT_STRING;
 			token->subtype = token->Length();
 			token->line = deftoken->line;
@@ -726,11 +724,10 @@ int idParser::ExpandBuiltinDefine( idToken *deftoken, define_t *define, idToken
 		case BUILTIN_TIME: {
 			t = time(NULL);
 			curtime = ctime(&t);
+			// "hh:mm:ss"
 			(*token) = "\"";
-			token->Append( curtime+11 );
-			token[8] = '\0';
+			token->Append( curtime+11, 8 );
 			token->Append( "\"" );
-			free(curtime);
 			token->type = TT_STRING;
 			token->subtype = token->Length();
 			token->line = deftoken->line;
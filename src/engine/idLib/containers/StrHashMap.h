@@ -0,0 +1,578 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code (?Doom 3 Source Code?).
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __STRHASHMAP_H__
+#define __STRHASHMAP_H__
+
+/*
+===============================================================================
+
+	Open addressing string to value map.
+
+	Robin Hood hashing over a power of two number of slots. The full hash of
+	every key is stored in a separate array so probing only touches the
+	hashes until a candidate matches, and growing the table never has to
+	hash a string again. Keys are copied into blocks owned by the map instead
+	of being allocated one by one.
+
+	Values move when the map grows or keys are removed, so the value type
+	should be small (usually a pointer) and a pointer returned by Get is only
+	valid until the next Set or Remove.
+
+	Does not allocate memory until the first key/value pair is added.
+
+===============================================================================
+*/
+
+#define STRHASHMAP_MIN_SLOTS		16
+#define STRHASHMAP_KEY_BLOCK_SIZE	4096
+
+template< class Type >
+class idStrHashMap {
+public:
+					idStrHashMap( bool caseSensitive = true );
+					~idStrHashMap( void );
+
+					// returns total size of allocated memory
+	size_t			Allocated( void ) const;
+					// returns total size of allocated memory including size of map type
+	size_t			Size( void ) const;
+
+					// add the key or replace the value of an existing key
+	void			Set( const char *key, const Type &value );
+					// returns a pointer to the value or NULL if the key is not in the map
+	Type *			Get( const char *key ) const;
+					// same as above with a hash already generated by GenerateHash
+	Type *			Get( const char *key, const unsigned int hash ) const;
+					// remove the key, returns false if the key is not in the map
+	bool			Remove( const char *key );
+					// remove all keys, the slots stay allocated
+	void			Clear( void );
+					// free allocated memory
+	void			Free( void );
+					// make room for the given number of keys without growing
+	void			Reserve( const int num );
+
+	int				Num( void ) const;
+					// the slots can be itterated over, empty slots return NULL,
+					// the slot of a key changes when keys are added or removed
+	int				NumSlots( void ) const;
+	const char *	GetKey( const int slot ) const;
+	Type *			GetValue( const int slot ) const;
+
+					// returns the hash the map uses for a key, never zero
+	unsigned int	GenerateHash( const char *key ) const;
+	static unsigned int	Hash( const char *key );
+	static unsigned int	IHash( const char *key );
+
+private:
+	struct entry_t {
+		const char *	key;
+		Type			value;
+	};
+
+	struct keyBlock_t {
+		keyBlock_t *	next;
+		int				size;
+		int				used;
+	};
+
+	bool			caseSensitive;
+	int				numSlots;
+	int				slotMask;
+	int				numEntries;
+	unsigned int *	hashes;			// zero marks an empty slot
+	entry_t *		entries;
+	keyBlock_t *	keyBlocks;
+	int				keyBytesUsed;	// bytes taken from the key blocks
+	int				keyBytesLive;	// bytes used by keys still in the map
+
+	int				FindSlot( const char *key, const unsigned int hash ) const;
+	void			Insert( unsigned int hash, const char *key, const Type &value );
+	void			Resize( const int newNumSlots );
+	const char *	CopyKey( const char *key );
+	void			FreeKeys( void );
+	void			CompactKeys( void );
+
+					idStrHashMap( const idStrHashMap<Type> &map );
+	void			operator=( const idStrHashMap<Type> &map );
+};
+
+/*
+================
+idStrHashMap<Type>::idStrHashMap
+================
+*/
+template< class Type >
+ID_INLINE idStrHashMap<Type>::idStrHashMap( bool caseSensitive ) {
+	this->caseSensitive = caseSensitive;
+	numSlots = 0;
+	slotMask = 0;
+	numEntries = 0;
+	hashes = NULL;
+	entries = NULL;
+	keyBlocks = NULL;
+	keyBytesUsed = 0;
+	keyBytesLive = 0;
+}
+
+/*
+================
+idStrHashMap<Type>::~idStrHashMap
+================
+*/
+template< class Type >
+ID_INLINE idStrHashMap<Type>::~idStrHashMap( void ) {
+	Free();
+}
+
+/*
+================
+idStrHashMap<Type>::Allocated
+================
+*/
+template< class Type >
+ID_INLINE size_t idStrHashMap<Type>::Allocated( void ) const {
+	size_t size = numSlots * ( sizeof( unsigned int ) + sizeof( entry_t ) );
+	for ( keyBlock_t *block = keyBlocks; block; block = block->next ) {
+		size += sizeof( keyBlock_t ) + block->size;
+	}
+	return size;
+}
+
+/*
+================
+idStrHashMap<Type>::Size
+================
+*/
+template< class Type >
+ID_INLINE size_t idStrHashMap<Type>::Size( void ) const {
+	return sizeof( *this ) + Allocated();
+}
+
+/*
+================
+idStrHashMap<Type>::Hash
+
+  FNV-1a, the map reserves zero for empty slots
+================
+*/
+template< class Type >
+ID_INLINE unsigned int idStrHashMap<Type>::Hash( const char *key ) {
+	unsigned int hash = 2166136261u;
+	while ( *key ) {
+		hash ^= (byte)*key++;
+		hash *= 16777619u;
+	}
+	return hash ? hash : 1;
+}
+
+/*
+================
+idStrHashMap<Type>::IHash
+================
+*/
+template< class Type >
+ID_INLINE unsigned int idStrHashMap<Type>::IHash( const char *key ) {
+	unsigned int hash = 2166136261u;
+	while ( *key ) {
+		hash ^= (byte)idStr::ToLower( *key++ );
+		hash *= 16777619u;
+	}
+	return hash ? hash : 1;
+}
+
+/*
+================
+idStrHashMap<Type>::GenerateHash
+================
+*/
+template< class Type >
+ID_INLINE unsigned int idStrHashMap<Type>::GenerateHash( const char *key ) const {
+	return caseSensitive ? Hash( key ) : IHash( key );
+}
+
+/*
+================
+idStrHashMap<Type>::FindSlot
+================
+*/
+template< class Type >
+ID_INLINE int idStrHashMap<Type>::FindSlot( const char *key, const unsigned int hash ) const {
+	int slot, dist;
+	unsigned int h;
+
+	if ( !numEntries ) {
+		return -1;
+	}
+
+	slot = hash & slotMask;
+	for ( dist = 0; ; dist++ ) {
+		h = hashes[slot];
+		if ( !h ) {
+			return -1;
+		}
+		// a key that far from home would have displaced this one
+		if ( ( ( slot - (int)( h & slotMask ) ) & slotMask ) < dist ) {
+			return -1;
+		}
+		if ( h == hash ) {
+			if ( caseSensitive ? !idStr::Cmp( key, entries[slot].key ) : !idStr::Icmp( key, entries[slot].key ) ) {
+				return slot;
+			}
+		}
+		slot = ( slot + 1 ) & slotMask;
+	}
+	return -1;
+}
+
+/*
+================
+idStrHashMap<Type>::Insert
+
+  assumes the key is not in the map and there is a free slot
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Insert( unsigned int hash, const char *key, const Type &value ) {
+	int slot, dist, slotDist;
+	unsigned int tmpHash;
+	entry_t entry, tmpEntry;
+
+	entry.key = key;
+	entry.value = value;
+
+	slot = hash & slotMask;
+	for ( dist = 0; ; dist++ ) {
+		if ( !hashes[slot] ) {
+			hashes[slot] = hash;
+			entries[slot] = entry;
+			return;
+		}
+		// take the slot from keys that are closer to their home slot
+		slotDist = ( slot - (int)( hashes[slot] & slotMask ) ) & slotMask;
+		if ( slotDist < dist ) {
+			tmpHash = hashes[slot];
+			hashes[slot] = hash;
+			hash = tmpHash;
+			tmpEntry = entries[slot];
+			entries[slot] = entry;
+			entry = tmpEntry;
+			dist = slotDist;
+		}
+		slot = ( slot + 1 ) & slotMask;
+	}
+}
+
+/*
+================
+idStrHashMap<Type>::Resize
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Resize( const int newNumSlots ) {
+	int i, oldNumSlots;
+	unsigned int *oldHashes;
+	entry_t *oldEntries;
+
+	assert( idMath::IsPowerOfTwo( newNumSlots ) );
+	assert( newNumSlots > numEntries );
+
+	oldNumSlots = numSlots;
+	oldHashes = hashes;
+	oldEntries = entries;
+
+	numSlots = newNumSlots;
+	slotMask = newNumSlots - 1;
+	hashes = new unsigned int[numSlots];
+	entries = new entry_t[numSlots];
+	memset( hashes, 0, numSlots * sizeof( hashes[0] ) );
+
+	for ( i = 0; i < oldNumSlots; i++ ) {
+		if ( oldHashes[i] ) {
+			Insert( oldHashes[i], oldEntries[i].key, oldEntries[i].value );
+		}
+	}
+
+	delete[] oldHashes;
+	delete[] oldEntries;
+}
+
+/*
+================
+idStrHashMap<Type>::Reserve
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Reserve( const int num ) {
+	int newNumSlots;
+
+	// keep the load factor at or below 3/4
+	newNumSlots = idMath::CeilPowerOfTwo( Max( STRHASHMAP_MIN_SLOTS, num + num / 3 + 1 ) );
+	if ( newNumSlots > numSlots ) {
+		Resize( newNumSlots );
+	}
+}
+
+/*
+================
+idStrHashMap<Type>::CopyKey
+================
+*/
+template< class Type >
+ID_INLINE const char *idStrHashMap<Type>::CopyKey( const char *key ) {
+	int length, blockSize;
+	keyBlock_t *block;
+	char *copy;
+
+	length = strlen( key ) + 1;
+	block = keyBlocks;
+	if ( !block || block->used + length > block->size ) {
+		blockSize = Max( STRHASHMAP_KEY_BLOCK_SIZE, length );
+		block = (keyBlock_t *)new byte[sizeof( keyBlock_t ) + blockSize];
+		block->next = keyBlocks;
+		block->size = blockSize;
+		block->used = 0;
+		keyBlocks = block;
+	}
+	copy = (char *)( block + 1 ) + block->used;
+	memcpy( copy, key, length );
+	block->used += length;
+	keyBytesUsed += length;
+	keyBytesLive += length;
+	return copy;
+}
+
+/*
+================
+idStrHashMap<Type>::FreeKeys
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::FreeKeys( void ) {
+	keyBlock_t *block, *next;
+
+	for ( block = keyBlocks; block; block = next ) {
+		next = block->next;
+		delete[] (byte *)block;
+	}
+	keyBlocks = NULL;
+	keyBytesUsed = 0;
+	keyBytesLive = 0;
+}
+
+/*
+================
+idStrHashMap<Type>::CompactKeys
+
+  copies the keys still in the map to new blocks and frees the old ones
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::CompactKeys( void ) {
+	int i;
+	keyBlock_t *block, *next, *oldBlocks;
+
+	oldBlocks = keyBlocks;
+	keyBlocks = NULL;
+	keyBytesUsed = 0;
+	keyBytesLive = 0;
+
+	for ( i = 0; i < numSlots; i++ ) {
+		if ( hashes[i] ) {
+			entries[i].key = CopyKey( entries[i].key );
+		}
+	}
+
+	for ( block = oldBlocks; block; block = next ) {
+		next = block->next;
+		delete[] (byte *)block;
+	}
+}
+
+/*
+================
+idStrHashMap<Type>::Set
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Set( const char *key, const Type &value ) {
+	unsigned int hash;
+	int slot;
+
+	hash = GenerateHash( key );
+	slot = FindSlot( key, hash );
+	if ( slot >= 0 ) {
+		entries[slot].value = value;
+		return;
+	}
+
+	if ( ( numEntries + 1 ) * 4 > numSlots * 3 ) {
+		Resize( Max( STRHASHMAP_MIN_SLOTS, numSlots * 2 ) );
+	}
+	Insert( hash, CopyKey( key ), value );
+	numEntries++;
+}
+
+/*
+================
+idStrHashMap<Type>::Get
+================
+*/
+template< class Type >
+ID_INLINE Type *idStrHashMap<Type>::Get( const char *key ) const {
+	return Get( key, GenerateHash( key ) );
+}
+
+/*
+================
+idStrHashMap<Type>::Get
+================
+*/
+template< class Type >
+ID_INLINE Type *idStrHashMap<Type>::Get( const char *key, const unsigned int hash ) const {
+	int slot;
+
+	slot = FindSlot( key, hash );
+	if ( slot < 0 ) {
+		return NULL;
+	}
+	return &entries[slot].value;
+}
+
+/*
+================
+idStrHashMap<Type>::Remove
+================
+*/
+template< class Type >
+ID_INLINE bool idStrHashMap<Type>::Remove( const char *key ) {
+	int slot, next;
+
+	slot = FindSlot( key, GenerateHash( key ) );
+	if ( slot < 0 ) {
+		return false;
+	}
+
+	keyBytesLive -= strlen( entries[slot].key ) + 1;
+
+	// shift the following keys back until one is in its home slot
+	next = ( slot + 1 ) & slotMask;
+	while ( hashes[next] && ( ( next - (int)( hashes[next] & slotMask ) ) & slotMask ) != 0 ) {
+		hashes[slot] = hashes[next];
+		entries[slot] = entries[next];
+		slot = next;
+		next = ( next + 1 ) & slotMask;
+	}
+	hashes[slot] = 0;
+	entries[slot].key = NULL;
+	numEntries--;
+
+	// don't let keys that are added and removed over and over pile up
+	if ( !numEntries ) {
+		FreeKeys();
+	} else if ( keyBytesUsed - keyBytesLive > Max( keyBytesLive, STRHASHMAP_KEY_BLOCK_SIZE ) ) {
+		CompactKeys();
+	}
+	return true;
+}
+
+/*
+================
+idStrHashMap<Type>::Clear
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Clear( void ) {
+	if ( hashes ) {
+		memset( hashes, 0, numSlots * sizeof( hashes[0] ) );
+	}
+	numEntries = 0;
+	FreeKeys();
+}
+
+/*
+================
+idStrHashMap<Type>::Free
+================
+*/
+template< class Type >
+ID_INLINE void idStrHashMap<Type>::Free( void ) {
+	delete[] hashes;
+	delete[] entries;
+	hashes = NULL;
+	entries = NULL;
+	numSlots = 0;
+	slotMask = 0;
+	numEntries = 0;
+	FreeKeys();
+}
+
+/*
+================
+idStrHashMap<Type>::Num
+================
+*/
+template< class Type >
+ID_INLINE int idStrHashMap<Type>::Num( void ) const {
+	return numEntries;
+}
+
+/*
+================
+idStrHashMap<Type>::NumSlots
+================
+*/
+template< class Type >
+ID_INLINE int idStrHashMap<Type>::NumSlots( void ) const {
+	return numSlots;
+}
+
+/*
+================
+idStrHashMap<Type>::GetKey
+================
+*/
+template< class Type >
+ID_INLINE const char *idStrHashMap<Type>::GetKey( const int slot ) const {
+	assert( slot >= 0 && slot < numSlots );
+	return hashes[slot] ? entries[slot].key : NULL;
+}
+
+/*
+================
+idStrHashMap<Type>::GetValue
+================
+*/
+template< class Type >
+ID_INLINE Type *idStrHashMap<Type>::GetValue( const int slot ) const {
+	assert( slot >= 0 && slot < numSlots );
+	return hashes[slot] ? &entries[slot].value : NULL;
+}
+
+#endif /* !__STRHASHMAP_H__ */
@@ -29,8 +29,9 @@ If you have questions concerning this license or the applicable additional terms
 #include "../precompiled.h"
 #pragma hdrstop
 
-/*#include "Simd_Generic.h"
-#include "Simd_MMX.h"
+#include "Simd_Generic.h"
+#include "Simd_Intrinsics.h"
+/*#include "Simd_MMX.h"
 #include "Simd_3DNow.h"
 #include "Simd_SSE.h"
 #include "Simd_SSE2.h"
@@ -49,12 +50,10 @@ idSIMD::Init
 ================
 */
 void idSIMD::Init( void ) {
-#if ID_USE_INLINEASM
 	generic = new idSIMD_Generic;
 	generic->cpuid = CPUID_GENERIC;
 	processor = NULL;
 	SIMDProcessor = generic;
-#endif
 }
 
 /*
@@ -63,59 +62,30 @@ idSIMD::InitProcessor
 ============
 */
 void idSIMD::InitProcessor( const char *module, bool forceGeneric ) {
-#if 0
-	cpuid_t cpuid;
 	idSIMDProcessor *newProcessor;
 
-	cpuid = idLib::sys->GetProcessorId();
-#if ID_USE_INLINEASM
 	if ( forceGeneric ) {
-#endif
 		newProcessor = generic;
-#if ID_USE_INLINEASM
 	} else {
-
 		if ( !processor ) {
-			if ( ( cpuid & CPUID_ALTIVEC ) ) {
-				processor = new idSIMD_AltiVec;
-			} else if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_SSE ) && ( cpuid & CPUID_SSE2 ) && ( cpuid & CPUID_SSE3 ) ) {
-				processor = new idSIMD_SSE3;
-			} else if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_SSE ) && ( cpuid & CPUID_SSE2 ) ) {
-				processor = new idSIMD_SSE2;
-			} else if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_SSE ) ) {
-				processor = new idSIMD_SSE;
-			} else if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_3DNOW ) ) {
-				processor = new idSIMD_3DNow;
-			} else if ( ( cpuid & CPUID_MMX ) ) {
-				processor = new idSIMD_MMX;
-			} else {
+#if ID_SIMD_INTRINSICS
+			cpuid_t cpuid = idSIMD_Intrinsics::GetProcessorId();
+			if ( cpuid & CPUID_SSE2 ) {
+				processor = new idSIMD_Intrinsics;
+				processor->cpuid = cpuid;
+			} else
+#endif
+			{
 				processor = generic;
 			}
-			processor->cpuid = cpuid;
 		}
-
-	newProcessor = processor;
+		newProcessor = processor;
 	}
-#endif
+
 	if ( newProcessor != SIMDProcessor ) {
 		SIMDProcessor = newProcessor;
-#if ID_USE_INLINEASM
-		idLib::common->Printf( "%s using %s for SIMD processing\n", module, SIMDProcessor->GetName() );
-#else
-		idLib::common->Printf( "%s forcing generic SIMD processor\n", module, SIMDProcessor->GetName() );
-#endif
+		Com_Printf( "%s using %s for SIMD processing\n", module, SIMDProcessor->GetName() );
 	}
-
-	if ( cpuid & CPUID_FTZ ) {
-		idLib::sys->FPU_SetFTZ( true );
-		idLib::common->Printf( "enabled Flush-To-Zero mode\n" );
-	}
-
-	if ( cpuid & CPUID_DAZ ) {
-		idLib::sys->FPU_SetDAZ( true );
-		idLib::common->Printf( "enabled Denormals-Are-Zero mode\n" );
-	}
-#endif
 }
 
 /*
@@ -313,6 +283,22 @@ TIME_TYPE time_in_millisec( void ) {
 #define StopRecordTime( end )				\
 	end = mach_absolute_time();
 #endif
+#elif ID_SIMD_INTRINSICS
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#define TIME_TYPE long long
+
+#define StartRecordTime( start )			\
+	start = __rdtsc();
+
+#define StopRecordTime( end )				\
+	end = __rdtsc();
+
 #else
 
 #define TIME_TYPE int
@@ -359,7 +345,8 @@ GetBaseClocks
 ============
 */
 void GetBaseClocks( void ) {
-	int i, start, end, bestClocks;
+	int i;
+	TIME_TYPE start, end, bestClocks;
 
 	bestClocks = 0;
 	for ( i = 0; i < NUMTESTS; i++ ) {
@@ -4129,9 +4116,34 @@ void idSIMD::Test_f( const idCmdArgs &args ) {
 	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL );
 #endif /* _WIN32 */
 
-	p_simd = processor;
+	p_simd = processor ? processor : generic;
 	p_generic = generic;
-#if ID_USE_INLINEASM
+#if ID_SIMD_INTRINSICS
+	if ( idStr::Length( args.Argv( 1 ) ) != 0 ) {
+		cpuid_t cpuid = idSIMD_Intrinsics::GetProcessorId();
+		cpuid_t mask;
+		idStr argString = args.Args();
+
+		argString.Replace( " ", "" );
+
+		if ( idStr::Icmp( argString, "SSE2" ) == 0 ) {
+			mask = (cpuid_t)( CPUID_MMX | CPUID_SSE | CPUID_SSE2 );
+		} else if ( idStr::Icmp( argString, "SSE41" ) == 0 ) {
+			mask = (cpuid_t)( CPUID_MMX | CPUID_SSE | CPUID_SSE2 | CPUID_SSE3 | CPUID_SSE41 );
+		} else if ( idStr::Icmp( argString, "AVX2" ) == 0 ) {
+			mask = (cpuid_t)( CPUID_MMX | CPUID_SSE | CPUID_SSE2 | CPUID_SSE3 | CPUID_SSE41 | CPUID_AVX | CPUID_AVX2 );
+		} else {
+			Com_Printf( "invalid argument, use: SSE2, SSE41, AVX2\n" );
+			return;
+		}
+		if ( ( cpuid & mask ) != mask ) {
+			Com_Printf( "CPU does not support %s\n", argString.c_str() );
+			return;
+		}
+		p_simd = new idSIMD_Intrinsics;
+		p_simd->cpuid = mask;
+	}
+#elif ID_USE_INLINEASM
 	if ( idStr::Length( args.Argv( 1 ) ) != 0 ) {
 		cpuid_t cpuid = idLib::sys->GetProcessorId();
 		idStr argString = args.Args();
@@ -4238,7 +4250,7 @@ void idSIMD::Test_f( const idCmdArgs &args ) {
 
 ///	idLib::common->SetRefreshOnPrint( false );
 
-	if ( p_simd != processor ) {
+	if ( p_simd != processor && p_simd != generic ) {
 		delete p_simd;
 	}
 	p_simd = NULL;
@@ -0,0 +1,2348 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company. 
+
+This file is part of the Doom 3 GPL Source Code (?Doom 3 Source Code?).  
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "../precompiled.h"
+#pragma hdrstop
+
+#include "Simd_Generic.h"
+#include "Simd_Intrinsics.h"
+
+#if ID_SIMD_INTRINSICS
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ID_TARGET_SSE41
+#define ID_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define ID_TARGET_SSE41		__attribute__(( target( "sse4.1" ) ))
+#define ID_TARGET_AVX2		__attribute__(( target( "avx2" ) ))
+#endif
+
+//===============================================================
+//
+//	SSE2 / SSE4.1 / AVX2 intrinsics implementation of idSIMDProcessor
+//
+//	Every kernel keeps the operation order of the generic code where
+//	the tests compare exactly (MatX, joints, tangents), so switching
+//	processors does not change the simulation results.
+//
+//===============================================================
+
+#define SHUF( a, b, c, d )		_MM_SHUFFLE( d, c, b, a )
+
+/*
+============
+CPUID
+
+  returns eax, ebx, ecx, edx of the given cpuid leaf
+============
+*/
+static void CPUID( unsigned int func, unsigned int regs[4] ) {
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex( r, func, 0 );
+	regs[0] = r[0]; regs[1] = r[1]; regs[2] = r[2]; regs[3] = r[3];
+#else
+	__cpuid_count( func, 0, regs[0], regs[1], regs[2], regs[3] );
+#endif
+}
+
+/*
+============
+XGETBV
+
+  returns the low 32 bits of the extended control register 0
+============
+*/
+static unsigned int XGETBV( void ) {
+#ifdef _MSC_VER
+	return (unsigned int)_xgetbv( 0 );
+#else
+	unsigned int eax, edx;
+	__asm__ __volatile__( "xgetbv" : "=a" ( eax ), "=d" ( edx ) : "c" ( 0 ) );
+	return eax;
+#endif
+}
+
+/*
+============
+idSIMD_Intrinsics::GetProcessorId
+============
+*/
+cpuid_t idSIMD_Intrinsics::GetProcessorId( void ) {
+	unsigned int regs[4];
+	int flags;
+
+	CPUID( 0, regs );
+	unsigned int maxLeaf = regs[0];
+
+	flags = CPUID_GENERIC;
+	if ( maxLeaf < 1 ) {
+		return (cpuid_t)flags;
+	}
+
+	CPUID( 1, regs );
+	if ( regs[3] & ( 1 << 23 ) ) {
+		flags |= CPUID_MMX;
+	}
+	if ( regs[3] & ( 1 << 25 ) ) {
+		flags |= CPUID_SSE;
+	}
+	if ( regs[3] & ( 1 << 26 ) ) {
+		flags |= CPUID_SSE2;
+	}
+	if ( regs[2] & ( 1 << 0 ) ) {
+		flags |= CPUID_SSE3;
+	}
+	if ( regs[2] & ( 1 << 19 ) ) {
+		flags |= CPUID_SSE41;
+	}
+
+	// AVX needs the OS to save the YMM registers on a context switch
+	if ( ( regs[2] & ( 1 << 27 ) ) && ( regs[2] & ( 1 << 28 ) ) && ( XGETBV() & 6 ) == 6 ) {
+		flags |= CPUID_AVX;
+		if ( maxLeaf >= 7 ) {
+			CPUID( 7, regs );
+			if ( regs[1] & ( 1 << 5 ) ) {
+				flags |= CPUID_AVX2;
+			}
+		}
+	}
+
+	return (cpuid_t)flags;
+}
+
+/*
+============
+idSIMD_Intrinsics::GetName
+============
+*/
+const char * idSIMD_Intrinsics::GetName( void ) const {
+	if ( cpuid & CPUID_AVX2 ) {
+		return "SSE2 & SSE4.1 & AVX2 intrinsics";
+	}
+	if ( cpuid & CPUID_SSE41 ) {
+		return "SSE2 & SSE4.1 intrinsics";
+	}
+	return "SSE2 intrinsics";
+}
+
+#define HAS_SSE41		( cpuid & CPUID_SSE41 )
+#define HAS_AVX2		( cpuid & CPUID_AVX2 )
+
+
+//===============================================================
+//
+//	helpers
+//
+//===============================================================
+
+/*
+============
+LoadVec3x4
+
+  loads four packed idVec3 and rearranges them into x, y and z registers
+============
+*/
+static ID_INLINE void LoadVec3x4( const float *p, __m128 &x, __m128 &y, __m128 &z ) {
+	__m128 a = _mm_loadu_ps( p + 0 );		// x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps( p + 4 );		// y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps( p + 8 );		// z2 x3 y3 z3
+
+	x = _mm_shuffle_ps( _mm_shuffle_ps( a, a, SHUF( 0, 0, 3, 3 ) ), _mm_shuffle_ps( b, c, SHUF( 2, 2, 1, 1 ) ), SHUF( 0, 2, 0, 2 ) );
+	y = _mm_shuffle_ps( _mm_shuffle_ps( a, b, SHUF( 1, 1, 0, 0 ) ), _mm_shuffle_ps( b, c, SHUF( 3, 3, 2, 2 ) ), SHUF( 0, 2, 0, 2 ) );
+	z = _mm_shuffle_ps( _mm_shuffle_ps( a, b, SHUF( 2, 2, 1, 1 ) ), _mm_shuffle_ps( c, c, SHUF( 0, 0, 3, 3 ) ), SHUF( 0, 2, 0, 2 ) );
+}
+
+/*
+============
+LoadStrided4
+
+  loads four floats at p, p + stride, p + 2 * stride and p + 3 * stride
+  and transposes them so x holds the first float of every element
+============
+*/
+static ID_INLINE void LoadStrided4( const float *p, const int stride, __m128 &x, __m128 &y, __m128 &z, __m128 &w ) {
+	x = _mm_loadu_ps( p + 0 * stride );
+	y = _mm_loadu_ps( p + 1 * stride );
+	z = _mm_loadu_ps( p + 2 * stride );
+	w = _mm_loadu_ps( p + 3 * stride );
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+}
+
+/*
+============
+StoreVec3
+
+  stores the first three floats without touching the fourth
+============
+*/
+static ID_INLINE void StoreVec3( float *p, const __m128 v ) {
+	_mm_storel_pi( (__m64 *)p, v );
+	_mm_store_ss( p + 2, _mm_movehl_ps( v, v ) );
+}
+
+/*
+============
+RSqrt
+
+  the same approximation as idMath::RSqrt so results match the generic code
+============
+*/
+static ID_INLINE __m128 RSqrt( const __m128 x ) {
+	__m128 y = _mm_mul_ps( x, _mm_set1_ps( 0.5f ) );
+	__m128i i = _mm_sub_epi32( _mm_set1_epi32( 0x5f3759df ), _mm_srai_epi32( _mm_castps_si128( x ), 1 ) );
+	__m128 r = _mm_castsi128_ps( i );
+	return _mm_mul_ps( r, _mm_sub_ps( _mm_set1_ps( 1.5f ), _mm_mul_ps( _mm_mul_ps( r, r ), y ) ) );
+}
+
+/*
+============
+PackCompareMasks
+
+  packs sixteen compare results into sixteen bytes of 0x00 or 0xFF
+============
+*/
+static ID_INLINE __m128i PackCompareMasks( const __m128 m0, const __m128 m1, const __m128 m2, const __m128 m3 ) {
+	__m128i lo = _mm_packs_epi32( _mm_castps_si128( m0 ), _mm_castps_si128( m1 ) );
+	__m128i hi = _mm_packs_epi32( _mm_castps_si128( m2 ), _mm_castps_si128( m3 ) );
+	return _mm_packs_epi16( lo, hi );
+}
+
+
+//===============================================================
+//
+//	arithmetic
+//
+//===============================================================
+
+#define UNROLL_SSE( OPER4, OPER1 ) { int _IX; for ( _IX = 0; _IX + 4 <= count; _IX += 4 ) { OPER4( _IX ); } for ( ; _IX < count; _IX++ ) { OPER1( _IX ); } }
+#define UNROLL_AVX( OPER8, OPER1 ) { int _IX; for ( _IX = 0; _IX + 8 <= count; _IX += 8 ) { OPER8( _IX ); } for ( ; _IX < count; _IX++ ) { OPER1( _IX ); } }
+
+/*
+============
+idSIMD_Intrinsics::Add
+
+  dst[i] = constant + src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Add( float *dst, const float constant, const float *src, const int count ) {
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_add_ps( _mm_loadu_ps( src + (X) ), c ) );
+#define OPER1(X) dst[(X)] = src[(X)] + constant;
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+Add_AVX2
+============
+*/
+ID_TARGET_AVX2 static void Add_AVX2( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_add_ps( _mm256_loadu_ps( src0 + (X) ), _mm256_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] + src1[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Add
+
+  dst[i] = src0[i] + src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Add( float *dst, const float *src0, const float *src1, const int count ) {
+	if ( HAS_AVX2 ) {
+		Add_AVX2( dst, src0, src1, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_add_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] + src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Sub
+
+  dst[i] = constant - src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Sub( float *dst, const float constant, const float *src, const int count ) {
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_sub_ps( c, _mm_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] = constant - src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+Sub_AVX2
+============
+*/
+ID_TARGET_AVX2 static void Sub_AVX2( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_sub_ps( _mm256_loadu_ps( src0 + (X) ), _mm256_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] - src1[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Sub
+
+  dst[i] = src0[i] - src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Sub( float *dst, const float *src0, const float *src1, const int count ) {
+	if ( HAS_AVX2 ) {
+		Sub_AVX2( dst, src0, src1, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_sub_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] - src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Mul
+
+  dst[i] = constant * src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Mul( float *dst, const float constant, const float *src, const int count ) {
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_mul_ps( c, _mm_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] = constant * src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+Mul_AVX2
+============
+*/
+ID_TARGET_AVX2 static void Mul_AVX2( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_mul_ps( _mm256_loadu_ps( src0 + (X) ), _mm256_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] * src1[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Mul
+
+  dst[i] = src0[i] * src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Mul( float *dst, const float *src0, const float *src1, const int count ) {
+	if ( HAS_AVX2 ) {
+		Mul_AVX2( dst, src0, src1, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_mul_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] * src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Div
+
+  dst[i] = constant / divisor[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Div( float *dst, const float constant, const float *divisor, const int count ) {
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_div_ps( c, _mm_loadu_ps( divisor + (X) ) ) );
+#define OPER1(X) dst[(X)] = constant / divisor[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Div
+
+  dst[i] = src0[i] / src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Div( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_div_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) );
+#define OPER1(X) dst[(X)] = src0[(X)] / src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+MulAdd_AVX2
+============
+*/
+ID_TARGET_AVX2 static void MulAdd_AVX2( float *dst, const float constant, const float *src, const int count ) {
+	const __m256 c = _mm256_set1_ps( constant );
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_add_ps( _mm256_loadu_ps( dst + (X) ), _mm256_mul_ps( c, _mm256_loadu_ps( src + (X) ) ) ) );
+#define OPER1(X) dst[(X)] += constant * src[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::MulAdd
+
+  dst[i] += constant * src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::MulAdd( float *dst, const float constant, const float *src, const int count ) {
+	if ( HAS_AVX2 ) {
+		MulAdd_AVX2( dst, constant, src, count );
+		return;
+	}
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_add_ps( _mm_loadu_ps( dst + (X) ), _mm_mul_ps( c, _mm_loadu_ps( src + (X) ) ) ) );
+#define OPER1(X) dst[(X)] += constant * src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+MulAdd_AVX2
+============
+*/
+ID_TARGET_AVX2 static void MulAdd_AVX2( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_add_ps( _mm256_loadu_ps( dst + (X) ), _mm256_mul_ps( _mm256_loadu_ps( src0 + (X) ), _mm256_loadu_ps( src1 + (X) ) ) ) );
+#define OPER1(X) dst[(X)] += src0[(X)] * src1[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::MulAdd
+
+  dst[i] += src0[i] * src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::MulAdd( float *dst, const float *src0, const float *src1, const int count ) {
+	if ( HAS_AVX2 ) {
+		MulAdd_AVX2( dst, src0, src1, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_add_ps( _mm_loadu_ps( dst + (X) ), _mm_mul_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) ) );
+#define OPER1(X) dst[(X)] += src0[(X)] * src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+MulSub_AVX2
+============
+*/
+ID_TARGET_AVX2 static void MulSub_AVX2( float *dst, const float constant, const float *src, const int count ) {
+	const __m256 c = _mm256_set1_ps( constant );
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_sub_ps( _mm256_loadu_ps( dst + (X) ), _mm256_mul_ps( c, _mm256_loadu_ps( src + (X) ) ) ) );
+#define OPER1(X) dst[(X)] -= constant * src[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::MulSub
+
+  dst[i] -= constant * src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::MulSub( float *dst, const float constant, const float *src, const int count ) {
+	if ( count < 4 ) {
+		idSIMD_Generic::MulSub( dst, constant, src, count );
+		return;
+	}
+	if ( HAS_AVX2 ) {
+		MulSub_AVX2( dst, constant, src, count );
+		return;
+	}
+	const __m128 c = _mm_set1_ps( constant );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_sub_ps( _mm_loadu_ps( dst + (X) ), _mm_mul_ps( c, _mm_loadu_ps( src + (X) ) ) ) );
+#define OPER1(X) dst[(X)] -= constant * src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+MulSub_AVX2
+============
+*/
+ID_TARGET_AVX2 static void MulSub_AVX2( float *dst, const float *src0, const float *src1, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_sub_ps( _mm256_loadu_ps( dst + (X) ), _mm256_mul_ps( _mm256_loadu_ps( src0 + (X) ), _mm256_loadu_ps( src1 + (X) ) ) ) );
+#define OPER1(X) dst[(X)] -= src0[(X)] * src1[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::MulSub
+
+  dst[i] -= src0[i] * src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::MulSub( float *dst, const float *src0, const float *src1, const int count ) {
+	if ( HAS_AVX2 ) {
+		MulSub_AVX2( dst, src0, src1, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_sub_ps( _mm_loadu_ps( dst + (X) ), _mm_mul_ps( _mm_loadu_ps( src0 + (X) ), _mm_loadu_ps( src1 + (X) ) ) ) );
+#define OPER1(X) dst[(X)] -= src0[(X)] * src1[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+
+//===============================================================
+//
+//	dot products
+//
+//===============================================================
+
+#define DRAWVERT_STRIDE		( sizeof( idDrawVert ) / sizeof( float ) )
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant * src[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idVec3 &constant, const idVec3 *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant.x );
+	const __m128 cy = _mm_set1_ps( constant.y );
+	const __m128 cz = _mm_set1_ps( constant.z );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z;
+		LoadVec3x4( src[i].ToFloatPtr(), x, y, z );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, cx ), _mm_mul_ps( y, cy ) ), _mm_mul_ps( z, cz ) ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant * src[i];
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant * src[i].Normal() + src[i][3];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idVec3 &constant, const idPlane *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant.x );
+	const __m128 cy = _mm_set1_ps( constant.y );
+	const __m128 cz = _mm_set1_ps( constant.z );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z, w;
+		LoadStrided4( src[i].ToFloatPtr(), 4, x, y, z, w );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, cx ), _mm_mul_ps( y, cy ) ), _mm_mul_ps( z, cz ) ), w ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant * src[i].Normal() + src[i][3];
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant * src[i].xyz;
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idVec3 &constant, const idDrawVert *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant.x );
+	const __m128 cy = _mm_set1_ps( constant.y );
+	const __m128 cz = _mm_set1_ps( constant.z );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z, w;
+		LoadStrided4( src[i].xyz.ToFloatPtr(), DRAWVERT_STRIDE, x, y, z, w );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, cx ), _mm_mul_ps( y, cy ) ), _mm_mul_ps( z, cz ) ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant * src[i].xyz;
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant.Normal() * src[i] + constant[3];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idPlane &constant, const idVec3 *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant[0] );
+	const __m128 cy = _mm_set1_ps( constant[1] );
+	const __m128 cz = _mm_set1_ps( constant[2] );
+	const __m128 cw = _mm_set1_ps( constant[3] );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z;
+		LoadVec3x4( src[i].ToFloatPtr(), x, y, z );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, x ), _mm_mul_ps( cy, y ) ), _mm_mul_ps( cz, z ) ), cw ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant.Normal() * src[i] + constant[3];
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant.Normal() * src[i].Normal() + constant[3] * src[i][3];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idPlane &constant, const idPlane *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant[0] );
+	const __m128 cy = _mm_set1_ps( constant[1] );
+	const __m128 cz = _mm_set1_ps( constant[2] );
+	const __m128 cw = _mm_set1_ps( constant[3] );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z, w;
+		LoadStrided4( src[i].ToFloatPtr(), 4, x, y, z, w );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, x ), _mm_mul_ps( cy, y ) ), _mm_mul_ps( cz, z ) ), _mm_mul_ps( cw, w ) ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant.Normal() * src[i].Normal() + constant[3] * src[i][3];
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = constant.Normal() * src[i].xyz + constant[3];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idPlane &constant, const idDrawVert *src, const int count ) {
+	const __m128 cx = _mm_set1_ps( constant[0] );
+	const __m128 cy = _mm_set1_ps( constant[1] );
+	const __m128 cz = _mm_set1_ps( constant[2] );
+	const __m128 cw = _mm_set1_ps( constant[3] );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z, w;
+		LoadStrided4( src[i].xyz.ToFloatPtr(), DRAWVERT_STRIDE, x, y, z, w );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, x ), _mm_mul_ps( cy, y ) ), _mm_mul_ps( cz, z ) ), cw ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = constant.Normal() * src[i].xyz + constant[3];
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dst[i] = src0[i] * src1[i];
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float *dst, const idVec3 *src0, const idVec3 *src1, const int count ) {
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x0, y0, z0, x1, y1, z1;
+		LoadVec3x4( src0[i].ToFloatPtr(), x0, y0, z0 );
+		LoadVec3x4( src1[i].ToFloatPtr(), x1, y1, z1 );
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( x0, x1 ), _mm_mul_ps( y0, y1 ) ), _mm_mul_ps( z0, z1 ) ) );
+	}
+	for ( ; i < count; i++ ) {
+		dst[i] = src0[i] * src1[i];
+	}
+}
+
+/*
+============
+Dot_AVX2
+============
+*/
+ID_TARGET_AVX2 static double Dot_AVX2( const float *src1, const float *src2, const int count ) {
+	__m256d s0 = _mm256_setzero_pd();
+	__m256d s1 = _mm256_setzero_pd();
+	int i;
+
+	for ( i = 0; i + 8 <= count; i += 8 ) {
+		__m256 p = _mm256_mul_ps( _mm256_loadu_ps( src1 + i ), _mm256_loadu_ps( src2 + i ) );
+		s0 = _mm256_add_pd( s0, _mm256_cvtps_pd( _mm256_castps256_ps128( p ) ) );
+		s1 = _mm256_add_pd( s1, _mm256_cvtps_pd( _mm256_extractf128_ps( p, 1 ) ) );
+	}
+	s0 = _mm256_add_pd( s0, s1 );
+	__m128d s = _mm_add_pd( _mm256_castpd256_pd128( s0 ), _mm256_extractf128_pd( s0, 1 ) );
+	double sum = _mm_cvtsd_f64( _mm_add_sd( s, _mm_unpackhi_pd( s, s ) ) );
+	for ( ; i < count; i++ ) {
+		sum += src1[i] * src2[i];
+	}
+	return sum;
+}
+
+/*
+============
+idSIMD_Intrinsics::Dot
+
+  dot = src1[0] * src2[0] + src1[1] * src2[1] + src1[2] * src2[2] + ...
+
+  the products are accumulated in double precision like the generic code
+============
+*/
+void VPCALL idSIMD_Intrinsics::Dot( float &dot, const float *src1, const float *src2, const int count ) {
+	if ( count < 8 ) {
+		idSIMD_Generic::Dot( dot, src1, src2, count );
+		return;
+	}
+	if ( HAS_AVX2 ) {
+		dot = (float) Dot_AVX2( src1, src2, count );
+		return;
+	}
+
+	__m128d s0 = _mm_setzero_pd();
+	__m128d s1 = _mm_setzero_pd();
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 p = _mm_mul_ps( _mm_loadu_ps( src1 + i ), _mm_loadu_ps( src2 + i ) );
+		s0 = _mm_add_pd( s0, _mm_cvtps_pd( p ) );
+		s1 = _mm_add_pd( s1, _mm_cvtps_pd( _mm_movehl_ps( p, p ) ) );
+	}
+	s0 = _mm_add_pd( s0, s1 );
+	double sum = _mm_cvtsd_f64( _mm_add_sd( s0, _mm_unpackhi_pd( s0, s0 ) ) );
+	for ( ; i < count; i++ ) {
+		sum += src1[i] * src2[i];
+	}
+	dot = (float) sum;
+}
+
+
+//===============================================================
+//
+//	compares
+//
+//===============================================================
+
+#define COMPARE_BYTES( CMP, OPER )																\
+	const __m128 c = _mm_set1_ps( constant );													\
+	const __m128i one = _mm_set1_epi8( 1 );														\
+	int i;																						\
+	for ( i = 0; i + 16 <= count; i += 16 ) {													\
+		__m128i b = PackCompareMasks( CMP( _mm_loadu_ps( src0 + i + 0 ), c ), CMP( _mm_loadu_ps( src0 + i + 4 ), c ),		\
+									CMP( _mm_loadu_ps( src0 + i + 8 ), c ), CMP( _mm_loadu_ps( src0 + i + 12 ), c ) );	\
+		_mm_storeu_si128( (__m128i *)( dst + i ), _mm_and_si128( b, one ) );					\
+	}																							\
+	for ( ; i < count; i++ ) {																	\
+		dst[i] = src0[i] OPER constant;															\
+	}
+
+#define COMPARE_BITS( CMP, OPER )																\
+	const __m128 c = _mm_set1_ps( constant );													\
+	const __m128i bit = _mm_set1_epi8( (char)( 1 << bitNum ) );									\
+	int i;																						\
+	for ( i = 0; i + 16 <= count; i += 16 ) {													\
+		__m128i b = PackCompareMasks( CMP( _mm_loadu_ps( src0 + i + 0 ), c ), CMP( _mm_loadu_ps( src0 + i + 4 ), c ),		\
+									CMP( _mm_loadu_ps( src0 + i + 8 ), c ), CMP( _mm_loadu_ps( src0 + i + 12 ), c ) );	\
+		__m128i d = _mm_loadu_si128( (const __m128i *)( dst + i ) );							\
+		_mm_storeu_si128( (__m128i *)( dst + i ), _mm_or_si128( d, _mm_and_si128( b, bit ) ) );	\
+	}																							\
+	for ( ; i < count; i++ ) {																	\
+		dst[i] |= ( src0[i] OPER constant ) << bitNum;											\
+	}
+
+/*
+============
+idSIMD_Intrinsics::CmpGT
+
+  dst[i] = src0[i] > constant;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpGT( byte *dst, const float *src0, const float constant, const int count ) {
+	COMPARE_BYTES( _mm_cmpgt_ps, > )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpGT
+
+  dst[i] |= ( src0[i] > constant ) << bitNum;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpGT( byte *dst, const byte bitNum, const float *src0, const float constant, const int count ) {
+	COMPARE_BITS( _mm_cmpgt_ps, > )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpGE
+
+  dst[i] = src0[i] >= constant;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpGE( byte *dst, const float *src0, const float constant, const int count ) {
+	COMPARE_BYTES( _mm_cmpge_ps, >= )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpGE
+
+  dst[i] |= ( src0[i] >= constant ) << bitNum;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpGE( byte *dst, const byte bitNum, const float *src0, const float constant, const int count ) {
+	COMPARE_BITS( _mm_cmpge_ps, >= )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpLT
+
+  dst[i] = src0[i] < constant;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpLT( byte *dst, const float *src0, const float constant, const int count ) {
+	COMPARE_BYTES( _mm_cmplt_ps, < )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpLT
+
+  dst[i] |= ( src0[i] < constant ) << bitNum;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpLT( byte *dst, const byte bitNum, const float *src0, const float constant, const int count ) {
+	COMPARE_BITS( _mm_cmplt_ps, < )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpLE
+
+  dst[i] = src0[i] <= constant;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpLE( byte *dst, const float *src0, const float constant, const int count ) {
+	COMPARE_BYTES( _mm_cmple_ps, <= )
+}
+
+/*
+============
+idSIMD_Intrinsics::CmpLE
+
+  dst[i] |= ( src0[i] <= constant ) << bitNum;
+============
+*/
+void VPCALL idSIMD_Intrinsics::CmpLE( byte *dst, const byte bitNum, const float *src0, const float constant, const int count ) {
+	COMPARE_BITS( _mm_cmple_ps, <= )
+}
+
+
+//===============================================================
+//
+//	bounds and clamping
+//
+//===============================================================
+
+/*
+============
+idSIMD_Intrinsics::MinMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::MinMax( float &min, float &max, const float *src, const int count ) {
+	__m128 vmin = _mm_set1_ps( idMath::INFINITY );
+	__m128 vmax = _mm_set1_ps( -idMath::INFINITY );
+	int i;
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 v = _mm_loadu_ps( src + i );
+		vmin = _mm_min_ps( vmin, v );
+		vmax = _mm_max_ps( vmax, v );
+	}
+	vmin = _mm_min_ps( vmin, _mm_movehl_ps( vmin, vmin ) );
+	vmax = _mm_max_ps( vmax, _mm_movehl_ps( vmax, vmax ) );
+	vmin = _mm_min_ss( vmin, _mm_shuffle_ps( vmin, vmin, SHUF( 1, 1, 1, 1 ) ) );
+	vmax = _mm_max_ss( vmax, _mm_shuffle_ps( vmax, vmax, SHUF( 1, 1, 1, 1 ) ) );
+	_mm_store_ss( &min, vmin );
+	_mm_store_ss( &max, vmax );
+
+	for ( ; i < count; i++ ) {
+		if ( src[i] < min ) {
+			min = src[i];
+		}
+		if ( src[i] > max ) {
+			max = src[i];
+		}
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MinMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::MinMax( idVec2 &min, idVec2 &max, const idVec2 *src, const int count ) {
+	__m128 vmin = _mm_set1_ps( idMath::INFINITY );
+	__m128 vmax = _mm_set1_ps( -idMath::INFINITY );
+	int i;
+
+	for ( i = 0; i + 2 <= count; i += 2 ) {
+		__m128 v = _mm_loadu_ps( src[i].ToFloatPtr() );
+		vmin = _mm_min_ps( vmin, v );
+		vmax = _mm_max_ps( vmax, v );
+	}
+	vmin = _mm_min_ps( vmin, _mm_movehl_ps( vmin, vmin ) );
+	vmax = _mm_max_ps( vmax, _mm_movehl_ps( vmax, vmax ) );
+	_mm_storel_pi( (__m64 *)min.ToFloatPtr(), vmin );
+	_mm_storel_pi( (__m64 *)max.ToFloatPtr(), vmax );
+
+	for ( ; i < count; i++ ) {
+		const idVec2 &v = src[i];
+		if ( v[0] < min[0] ) { min[0] = v[0]; } if ( v[0] > max[0] ) { max[0] = v[0]; }
+		if ( v[1] < min[1] ) { min[1] = v[1]; } if ( v[1] > max[1] ) { max[1] = v[1]; }
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MinMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::MinMax( idVec3 &min, idVec3 &max, const idVec3 *src, const int count ) {
+	__m128 minX, minY, minZ, maxX, maxY, maxZ;
+	float tmp[4];
+	int i;
+
+	minX = minY = minZ = _mm_set1_ps( idMath::INFINITY );
+	maxX = maxY = maxZ = _mm_set1_ps( -idMath::INFINITY );
+
+	for ( i = 0; i + 4 <= count; i += 4 ) {
+		__m128 x, y, z;
+		LoadVec3x4( src[i].ToFloatPtr(), x, y, z );
+		minX = _mm_min_ps( minX, x ); maxX = _mm_max_ps( maxX, x );
+		minY = _mm_min_ps( minY, y ); maxY = _mm_max_ps( maxY, y );
+		minZ = _mm_min_ps( minZ, z ); maxZ = _mm_max_ps( maxZ, z );
+	}
+
+	// gather the four lanes of every axis into one register and reduce them
+	__m128 w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS( minX, minY, minZ, w );
+	_mm_storeu_ps( tmp, _mm_min_ps( _mm_min_ps( minX, minY ), _mm_min_ps( minZ, w ) ) );
+	min.Set( tmp[0], tmp[1], tmp[2] );
+	w = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS( maxX, maxY, maxZ, w );
+	_mm_storeu_ps( tmp, _mm_max_ps( _mm_max_ps( maxX, maxY ), _mm_max_ps( maxZ, w ) ) );
+	max.Set( tmp[0], tmp[1], tmp[2] );
+
+	for ( ; i < count; i++ ) {
+		const idVec3 &v = src[i];
+		if ( v[0] < min[0] ) { min[0] = v[0]; } if ( v[0] > max[0] ) { max[0] = v[0]; }
+		if ( v[1] < min[1] ) { min[1] = v[1]; } if ( v[1] > max[1] ) { max[1] = v[1]; }
+		if ( v[2] < min[2] ) { min[2] = v[2]; } if ( v[2] > max[2] ) { max[2] = v[2]; }
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MinMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::MinMax( idVec3 &min, idVec3 &max, const idDrawVert *src, const int count ) {
+	__m128 vmin = _mm_set1_ps( idMath::INFINITY );
+	__m128 vmax = _mm_set1_ps( -idMath::INFINITY );
+	float tmp[4];
+
+	// the fourth lane picks up st[0] and is ignored
+	for ( int i = 0; i < count; i++ ) {
+		__m128 v = _mm_loadu_ps( src[i].xyz.ToFloatPtr() );
+		vmin = _mm_min_ps( vmin, v );
+		vmax = _mm_max_ps( vmax, v );
+	}
+	_mm_storeu_ps( tmp, vmin );
+	min.Set( tmp[0], tmp[1], tmp[2] );
+	_mm_storeu_ps( tmp, vmax );
+	max.Set( tmp[0], tmp[1], tmp[2] );
+}
+
+/*
+============
+idSIMD_Intrinsics::MinMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::MinMax( idVec3 &min, idVec3 &max, const idDrawVert *src, const int *indexes, const int count ) {
+	__m128 vmin = _mm_set1_ps( idMath::INFINITY );
+	__m128 vmax = _mm_set1_ps( -idMath::INFINITY );
+	float tmp[4];
+
+	for ( int i = 0; i < count; i++ ) {
+		__m128 v = _mm_loadu_ps( src[indexes[i]].xyz.ToFloatPtr() );
+		vmin = _mm_min_ps( vmin, v );
+		vmax = _mm_max_ps( vmax, v );
+	}
+	_mm_storeu_ps( tmp, vmin );
+	min.Set( tmp[0], tmp[1], tmp[2] );
+	_mm_storeu_ps( tmp, vmax );
+	max.Set( tmp[0], tmp[1], tmp[2] );
+}
+
+/*
+============
+idSIMD_Intrinsics::Clamp
+============
+*/
+void VPCALL idSIMD_Intrinsics::Clamp( float *dst, const float *src, const float min, const float max, const int count ) {
+	const __m128 vmin = _mm_set1_ps( min );
+	const __m128 vmax = _mm_set1_ps( max );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src + (X) ), vmin ), vmax ) );
+#define OPER1(X) dst[(X)] = src[(X)] < min ? min : src[(X)] > max ? max : src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::ClampMin
+============
+*/
+void VPCALL idSIMD_Intrinsics::ClampMin( float *dst, const float *src, const float min, const int count ) {
+	const __m128 vmin = _mm_set1_ps( min );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_max_ps( _mm_loadu_ps( src + (X) ), vmin ) );
+#define OPER1(X) dst[(X)] = src[(X)] < min ? min : src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::ClampMax
+============
+*/
+void VPCALL idSIMD_Intrinsics::ClampMax( float *dst, const float *src, const float max, const int count ) {
+	const __m128 vmax = _mm_set1_ps( max );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_min_ps( _mm_loadu_ps( src + (X) ), vmax ) );
+#define OPER1(X) dst[(X)] = src[(X)] > max ? max : src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+
+//===============================================================
+//
+//	padded 16 byte aligned arrays
+//
+//===============================================================
+
+/*
+============
+idSIMD_Intrinsics::Zero16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Zero16( float *dst, const int count ) {
+	const __m128 zero = _mm_setzero_ps();
+#define OPER4(X) _mm_storeu_ps( dst + (X), zero );
+#define OPER1(X) dst[(X)] = 0.0f;
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Negate16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Negate16( float *dst, const int count ) {
+	const __m128 sign = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_xor_ps( _mm_loadu_ps( dst + (X) ), sign ) );
+#define OPER1(X) dst[(X)] = -dst[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Copy16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Copy16( float *dst, const float *src, const int count ) {
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_loadu_ps( src + (X) ) );
+#define OPER1(X) dst[(X)] = src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::Add16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Add16( float *dst, const float *src1, const float *src2, const int count ) {
+	Add( dst, src1, src2, count );
+}
+
+/*
+============
+idSIMD_Intrinsics::Sub16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Sub16( float *dst, const float *src1, const float *src2, const int count ) {
+	Sub( dst, src1, src2, count );
+}
+
+/*
+============
+idSIMD_Intrinsics::Mul16
+============
+*/
+void VPCALL idSIMD_Intrinsics::Mul16( float *dst, const float *src1, const float constant, const int count ) {
+	Mul( dst, constant, src1, count );
+}
+
+/*
+============
+AddAssign_AVX2
+============
+*/
+ID_TARGET_AVX2 static void AddAssign_AVX2( float *dst, const float *src, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_add_ps( _mm256_loadu_ps( dst + (X) ), _mm256_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] += src[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::AddAssign16
+============
+*/
+void VPCALL idSIMD_Intrinsics::AddAssign16( float *dst, const float *src, const int count ) {
+	if ( HAS_AVX2 ) {
+		AddAssign_AVX2( dst, src, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_add_ps( _mm_loadu_ps( dst + (X) ), _mm_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] += src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+SubAssign_AVX2
+============
+*/
+ID_TARGET_AVX2 static void SubAssign_AVX2( float *dst, const float *src, const int count ) {
+#define OPER8(X) _mm256_storeu_ps( dst + (X), _mm256_sub_ps( _mm256_loadu_ps( dst + (X) ), _mm256_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] -= src[(X)];
+	UNROLL_AVX( OPER8, OPER1 )
+#undef OPER8
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::SubAssign16
+============
+*/
+void VPCALL idSIMD_Intrinsics::SubAssign16( float *dst, const float *src, const int count ) {
+	if ( HAS_AVX2 ) {
+		SubAssign_AVX2( dst, src, count );
+		return;
+	}
+#define OPER4(X) _mm_storeu_ps( dst + (X), _mm_sub_ps( _mm_loadu_ps( dst + (X) ), _mm_loadu_ps( src + (X) ) ) );
+#define OPER1(X) dst[(X)] -= src[(X)];
+	UNROLL_SSE( OPER4, OPER1 )
+#undef OPER4
+#undef OPER1
+}
+
+/*
+============
+idSIMD_Intrinsics::MulAssign16
+============
+*/
+void VPCALL idSIMD_Intrinsics::MulAssign16( float *dst, const float constant, const int count ) {
+	Mul( dst, constant, dst, count );
+}
+
+
+//===============================================================
+//
+//	matrix * vector
+//
+//	Four (SSE2) or eight (AVX2) rows or columns are processed side by
+//	side, one per lane, and the products are summed column by column
+//	in the same order as the generic code.
+//
+//===============================================================
+
+#define MATX_ASSIGN		0
+#define MATX_ADD		1
+#define MATX_SUB		2
+
+/*
+============
+StoreMatXResult
+============
+*/
+static ID_INLINE void StoreMatXResult( float *dst, const __m128 sum, const int op ) {
+	switch( op ) {
+		case MATX_ASSIGN: _mm_storeu_ps( dst, sum ); break;
+		case MATX_ADD: _mm_storeu_ps( dst, _mm_add_ps( _mm_loadu_ps( dst ), sum ) ); break;
+		case MATX_SUB: _mm_storeu_ps( dst, _mm_sub_ps( _mm_loadu_ps( dst ), sum ) ); break;
+	}
+}
+
+/*
+============
+StoreMatXResult
+============
+*/
+static ID_INLINE void StoreMatXResult( float *dst, const float sum, const int op ) {
+	switch( op ) {
+		case MATX_ASSIGN: *dst = sum; break;
+		case MATX_ADD: *dst += sum; break;
+		case MATX_SUB: *dst -= sum; break;
+	}
+}
+
+/*
+============
+MatX_MultiplyVecX_AVX2
+
+  returns the first row that was not processed
+============
+*/
+ID_TARGET_AVX2 static int MatX_MultiplyVecX_AVX2( float *dstPtr, const float *mPtr, const float *vPtr, const int numRows, const int numColumns, const int op ) {
+	int i, j;
+
+	for ( i = 0; i + 8 <= numRows; i += 8 ) {
+		const float *m = mPtr + i * numColumns;
+		__m256 sum = _mm256_setzero_ps();
+
+		for ( j = 0; j + 4 <= numColumns; j += 4 ) {
+			__m128 a0, a1, a2, a3, b0, b1, b2, b3;
+			LoadStrided4( m + j, numColumns, a0, a1, a2, a3 );
+			LoadStrided4( m + 4 * numColumns + j, numColumns, b0, b1, b2, b3 );
+			__m256 c0 = _mm256_insertf128_ps( _mm256_castps128_ps256( a0 ), b0, 1 );
+			__m256 c1 = _mm256_insertf128_ps( _mm256_castps128_ps256( a1 ), b1, 1 );
+			__m256 c2 = _mm256_insertf128_ps( _mm256_castps128_ps256( a2 ), b2, 1 );
+			__m256 c3 = _mm256_insertf128_ps( _mm256_castps128_ps256( a3 ), b3, 1 );
+			if ( j == 0 ) {
+				sum = _mm256_mul_ps( c0, _mm256_set1_ps( vPtr[0] ) );
+			} else {
+				sum = _mm256_add_ps( sum, _mm256_mul_ps( c0, _mm256_set1_ps( vPtr[j+0] ) ) );
+			}
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( c1, _mm256_set1_ps( vPtr[j+1] ) ) );
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( c2, _mm256_set1_ps( vPtr[j+2] ) ) );
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( c3, _mm256_set1_ps( vPtr[j+3] ) ) );
+		}
+		for ( ; j < numColumns; j++ ) {
+			const float *c = m + j;
+			__m256 col = _mm256_set_ps( c[7*numColumns], c[6*numColumns], c[5*numColumns], c[4*numColumns],
+										c[3*numColumns], c[2*numColumns], c[1*numColumns], c[0] );
+			if ( j == 0 ) {
+				sum = _mm256_mul_ps( col, _mm256_set1_ps( vPtr[0] ) );
+			} else {
+				sum = _mm256_add_ps( sum, _mm256_mul_ps( col, _mm256_set1_ps( vPtr[j] ) ) );
+			}
+		}
+
+		switch( op ) {
+			case MATX_ASSIGN: _mm256_storeu_ps( dstPtr + i, sum ); break;
+			case MATX_ADD: _mm256_storeu_ps( dstPtr + i, _mm256_add_ps( _mm256_loadu_ps( dstPtr + i ), sum ) ); break;
+			case MATX_SUB: _mm256_storeu_ps( dstPtr + i, _mm256_sub_ps( _mm256_loadu_ps( dstPtr + i ), sum ) ); break;
+		}
+	}
+	return i;
+}
+
+/*
+============
+MatX_MultiplyVecX_SSE2
+============
+*/
+static void MatX_MultiplyVecX_SSE2( float *dstPtr, const float *mPtr, const float *vPtr, const int firstRow, const int numRows, const int numColumns, const int op ) {
+	int i, j;
+
+	for ( i = firstRow; i + 4 <= numRows; i += 4 ) {
+		const float *m = mPtr + i * numColumns;
+		__m128 sum = _mm_setzero_ps();
+
+		for ( j = 0; j + 4 <= numColumns; j += 4 ) {
+			__m128 c0, c1, c2, c3;
+			LoadStrided4( m + j, numColumns, c0, c1, c2, c3 );
+			if ( j == 0 ) {
+				sum = _mm_mul_ps( c0, _mm_set1_ps( vPtr[0] ) );
+			} else {
+				sum = _mm_add_ps( sum, _mm_mul_ps( c0, _mm_set1_ps( vPtr[j+0] ) ) );
+			}
+			sum = _mm_add_ps( sum, _mm_mul_ps( c1, _mm_set1_ps( vPtr[j+1] ) ) );
+			sum = _mm_add_ps( sum, _mm_mul_ps( c2, _mm_set1_ps( vPtr[j+2] ) ) );
+			sum = _mm_add_ps( sum, _mm_mul_ps( c3, _mm_set1_ps( vPtr[j+3] ) ) );
+		}
+		for ( ; j < numColumns; j++ ) {
+			const float *c = m + j;
+			__m128 col = _mm_set_ps( c[3*numColumns], c[2*numColumns], c[1*numColumns], c[0] );
+			if ( j == 0 ) {
+				sum = _mm_mul_ps( col, _mm_set1_ps( vPtr[0] ) );
+			} else {
+				sum = _mm_add_ps( sum, _mm_mul_ps( col, _mm_set1_ps( vPtr[j] ) ) );
+			}
+		}
+
+		StoreMatXResult( dstPtr + i, sum, op );
+	}
+
+	for ( ; i < numRows; i++ ) {
+		const float *m = mPtr + i * numColumns;
+		float sum = m[0] * vPtr[0];
+		for ( j = 1; j < numColumns; j++ ) {
+			sum += m[j] * vPtr[j];
+		}
+		StoreMatXResult( dstPtr + i, sum, op );
+	}
+}
+
+/*
+============
+MatX_TransposeMultiplyVecX_AVX2
+
+  returns the first column that was not processed
+============
+*/
+ID_TARGET_AVX2 static int MatX_TransposeMultiplyVecX_AVX2( float *dstPtr, const float *mPtr, const float *vPtr, const int numRows, const int numColumns, const int op ) {
+	int i, j;
+
+	for ( i = 0; i + 8 <= numColumns; i += 8 ) {
+		const float *m = mPtr + i;
+		__m256 sum = _mm256_mul_ps( _mm256_loadu_ps( m ), _mm256_set1_ps( vPtr[0] ) );
+		for ( j = 1; j < numRows; j++ ) {
+			m += numColumns;
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_loadu_ps( m ), _mm256_set1_ps( vPtr[j] ) ) );
+		}
+
+		switch( op ) {
+			case MATX_ASSIGN: _mm256_storeu_ps( dstPtr + i, sum ); break;
+			case MATX_ADD: _mm256_storeu_ps( dstPtr + i, _mm256_add_ps( _mm256_loadu_ps( dstPtr + i ), sum ) ); break;
+			case MATX_SUB: _mm256_storeu_ps( dstPtr + i, _mm256_sub_ps( _mm256_loadu_ps( dstPtr + i ), sum ) ); break;
+		}
+	}
+	return i;
+}
+
+/*
+============
+MatX_TransposeMultiplyVecX_SSE2
+============
+*/
+static void MatX_TransposeMultiplyVecX_SSE2( float *dstPtr, const float *mPtr, const float *vPtr, const int firstColumn, const int numRows, const int numColumns, const int op ) {
+	int i, j;
+
+	for ( i = firstColumn; i + 4 <= numColumns; i += 4 ) {
+		const float *m = mPtr + i;
+		__m128 sum = _mm_mul_ps( _mm_loadu_ps( m ), _mm_set1_ps( vPtr[0] ) );
+		for ( j = 1; j < numRows; j++ ) {
+			m += numColumns;
+			sum = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( m ), _mm_set1_ps( vPtr[j] ) ) );
+		}
+		StoreMatXResult( dstPtr + i, sum, op );
+	}
+
+	for ( ; i < numColumns; i++ ) {
+		const float *m = mPtr + i;
+		float sum = m[0] * vPtr[0];
+		for ( j = 1; j < numRows; j++ ) {
+			m += numColumns;
+			sum += m[0] * vPtr[j];
+		}
+		StoreMatXResult( dstPtr + i, sum, op );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_MultiplyVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_MultiplyVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumColumns() );
+	assert( dst.GetSize() >= mat.GetNumRows() );
+
+	// the generic code has unrolled paths for up to six columns
+	if ( mat.GetNumColumns() <= 6 ) {
+		idSIMD_Generic::MatX_MultiplyVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_MultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_ASSIGN );
+	}
+	MatX_MultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_ASSIGN );
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_MultiplyAddVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_MultiplyAddVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumColumns() );
+	assert( dst.GetSize() >= mat.GetNumRows() );
+
+	if ( mat.GetNumColumns() <= 6 ) {
+		idSIMD_Generic::MatX_MultiplyAddVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_MultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_ADD );
+	}
+	MatX_MultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_ADD );
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_MultiplySubVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_MultiplySubVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumColumns() );
+	assert( dst.GetSize() >= mat.GetNumRows() );
+
+	if ( mat.GetNumColumns() <= 6 ) {
+		idSIMD_Generic::MatX_MultiplySubVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_MultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_SUB );
+	}
+	MatX_MultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_SUB );
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_TransposeMultiplyVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_TransposeMultiplyVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumRows() );
+	assert( dst.GetSize() >= mat.GetNumColumns() );
+
+	// the generic code has unrolled paths for up to six rows
+	if ( mat.GetNumRows() <= 6 ) {
+		idSIMD_Generic::MatX_TransposeMultiplyVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_TransposeMultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_ASSIGN );
+	}
+	MatX_TransposeMultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_ASSIGN );
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_TransposeMultiplyAddVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_TransposeMultiplyAddVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumRows() );
+	assert( dst.GetSize() >= mat.GetNumColumns() );
+
+	if ( mat.GetNumRows() <= 6 ) {
+		idSIMD_Generic::MatX_TransposeMultiplyAddVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_TransposeMultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_ADD );
+	}
+	MatX_TransposeMultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_ADD );
+}
+
+/*
+============
+idSIMD_Intrinsics::MatX_TransposeMultiplySubVecX
+============
+*/
+void VPCALL idSIMD_Intrinsics::MatX_TransposeMultiplySubVecX( idVecX &dst, const idMatX &mat, const idVecX &vec ) {
+	assert( vec.GetSize() >= mat.GetNumRows() );
+	assert( dst.GetSize() >= mat.GetNumColumns() );
+
+	if ( mat.GetNumRows() <= 6 ) {
+		idSIMD_Generic::MatX_TransposeMultiplySubVecX( dst, mat, vec );
+		return;
+	}
+
+	int first = 0;
+	if ( HAS_AVX2 ) {
+		first = MatX_TransposeMultiplyVecX_AVX2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), mat.GetNumRows(), mat.GetNumColumns(), MATX_SUB );
+	}
+	MatX_TransposeMultiplyVecX_SSE2( dst.ToFloatPtr(), mat.ToFloatPtr(), vec.ToFloatPtr(), first, mat.GetNumRows(), mat.GetNumColumns(), MATX_SUB );
+}
+
+
+//===============================================================
+//
+//	skinning
+//
+//===============================================================
+
+#define JOINTQUAT_STRIDE	( sizeof( idJointQuat ) / sizeof( float ) )
+
+/*
+============
+Select
+
+  returns a where the mask is set and b elsewhere
+============
+*/
+static ID_INLINE __m128 Select( const __m128 mask, const __m128 a, const __m128 b ) {
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+/*
+============
+idSIMD_Intrinsics::BlendJoints
+
+  Slerps four quaternions at a time with the same approximations as idQuat::Slerp.
+  Both angles passed to the sine are in [0, pi/2] so no range reduction is needed.
+============
+*/
+void VPCALL idSIMD_Intrinsics::BlendJoints( idJointQuat *joints, const idJointQuat *blendJoints, const float lerp, const int *index, const int numJoints ) {
+	int i;
+
+	if ( lerp <= 0.0f ) {
+		return;
+	}
+	if ( lerp >= 1.0f ) {
+		for ( i = 0; i < numJoints; i++ ) {
+			int j = index[i];
+			joints[j] = blendJoints[j];
+		}
+		return;
+	}
+
+	const __m128 signMask = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 vlerp = _mm_set1_ps( lerp );
+	const __m128 vinvLerp = _mm_set1_ps( 1.0f - lerp );
+
+	for ( i = 0; i + 4 <= numJoints; i += 4 ) {
+		float *q0 = joints[index[i+0]].q.ToFloatPtr();
+		float *q1 = joints[index[i+1]].q.ToFloatPtr();
+		float *q2 = joints[index[i+2]].q.ToFloatPtr();
+		float *q3 = joints[index[i+3]].q.ToFloatPtr();
+
+		__m128 fx = _mm_loadu_ps( q0 ), fy = _mm_loadu_ps( q1 ), fz = _mm_loadu_ps( q2 ), fw = _mm_loadu_ps( q3 );
+		_MM_TRANSPOSE4_PS( fx, fy, fz, fw );
+		__m128 tx = _mm_loadu_ps( blendJoints[index[i+0]].q.ToFloatPtr() );
+		__m128 ty = _mm_loadu_ps( blendJoints[index[i+1]].q.ToFloatPtr() );
+		__m128 tz = _mm_loadu_ps( blendJoints[index[i+2]].q.ToFloatPtr() );
+		__m128 tw = _mm_loadu_ps( blendJoints[index[i+3]].q.ToFloatPtr() );
+		_MM_TRANSPOSE4_PS( tx, ty, tz, tw );
+
+		__m128 cosom = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( fx, tx ), _mm_mul_ps( fy, ty ) ), _mm_mul_ps( fz, tz ) ), _mm_mul_ps( fw, tw ) );
+		__m128 sign = _mm_and_ps( cosom, signMask );
+		cosom = _mm_xor_ps( cosom, sign );
+		tx = _mm_xor_ps( tx, sign );
+		ty = _mm_xor_ps( ty, sign );
+		tz = _mm_xor_ps( tz, sign );
+		tw = _mm_xor_ps( tw, sign );
+
+		// scale0 = 1 - cosom * cosom, sinom = 1 / sqrt( scale0 )
+		__m128 scale0 = _mm_sub_ps( one, _mm_mul_ps( cosom, cosom ) );
+		__m128 sinom = _mm_rsqrt_ps( scale0 );
+		sinom = _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ), sinom ), _mm_sub_ps( _mm_set1_ps( 3.0f ), _mm_mul_ps( _mm_mul_ps( scale0, sinom ), sinom ) ) );
+
+		// omega = idMath::ATan16( scale0 * sinom, cosom ), both arguments are positive
+		__m128 y = _mm_mul_ps( scale0, sinom );
+		__m128 big = _mm_cmpgt_ps( y, cosom );
+		__m128 a = _mm_div_ps( Select( big, cosom, y ), Select( big, y, cosom ) );
+		__m128 s = _mm_mul_ps( a, a );
+		__m128 p = _mm_set1_ps( 0.0028662257f );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( -0.0161657367f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( 0.0429096138f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( -0.0752896400f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( 0.1065626393f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( -0.1420889944f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( 0.1999355085f ) );
+		p = _mm_add_ps( _mm_mul_ps( p, s ), _mm_set1_ps( -0.3333314528f ) );
+		p = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( p, s ), one ), a );
+		__m128 omega = Select( big, _mm_sub_ps( _mm_set1_ps( idMath::HALF_PI ), p ), p );
+
+		// scale0 = idMath::Sin16( ( 1 - lerp ) * omega ) * sinom, scale1 = idMath::Sin16( lerp * omega ) * sinom
+		__m128 a0 = _mm_mul_ps( vinvLerp, omega );
+		__m128 a1 = _mm_mul_ps( vlerp, omega );
+		__m128 s0 = _mm_mul_ps( a0, a0 );
+		__m128 s1 = _mm_mul_ps( a1, a1 );
+		__m128 p0 = _mm_set1_ps( -2.39e-08f );
+		__m128 p1 = p0;
+		p0 = _mm_add_ps( _mm_mul_ps( p0, s0 ), _mm_set1_ps( 2.7526e-06f ) );
+		p1 = _mm_add_ps( _mm_mul_ps( p1, s1 ), _mm_set1_ps( 2.7526e-06f ) );
+		p0 = _mm_add_ps( _mm_mul_ps( p0, s0 ), _mm_set1_ps( -1.98409e-04f ) );
+		p1 = _mm_add_ps( _mm_mul_ps( p1, s1 ), _mm_set1_ps( -1.98409e-04f ) );
+		p0 = _mm_add_ps( _mm_mul_ps( p0, s0 ), _mm_set1_ps( 8.3333315e-03f ) );
+		p1 = _mm_add_ps( _mm_mul_ps( p1, s1 ), _mm_set1_ps( 8.3333315e-03f ) );
+		p0 = _mm_add_ps( _mm_mul_ps( p0, s0 ), _mm_set1_ps( -1.666666664e-01f ) );
+		p1 = _mm_add_ps( _mm_mul_ps( p1, s1 ), _mm_set1_ps( -1.666666664e-01f ) );
+		p0 = _mm_mul_ps( a0, _mm_add_ps( _mm_mul_ps( p0, s0 ), one ) );
+		p1 = _mm_mul_ps( a1, _mm_add_ps( _mm_mul_ps( p1, s1 ), one ) );
+
+		// nearly identical quaternions are interpolated linearly
+		__m128 linear = _mm_cmple_ps( _mm_sub_ps( one, cosom ), _mm_set1_ps( 1e-6f ) );
+		scale0 = Select( linear, vinvLerp, _mm_mul_ps( p0, sinom ) );
+		__m128 scale1 = Select( linear, vlerp, _mm_mul_ps( p1, sinom ) );
+
+		fx = _mm_add_ps( _mm_mul_ps( scale0, fx ), _mm_mul_ps( scale1, tx ) );
+		fy = _mm_add_ps( _mm_mul_ps( scale0, fy ), _mm_mul_ps( scale1, ty ) );
+		fz = _mm_add_ps( _mm_mul_ps( scale0, fz ), _mm_mul_ps( scale1, tz ) );
+		fw = _mm_add_ps( _mm_mul_ps( scale0, fw ), _mm_mul_ps( scale1, tw ) );
+		_MM_TRANSPOSE4_PS( fx, fy, fz, fw );
+		_mm_storeu_ps( q0, fx );
+		_mm_storeu_ps( q1, fy );
+		_mm_storeu_ps( q2, fz );
+		_mm_storeu_ps( q3, fw );
+
+		for ( int k = 0; k < 4; k++ ) {
+			int j = index[i+k];
+			joints[j].t.Lerp( joints[j].t, blendJoints[j].t, lerp );
+		}
+	}
+
+	for ( ; i < numJoints; i++ ) {
+		int j = index[i];
+		joints[j].q.Slerp( joints[j].q, blendJoints[j].q, lerp );
+		joints[j].t.Lerp( joints[j].t, blendJoints[j].t, lerp );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::ConvertJointQuatsToJointMats
+============
+*/
+void VPCALL idSIMD_Intrinsics::ConvertJointQuatsToJointMats( idJointMat *jointMats, const idJointQuat *jointQuats, const int numJoints ) {
+	const __m128 one = _mm_set1_ps( 1.0f );
+	int i;
+
+	for ( i = 0; i + 4 <= numJoints; i += 4 ) {
+		const idJointQuat *jq = jointQuats + i;
+		__m128 x, y, z, w;
+		LoadStrided4( jq[0].q.ToFloatPtr(), JOINTQUAT_STRIDE, x, y, z, w );
+		__m128 tx = _mm_set_ps( jq[3].t.x, jq[2].t.x, jq[1].t.x, jq[0].t.x );
+		__m128 ty = _mm_set_ps( jq[3].t.y, jq[2].t.y, jq[1].t.y, jq[0].t.y );
+		__m128 tz = _mm_set_ps( jq[3].t.z, jq[2].t.z, jq[1].t.z, jq[0].t.z );
+
+		__m128 x2 = _mm_add_ps( x, x );
+		__m128 y2 = _mm_add_ps( y, y );
+		__m128 z2 = _mm_add_ps( z, z );
+
+		__m128 xx = _mm_mul_ps( x, x2 );
+		__m128 xy = _mm_mul_ps( x, y2 );
+		__m128 xz = _mm_mul_ps( x, z2 );
+		__m128 yy = _mm_mul_ps( y, y2 );
+		__m128 yz = _mm_mul_ps( y, z2 );
+		__m128 zz = _mm_mul_ps( z, z2 );
+		__m128 wx = _mm_mul_ps( w, x2 );
+		__m128 wy = _mm_mul_ps( w, y2 );
+		__m128 wz = _mm_mul_ps( w, z2 );
+
+		// rows of the joint matrix are the columns of idQuat::ToMat3
+		__m128 m00 = _mm_sub_ps( one, _mm_add_ps( yy, zz ) );
+		__m128 m01 = _mm_add_ps( xy, wz );
+		__m128 m02 = _mm_sub_ps( xz, wy );
+		__m128 m10 = _mm_sub_ps( xy, wz );
+		__m128 m11 = _mm_sub_ps( one, _mm_add_ps( xx, zz ) );
+		__m128 m12 = _mm_add_ps( yz, wx );
+		__m128 m20 = _mm_add_ps( xz, wy );
+		__m128 m21 = _mm_sub_ps( yz, wx );
+		__m128 m22 = _mm_sub_ps( one, _mm_add_ps( xx, yy ) );
+
+		_MM_TRANSPOSE4_PS( m00, m01, m02, tx );
+		_MM_TRANSPOSE4_PS( m10, m11, m12, ty );
+		_MM_TRANSPOSE4_PS( m20, m21, m22, tz );
+
+		float *m = jointMats[i].ToFloatPtr();
+		_mm_storeu_ps( m + 0 * 12 + 0, m00 );
+		_mm_storeu_ps( m + 0 * 12 + 4, m10 );
+		_mm_storeu_ps( m + 0 * 12 + 8, m20 );
+		_mm_storeu_ps( m + 1 * 12 + 0, m01 );
+		_mm_storeu_ps( m + 1 * 12 + 4, m11 );
+		_mm_storeu_ps( m + 1 * 12 + 8, m21 );
+		_mm_storeu_ps( m + 2 * 12 + 0, m02 );
+		_mm_storeu_ps( m + 2 * 12 + 4, m12 );
+		_mm_storeu_ps( m + 2 * 12 + 8, m22 );
+		_mm_storeu_ps( m + 3 * 12 + 0, tx );
+		_mm_storeu_ps( m + 3 * 12 + 4, ty );
+		_mm_storeu_ps( m + 3 * 12 + 8, tz );
+	}
+
+	for ( ; i < numJoints; i++ ) {
+		jointMats[i].SetRotation( jointQuats[i].q.ToMat3() );
+		jointMats[i].SetTranslation( jointQuats[i].t );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::TransformJoints
+
+  jointMats[i] *= jointMats[parents[i]] with the rows kept in registers
+============
+*/
+void VPCALL idSIMD_Intrinsics::TransformJoints( idJointMat *jointMats, const int *parents, const int firstJoint, const int lastJoint ) {
+	const __m128 maskW = _mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) );
+
+	for ( int i = firstJoint; i <= lastJoint; i++ ) {
+		assert( parents[i] < i );
+		float *m = jointMats[i].ToFloatPtr();
+		const float *a = jointMats[parents[i]].ToFloatPtr();
+
+		__m128 r0 = _mm_loadu_ps( m + 0 );
+		__m128 r1 = _mm_loadu_ps( m + 4 );
+		__m128 r2 = _mm_loadu_ps( m + 8 );
+
+		for ( int k = 0; k < 3; k++ ) {
+			const float *ak = a + k * 4;
+			__m128 n = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r0, _mm_set1_ps( ak[0] ) ), _mm_mul_ps( r1, _mm_set1_ps( ak[1] ) ) ), _mm_mul_ps( r2, _mm_set1_ps( ak[2] ) ) );
+			_mm_storeu_ps( m + k * 4, _mm_add_ps( n, _mm_and_ps( _mm_loadu_ps( ak ), maskW ) ) );
+		}
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::UntransformJoints
+
+  jointMats[i] /= jointMats[parents[i]] with the rows kept in registers
+============
+*/
+void VPCALL idSIMD_Intrinsics::UntransformJoints( idJointMat *jointMats, const int *parents, const int firstJoint, const int lastJoint ) {
+	const __m128 maskW = _mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) );
+
+	for ( int i = lastJoint; i >= firstJoint; i-- ) {
+		assert( parents[i] < i );
+		float *m = jointMats[i].ToFloatPtr();
+		const float *a = jointMats[parents[i]].ToFloatPtr();
+
+		__m128 r0 = _mm_sub_ps( _mm_loadu_ps( m + 0 ), _mm_and_ps( _mm_loadu_ps( a + 0 ), maskW ) );
+		__m128 r1 = _mm_sub_ps( _mm_loadu_ps( m + 4 ), _mm_and_ps( _mm_loadu_ps( a + 4 ), maskW ) );
+		__m128 r2 = _mm_sub_ps( _mm_loadu_ps( m + 8 ), _mm_and_ps( _mm_loadu_ps( a + 8 ), maskW ) );
+
+		for ( int k = 0; k < 3; k++ ) {
+			__m128 n = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r0, _mm_set1_ps( a[0 * 4 + k] ) ), _mm_mul_ps( r1, _mm_set1_ps( a[1 * 4 + k] ) ) ), _mm_mul_ps( r2, _mm_set1_ps( a[2 * 4 + k] ) ) );
+			_mm_storeu_ps( m + k * 4, n );
+		}
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::TransformVerts
+
+  the weighted joint rows are summed first and reduced once per vertex
+============
+*/
+void VPCALL idSIMD_Intrinsics::TransformVerts( idDrawVert *verts, const int numVerts, const idJointMat *joints, const idVec4 *weights, const int *index, const int numWeights ) {
+	const byte *jointsPtr = (byte *)joints;
+	int i, j;
+
+	for ( j = i = 0; i < numVerts; i++ ) {
+		const float *m = (const float *)( jointsPtr + index[j*2+0] );
+		__m128 w = _mm_loadu_ps( weights[j].ToFloatPtr() );
+		__m128 r0 = _mm_mul_ps( _mm_loadu_ps( m + 0 ), w );
+		__m128 r1 = _mm_mul_ps( _mm_loadu_ps( m + 4 ), w );
+		__m128 r2 = _mm_mul_ps( _mm_loadu_ps( m + 8 ), w );
+
+		while( index[j*2+1] == 0 ) {
+			j++;
+			m = (const float *)( jointsPtr + index[j*2+0] );
+			w = _mm_loadu_ps( weights[j].ToFloatPtr() );
+			r0 = _mm_add_ps( r0, _mm_mul_ps( _mm_loadu_ps( m + 0 ), w ) );
+			r1 = _mm_add_ps( r1, _mm_mul_ps( _mm_loadu_ps( m + 4 ), w ) );
+			r2 = _mm_add_ps( r2, _mm_mul_ps( _mm_loadu_ps( m + 8 ), w ) );
+		}
+		j++;
+
+		__m128 r3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+		StoreVec3( verts[i].xyz.ToFloatPtr(), _mm_add_ps( _mm_add_ps( _mm_add_ps( r0, r1 ), r2 ), r3 ) );
+	}
+}
+
+/*
+============
+LoadDrawVerts4
+
+  gathers the xyz and st of four vertices into separate registers
+============
+*/
+static ID_INLINE void LoadDrawVerts4( const idDrawVert *v[4], __m128 &x, __m128 &y, __m128 &z, __m128 &s, __m128 &t ) {
+	x = _mm_loadu_ps( v[0]->xyz.ToFloatPtr() );
+	y = _mm_loadu_ps( v[1]->xyz.ToFloatPtr() );
+	z = _mm_loadu_ps( v[2]->xyz.ToFloatPtr() );
+	s = _mm_loadu_ps( v[3]->xyz.ToFloatPtr() );
+	_MM_TRANSPOSE4_PS( x, y, z, s );
+	t = _mm_set_ps( v[3]->st[1], v[2]->st[1], v[1]->st[1], v[0]->st[1] );
+}
+
+/*
+============
+idSIMD_Intrinsics::DeriveTangents
+
+	Derives the normal and orthogonal tangent vectors for the triangle vertices.
+	The per triangle vectors and planes of four triangles are calculated at once,
+	the accumulation into the shared vertices stays sequential.
+============
+*/
+void VPCALL idSIMD_Intrinsics::DeriveTangents( idPlane *planes, idDrawVert *verts, const int numVerts, const int *indexes, const int numIndexes ) {
+	const __m128 signMask = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+	ALIGN16( float n[3][4] );
+	ALIGN16( float t0[3][4] );
+	ALIGN16( float t1[3][4] );
+	ALIGN16( float d[4] );
+	int i, k;
+
+	bool *used = (bool *)_alloca16( numVerts * sizeof( used[0] ) );
+	memset( used, 0, numVerts * sizeof( used[0] ) );
+
+	idPlane *planesPtr = planes;
+	for ( i = 0; i < numIndexes; i += 4 * 3 ) {
+		const idDrawVert *a[4], *b[4], *c[4];
+		int numTris = ( numIndexes - i ) / 3;
+		if ( numTris > 4 ) {
+			numTris = 4;
+		}
+
+		// unused lanes repeat the first triangle
+		for ( k = 0; k < 4; k++ ) {
+			const int *tri = indexes + i + ( k < numTris ? k : 0 ) * 3;
+			a[k] = verts + tri[0];
+			b[k] = verts + tri[1];
+			c[k] = verts + tri[2];
+		}
+
+		__m128 ax, ay, az, as, at, bx, by, bz, bs, bt, cx, cy, cz, cs, ct;
+		LoadDrawVerts4( a, ax, ay, az, as, at );
+		LoadDrawVerts4( b, bx, by, bz, bs, bt );
+		LoadDrawVerts4( c, cx, cy, cz, cs, ct );
+
+		__m128 d00 = _mm_sub_ps( bx, ax );
+		__m128 d01 = _mm_sub_ps( by, ay );
+		__m128 d02 = _mm_sub_ps( bz, az );
+		__m128 d03 = _mm_sub_ps( bs, as );
+		__m128 d04 = _mm_sub_ps( bt, at );
+
+		__m128 d10 = _mm_sub_ps( cx, ax );
+		__m128 d11 = _mm_sub_ps( cy, ay );
+		__m128 d12 = _mm_sub_ps( cz, az );
+		__m128 d13 = _mm_sub_ps( cs, as );
+		__m128 d14 = _mm_sub_ps( ct, at );
+
+		// normal
+		__m128 nx = _mm_sub_ps( _mm_mul_ps( d11, d02 ), _mm_mul_ps( d12, d01 ) );
+		__m128 ny = _mm_sub_ps( _mm_mul_ps( d12, d00 ), _mm_mul_ps( d10, d02 ) );
+		__m128 nz = _mm_sub_ps( _mm_mul_ps( d10, d01 ), _mm_mul_ps( d11, d00 ) );
+
+		__m128 f = RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, nx ), _mm_mul_ps( ny, ny ) ), _mm_mul_ps( nz, nz ) ) );
+		nx = _mm_mul_ps( nx, f );
+		ny = _mm_mul_ps( ny, f );
+		nz = _mm_mul_ps( nz, f );
+
+		__m128 dist = _mm_xor_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, ax ), _mm_mul_ps( ny, ay ) ), _mm_mul_ps( nz, az ) ), signMask );
+
+		// area sign bit
+		__m128 signBit = _mm_and_ps( _mm_sub_ps( _mm_mul_ps( d03, d14 ), _mm_mul_ps( d04, d13 ) ), signMask );
+
+		// first tangent
+		__m128 t0x = _mm_sub_ps( _mm_mul_ps( d00, d14 ), _mm_mul_ps( d04, d10 ) );
+		__m128 t0y = _mm_sub_ps( _mm_mul_ps( d01, d14 ), _mm_mul_ps( d04, d11 ) );
+		__m128 t0z = _mm_sub_ps( _mm_mul_ps( d02, d14 ), _mm_mul_ps( d04, d12 ) );
+
+		f = _mm_xor_ps( RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( t0x, t0x ), _mm_mul_ps( t0y, t0y ) ), _mm_mul_ps( t0z, t0z ) ) ), signBit );
+		_mm_store_ps( t0[0], _mm_mul_ps( t0x, f ) );
+		_mm_store_ps( t0[1], _mm_mul_ps( t0y, f ) );
+		_mm_store_ps( t0[2], _mm_mul_ps( t0z, f ) );
+
+		// second tangent
+		__m128 t1x = _mm_sub_ps( _mm_mul_ps( d03, d10 ), _mm_mul_ps( d00, d13 ) );
+		__m128 t1y = _mm_sub_ps( _mm_mul_ps( d03, d11 ), _mm_mul_ps( d01, d13 ) );
+		__m128 t1z = _mm_sub_ps( _mm_mul_ps( d03, d12 ), _mm_mul_ps( d02, d13 ) );
+
+		f = _mm_xor_ps( RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( t1x, t1x ), _mm_mul_ps( t1y, t1y ) ), _mm_mul_ps( t1z, t1z ) ) ), signBit );
+		_mm_store_ps( t1[0], _mm_mul_ps( t1x, f ) );
+		_mm_store_ps( t1[1], _mm_mul_ps( t1y, f ) );
+		_mm_store_ps( t1[2], _mm_mul_ps( t1z, f ) );
+
+		_mm_store_ps( n[0], nx );
+		_mm_store_ps( n[1], ny );
+		_mm_store_ps( n[2], nz );
+		_mm_store_ps( d, dist );
+
+		for ( k = 0; k < numTris; k++ ) {
+			idVec3 vn( n[0][k], n[1][k], n[2][k] );
+			idVec3 vt0( t0[0][k], t0[1][k], t0[2][k] );
+			idVec3 vt1( t1[0][k], t1[1][k], t1[2][k] );
+
+			planesPtr->SetNormal( vn );
+			( *planesPtr )[3] = d[k];
+			planesPtr++;
+
+			const int *tri = indexes + i + k * 3;
+			for ( int l = 0; l < 3; l++ ) {
+				idDrawVert *v = verts + tri[l];
+				if ( used[tri[l]] ) {
+					v->normal += vn;
+					v->tangents[0] += vt0;
+					v->tangents[1] += vt1;
+				} else {
+					v->normal = vn;
+					v->tangents[0] = vt0;
+					v->tangents[1] = vt1;
+					used[tri[l]] = true;
+				}
+			}
+		}
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::NormalizeTangents
+
+	Normalizes each vertex normal and projects and normalizes the
+	tangent vectors onto the plane orthogonal to the vertex normal.
+============
+*/
+void VPCALL idSIMD_Intrinsics::NormalizeTangents( idDrawVert *verts, const int numVerts ) {
+	int i;
+
+	for ( i = 0; i + 4 <= numVerts; i += 4 ) {
+		__m128 nx, ny, nz, nw;
+		__m128 ux, uy, uz, uw;
+		__m128 vx, vy, vz, vw;
+
+		// the fourth lane of each load is the first float of the next vector and is ignored
+		LoadStrided4( verts[i].normal.ToFloatPtr(), DRAWVERT_STRIDE, nx, ny, nz, nw );
+		LoadStrided4( verts[i].tangents[0].ToFloatPtr(), DRAWVERT_STRIDE, ux, uy, uz, uw );
+		LoadStrided4( verts[i].tangents[1].ToFloatPtr(), DRAWVERT_STRIDE, vx, vy, vz, vw );
+
+		__m128 f = RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, nx ), _mm_mul_ps( ny, ny ) ), _mm_mul_ps( nz, nz ) ) );
+		nx = _mm_mul_ps( nx, f );
+		ny = _mm_mul_ps( ny, f );
+		nz = _mm_mul_ps( nz, f );
+
+		__m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ux, nx ), _mm_mul_ps( uy, ny ) ), _mm_mul_ps( uz, nz ) );
+		ux = _mm_sub_ps( ux, _mm_mul_ps( dot, nx ) );
+		uy = _mm_sub_ps( uy, _mm_mul_ps( dot, ny ) );
+		uz = _mm_sub_ps( uz, _mm_mul_ps( dot, nz ) );
+		f = RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ux, ux ), _mm_mul_ps( uy, uy ) ), _mm_mul_ps( uz, uz ) ) );
+		ux = _mm_mul_ps( ux, f );
+		uy = _mm_mul_ps( uy, f );
+		uz = _mm_mul_ps( uz, f );
+
+		dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, nx ), _mm_mul_ps( vy, ny ) ), _mm_mul_ps( vz, nz ) );
+		vx = _mm_sub_ps( vx, _mm_mul_ps( dot, nx ) );
+		vy = _mm_sub_ps( vy, _mm_mul_ps( dot, ny ) );
+		vz = _mm_sub_ps( vz, _mm_mul_ps( dot, nz ) );
+		f = RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy ) ), _mm_mul_ps( vz, vz ) ) );
+		vx = _mm_mul_ps( vx, f );
+		vy = _mm_mul_ps( vy, f );
+		vz = _mm_mul_ps( vz, f );
+
+		_MM_TRANSPOSE4_PS( nx, ny, nz, nw );
+		_MM_TRANSPOSE4_PS( ux, uy, uz, uw );
+		_MM_TRANSPOSE4_PS( vx, vy, vz, vw );
+
+		StoreVec3( verts[i+0].normal.ToFloatPtr(), nx );
+		StoreVec3( verts[i+1].normal.ToFloatPtr(), ny );
+		StoreVec3( verts[i+2].normal.ToFloatPtr(), nz );
+		StoreVec3( verts[i+3].normal.ToFloatPtr(), nw );
+		StoreVec3( verts[i+0].tangents[0].ToFloatPtr(), ux );
+		StoreVec3( verts[i+1].tangents[0].ToFloatPtr(), uy );
+		StoreVec3( verts[i+2].tangents[0].ToFloatPtr(), uz );
+		StoreVec3( verts[i+3].tangents[0].ToFloatPtr(), uw );
+		StoreVec3( verts[i+0].tangents[1].ToFloatPtr(), vx );
+		StoreVec3( verts[i+1].tangents[1].ToFloatPtr(), vy );
+		StoreVec3( verts[i+2].tangents[1].ToFloatPtr(), vz );
+		StoreVec3( verts[i+3].tangents[1].ToFloatPtr(), vw );
+	}
+
+	for ( ; i < numVerts; i++ ) {
+		idVec3 &v = verts[i].normal;
+		float f;
+
+		f = idMath::RSqrt( v.x * v.x + v.y * v.y + v.z * v.z );
+		v.x *= f; v.y *= f; v.z *= f;
+
+		for ( int j = 0; j < 2; j++ ) {
+			idVec3 &t = verts[i].tangents[j];
+
+			t -= ( t * v ) * v;
+			f = idMath::RSqrt( t.x * t.x + t.y * t.y + t.z * t.z );
+			t.x *= f; t.y *= f; t.z *= f;
+		}
+	}
+}
+
+
+//===============================================================
+//
+//	sound
+//
+//===============================================================
+
+/*
+============
+UPSAMPLE_PCM
+
+  shared body of the SSE2 and SSE4.1 up-samplers, LOAD4 converts four shorts to floats
+============
+*/
+#define UPSAMPLE_PCM( LOAD4 )																	\
+	int i = 0;																					\
+	if ( kHz == 11025 ) {																		\
+		if ( numChannels == 1 ) {																\
+			for ( ; i + 4 <= numSamples; i += 4 ) {												\
+				__m128 f = LOAD4( src + i );													\
+				_mm_storeu_ps( dest + i*4+ 0, _mm_shuffle_ps( f, f, SHUF( 0, 0, 0, 0 ) ) );	\
+				_mm_storeu_ps( dest + i*4+ 4, _mm_shuffle_ps( f, f, SHUF( 1, 1, 1, 1 ) ) );	\
+				_mm_storeu_ps( dest + i*4+ 8, _mm_shuffle_ps( f, f, SHUF( 2, 2, 2, 2 ) ) );	\
+				_mm_storeu_ps( dest + i*4+12, _mm_shuffle_ps( f, f, SHUF( 3, 3, 3, 3 ) ) );	\
+			}																					\
+			for ( ; i < numSamples; i++ ) {														\
+				dest[i*4+0] = dest[i*4+1] = dest[i*4+2] = dest[i*4+3] = (float) src[i+0];		\
+			}																					\
+		} else {																				\
+			for ( ; i + 4 <= numSamples; i += 4 ) {												\
+				__m128 f = LOAD4( src + i );													\
+				__m128 lo = _mm_movelh_ps( f, f );												\
+				__m128 hi = _mm_movehl_ps( f, f );												\
+				_mm_storeu_ps( dest + i*4+ 0, lo );												\
+				_mm_storeu_ps( dest + i*4+ 4, lo );												\
+				_mm_storeu_ps( dest + i*4+ 8, hi );												\
+				_mm_storeu_ps( dest + i*4+12, hi );												\
+			}																					\
+			for ( ; i < numSamples; i += 2 ) {													\
+				dest[i*4+0] = dest[i*4+2] = dest[i*4+4] = dest[i*4+6] = (float) src[i+0];		\
+				dest[i*4+1] = dest[i*4+3] = dest[i*4+5] = dest[i*4+7] = (float) src[i+1];		\
+			}																					\
+		}																						\
+	} else if ( kHz == 22050 ) {																\
+		if ( numChannels == 1 ) {																\
+			for ( ; i + 4 <= numSamples; i += 4 ) {												\
+				__m128 f = LOAD4( src + i );													\
+				_mm_storeu_ps( dest + i*2+0, _mm_unpacklo_ps( f, f ) );							\
+				_mm_storeu_ps( dest + i*2+4, _mm_unpackhi_ps( f, f ) );							\
+			}																					\
+			for ( ; i < numSamples; i++ ) {														\
+				dest[i*2+0] = dest[i*2+1] = (float) src[i+0];									\
+			}																					\
+		} else {																				\
+			for ( ; i + 4 <= numSamples; i += 4 ) {												\
+				__m128 f = LOAD4( src + i );													\
+				_mm_storeu_ps( dest + i*2+0, _mm_movelh_ps( f, f ) );							\
+				_mm_storeu_ps( dest + i*2+4, _mm_movehl_ps( f, f ) );							\
+			}																					\
+			for ( ; i < numSamples; i += 2 ) {													\
+				dest[i*2+0] = dest[i*2+2] = (float) src[i+0];									\
+				dest[i*2+1] = dest[i*2+3] = (float) src[i+1];									\
+			}																					\
+		}																						\
+	} else if ( kHz == 44100 ) {																\
+		for ( ; i + 4 <= numSamples; i += 4 ) {													\
+			_mm_storeu_ps( dest + i, LOAD4( src + i ) );										\
+		}																						\
+		for ( ; i < numSamples; i++ ) {															\
+			dest[i] = (float) src[i];															\
+		}																						\
+	} else {																					\
+		assert( 0 );																			\
+	}
+
+#define LOAD4_SSE2( p )		_mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i *)( p ) ), _mm_loadl_epi64( (const __m128i *)( p ) ) ), 16 ) )
+#define LOAD4_SSE41( p )	_mm_cvtepi32_ps( _mm_cvtepi16_epi32( _mm_loadl_epi64( (const __m128i *)( p ) ) ) )
+
+/*
+============
+UpSamplePCMTo44kHz_SSE41
+============
+*/
+ID_TARGET_SSE41 static void UpSamplePCMTo44kHz_SSE41( float *dest, const short *src, const int numSamples, const int kHz, const int numChannels ) {
+	UPSAMPLE_PCM( LOAD4_SSE41 )
+}
+
+/*
+============
+idSIMD_Intrinsics::UpSamplePCMTo44kHz
+
+  Duplicate samples for 44kHz output.
+============
+*/
+void VPCALL idSIMD_Intrinsics::UpSamplePCMTo44kHz( float *dest, const short *src, const int numSamples, const int kHz, const int numChannels ) {
+	if ( HAS_SSE41 ) {
+		UpSamplePCMTo44kHz_SSE41( dest, src, numSamples, kHz, numChannels );
+		return;
+	}
+	UPSAMPLE_PCM( LOAD4_SSE2 )
+}
+
+/*
+============
+idSIMD_Intrinsics::MixSoundTwoSpeakerMono
+============
+*/
+void VPCALL idSIMD_Intrinsics::MixSoundTwoSpeakerMono( float *mixBuffer, const float *samples, const int numSamples, const float lastV[2], const float currentV[2] ) {
+	float incL = ( currentV[0] - lastV[0] ) / MIXBUFFER_SAMPLES;
+	float incR = ( currentV[1] - lastV[1] ) / MIXBUFFER_SAMPLES;
+
+	assert( numSamples == MIXBUFFER_SAMPLES );
+
+	// volumes of two consecutive samples
+	__m128 vol = _mm_set_ps( lastV[1] + incR, lastV[0] + incL, lastV[1], lastV[0] );
+	const __m128 inc = _mm_set_ps( 2.0f * incR, 2.0f * incL, 2.0f * incR, 2.0f * incL );
+
+	for ( int j = 0; j < MIXBUFFER_SAMPLES; j += 4 ) {
+		__m128 s = _mm_loadu_ps( samples + j );
+		_mm_storeu_ps( mixBuffer + j*2+0, _mm_add_ps( _mm_loadu_ps( mixBuffer + j*2+0 ), _mm_mul_ps( _mm_unpacklo_ps( s, s ), vol ) ) );
+		vol = _mm_add_ps( vol, inc );
+		_mm_storeu_ps( mixBuffer + j*2+4, _mm_add_ps( _mm_loadu_ps( mixBuffer + j*2+4 ), _mm_mul_ps( _mm_unpackhi_ps( s, s ), vol ) ) );
+		vol = _mm_add_ps( vol, inc );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MixSoundTwoSpeakerStereo
+============
+*/
+void VPCALL idSIMD_Intrinsics::MixSoundTwoSpeakerStereo( float *mixBuffer, const float *samples, const int numSamples, const float lastV[2], const float currentV[2] ) {
+	float incL = ( currentV[0] - lastV[0] ) / MIXBUFFER_SAMPLES;
+	float incR = ( currentV[1] - lastV[1] ) / MIXBUFFER_SAMPLES;
+
+	assert( numSamples == MIXBUFFER_SAMPLES );
+
+	__m128 vol = _mm_set_ps( lastV[1] + incR, lastV[0] + incL, lastV[1], lastV[0] );
+	const __m128 inc = _mm_set_ps( 2.0f * incR, 2.0f * incL, 2.0f * incR, 2.0f * incL );
+
+	for ( int j = 0; j < MIXBUFFER_SAMPLES; j += 2 ) {
+		_mm_storeu_ps( mixBuffer + j*2, _mm_add_ps( _mm_loadu_ps( mixBuffer + j*2 ), _mm_mul_ps( _mm_loadu_ps( samples + j*2 ), vol ) ) );
+		vol = _mm_add_ps( vol, inc );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MixSoundSixSpeakerMono
+============
+*/
+void VPCALL idSIMD_Intrinsics::MixSoundSixSpeakerMono( float *mixBuffer, const float *samples, const int numSamples, const float lastV[6], const float currentV[6] ) {
+	float inc[6];
+	for ( int k = 0; k < 6; k++ ) {
+		inc[k] = ( currentV[k] - lastV[k] ) / MIXBUFFER_SAMPLES;
+	}
+
+	assert( numSamples == MIXBUFFER_SAMPLES );
+
+	// twelve volumes of two consecutive samples spread over three registers
+	__m128 vol0 = _mm_set_ps( lastV[3], lastV[2], lastV[1], lastV[0] );
+	__m128 vol1 = _mm_set_ps( lastV[1] + inc[1], lastV[0] + inc[0], lastV[5], lastV[4] );
+	__m128 vol2 = _mm_set_ps( lastV[5] + inc[5], lastV[4] + inc[4], lastV[3] + inc[3], lastV[2] + inc[2] );
+	const __m128 inc0 = _mm_set_ps( 2.0f * inc[3], 2.0f * inc[2], 2.0f * inc[1], 2.0f * inc[0] );
+	const __m128 inc1 = _mm_set_ps( 2.0f * inc[1], 2.0f * inc[0], 2.0f * inc[5], 2.0f * inc[4] );
+	const __m128 inc2 = _mm_set_ps( 2.0f * inc[5], 2.0f * inc[4], 2.0f * inc[3], 2.0f * inc[2] );
+
+	for ( int i = 0; i < MIXBUFFER_SAMPLES; i += 4 ) {
+		__m128 s = _mm_loadu_ps( samples + i );
+		float *mix = mixBuffer + i * 6;
+
+		_mm_storeu_ps( mix +  0, _mm_add_ps( _mm_loadu_ps( mix +  0 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 0, 0, 0, 0 ) ), vol0 ) ) );
+		_mm_storeu_ps( mix +  4, _mm_add_ps( _mm_loadu_ps( mix +  4 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 0, 0, 1, 1 ) ), vol1 ) ) );
+		_mm_storeu_ps( mix +  8, _mm_add_ps( _mm_loadu_ps( mix +  8 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 1, 1, 1, 1 ) ), vol2 ) ) );
+		vol0 = _mm_add_ps( vol0, inc0 );
+		vol1 = _mm_add_ps( vol1, inc1 );
+		vol2 = _mm_add_ps( vol2, inc2 );
+		_mm_storeu_ps( mix + 12, _mm_add_ps( _mm_loadu_ps( mix + 12 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 2, 2, 2, 2 ) ), vol0 ) ) );
+		_mm_storeu_ps( mix + 16, _mm_add_ps( _mm_loadu_ps( mix + 16 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 2, 2, 3, 3 ) ), vol1 ) ) );
+		_mm_storeu_ps( mix + 20, _mm_add_ps( _mm_loadu_ps( mix + 20 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 3, 3, 3, 3 ) ), vol2 ) ) );
+		vol0 = _mm_add_ps( vol0, inc0 );
+		vol1 = _mm_add_ps( vol1, inc1 );
+		vol2 = _mm_add_ps( vol2, inc2 );
+	}
+}
+
+/*
+============
+idSIMD_Intrinsics::MixSoundSixSpeakerStereo
+
+  left feeds speakers 0, 2, 3 and 4, right feeds speakers 1 and 5
+============
+*/
+void VPCALL idSIMD_Intrinsics::MixSoundSixSpeakerStereo( float *mixBuffer, const float *samples, const int numSamples, const float lastV[6], const float currentV[6] ) {
+	float inc[6];
+	for ( int k = 0; k < 6; k++ ) {
+		inc[k] = ( currentV[k] - lastV[k] ) / MIXBUFFER_SAMPLES;
+	}
+
+	assert( numSamples == MIXBUFFER_SAMPLES );
+
+	__m128 vol0 = _mm_set_ps( lastV[3], lastV[2], lastV[1], lastV[0] );
+	__m128 vol1 = _mm_set_ps( lastV[1] + inc[1], lastV[0] + inc[0], lastV[5], lastV[4] );
+	__m128 vol2 = _mm_set_ps( lastV[5] + inc[5], lastV[4] + inc[4], lastV[3] + inc[3], lastV[2] + inc[2] );
+	const __m128 inc0 = _mm_set_ps( 2.0f * inc[3], 2.0f * inc[2], 2.0f * inc[1], 2.0f * inc[0] );
+	const __m128 inc1 = _mm_set_ps( 2.0f * inc[1], 2.0f * inc[0], 2.0f * inc[5], 2.0f * inc[4] );
+	const __m128 inc2 = _mm_set_ps( 2.0f * inc[5], 2.0f * inc[4], 2.0f * inc[3], 2.0f * inc[2] );
+
+	for ( int i = 0; i < MIXBUFFER_SAMPLES; i += 2 ) {
+		__m128 s = _mm_loadu_ps( samples + i * 2 );		// l0 r0 l1 r1
+		float *mix = mixBuffer + i * 6;
+
+		_mm_storeu_ps( mix + 0, _mm_add_ps( _mm_loadu_ps( mix + 0 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 0, 1, 0, 0 ) ), vol0 ) ) );
+		_mm_storeu_ps( mix + 4, _mm_add_ps( _mm_loadu_ps( mix + 4 ), _mm_mul_ps( s, vol1 ) ) );
+		_mm_storeu_ps( mix + 8, _mm_add_ps( _mm_loadu_ps( mix + 8 ), _mm_mul_ps( _mm_shuffle_ps( s, s, SHUF( 2, 2, 2, 3 ) ), vol2 ) ) );
+		vol0 = _mm_add_ps( vol0, inc0 );
+		vol1 = _mm_add_ps( vol1, inc1 );
+		vol2 = _mm_add_ps( vol2, inc2 );
+	}
+}
+
+/*
+============
+MixedSoundToSamples_AVX2
+============
+*/
+ID_TARGET_AVX2 static int MixedSoundToSamples_AVX2( short *samples, const float *mixBuffer, const int numSamples ) {
+	const __m256 vmin = _mm256_set1_ps( -32768.0f );
+	const __m256 vmax = _mm256_set1_ps( 32767.0f );
+	int i;
+
+	for ( i = 0; i + 16 <= numSamples; i += 16 ) {
+		__m256i a = _mm256_cvttps_epi32( _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( mixBuffer + i + 0 ), vmin ), vmax ) );
+		__m256i b = _mm256_cvttps_epi32( _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( mixBuffer + i + 8 ), vmin ), vmax ) );
+		// packs works per 128 bit lane so the quadwords have to be put back in order
+		__m256i s = _mm256_permute4x64_epi64( _mm256_packs_epi32( a, b ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		_mm256_storeu_si256( (__m256i *)( samples + i ), s );
+	}
+	return i;
+}
+
+/*
+============
+idSIMD_Intrinsics::MixedSoundToSamples
+============
+*/
+void VPCALL idSIMD_Intrinsics::MixedSoundToSamples( short *samples, const float *mixBuffer, const int numSamples ) {
+	const __m128 vmin = _mm_set1_ps( -32768.0f );
+	const __m128 vmax = _mm_set1_ps( 32767.0f );
+	int i = 0;
+
+	if ( HAS_AVX2 ) {
+		i = MixedSoundToSamples_AVX2( samples, mixBuffer, numSamples );
+	}
+	for ( ; i + 8 <= numSamples; i += 8 ) {
+		__m128i a = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( mixBuffer + i + 0 ), vmin ), vmax ) );
+		__m128i b = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( mixBuffer + i + 4 ), vmin ), vmax ) );
+		_mm_storeu_si128( (__m128i *)( samples + i ), _mm_packs_epi32( a, b ) );
+	}
+	for ( ; i < numSamples; i++ ) {
+		if ( mixBuffer[i] <= -32768.0f ) {
+			samples[i] = -32768;
+		} else if ( mixBuffer[i] >= 32767.0f ) {
+			samples[i] = 32767;
+		} else {
+			samples[i] = (short) mixBuffer[i];
+		}
+	}
+}
+
+#endif /* ID_SIMD_INTRINSICS */
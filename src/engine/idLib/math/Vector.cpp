@@ -384,7 +384,7 @@ const char *idVec6::ToString( int precision ) const {
 //===============================================================
 
 float	idVecX::temp[VECX_MAX_TEMP+4];
-float *	idVecX::tempPtr = (float *) ( ( (int) idVecX::temp + 15 ) & ~15 );
+float *	idVecX::tempPtr = (float *) ( ( (uintptr_t) idVecX::temp + 15 ) & ~(uintptr_t)15 );
 int		idVecX::tempIndex = 0;
 
 /*
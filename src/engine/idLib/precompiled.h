@@ -93,6 +93,7 @@ If you have questions concerning this license or the applicable additional terms
 	#define NDEBUG
 #endif
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -130,7 +131,7 @@ extern "C" {
 #define ALIGN16( x )					__declspec(align(16)) x
 #define PACKED
 
-#define _alloca16( x )					((void *)((((int)_alloca( (x)+15 )) + 15) & ~15))
+#define _alloca16( x )					((void *)((((size_t)_alloca( (x)+15 )) + 15) & ~(size_t)15))
 
 #define PATHSEPERATOR_STR				"\\"
 #define PATHSEPERATOR_CHAR				'\\'
@@ -164,7 +165,7 @@ extern "C" {
 #endif
 
 #define _alloca							alloca
-#define _alloca16( x )					((void *)((((int)alloca( (x)+15 )) + 15) & ~15))
+#define _alloca16( x )					((void *)((((size_t)alloca( (x)+15 )) + 15) & ~(size_t)15))
 
 #define PATHSEPERATOR_STR				"/"
 #define PATHSEPERATOR_CHAR				'/'
@@ -195,7 +196,7 @@ extern "C" {
 #endif
 
 #define _alloca							alloca
-#define _alloca16( x )					((void *)((((int)alloca( (x)+15 )) + 15) & ~15))
+#define _alloca16( x )					((void *)((((size_t)alloca( (x)+15 )) + 15) & ~(size_t)15))
 
 #define ALIGN16( x )					x
 #define PACKED							__attribute__((packed))
@@ -234,7 +235,10 @@ typedef enum {
 	CPUID_HTT							= 0x01000,	// Hyper-Threading Technology
 	CPUID_CMOV							= 0x02000,	// Conditional Move (CMOV) and fast floating point comparison (FCOMI) instructions
 	CPUID_FTZ							= 0x04000,	// Flush-To-Zero mode (denormal results are flushed to zero)
-	CPUID_DAZ							= 0x08000	// Denormals-Are-Zero mode (denormal source operands are set to zero)
+	CPUID_DAZ							= 0x08000,	// Denormals-Are-Zero mode (denormal source operands are set to zero)
+	CPUID_SSE41							= 0x10000,	// Streaming SIMD Extensions 4.1
+	CPUID_AVX							= 0x20000,	// Advanced Vector Extensions (with OS support for the YMM state)
+	CPUID_AVX2							= 0x40000	// Advanced Vector Extensions 2
 } cpuid_t;
 
 typedef enum {
@@ -60,14 +60,6 @@ void SetPlaneSignbits(cplane_t * out) {
 }
 #endif //BSPC
 
-// to allow boxes to be treated as brush models, we allocate
-// some extra indexes along with those needed by the map
-#define BOX_LEAF_BRUSHES    1	// ydnar
-#define BOX_BRUSHES     1
-#define BOX_SIDES       6
-#define BOX_LEAFS       2
-#define BOX_PLANES      12
-
 #define LL( x ) x = LittleLong( x )
 
 
@@ -85,15 +77,17 @@ convar_t         *cm_playerCurveClip;
 convar_t         *cm_optimize;
 convar_t         *cm_showCurves;
 convar_t         *cm_showTriangles;
+convar_t         *cm_simd;
+convar_t         *r_debugSurfaceUpdate;
 #endif
 
-cmodel_t        box_model;
-cplane_t       *box_planes;
-cbrush_t       *box_brush;
-
+static cmTraceContext_t cm_mainTraceContext;
+static cmTraceContext_t *cm_traceContexts;
+static Q_THREAD_LOCAL cmTraceContext_t *cm_threadTraceContext;
 
 
 void            CM_InitBoxHull(void);
+void            CM_ResizeTraceContexts(void);
 void            CM_FloodAreaConnections(void);
 
 
@@ -247,6 +241,38 @@ void CM_BoundBrush(cbrush_t * b) {
 	b->bounds[1][2] = b->sides[5].plane->dist;
 }
 
+/*
+=================
+CM_SetBrushSidePlanes
+
+Copies the side planes into the batched layout used by the SIMD trace code
+=================
+*/
+void CM_SetBrushSidePlanes(cbrush_t * b) {
+	int             i, j, lane;
+	cSidePlanes_t  *batch;
+	cplane_t       *plane;
+
+	for(i = 0; i < CM_SIDE_BATCHES(b->numsides) * CM_SIDE_BATCH; i++) {
+		batch = &b->sidePlanes[i / CM_SIDE_BATCH];
+		lane = i % CM_SIDE_BATCH;
+
+		if(i >= b->numsides) {
+			for(j = 0; j < 3; j++) {
+				batch->normal[j][lane] = 0;
+			}
+			batch->dist[lane] = 0;
+			continue;
+		}
+
+		plane = b->sides[i].plane;
+		for(j = 0; j < 3; j++) {
+			batch->normal[j][lane] = plane->normal[j];
+		}
+		batch->dist[lane] = plane->dist;
+	}
+}
+
 
 /*
 =================
@@ -256,7 +282,8 @@ CMod_LoadBrushes
 void CMod_LoadBrushes(lump_t * l) {
 	dbrush_t       *in;
 	cbrush_t       *out;
-	int             i, count, shaderNum;
+	cSidePlanes_t  *sidePlanes;
+	int             i, count, shaderNum, numBatches;
 
 	in = (dbrush_t*)(cmod_base + l->fileofs);
 	if(l->filelen % sizeof(*in)) {
@@ -265,14 +292,21 @@ void CMod_LoadBrushes(lump_t * l) {
 	count = l->filelen / sizeof(*in);
 
 	cm.brushes = (cbrush_t*)Hunk_Alloc((BOX_BRUSHES + count) * sizeof(*cm.brushes), h_high);
-	cm.brushCheckCounts = (int*)Hunk_Alloc( ( BOX_BRUSHES + count ) * sizeof( *cm.brushCheckCounts ), h_high );
 	cm.numBrushes = count;
 
+	numBatches = 0;
+	for(i = 0; i < count; i++) {
+		numBatches += CM_SIDE_BATCHES(LittleLong(in[i].numSides));
+	}
+	sidePlanes = (cSidePlanes_t*)Hunk_Alloc(numBatches * sizeof(*sidePlanes), h_high);
+
 	out = cm.brushes;
 
 	for(i = 0; i < count; i++, out++, in++) {
 		out->sides = cm.brushsides + LittleLong(in->firstSide);
 		out->numsides = LittleLong(in->numSides);
+		out->sidePlanes = sidePlanes;
+		sidePlanes += CM_SIDE_BATCHES(out->numsides);
 
 		shaderNum = LittleLong(in->shaderNum);
 		if(shaderNum < 0 || shaderNum >= cm.numShaders) {
@@ -281,6 +315,7 @@ void CMod_LoadBrushes(lump_t * l) {
 		out->contents = cm.shaders[shaderNum].contentFlags;
 
 		CM_BoundBrush(out);
+		CM_SetBrushSidePlanes(out);
 	}
 
 }
@@ -897,6 +932,8 @@ void CM_LoadMapOLD(const char *name, qboolean clientload, int *checksum) {
 	cm_optimize = Cvar_Get("cm_optimize", "1", CVAR_CHEAT, "test");
 	cm_showCurves = Cvar_Get("cm_showCurves", "0", CVAR_CHEAT, "test");
 	cm_showTriangles = Cvar_Get("cm_showTriangles", "0", CVAR_CHEAT, "test");
+	cm_simd = Cvar_Get("cm_simd", "1", CVAR_CHEAT, "Test brush side planes with SIMD, 2 also compares against the scalar code");
+	r_debugSurfaceUpdate = Cvar_Get("r_debugSurfaceUpdate", "1", 0, "test");
 #endif
 	Com_DPrintf("CM_LoadMap( %s, %i )\n", name, clientload);
 
@@ -971,10 +1008,10 @@ void CM_LoadMapOLD(const char *name, qboolean clientload, int *checksum) {
 	FS_FreeFile(buf);
 
 
-	cm.brushCheckCounts = (int*)Hunk_Alloc( cm.numBrushes * sizeof( int ), h_high );
 	CMod_SetupAreasAndPortals();
 
 	CM_InitBoxHull();
+	CM_ResizeTraceContexts();
 
 	CM_FloodAreaConnections();
 
@@ -993,6 +1030,7 @@ CM_ClearMap
 void CM_ClearMap(void) {
 	Com_Memset(&cm, 0, sizeof(cm));
 	CM_ClearLevelPatches();
+	CM_ResizeTraceContexts();
 
 #ifdef USE_PHYSICS
 	CMod_PhysicsShutdown();
@@ -1012,7 +1050,7 @@ cmodel_t *CM_ClipHandleToModel(clipHandle_t handle) {
 		return &cm.cmodels[handle];
 	}
 	if(handle == BOX_MODEL_HANDLE || handle == CAPSULE_MODEL_HANDLE) {
-		return &box_model;
+		return &CM_TraceContext()->boxModel;
 	}
 	if(handle < MAX_SUBMODELS) {
 		Com_Error(ERR_DROP, "CM_ClipHandleToModel: bad handle %i < %i < %i", cm.numSubModels, handle, MAX_SUBMODELS);
@@ -1093,45 +1131,54 @@ int CM_LeafArea(int leafnum) {
 ===================
 CM_InitBoxHull
 
+The box brush itself lives in each trace context, the map only reserves
+a leaf brush index for it
+===================
+*/
+void CM_InitBoxHull(void) {
+	cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes;
+}
+
+/*
+===================
+CM_InitContextBoxHull
+
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
 ===================
 */
-void CM_InitBoxHull(void) {
+static void CM_InitContextBoxHull(cmTraceContext_t * ctx) {
 	int             i, side;
 	cplane_t       *p;
 	cbrushside_t   *s;
+	cbrush_t       *box_brush;
 
-	box_planes = &cm.planes[cm.numPlanes];
-
-	box_brush = &cm.brushes[cm.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cm.brushsides + cm.numBrushSides;
+	box_brush = &ctx->boxBrush;
+	box_brush->numsides = BOX_SIDES;
+	box_brush->sides = ctx->boxSides;
 	box_brush->contents = CONTENTS_BODY;
-	box_brush->edges = (cbrushedge_t *) Hunk_Alloc(sizeof(cbrushedge_t) * 12, h_low);
-	box_brush->numEdges = 12;
+	box_brush->edges = ctx->boxEdges;
+	box_brush->numEdges = BOX_EDGES;
+	box_brush->sidePlanes = ctx->boxSidePlanes;
 
-	box_model.leaf.numLeafBrushes = 1;
-//  box_model.leaf.firstLeafBrush = cm.numBrushes;
-	box_model.leaf.firstLeafBrush = cm.numLeafBrushes;
-	cm.leafbrushes[cm.numLeafBrushes] = cm.numBrushes;
+	ctx->boxModel.leaf.numLeafBrushes = 1;
 
 	for(i = 0; i < 6; i++) {
 		side = i & 1;
 
 		// brush sides
-		s = &cm.brushsides[cm.numBrushSides + i];
-		s->plane = cm.planes + (cm.numPlanes + i * 2 + side);
+		s = &ctx->boxSides[i];
+		s->plane = ctx->boxPlanes + (i * 2 + side);
 		s->surfaceFlags = 0;
 
 		// planes
-		p = &box_planes[i * 2];
+		p = &ctx->boxPlanes[i * 2];
 		p->type = i >> 1;
 		p->signbits = 0;
 		VectorClear(p->normal);
 		p->normal[i >> 1] = 1;
 
-		p = &box_planes[i * 2 + 1];
+		p = &ctx->boxPlanes[i * 2 + 1];
 		p->type = 3 + (i >> 1);
 		p->signbits = 0;
 		VectorClear(p->normal);
@@ -1139,6 +1186,8 @@ void CM_InitBoxHull(void) {
 
 		SetPlaneSignbits(p);
 	}
+
+	CM_SetBrushSidePlanes(box_brush);
 }
 
 /*
@@ -1148,12 +1197,20 @@ CM_TempBoxModel
 To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 Capsules are handled differently though.
+The box belongs to the calling thread's trace context.
 ===================
 */
 clipHandle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, int capsule) {
+	cmTraceContext_t *ctx;
+	cplane_t       *box_planes;
+	cbrush_t       *box_brush;
+
+	ctx = CM_TraceContext();
+	box_planes = ctx->boxPlanes;
+	box_brush = &ctx->boxBrush;
 
-	VectorCopy(mins, box_model.mins);
-	VectorCopy(maxs, box_model.maxs);
+	VectorCopy(mins, ctx->boxModel.mins);
+	VectorCopy(maxs, ctx->boxModel.maxs);
 
 	if(capsule) {
 		return CAPSULE_MODEL_HANDLE;
@@ -1172,6 +1229,8 @@ clipHandle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, int capsule)
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
+	CM_SetBrushSidePlanes(box_brush);
+
 	// First side
 	VectorSet(box_brush->edges[0].p0, mins[0], mins[1], mins[2]);
 	VectorSet(box_brush->edges[0].p1, mins[0], maxs[1], mins[2]);
@@ -1208,6 +1267,152 @@ clipHandle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, int capsule)
 	return BOX_MODEL_HANDLE;
 }
 
+/*
+===============================================================================
+
+TRACE CONTEXTS
+
+The check counts, collision markers and the temp box model are kept per
+context instead of in cm, so each thread tracing with its own context
+never touches another thread's state. The main thread always uses
+cm_mainTraceContext.
+
+===============================================================================
+*/
+
+/*
+===================
+CM_ResizeTraceContext
+===================
+*/
+static void CM_ResizeTraceContext(cmTraceContext_t * ctx) {
+	if(ctx->brushCheckCounts) {
+		Z_Free(ctx->brushCheckCounts);
+		Z_Free(ctx->brushCollided);
+	}
+	if(ctx->surfaceCheckCounts) {
+		Z_Free(ctx->surfaceCheckCounts);
+	}
+
+	ctx->checkcount = 0;
+	ctx->numBrushes = cm.numBrushes + BOX_BRUSHES;
+	ctx->brushCheckCounts = (int*)Z_Malloc(ctx->numBrushes * sizeof(*ctx->brushCheckCounts));
+	ctx->brushCollided = (qboolean*)Z_Malloc(ctx->numBrushes * sizeof(*ctx->brushCollided));
+
+	ctx->numSurfaces = cm.numSurfaces;
+	ctx->surfaceCheckCounts = NULL;
+	if(ctx->numSurfaces) {
+		ctx->surfaceCheckCounts = (int*)Z_Malloc(ctx->numSurfaces * sizeof(*ctx->surfaceCheckCounts));
+	}
+
+	ctx->boxModel.leaf.firstLeafBrush = cm.numLeafBrushes;
+}
+
+/*
+===================
+CM_ResizeTraceContexts
+
+Called whenever the map changes, no traces may be running
+===================
+*/
+void CM_ResizeTraceContexts(void) {
+	cmTraceContext_t *ctx;
+
+	if(!cm_mainTraceContext.boxBrush.sides) {
+		CM_InitContextBoxHull(&cm_mainTraceContext);
+		cm_mainTraceContext.next = cm_traceContexts;
+		cm_traceContexts = &cm_mainTraceContext;
+	}
+
+	for(ctx = cm_traceContexts; ctx; ctx = ctx->next) {
+		CM_ResizeTraceContext(ctx);
+	}
+}
+
+/*
+===================
+CM_CreateTraceContext
+===================
+*/
+cmTraceContext_t *CM_CreateTraceContext(void) {
+	cmTraceContext_t *ctx;
+
+	ctx = (cmTraceContext_t*)Z_Malloc(sizeof(*ctx));
+
+	CM_InitContextBoxHull(ctx);
+	CM_ResizeTraceContext(ctx);
+
+	ctx->next = cm_traceContexts;
+	cm_traceContexts = ctx;
+
+	return ctx;
+}
+
+/*
+===================
+CM_FreeTraceContext
+===================
+*/
+void CM_FreeTraceContext(cmTraceContext_t * ctx) {
+	cmTraceContext_t **prev;
+
+	if(!ctx || ctx == &cm_mainTraceContext) {
+		return;
+	}
+
+	for(prev = &cm_traceContexts; *prev; prev = &(*prev)->next) {
+		if(*prev == ctx) {
+			*prev = ctx->next;
+			break;
+		}
+	}
+
+	Z_Free(ctx->brushCheckCounts);
+	Z_Free(ctx->brushCollided);
+	if(ctx->surfaceCheckCounts) {
+		Z_Free(ctx->surfaceCheckCounts);
+	}
+	Z_Free(ctx);
+}
+
+/*
+===================
+CM_SetThreadTraceContext
+
+NULL reverts the calling thread to the main context
+===================
+*/
+void CM_SetThreadTraceContext(cmTraceContext_t * ctx) {
+	cm_threadTraceContext = ctx;
+}
+
+/*
+===================
+CM_TraceContext
+===================
+*/
+cmTraceContext_t *CM_TraceContext(void) {
+	if(cm_threadTraceContext) {
+		return cm_threadTraceContext;
+	}
+	return &cm_mainTraceContext;
+}
+
+/*
+===================
+CM_LeafBrush
+
+Leaf brush lookup that maps the reserved box brush index to the
+context's own box brush
+===================
+*/
+cbrush_t *CM_LeafBrush(cmTraceContext_t * ctx, int brushnum) {
+	if(brushnum == cm.numBrushes) {
+		return &ctx->boxBrush;
+	}
+	return &cm.brushes[brushnum];
+}
+
 /*
 ===================
 CM_ModelBounds
@@ -41,9 +41,30 @@ Maryland 20850 USA.
 #define BOX_MODEL_HANDLE        511
 #define CAPSULE_MODEL_HANDLE    510
 
+// to allow boxes to be treated as brush models, we allocate
+// some extra indexes along with those needed by the map
+#define BOX_LEAF_BRUSHES    1	// ydnar
+#define BOX_BRUSHES     1
+#define BOX_SIDES       6
+#define BOX_LEAFS       2
+#define BOX_PLANES      12
+#define BOX_EDGES       12
+
 // enable to make the collision detection a bunch faster
 #define MRE_OPTIMIZE
 
+// brush side planes are also kept in a structure-of-arrays layout so the
+// trace code can test CM_SIDE_BATCH planes at once with SSE
+#if !defined(C_ONLY) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define CM_SIMD_SSE 1
+#include <xmmintrin.h>
+#else
+#define CM_SIMD_SSE 0
+#endif
+
+#define CM_SIDE_BATCH           4
+#define CM_SIDE_BATCHES(n)      (((n) + CM_SIDE_BATCH - 1) / CM_SIDE_BATCH)
+
 typedef struct cbrushedge_s {
 	vec3_t          p0;
 	vec3_t          p1;
@@ -78,14 +99,18 @@ typedef struct {
     winding_t      *winding;
 } cbrushside_t;
 
+// CM_SIDE_BATCH consecutive brush side planes, unused lanes are zeroed
+typedef struct {
+	float           normal[3][CM_SIDE_BATCH];
+	float           dist[CM_SIDE_BATCH];
+} cSidePlanes_t;
 
 typedef struct {
 	int             contents;
 	vec3_t          bounds[2];
 	int             numsides;
 	cbrushside_t   *sides;
-	int             checkcount;	// to avoid repeated testings
-	qboolean        collided;	// marker for optimisation
+	cSidePlanes_t  *sidePlanes;	// CM_SIDE_BATCHES( numsides ) batches
 	cbrushedge_t   *edges;
 	int             numEdges;
 } cbrush_t;
@@ -118,7 +143,6 @@ typedef struct cSurfaceCollide_s {
 } cSurfaceCollide_t;
 
 typedef struct {
-	int             checkcount;	// to avoid repeated testings
 	int             surfaceFlags;
 	int             contents;
 	cSurfaceCollide_t *sc;
@@ -150,7 +174,6 @@ typedef struct {
 	cmodel_t       *cmodels;
 	int             numBrushes;
 	cbrush_t       *brushes;
-	int			   *brushCheckCounts;
 	int             numClusters;
 	int             clusterBytes;
 	byte           *visibility;
@@ -163,10 +186,37 @@ typedef struct {
 	int             numSurfaces;
 	cSurface_t     **surfaces;					// non-patches will be NULL
 	int             floodvalid;
-	int             checkcount;					// incremented on each trace
 	qboolean        perPolyCollision;
 } clipMap_t;
 
+// everything a trace writes to, so threads with their own context can
+// trace concurrently, see CM_SetThreadTraceContext
+struct cmTraceContext_s {
+	int             checkcount;					// incremented on each trace
+	int             numBrushes;					// cm.numBrushes + BOX_BRUSHES
+	int            *brushCheckCounts;			// to avoid repeated testings
+	qboolean       *brushCollided;				// marker for optimisation
+	int             numSurfaces;
+	int            *surfaceCheckCounts;
+
+	// the temp box model, see CM_TempBoxModel
+	cmodel_t        boxModel;
+	cbrush_t        boxBrush;
+	cbrushside_t    boxSides[BOX_SIDES];
+	cplane_t        boxPlanes[BOX_PLANES];
+	cbrushedge_t    boxEdges[BOX_EDGES];
+	cSidePlanes_t   boxSidePlanes[CM_SIDE_BATCHES(BOX_SIDES)];
+
+	// CM_TracePointThroughSurfaceCollide scratch space
+	qboolean        frontFacing[SHADER_MAX_TRIANGLES];
+	float           intersection[SHADER_MAX_TRIANGLES];
+
+	struct cmTraceContext_s *next;
+};
+
+// maps a brush to its index in the context marker arrays
+#define CM_BrushNum( ctx, b )   ( ( b ) == &( ctx )->boxBrush ? cm.numBrushes : (int)( ( b ) - cm.brushes ) )
+
 
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
@@ -182,6 +232,12 @@ extern convar_t  *cm_forceTriangles;
 extern convar_t  *cm_optimize;
 extern convar_t  *cm_showCurves;
 extern convar_t  *cm_showTriangles;
+extern convar_t  *cm_simd;
+extern convar_t  *r_debugSurfaceUpdate;
+
+// cm_load.c
+void            CM_SetBrushSidePlanes(cbrush_t * b);
+cmTraceContext_t *CM_TraceContext(void);
 
 // cm_test.c
 
@@ -213,6 +269,7 @@ typedef struct {
 	sphere_t        sphere;					// sphere for oriendted capsule collision
 	biSphere_t		biSphere;
 	qboolean		testLateralCollision;	// whether or not to test for lateral collision
+	cmTraceContext_t *ctx;					// markers and scratch space for this trace
 #ifdef MRE_OPTIMIZE
 	cplane_t        tracePlane1;
 	cplane_t        tracePlane2;
@@ -263,5 +320,6 @@ void            CM_StoreLeafs(leafList_t * ll, int nodenum);
 void            CM_StoreBrushes(leafList_t * ll, int nodenum);
 void            CM_BoxLeafnums_r(leafList_t * ll, int nodenum);
 cmodel_t       *CM_ClipHandleToModel(clipHandle_t handle);
+cbrush_t       *CM_LeafBrush(cmTraceContext_t * ctx, int brushnum);
 qboolean        CM_BoundsIntersect(const vec3_t mins, const vec3_t maxs, const vec3_t mins2, const vec3_t maxs2);
 qboolean        CM_BoundsIntersectPoint(const vec3_t mins, const vec3_t maxs, const vec3_t point);
\ No newline at end of file
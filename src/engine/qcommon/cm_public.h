@@ -38,6 +38,8 @@ Maryland 20850 USA.
 #include "q_shared.h"
 #include "../rendererGL/tr_types.h"
 
+typedef struct cmTraceContext_s cmTraceContext_t;
+
 void            CM_LoadMap(const char *name, qboolean clientload, int *checksum);
 void            CM_ClearMap(void);
 clipHandle_t    CM_InlineModel(int index);	// 0 = world, 1 + are bmodels
@@ -66,6 +68,14 @@ void            CM_AdjustAreaPortalState(int area1, int area2, qboolean open);
 qboolean        CM_AreasConnected(int area1, int area2);
 int             CM_WriteAreaBits(byte * buffer, int area);
 
+// each thread other than the main one must trace with its own context,
+// contexts are created and freed on the main thread
+cmTraceContext_t *CM_CreateTraceContext(void);
+void            CM_FreeTraceContext(cmTraceContext_t * ctx);
+void            CM_SetThreadTraceContext(cmTraceContext_t * ctx);
+void            CM_TraceStress_f(void);
+void            CM_TraceJobs_f(void);
+
 // cm_tag.c
 int             CM_LerpTag(orientation_t * tag, const refEntity_t * refent, const char *tagName, int startIndex);
 
@@ -110,6 +110,7 @@ void CM_StoreBrushes(leafList_t * ll, int nodenum) {
 	int             i, k, leafnum, brushnum;
 	cLeaf_t        *leaf;
 	cbrush_t       *b;
+	cmTraceContext_t *ctx = CM_TraceContext();
 
 	leafnum = -1 - nodenum;
 
@@ -117,11 +118,11 @@ void CM_StoreBrushes(leafList_t * ll, int nodenum) {
 
 	for(k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b = &cm.brushes[brushnum];
-		if ( cm.brushCheckCounts[brushnum] == cm.checkcount ) {
+		b = CM_LeafBrush(ctx, brushnum);
+		if ( ctx->brushCheckCounts[brushnum] == ctx->checkcount ) {
 			continue; // already checked this brush in another leaf
 		}
-		cm.brushCheckCounts[brushnum] = cm.checkcount;
+		ctx->brushCheckCounts[brushnum] = ctx->checkcount;
 		for(i = 0; i < 3; i++) {
 			if(b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i]) {
 				break;
@@ -188,7 +189,7 @@ CM_BoxLeafnums
 int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf) {
 	leafList_t ll;
 
-	cm.checkcount++;
+	CM_TraceContext()->checkcount++;
 
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
@@ -213,7 +214,7 @@ CM_BoxBrushes
 int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t ** list, int listsize) {
 	leafList_t      ll;
 
-	cm.checkcount++;
+	CM_TraceContext()->checkcount++;
 
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
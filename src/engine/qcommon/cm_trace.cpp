@@ -163,6 +163,109 @@ float SquareRootFloat(float number) {
 }
 
 
+/*
+===============================================================================
+
+BRUSH SIDE PLANE DISTANCES
+
+===============================================================================
+*/
+
+/*
+================
+CM_BrushSideDistancesScalar
+
+Reference version of CM_BrushSideDistances
+================
+*/
+static void CM_BrushSideDistancesScalar(const traceWork_t * tw, const cbrush_t * brush, int first, float *d1, float *d2) {
+	int             i;
+	float           dist;
+	cplane_t       *plane;
+
+	for(i = 0; i < CM_SIDE_BATCH && first + i < brush->numsides; i++) {
+		plane = brush->sides[first + i].plane;
+
+		// adjust the plane distance appropriately for mins/maxs
+		dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
+
+		d1[i] = DotProduct(tw->start, plane->normal) - dist;
+		if(d2) {
+			d2[i] = DotProduct(tw->end, plane->normal) - dist;
+		}
+	}
+}
+
+#if CM_SIMD_SSE
+/*
+================
+CM_BrushSideDistancesSSE
+
+Picks the box corner per plane from the sign of each normal component,
+which is what tw->offsets[plane->signbits] does in the scalar version
+================
+*/
+static void CM_BrushSideDistancesSSE(const traceWork_t * tw, const cSidePlanes_t * batch, float *d1, float *d2) {
+	__m128          nx, ny, nz, zero, neg, ox, oy, oz, dist;
+
+	nx = _mm_loadu_ps(batch->normal[0]);
+	ny = _mm_loadu_ps(batch->normal[1]);
+	nz = _mm_loadu_ps(batch->normal[2]);
+	zero = _mm_setzero_ps();
+
+	neg = _mm_cmplt_ps(nx, zero);
+	ox = _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][0])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][0])));
+	neg = _mm_cmplt_ps(ny, zero);
+	oy = _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][1])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][1])));
+	neg = _mm_cmplt_ps(nz, zero);
+	oz = _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(tw->size[1][2])), _mm_andnot_ps(neg, _mm_set1_ps(tw->size[0][2])));
+
+	// adjust the plane distance appropriately for mins/maxs
+	dist = _mm_sub_ps(_mm_loadu_ps(batch->dist),
+		_mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, nx), _mm_mul_ps(oy, ny)), _mm_mul_ps(oz, nz)));
+
+	_mm_storeu_ps(d1, _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tw->start[0]), nx),
+		_mm_mul_ps(_mm_set1_ps(tw->start[1]), ny)), _mm_mul_ps(_mm_set1_ps(tw->start[2]), nz)), dist));
+	if(d2) {
+		_mm_storeu_ps(d2, _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tw->end[0]), nx),
+			_mm_mul_ps(_mm_set1_ps(tw->end[1]), ny)), _mm_mul_ps(_mm_set1_ps(tw->end[2]), nz)), dist));
+	}
+}
+#endif
+
+/*
+================
+CM_BrushSideDistances
+
+Distances of the trace start (d1) and end (d2) to the box expanded side
+planes first .. first + CM_SIDE_BATCH - 1, d2 may be NULL
+================
+*/
+static void CM_BrushSideDistances(const traceWork_t * tw, const cbrush_t * brush, int first, float *d1, float *d2) {
+#if CM_SIMD_SSE
+	int             i;
+	float           ref1[CM_SIDE_BATCH], ref2[CM_SIDE_BATCH];
+
+	if(cm_simd->integer) {
+		CM_BrushSideDistancesSSE(tw, &brush->sidePlanes[first / CM_SIDE_BATCH], d1, d2);
+
+		if(cm_simd->integer > 1) {
+			CM_BrushSideDistancesScalar(tw, brush, first, ref1, d2 ? ref2 : NULL);
+			for(i = 0; i < CM_SIDE_BATCH && first + i < brush->numsides; i++) {
+				if(fabs(d1[i] - ref1[i]) > 0.001f || (d2 && fabs(d2[i] - ref2[i]) > 0.001f)) {
+					Com_Printf(S_COLOR_YELLOW "WARNING: CM_BrushSideDistances: SIMD mismatch on side %i of brush %i\n",
+						first + i, (int)(brush - cm.brushes));
+				}
+			}
+		}
+		return;
+	}
+#endif
+
+	CM_BrushSideDistancesScalar(tw, brush, first, d1, d2);
+}
+
+
 /*
 ===============================================================================
 
@@ -177,9 +280,9 @@ CM_TestBoxInBrush
 ================
 */
 static void CM_TestBoxInBrush(traceWork_t * tw, cbrush_t * brush) {
-	int             i;
+	int             i, j;
 	cplane_t       *plane;
-	float           dist, d1, t;
+	float           dist, d1, t, d1s[CM_SIDE_BATCH];
 	cbrushside_t   *side;
 	vec3_t          startp;
 
@@ -218,16 +321,13 @@ static void CM_TestBoxInBrush(traceWork_t * tw, cbrush_t * brush) {
 		// the first six planes are the axial planes, so we only
 		// need to test the remainder
 		for(i = 6; i < brush->numsides; i++) {
-			side = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance apropriately for mins/maxs
-			dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
-
-			d1 = DotProduct(tw->start, plane->normal) - dist;
+			j = i % CM_SIDE_BATCH;
+			if(!j || i == 6) {
+				CM_BrushSideDistances(tw, brush, i - j, d1s, NULL);
+			}
 
 			// if completely in front of face, no intersection
-			if(d1 > 0) {
+			if(d1s[j] > 0) {
 				return;
 			}
 		}
@@ -333,21 +433,22 @@ CM_TestInLeaf
 ================
 */
 void CM_TestInLeaf(traceWork_t * tw, cLeaf_t * leaf) {
-	int             k, brushnum;
+	int             k, brushnum, surfacenum;
 	cbrush_t       *b;
 	cSurface_t     *surface;
+	cmTraceContext_t *ctx = tw->ctx;
 
 	// test box position against all brushes in the leaf
 	for(k = 0; k < leaf->numLeafBrushes; k++)
 	{
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b = &cm.brushes[brushnum];
-		if( cm.brushCheckCounts[brushnum] == cm.checkcount) {
+		b = CM_LeafBrush(ctx, brushnum);
+		if( ctx->brushCheckCounts[brushnum] == ctx->checkcount) {
 			continue; // already checked this brush in another leaf
 		}
-		cm.brushCheckCounts[brushnum] = cm.checkcount;
+		ctx->brushCheckCounts[brushnum] = ctx->checkcount;
 
-		if ( !(cm.shaders[b->shaderNum].contentFlags & tw->contents)) {
+		if ( !(b->contents & tw->contents)) {
 			continue;
 		}
 
@@ -359,17 +460,18 @@ void CM_TestInLeaf(traceWork_t * tw, cLeaf_t * leaf) {
 
 	// test against all surfaces
 	for(k = 0; k < leaf->numLeafSurfaces; k++) {
-		surface = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+		surfacenum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+		surface = cm.surfaces[surfacenum];
 
 		if(!surface) {
 			continue;
 		}
 
-		if(surface->checkcount == cm.checkcount) {
+		if(ctx->surfaceCheckCounts[surfacenum] == ctx->checkcount) {
 			continue; // already checked this surface in another leaf
 		}
 
-		surface->checkcount = cm.checkcount;
+		ctx->surfaceCheckCounts[surfacenum] = ctx->checkcount;
 
 		if(!(surface->contents & tw->contents)) {
 			continue;
@@ -525,11 +627,11 @@ void CM_PositionTest(traceWork_t * tw) {
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
 
-	cm.checkcount++;
+	tw->ctx->checkcount++;
 
 	CM_BoxLeafnums_r(&ll, 0);
 
-	cm.checkcount++;
+	tw->ctx->checkcount++;
 
 	// test the contents of the leafs
 	for(i = 0; i < ll.count; i++) {
@@ -557,13 +659,12 @@ CM_TracePointThroughSurfaceCollide
 ====================
 */
 void CM_TracePointThroughSurfaceCollide(traceWork_t * tw, const cSurfaceCollide_t * sc) {
-	static qboolean frontFacing[SHADER_MAX_TRIANGLES];
-	static float    intersection[SHADER_MAX_TRIANGLES];
+	qboolean       *frontFacing = tw->ctx->frontFacing;
+	float          *intersection = tw->ctx->intersection;
 	float           intersect, offset, d1, d2;
 	const cPlane_t *planes;
 	const cFacet_t *facet;
 	int             i, j, k;
-	static convar_t  *cv;
 
 	if(!tw->isPoint) {
 		return;
@@ -616,11 +717,7 @@ void CM_TracePointThroughSurfaceCollide(traceWork_t * tw, const cSurfaceCollide_
 		}
 		if(j == facet->numBorders) {
 			// we hit this facet
-			if(!cv) {
-				cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0, "test");
-			}
-
-			if(cv->integer) {
+			if(r_debugSurfaceUpdate->integer) {
 				debugSurfaceCollide = sc;
 				debugFacet = facet;
 			}
@@ -703,7 +800,6 @@ void CM_TraceThroughSurfaceCollide(traceWork_t * tw, const cSurfaceCollide_t * s
 	cPlane_t       *planes;
 	cFacet_t       *facet;
 	vec3_t          startp, endp;
-	static convar_t  *cv;
 
 	if(!CM_BoundsIntersect(tw->bounds[0], tw->bounds[1], sc->bounds[0], sc->bounds[1])) {
 		return;
@@ -808,10 +904,7 @@ void CM_TraceThroughSurfaceCollide(traceWork_t * tw, const cSurfaceCollide_t * s
 					enterFrac = 0;
 				}
 
-				if(!cv) {
-					cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0, "test");
-				}
-				if(cv && cv->integer) {
+				if(r_debugSurfaceUpdate->integer) {
 					debugSurfaceCollide = sc;
 					debugFacet = facet;
 				}
@@ -856,10 +949,11 @@ CM_TraceThroughBrush
 ================
 */
 void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
-	int             i;
+	int             i, j;
 	cplane_t       *plane, *clipplane;
 	float           dist, enterFrac, leaveFrac, d1, d2, f, t;
-	qboolean        getout, startout;
+	float           d1s[CM_SIDE_BATCH], d2s[CM_SIDE_BATCH];
+	qboolean        getout, startout, *collided;
 	cbrushside_t   *side, *leadside;
 	vec3_t          startp, endp;
 
@@ -873,6 +967,8 @@ void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
 
 	c_brush_traces++;
 
+	collided = &tw->ctx->brushCollided[CM_BrushNum(tw->ctx, brush)];
+
 	getout = qfalse;
 	startout = qfalse;
 
@@ -909,7 +1005,7 @@ void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
 				continue;
 			}
 
-			brush->collided = qtrue;
+			*collided = qtrue;
 
 			// crosses face
 			if(d1 > d2) {
@@ -977,7 +1073,7 @@ void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
 				continue;
 			}
 
-			brush->collided = qtrue;
+			*collided = qtrue;
 
 			// crosses face
 			if(d1 > d2) { // enter
@@ -1007,14 +1103,16 @@ void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
 		// and the earliest time the trace crosses a plane towards the exterior
 		//
 		for(i = 0; i < brush->numsides; i++) {
+			j = i % CM_SIDE_BATCH;
+			if(!j) {
+				CM_BrushSideDistances(tw, brush, i, d1s, d2s);
+			}
+
 			side = brush->sides + i;
 			plane = side->plane;
 
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct(tw->offsets[plane->signbits], plane->normal);
-
-			d1 = DotProduct(tw->start, plane->normal) - dist;
-			d2 = DotProduct(tw->end, plane->normal) - dist;
+			d1 = d1s[j];
+			d2 = d2s[j];
 
 			if(d2 > 0) {
 				getout = qtrue;	// endpoint is not in solid
@@ -1033,7 +1131,7 @@ void CM_TraceThroughBrush(traceWork_t * tw, cbrush_t * brush) {
 				continue;
 			}
 
-			brush->collided = qtrue;
+			*collided = qtrue;
 
 			// crosses face
 			if(d1 > d2) { // enter
@@ -1099,6 +1197,7 @@ static void CM_ProximityToBrush(traceWork_t * tw, cbrush_t * brush) {
 	// cheapish purely linear trace to test for intersection
 	Com_Memset(&tw2, 0, sizeof(tw2));
 
+	tw2.ctx = tw->ctx;
 	tw2.trace.fraction = 1.0f;
 	tw2.type = TT_CAPSULE;
 	tw2.sphere.radius = 0.0f;
@@ -1149,6 +1248,7 @@ static void CM_ProximityToSurface(traceWork_t * tw, cSurface_t * surface) {
 	// cheapish purely linear trace to test for intersection
 	Com_Memset(&tw2, 0, sizeof(tw2));
 
+	tw2.ctx = tw->ctx;
 	tw2.trace.fraction = 1.0f;
 	tw2.type = TT_CAPSULE;
 	tw2.sphere.radius = 0.0f;
@@ -1172,25 +1272,26 @@ CM_TraceThroughLeaf
 ================
 */
 void CM_TraceThroughLeaf(traceWork_t * tw, cLeaf_t * leaf) {
-	int             k, brushnum;
+	int             k, brushnum, surfacenum;
 	cbrush_t       *b;
 	cSurface_t     *surface;
+	cmTraceContext_t *ctx = tw->ctx;
 
 	// trace line against all brushes in the leaf
 	for(k = 0; k < leaf->numLeafBrushes; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 
-		b = &cm.brushes[brushnum];
-		if ( cm.brushCheckCounts[brushnum] == cm.checkcount ) {
+		b = CM_LeafBrush(ctx, brushnum);
+		if ( ctx->brushCheckCounts[brushnum] == ctx->checkcount ) {
 			continue; // already checked this brush in another leaf
 		}
-		cm.brushCheckCounts[brushnum] = cm.checkcount;
+		ctx->brushCheckCounts[brushnum] = ctx->checkcount;
 
-		if ( !(cm.shaders[b->shaderNum].contentFlags & tw->contents) ) {
+		if ( !(b->contents & tw->contents) ) {
 			continue;
 		}
 
-		b->collided = qfalse;
+		ctx->brushCollided[brushnum] = qfalse;
 
 		if(!CM_BoundsIntersect(tw->bounds[0], tw->bounds[1], b->bounds[0], b->bounds[1])) {
 			continue;
@@ -1205,17 +1306,18 @@ void CM_TraceThroughLeaf(traceWork_t * tw, cLeaf_t * leaf) {
 
 	// trace line against all surfaces in the leaf
 	for(k = 0; k < leaf->numLeafSurfaces; k++) {
-		surface = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+		surfacenum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+		surface = cm.surfaces[surfacenum];
 
 		if(!surface) {
 			continue;
 		}
 
-		if(surface->checkcount == cm.checkcount) {
+		if(ctx->surfaceCheckCounts[surfacenum] == ctx->checkcount) {
 			continue; // already checked this surface in another leaf
 		}
 
-		surface->checkcount = cm.checkcount;
+		ctx->surfaceCheckCounts[surfacenum] = ctx->checkcount;
 
 		if(!(surface->contents & tw->contents)) {
 			continue;
@@ -1237,10 +1339,10 @@ void CM_TraceThroughLeaf(traceWork_t * tw, cLeaf_t * leaf) {
 		for(k = 0; k < leaf->numLeafBrushes; k++) {
 			brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 
-			b = &cm.brushes[brushnum];
+			b = CM_LeafBrush(ctx, brushnum);
 
 			// This brush never collided, so don't bother
-			if(!b->collided) {
+			if(!ctx->brushCollided[brushnum]) {
 				continue;
 			}
 
@@ -1673,12 +1775,12 @@ static void CM_Trace(trace_t * results, const vec3_t start, const vec3_t end, ve
 
 	cmod = CM_ClipHandleToModel(model);
 
-	cm.checkcount++;			// for multi-check avoidance
-
 	c_traces++;					// for statistics, may be zeroed
 
 	// fill in a default trace
 	Com_Memset(&tw, 0, sizeof(tw));
+	tw.ctx = CM_TraceContext();
+	tw.ctx->checkcount++;		// for multi-check avoidance
 	tw.trace.fraction = 1;		// assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
 	tw.type = type;
@@ -1979,12 +2081,12 @@ void CM_BiSphereTrace(trace_t * results, const vec3_t start, const vec3_t end, f
 
 	cmod = CM_ClipHandleToModel(model);
 
-	cm.checkcount++;			// for multi-check avoidance
-
 	c_traces++;					// for statistics, may be zeroed
 
 	// fill in a default trace
 	Com_Memset(&tw, 0, sizeof(tw));
+	tw.ctx = CM_TraceContext();
+	tw.ctx->checkcount++;		// for multi-check avoidance
 	tw.trace.fraction = 1.0f;	// assume it goes the entire distance until shown otherwise
 	VectorCopy(vec3_origin, tw.modelOrigin);
 	tw.type = TT_BISPHERE;
@@ -2174,3 +2276,308 @@ void CM_DrawDebugSurface(void (*drawPoly) (int color, int numPoints, float *poin
 		}
 	}
 }
+
+/*
+===============================================================================
+
+TRACE STRESS TEST
+
+===============================================================================
+*/
+
+#define MAX_STRESS_THREADS		32
+
+typedef struct {
+	vec3_t          start, end;
+	vec3_t          mins, maxs;
+	qboolean        useBox;					// trace against a temp box model instead of the world
+	vec3_t          boxMins, boxMaxs;
+	trace_t         result;					// single threaded reference
+} cmStressTrace_t;
+
+typedef struct {
+	cmTraceContext_t *ctx;
+	cmStressTrace_t *traces;
+	int             numTraces;
+	int             first;					// threads start at different traces to mix up the order
+	int             mismatches;
+} cmStressThread_t;
+
+/*
+================
+CM_StressTrace
+================
+*/
+static void CM_StressTrace(cmStressTrace_t * st, trace_t * tr) {
+	clipHandle_t    model = 0;
+
+	if(st->useBox) {
+		model = CM_TempBoxModel(st->boxMins, st->boxMaxs, qfalse);
+	}
+
+	CM_BoxTrace(tr, st->start, st->end, st->mins, st->maxs, model, CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_BODY, TT_AABB);
+}
+
+/*
+================
+CM_StressThread
+================
+*/
+static int CM_StressThread(void *data) {
+	cmStressThread_t *t = (cmStressThread_t *)data;
+	cmStressTrace_t *st;
+	trace_t         tr;
+	int             i;
+
+	CM_SetThreadTraceContext(t->ctx);
+
+	for(i = 0; i < t->numTraces; i++) {
+		st = &t->traces[(t->first + i) % t->numTraces];
+		CM_StressTrace(st, &tr);
+		if(memcmp(&tr, &st->result, sizeof(tr))) {
+			t->mismatches++;
+		}
+	}
+
+	CM_SetThreadTraceContext(NULL);
+	return 0;
+}
+
+/*
+================
+CM_BuildStressTraces
+
+Random traces through the loaded map with their single threaded results
+================
+*/
+static cmStressTrace_t *CM_BuildStressTraces(int numTraces) {
+	cmStressTrace_t *traces, *st;
+	cmodel_t       *world;
+	int             i, j, seed;
+	float           size;
+
+	world = &cm.cmodels[0];
+	traces = (cmStressTrace_t *)Z_Malloc(numTraces * sizeof(*traces));
+
+	seed = 0x4d41;
+	for(i = 0, st = traces; i < numTraces; i++, st++) {
+		for(j = 0; j < 3; j++) {
+			st->start[j] = world->mins[j] + Q_random(&seed) * (world->maxs[j] - world->mins[j]);
+			st->end[j] = st->start[j] + Q_crandom(&seed) * 512;
+		}
+
+		// mix of point, player sized and random boxes
+		size = (i % 3) ? ((i % 3) == 1 ? 16 : Q_random(&seed) * 64) : 0;
+		VectorSet(st->mins, -size, -size, -size);
+		VectorSet(st->maxs, size, size, size);
+
+		st->useBox = (i % 4) == 0 ? qtrue : qfalse;
+		if(st->useBox) {
+			for(j = 0; j < 3; j++) {
+				st->boxMins[j] = st->start[j] + Q_crandom(&seed) * 256;
+				st->boxMaxs[j] = st->boxMins[j] + 8 + Q_random(&seed) * 64;
+			}
+		}
+
+		CM_StressTrace(st, &st->result);
+	}
+
+	return traces;
+}
+
+/*
+================
+CM_TraceStress_f
+
+cm_traceStress [threads] [traces]
+Runs random traces through the loaded map from several threads at once
+and compares them to the single threaded results
+================
+*/
+void CM_TraceStress_f(void) {
+	cmStressTrace_t *traces;
+	cmStressThread_t threads[MAX_STRESS_THREADS];
+	void           *handles[MAX_STRESS_THREADS];
+	int             numThreads, numTraces, i, start, mismatches;
+
+	if(!cm.numNodes) {
+		Com_Printf("cm_traceStress: no map loaded\n");
+		return;
+	}
+
+	numThreads = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 4;
+	numTraces = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 10000;
+	numThreads = Com_Clamp(1, MAX_STRESS_THREADS, numThreads);
+	if(numTraces < 1) {
+		numTraces = 1;
+	}
+
+	// build the traces and the reference results on the main thread
+	traces = CM_BuildStressTraces(numTraces);
+
+	for(i = 0; i < numThreads; i++) {
+		threads[i].ctx = CM_CreateTraceContext();
+		threads[i].traces = traces;
+		threads[i].numTraces = numTraces;
+		threads[i].first = i * numTraces / numThreads;
+		threads[i].mismatches = 0;
+	}
+
+	start = Sys_Milliseconds();
+	for(i = 0; i < numThreads; i++) {
+		handles[i] = Sys_CreateThread(CM_StressThread, &threads[i]);
+		if(!handles[i]) {
+			// run it here instead
+			CM_StressThread(&threads[i]);
+		}
+	}
+
+	mismatches = 0;
+	for(i = 0; i < numThreads; i++) {
+		if(handles[i]) {
+			Sys_JoinThread(handles[i]);
+		}
+		mismatches += threads[i].mismatches;
+		CM_FreeTraceContext(threads[i].ctx);
+	}
+
+	Com_Printf("%i threads x %i traces in %i msec, %i mismatches\n", numThreads, numTraces, Sys_Milliseconds() - start, mismatches);
+
+	Z_Free(traces);
+}
+
+typedef struct {
+	cmStressTrace_t *traces;
+	trace_t        *results;
+	cmTraceContext_t **contexts;			// one per job thread, NULL for the main thread
+	int             first, count;
+} cmTraceBatch_t;
+
+typedef struct {
+	cmStressTrace_t *traces;
+	trace_t        *results;
+	int             numTraces;
+	int             mismatches;
+} cmTraceVerify_t;
+
+/*
+================
+CM_TraceBatchJob
+================
+*/
+static void CM_TraceBatchJob(void *data) {
+	cmTraceBatch_t *batch = (cmTraceBatch_t *)data;
+	int             i;
+
+	CM_SetThreadTraceContext(batch->contexts[Job_ThreadIndex()]);
+
+	for(i = batch->first; i < batch->first + batch->count; i++) {
+		CM_StressTrace(&batch->traces[i], &batch->results[i]);
+	}
+
+	CM_SetThreadTraceContext(NULL);
+}
+
+/*
+================
+CM_TraceVerifyJob
+
+Depends on all batches
+================
+*/
+static void CM_TraceVerifyJob(void *data) {
+	cmTraceVerify_t *verify = (cmTraceVerify_t *)data;
+	int             i;
+
+	for(i = 0; i < verify->numTraces; i++) {
+		if(memcmp(&verify->results[i], &verify->traces[i].result, sizeof(trace_t))) {
+			verify->mismatches++;
+		}
+	}
+}
+
+/*
+================
+CM_TraceJobs_f
+
+cm_traceJobs [traces] [batch]
+Runs the random traces of cm_traceStress as job batches, followed by a
+job that depends on them and compares the results to the single
+threaded ones
+================
+*/
+void CM_TraceJobs_f(void) {
+	cmStressTrace_t *traces;
+	cmTraceBatch_t *batches;
+	cmTraceVerify_t verify;
+	cmTraceContext_t **contexts;
+	jobCounter_t    batchCounter, verifyCounter;
+	trace_t         tr;
+	int             numTraces, batchSize, numBatches, numThreads, i, start, singleMsec, jobMsec;
+
+	if(!cm.numNodes) {
+		Com_Printf("cm_traceJobs: no map loaded\n");
+		return;
+	}
+
+	numTraces = Cmd_Argc() > 1 ? atoi(Cmd_Argv(1)) : 10000;
+	batchSize = Cmd_Argc() > 2 ? atoi(Cmd_Argv(2)) : 64;
+	if(numTraces < 1) {
+		numTraces = 1;
+	}
+	if(batchSize < 1) {
+		batchSize = 1;
+	}
+
+	traces = CM_BuildStressTraces(numTraces);
+
+	start = Sys_Milliseconds();
+	for(i = 0; i < numTraces; i++) {
+		CM_StressTrace(&traces[i], &tr);
+	}
+	singleMsec = Sys_Milliseconds() - start;
+
+	// the trace contexts have to be created and freed on the main thread
+	numThreads = Job_NumThreads();
+	contexts = (cmTraceContext_t **)Z_Malloc(numThreads * sizeof(*contexts));
+	for(i = 1; i < numThreads; i++) {
+		contexts[i] = CM_CreateTraceContext();
+	}
+
+	numBatches = (numTraces + batchSize - 1) / batchSize;
+	batches = (cmTraceBatch_t *)Z_Malloc(numBatches * sizeof(*batches));
+	for(i = 0; i < numBatches; i++) {
+		batches[i].traces = traces;
+		batches[i].contexts = contexts;
+		batches[i].first = i * batchSize;
+		batches[i].count = Q_min(batchSize, numTraces - batches[i].first);
+	}
+
+	verify.traces = traces;
+	verify.results = (trace_t *)Z_Malloc(numTraces * sizeof(trace_t));
+	verify.numTraces = numTraces;
+	verify.mismatches = 0;
+
+	batchCounter.count = 0;
+	verifyCounter.count = 0;
+
+	start = Sys_Milliseconds();
+	for(i = 0; i < numBatches; i++) {
+		batches[i].results = verify.results;
+		Job_Add(CM_TraceBatchJob, &batches[i], &batchCounter, NULL);
+	}
+	Job_Add(CM_TraceVerifyJob, &verify, &verifyCounter, &batchCounter);
+	Job_Wait(&verifyCounter);
+	jobMsec = Sys_Milliseconds() - start;
+
+	Com_Printf("%i traces in %i batches on %i threads: %i msec, single threaded %i msec, %i mismatches\n", numTraces, numBatches,
+			   numThreads, jobMsec, singleMsec, verify.mismatches);
+
+	for(i = 1; i < numThreads; i++) {
+		CM_FreeTraceContext(contexts[i]);
+	}
+	Z_Free(contexts);
+	Z_Free(verify.results);
+	Z_Free(batches);
+	Z_Free(traces);
+}
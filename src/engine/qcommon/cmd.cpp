@@ -97,6 +97,7 @@ static cmdContext_t		cmd;
 static cmdContext_t		savedCmd;
 
 static cmd_function_t *cmd_functions;	// possible commands to execute
+static idStrHashMap< cmd_function_t * > cmd_hash( false );	// commands by name, case insensitive
 
 
 
@@ -109,15 +110,10 @@ Cmd_FindCommand
 */
 cmd_function_t *Cmd_FindCommand( const char *cmd_name )
 {
-	cmd_function_t *cmd;
-	for( cmd = cmd_functions; cmd; cmd = cmd->next )
-	{
-		if( !Q_stricmp( cmd_name, cmd->name ) ) 
-		{
-			return cmd;
-		}
-	}
-	return NULL;
+	cmd_function_t **cmd;
+
+	cmd = cmd_hash.Get( cmd_name );
+	return cmd ? *cmd : NULL;
 }
 
 /*
@@ -1216,6 +1212,7 @@ void Cmd_AddCommand(const char *cmd_name, xcommand_t function, const char *cmd_d
 	cmd->next = cmd_functions;
 	cmd->complete = NULL;
 	cmd_functions = cmd;
+	cmd_hash.Set(cmd->name, cmd);
 }
 
 /*
@@ -1226,10 +1223,9 @@ Cmd_SetCommandCompletionFunc
 void Cmd_SetCommandCompletionFunc( const char *command, completionFunc_t complete ) {
 	cmd_function_t	*cmd;
 
-	for( cmd = cmd_functions; cmd; cmd = cmd->next ) {
-		if( !Q_stricmp( command, cmd->name ) ) {
-			cmd->complete = complete;
-		}
+	cmd = Cmd_FindCommand( command );
+	if( cmd ) {
+		cmd->complete = complete;
 	}
 }
 
@@ -1248,16 +1244,18 @@ void Cmd_RemoveCommand(const char *cmd_name)
 		return;
 	}
 
+	cmd = Cmd_FindCommand(cmd_name);
+	if(!cmd)
+	{
+		// command wasn't active
+		return;
+	}
+	cmd_hash.Remove(cmd_name);
+
 	back = &cmd_functions;
 	while(1)
 	{
-		cmd = *back;
-		if(!cmd)
-		{
-			// command wasn't active
-			return;
-		}
-		if(!strcmp(cmd_name, cmd->name))
+		if(*back == cmd)
 		{
 			*back = cmd->next;
 
@@ -1273,7 +1271,7 @@ void Cmd_RemoveCommand(const char *cmd_name)
 			Z_Free(cmd);
 			return;
 		}
-		back = &cmd->next;
+		back = &(*back)->next;
 	}
 }
 
@@ -1301,10 +1299,9 @@ Cmd_CompleteArgument
 void Cmd_CompleteArgument( const char *command, char *args, int argNum ) {
 	cmd_function_t	*cmd;
 
-	for( cmd = cmd_functions; cmd; cmd = cmd->next ) {
-		if( !Q_stricmp( command, cmd->name ) && cmd->complete ) {
-			cmd->complete( args, argNum );
-		}
+	cmd = Cmd_FindCommand( command );
+	if( cmd && cmd->complete ) {
+		cmd->complete( args, argNum );
 	}
 }
 
@@ -1318,7 +1315,7 @@ A complete command line has been parsed, so try to execute it
 */
 void Cmd_ExecuteString(const char *text)
 {
-	cmd_function_t *cmdFunc, **prev;
+	cmd_function_t *cmdFunc;
 
 	// execute the command line
 	Cmd_TokenizeStringParseCvar( text );
@@ -1327,30 +1324,14 @@ void Cmd_ExecuteString(const char *text)
 		return;					// no tokens
 	}
 
-	// check registered command functions
-	for(prev = &cmd_functions; *prev; prev = &cmdFunc->next)
+	// check registered command functions, the ones without
+	// a function are left for the cgame or game to handle
+	cmdFunc = Cmd_FindCommand(cmd.argv[0]);
+	if(cmdFunc && cmdFunc->function)
 	{
-		cmdFunc = *prev;
-		if(!Q_stricmp(cmd.argv[0], cmdFunc->name))
-		{
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmdFunc->next;
-			cmdFunc->next = cmd_functions;
-			cmd_functions = cmdFunc;
-
-			// perform the action
-			if(!cmdFunc->function)
-			{
-				// let the cgame or game handle it
-				break;
-			}
-			else
-			{
-				cmdFunc->function();
-			}
-			return;
-		}
+		// perform the action
+		cmdFunc->function();
+		return;
 	}
 
 	// check cvars
@@ -1525,12 +1506,5 @@ Cmd_Exists
 */
 qboolean Cmd_Exists( const char *cmd_name )
 {
-	cmd_function_t	*cmd;
-
-	for( cmd = cmd_functions; cmd; cmd = cmd->next )
-	{
-		if( !idStr::Cmp( cmd_name, cmd->name ))
-			return qtrue;
-	}
-	return qfalse;
-}
\ No newline at end of file
+	return Cmd_FindCommand( cmd_name ) ? qtrue : qfalse;
+}
@@ -38,6 +38,7 @@ Maryland 20850 USA.
 #include "../idLib/precompiled.h"
 #include "../qcommon/q_shared.h"
 #include "qcommon.h"
+#include "htable.h"
 #include "../database/database.h"
 #include <setjmp.h>
 #if defined (_WIN32)
@@ -122,6 +123,7 @@ convar_t         *com_cameraMode;
 convar_t         *com_maxfpsUnfocused;
 convar_t         *com_maxfpsMinimized;
 convar_t         *com_abnormalExit;
+convar_t         *com_forceGenericSIMD;
 
 #if defined (USE_HTTP)
 convar_t         *com_webhost;
@@ -2798,6 +2800,20 @@ static void Com_Crash_f(void)
 	*(volatile int *)0 = 0x12345678;
 }
 
+/*
+=================
+Com_TestSIMD_f
+
+Benchmarks the active SIMD processor and checks every kernel against the generic code
+=================
+*/
+static void Com_TestSIMD_f(void)
+{
+	idCmdArgs args(Cmd_Cmd(), false);
+
+	idSIMD::Test_f(args);
+}
+
 
 // TTimo: centralizing the cl_cdkey stuff after I discovered a buffer overflow problem with the dedicated server version
 //   not sure it's necessary to have different defaults for regular and dedicated, but I don't want to take the risk
@@ -3240,6 +3256,9 @@ void Com_Init(char *commandLine)
 	com_maxfpsUnfocused = Cvar_Get("com_maxfpsUnfocused", "0", CVAR_ARCHIVE, "test");
 	com_maxfpsMinimized = Cvar_Get("com_maxfpsMinimized", "0", CVAR_ARCHIVE, "test");
 	com_abnormalExit = Cvar_Get( "com_abnormalExit", "0", CVAR_ROM, "test" );
+	com_forceGenericSIMD = Cvar_Get("com_forceGenericSIMD", "0", CVAR_ARCHIVE | CVAR_LATCH, "test");
+
+	idSIMD::InitProcessor("OpenWolf", com_forceGenericSIMD->integer != 0);
 
 #if defined (USE_HTTP)
 	com_webhost	= Cvar_Get( "com_webhost", "http://localhost", CVAR_INIT | CVAR_ARCHIVE | CVAR_SYSTEMINFO, "test" );
@@ -3268,16 +3287,21 @@ void Com_Init(char *commandLine)
 		Cmd_AddCommand("error", Com_Error_f, "^1Execute an error routine to protect the server");
 		Cmd_AddCommand("crash", Com_Crash_f, "^1Causes engine to perform an illegal operation in Windows");
 		Cmd_AddCommand("freeze", Com_Freeze_f, "^1Freeze game and all animation for specified time (freeze 5) (5 seconds)");
+		Cmd_AddCommand("cm_traceStress", CM_TraceStress_f, "^1Traces the map from several threads and compares the results to single threaded traces");
+		Cmd_AddCommand("cm_traceJobs", CM_TraceJobs_f, "^1Traces the map in job batches and compares the results to single threaded traces");
+		Cmd_AddCommand("hashBench", HT_Benchmark_f, "^1Measures insert and lookup speed of the open addressing string map against chained tables");
 	}
 	Cmd_AddCommand("quit", Com_Quit_f, "^1Quit OpenWolf and return to your OS");
 	Cmd_AddCommand("changeVectors", MSG_ReportChangeVectors_f, "^1Change to vector defined by FIND_NEW_CHANGE_VECTORS as in vector graphics");
 	Cmd_AddCommand("writeconfig", Com_WriteConfig_f, "^1Saves current configuration to a cfg file");
+	Cmd_AddCommand("testSIMD", Com_TestSIMD_f, "^1Benchmarks the SIMD processor and verifies every kernel against the generic code");
 
 	s = va("%s %s %s", Q3_VERSION, ARCH_STRING, __DATE__);
 	com_version = Cvar_Get("version", s, CVAR_ROM | CVAR_SERVERINFO, "test");
 	com_protocol = Cvar_Get ("protocol", va("%i", ETPROTOCOL_VERSION), CVAR_SERVERINFO | CVAR_ARCHIVE, "test");
 
 	Sys_Init();
+	Job_Init();
 
 	if( Sys_WritePIDFile( ) ) {
 #ifndef DEDICATED
@@ -3818,6 +3842,8 @@ void Com_Shutdown(qboolean badProfile)
 	Net_HTTP_Kill();
 #endif
 
+	Job_Shutdown();
+
 	// shut down the key system
 	idKeyInput::Shutdown();
 
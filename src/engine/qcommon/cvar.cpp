@@ -47,37 +47,23 @@ int             cvar_modifiedFlags;
 convar_t          cvar_indexes[MAX_CVARS];
 int             cvar_numIndexes;
 
-#define FILE_HASH_SIZE      512
-static convar_t  *hashTable[FILE_HASH_SIZE];
+// cvar names are case insensitive
+static idStrHashMap< convar_t * > cvar_hash( false );
 
-convar_t         *Cvar_Set2(const char *var_name, const char *value, qboolean force);
+// most name lookups come from string literals in the engine and the game
+// modules, so remember which handle the last lookup through each name
+// pointer resolved to and only confirm the name on the next one
+#define CVAR_LOOKUP_SIZE	256
 
-/*
-================
-return a hash value for the filename
-================
-*/
-static long generateHashValue(const char *fname)
+typedef struct
 {
-	int             i;
-	long            hash;
-	char            letter;
+	const char     *name;
+	cvarHandle_t    handle;
+} cvarLookup_t;
 
-	if(!fname)
-	{
-		Com_Error(ERR_DROP, "null name in generateHashValue");	//gjd
-	}
-	hash = 0;
-	i = 0;
-	while(fname[i] != '\0')
-	{
-		letter = idStr::ToLower(fname[i]);
-		hash += (long)(letter) * (i + 119);
-		i++;
-	}
-	hash &= (FILE_HASH_SIZE - 1);
-	return hash;
-}
+static cvarLookup_t cvar_lookup[CVAR_LOOKUP_SIZE];
+
+convar_t         *Cvar_Set2(const char *var_name, const char *value, qboolean force);
 
 /*
 ============
@@ -112,20 +98,36 @@ Cvar_FindVar
 */
 convar_t  *Cvar_FindVar(const char *var_name)
 {
-	convar_t         *var;
-	long            hash;
+	cvarLookup_t   *lookup;
+	convar_t       *var, **slot;
 
-	hash = generateHashValue(var_name);
+	if(!var_name)
+	{
+		Com_Error(ERR_DROP, "null name in Cvar_FindVar");
+	}
 
-	for(var = hashTable[hash]; var; var = var->hashNext)
+	lookup = &cvar_lookup[((size_t)var_name >> 3) & (CVAR_LOOKUP_SIZE - 1)];
+	if(lookup->name == var_name)
 	{
-		if(!Q_stricmp(var_name, var->name))
+		// the pointer may be a reused buffer, so the name still has to match
+		var = &cvar_indexes[lookup->handle];
+		if(!Q_stricmp(var->name, var_name))
 		{
 			return var;
 		}
 	}
 
-	return NULL;
+	slot = cvar_hash.Get(var_name);
+	if(!slot)
+	{
+		return NULL;
+	}
+
+	var = *slot;
+	lookup->name = var_name;
+	lookup->handle = var - cvar_indexes;
+
+	return var;
 }
 
 /*
@@ -331,7 +333,6 @@ The flags will be or'ed in if the variable exists.
 convar_t *Cvar_Get( const char *var_name, const char *var_value, int flags, const char *var_desc )
 {
 	convar_t	*var;
-	long        hash;
 
 	if( !var_name )
 	{
@@ -454,9 +455,7 @@ convar_t *Cvar_Get( const char *var_name, const char *var_value, int flags, cons
 
 	var->flags = flags;
 
-	hash = generateHashValue(var_name);
-	var->hashNext = hashTable[hash];
-	hashTable[hash] = var;
+	cvar_hash.Set(var->name, var);
 
 	return var;
 }
@@ -1173,6 +1172,7 @@ void Cvar_Restart_f(void)
 			*prev = var->next;
 			if(var->name)
 			{
+				cvar_hash.Remove(var->name);
 				Z_Free(var->name);
 			}
 			if(var->string)
@@ -1200,6 +1200,9 @@ void Cvar_Restart_f(void)
 
 		prev = &var->next;
 	}
+
+	// cleared cvars may still be remembered by name pointer
+	memset(cvar_lookup, 0, sizeof(cvar_lookup));
 }
 
 
@@ -623,6 +623,126 @@ void FS_HomeRemove(const char *homePath)
 	remove(FS_BuildOSPath(fs_homepath->string, fs_gamedir, homePath));
 }
 
+/*
+===========
+FS_HomeReadFile
+
+Reads a file from the gamedir of fs_homepath without going through the
+search path, for caches the engine writes for itself. Unlike FS_ReadFile
+this is never affected by sv_pure or fs_restrict and doesn't count towards
+the pure checksums. Returns -1 if the file isn't there, free the buffer
+with FS_FreeFile.
+===========
+*/
+int FS_HomeReadFile(const char *homePath, void **buffer)
+{
+	FILE           *f;
+	byte           *buf;
+	int             len;
+
+	if(!fs_searchpaths)
+	{
+		Com_Error(ERR_FATAL, "Filesystem call made without initialization\n");
+	}
+
+	if(buffer)
+	{
+		*buffer = NULL;
+	}
+
+	f = fopen(FS_BuildOSPath(fs_homepath->string, fs_gamedir, homePath), "rb");
+	if(!f)
+	{
+		return -1;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if(len < 0 || !buffer)
+	{
+		fclose(f);
+		return len;
+	}
+
+	buf = (byte *)Hunk_AllocateTempMemory(len + 1);
+	if((int)fread(buf, 1, len, f) != len)
+	{
+		Hunk_FreeTempMemory(buf);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	// guarantee that it will have a trailing 0 for string operations
+	buf[len] = 0;
+	*buffer = buf;
+
+	return len;
+}
+
+/*
+===========
+FS_HomeWriteFile
+
+Counterpart of FS_HomeReadFile
+===========
+*/
+void FS_HomeWriteFile(const char *homePath, const void *buffer, int size)
+{
+	char           *ospath;
+	FILE           *f;
+
+	if(!fs_searchpaths)
+	{
+		Com_Error(ERR_FATAL, "Filesystem call made without initialization\n");
+	}
+
+	ospath = FS_BuildOSPath(fs_homepath->string, fs_gamedir, homePath);
+	if(FS_CreatePath(ospath))
+	{
+		return;
+	}
+
+	f = fopen(ospath, "wb");
+	if(!f)
+	{
+		Com_Printf("Failed to open %s\n", homePath);
+		return;
+	}
+
+	if((int)fwrite(buffer, 1, size, f) != size)
+	{
+		// don't leave a truncated file behind
+		fclose(f);
+		remove(ospath);
+		return;
+	}
+	fclose(f);
+}
+
+/*
+===========
+FS_HomeListFiles
+
+Lists a directory of the gamedir in fs_homepath only, free the list with
+FS_FreeFileList
+===========
+*/
+char **FS_HomeListFiles(const char *homePath, const char *extension, int *numFiles)
+{
+	if(!fs_searchpaths)
+	{
+		Com_Error(ERR_FATAL, "Filesystem call made without initialization\n");
+	}
+
+	return Sys_ListFiles(FS_BuildOSPath(fs_homepath->string, fs_gamedir, homePath), extension, NULL, numFiles, qfalse);
+}
+
 /*
 ================
 FS_FileExists
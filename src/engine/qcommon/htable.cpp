@@ -32,6 +32,7 @@ Maryland 20850 USA.
 ===========================================================================
 */
 
+
 #include "../idLib/precompiled.h"
 //#include "qcommon.h"
 #include "htable.h"
@@ -43,46 +44,15 @@ Maryland 20850 USA.
 
 
 /*
- * "List heads" - used to store various lists
+ * Number of items in each block of an in-table hash table
  */
-
-struct listhead_t
-{
-	struct listhead_t *	previous;
-	struct listhead_t *	next;
-};
-
-
-/*
- * Resets a list head
- */
-#define RESET_LIST(LPTR) \
-	( (LPTR)->previous = (LPTR)->next = (LPTR) )
-
-
-/*
- * Table entry - used to store actual items
- */
-
-struct tentry_t
-{
-	/* Entry in one of the table's sub-lists */
-	struct listhead_t	loc_list;
-
-	/* Entry in the table's main list */
-	struct listhead_t	full_list;
-
-	/* Cached hash value */
-	unsigned int		hash;
-};
+#define HT_BLOCK_ITEMS		32
 
 
 /*
  * Function pointers
  */
 
-typedef unsigned int ( * getkey_t )( const char * key );
-typedef char * ( * keyfromentry_t )( struct tentry_t * entry , size_t key_offset );
 typedef int ( * comparekey_t )( const char * k1 , const char * k2 );
 
 
@@ -91,9 +61,6 @@ typedef int ( * comparekey_t )( const char * k1 , const char * k2 );
  */
 struct hashtable_s
 {
-	/* Actual size of the table */
-	size_t			size;
-
 	/* Table flags */
 	unsigned int		flags;
 
@@ -107,55 +74,48 @@ struct hashtable_s
 	size_t			key_length;
 
 	/* Functions */
-	getkey_t		GetKey;
-	keyfromentry_t		KeyFromEntry;
 	comparekey_t		CompareKey;
 
-	/* List of all items */
-	struct listhead_t	all_items;
-};
-
+	/* Items by key */
+	idStrHashMap< void * >	items;
 
-/*
- * Macro that finds the first list head after a table's main structure
- */
-#define TABLE_START(TABLE) \
-	( (struct listhead_t *)( ((char*)(TABLE)) + sizeof( struct hashtable_s ) ) )
+	/* Items in insertion or key order, for HT_Apply */
+	idList< void * >	order;
 
+	/* Size of an item's slot in the blocks */
+	size_t			slot_size;
 
-/*=============================================*
- * Internal functions prototypes               *
- *=============================================*/
+	/* Blocks holding the items of an in-table hash table */
+	idList< char * >	blocks;
 
-/* Checks if a size is a prime number */
-static qboolean _HT_IsPrime( size_t n );
+	/* Unused slots left in the last block */
+	int			block_free;
 
-/* Finds the next higher prime number */
-static size_t _HT_NextPrime( size_t n );
+	/* Deleted items, linked through their first bytes */
+	void *			free_items;
 
-/* Computes a string's hash key (case insensitive) */
-static unsigned int _HT_GetCIKey( const char * key );
+	hashtable_s( unsigned int flags ) : items( ( flags & HT_FLAG_CASE ) != 0 ) { }
+};
 
-/* Computes a string's hash key (case sensitive) */
-static unsigned int _HT_GetKey( const char * key );
 
-/* Returns a table entry's key (in-table items, fixed size key) */
-static char * _HT_KeyFromEntryII( struct tentry_t * entry , size_t key_offset );
+/*=============================================*
+ * Internal functions prototypes               *
+ *=============================================*/
 
-/* Returns a table entry's key (in-table items, pointer key) */
-static char * _HT_KeyFromEntryIP( struct tentry_t * entry , size_t key_offset );
+/* Returns an item's key */
+static char * _HT_KeyFromItem( hashtable_t table , void * item );
 
-/* Returns a table entry's key (external items, fixed size key) */
-static char * _HT_KeyFromEntryPI( struct tentry_t * entry , size_t key_offset );
+/* Insert an item into a table's ordered list */
+static void _HT_InsertInOrder( hashtable_t table , void * item );
 
-/* Returns a table entry's key (external items, pointer key) */
-static char * _HT_KeyFromEntryPP( struct tentry_t * entry , size_t key_offset );
+/* Removes an item from a table's ordered list */
+static void _HT_RemoveFromOrder( hashtable_t table , void * item );
 
-/* Allocate and initialise a table entry. */
-static struct tentry_t * _HT_CreateEntry( hashtable_t table , unsigned int hash , struct listhead_t * list_entry , const char * key );
+/* Allocates a cleared item from an in-table hash table's blocks */
+static void * _HT_AllocItem( hashtable_t table );
 
-/* Insert a table entry into a table's global list */
-static void _HT_InsertInGlobalList( hashtable_t table , struct tentry_t * t_entry , const char * key );
+/* Returns an item to an in-table hash table's blocks */
+static void _HT_FreeItem( hashtable_t table , void * item );
 
 
 /*=============================================*
@@ -172,37 +132,25 @@ hashtable_t HT_Create(
 	)
 {
 	hashtable_t		table;
-	size_t			real_size;
-	struct listhead_t *	t_item;
 
 	// Allocate table
-	real_size = _HT_NextPrime( size );
-	table = (hashtable_t)Z_Malloc( sizeof( struct hashtable_s ) + real_size * sizeof( struct listhead_t ) );
-	assert( table );
+	table = new hashtable_s( flags );
 
 	// Initialise main table fields
-	table->size = real_size;
 	table->flags = flags;
 	table->item_size = item_size;
 	table->key_offset = key_offset;
 	table->key_length = key_length;
-	RESET_LIST( &table->all_items );
-
-	// Set functions
-	table->GetKey = ( flags & HT_FLAG_CASE ) ? _HT_GetKey : _HT_GetCIKey;
 	table->CompareKey = ( flags & HT_FLAG_CASE ) ? strcmp : Q_strcasecmp;
-	if ( ( flags & HT_FLAG_INTABLE ) == 0 ) {
-		table->KeyFromEntry = key_length ? _HT_KeyFromEntryPI : _HT_KeyFromEntryPP;
-	} else {
-		table->KeyFromEntry = key_length ? _HT_KeyFromEntryII : _HT_KeyFromEntryIP;
-	}
 
-	// Initialise table entries
-	t_item = TABLE_START( table );
-	while ( real_size > 0 ) {
-		RESET_LIST( t_item );
-		t_item ++, real_size --;
-	}
+	// Slots are big enough to link free items and keep them aligned
+	table->slot_size = ( MAX( item_size , sizeof( void * ) ) + 15 ) & ~15;
+	table->block_free = 0;
+	table->free_items = NULL;
+
+	// Make room for the expected number of items
+	table->items.Reserve( size );
+	table->order.SetGranularity( 32 );
 
 	return table;
 }
@@ -213,26 +161,24 @@ void HT_Destroy(
 	)
 {
 	qboolean		del_key;
-	struct listhead_t *	list_head;
-	struct listhead_t *	list_entry;
-	struct tentry_t *	t_entry;
+	qboolean		del_item;
+	int			i;
 
 	del_key = (qboolean)( table->key_length == 0 && ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) != 0 );
-	list_head = &( table->all_items );
-	list_entry = list_head->next;
-	while ( list_entry != list_head ) {
-		t_entry = (struct tentry_t *)( ( (char *) list_entry ) - HT_OffsetOfField( struct tentry_t , full_list )  );
-		list_entry = list_entry->next;
+	del_item = (qboolean)( ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) != 0 );
+	for ( i = 0 ; i < table->order.Num( ) ; i ++ ) {
+		void * item = table->order[ i ];
 
 		if ( del_key )
-			Z_Free( table->KeyFromEntry( t_entry , table->key_offset ) );
-		if ( ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) == HT_FLAG_FREE ) {
-			void ** data = (void **)( ( (char *) t_entry ) + sizeof( struct tentry_t ) );
-			Z_Free( *data );
-		}
-		Z_Free( t_entry );
+			Z_Free( _HT_KeyFromItem( table , item ) );
+		if ( del_item && ( table->flags & HT_FLAG_INTABLE ) == 0 )
+			Z_Free( item );
 	}
-	Z_Free( table );
+
+	// In-table items go away with their blocks
+	for ( i = 0 ; i < table->blocks.Num( ) ; i ++ )
+		Z_Free( table->blocks[ i ] );
+	delete table;
 }
 
 
@@ -242,52 +188,31 @@ void * HT_GetItem(
 		qboolean *	created
 	)
 {
-	unsigned int		hash;
-	struct listhead_t *	list_head;
-	struct listhead_t *	list_entry;
-	struct tentry_t *	t_entry;
+	void **			found;
 	void *			data;
 
 	assert( table->key_length == 0 || table->key_length >= strlen( key ) );
 
 	// Try finding the item
-	hash = table->GetKey( key );
-	list_head = ( TABLE_START( table ) + ( hash % table->size ) );
-	list_entry = list_head->next;
-	while ( list_entry != list_head ) {
-		t_entry = ( struct tentry_t * ) list_entry;
-
-		if ( t_entry->hash > hash )
-			break;
-
-		if ( t_entry->hash == hash ) {
-			char * item_key = table->KeyFromEntry( t_entry , table->key_offset );
-			if ( ! table->CompareKey( key , item_key ) ) {
-				data = (void *)( ( (char *)t_entry ) + sizeof( struct tentry_t ) );
-				if ( created != NULL )
-					*created = qfalse;
-				return ( table->flags & HT_FLAG_INTABLE ) ? data : ( *(void**)data );
-			}
-		}
-
-		list_entry = list_entry->next;
+	found = table->items.Get( key );
+	if ( found != NULL ) {
+		if ( created != NULL )
+			*created = qfalse;
+		return *found;
 	}
 
 	// Check if we can create the entry
 	if ( created == NULL )
 		return NULL;
 
-	// Create entry
+	// Create item
 	*created = qtrue;
-	t_entry = _HT_CreateEntry( table , hash , list_entry , key );
-
-	// Initialise data
-	data = (void *)( ( (char *)t_entry ) + sizeof( struct tentry_t ) );
-	if ( ( table->flags & HT_FLAG_INTABLE ) == 0 ) {
-		*(void **) data = Z_Malloc( table->item_size );
-		data = *(void **) data;
+	if ( ( table->flags & HT_FLAG_INTABLE ) != 0 ) {
+		data = _HT_AllocItem( table );
+	} else {
+		data = Z_Malloc( table->item_size );
+		memset( data , 0 , table->item_size );
 	}
-	memset( data , 0 , table->item_size );
 
 	// Copy key
 	if ( table->key_length == 0 ) {
@@ -299,6 +224,9 @@ void * HT_GetItem(
 		strcpy( key_ptr , key );
 	}
 
+	table->items.Set( key , data );
+	_HT_InsertInOrder( table , data );
+
 	return data;
 }
 
@@ -309,79 +237,52 @@ void * HT_PutItem(
 		qboolean	allow_replacement
 	)
 {
-	void *			ret_val = NULL;
-	void *			prev_entry = NULL;
+	void **			found;
+	void *			prev_item;
+	void *			data;
 	const char *		insert_key;
-	unsigned int		hash;
-	struct listhead_t *	list_head;
-	struct listhead_t *	list_entry;
-	struct tentry_t *	t_entry;
-
-	// Extract item key
-	if ( table->key_length ) {
-		insert_key = ( (const char *) item ) + table->key_offset;
-	} else {
-		insert_key = *(const char **)( ( (char *) item ) + table->key_offset );
-	}
 
-	// Try finding an item with that key, or the new item's location
-	hash = table->GetKey( insert_key );
-	list_head = ( TABLE_START( table ) + ( hash % table->size ) );
-	list_entry = list_head->next;
-	while ( list_entry != list_head ) {
-		t_entry = ( struct tentry_t * ) list_entry;
-
-		if ( t_entry->hash > hash )
-			break;
-
-		if ( t_entry->hash == hash ) {
-			const char * item_key = table->KeyFromEntry( t_entry , table->key_offset );
-			int cres = table->CompareKey( insert_key , item_key );
-			if ( ! cres ) {
-				prev_entry = ( ( (char *)t_entry ) + sizeof( struct tentry_t ) );
-				ret_val = ( table->flags & HT_FLAG_INTABLE ) ? prev_entry : ( *(void**)prev_entry );
-				if ( ! allow_replacement )
-					return ret_val;
-				break;
-			} else if ( cres > 0 ) {
-				break;
-			}
-		}
+	// Try finding an item with that key
+	insert_key = _HT_KeyFromItem( table , item );
+	found = table->items.Get( insert_key );
 
-		list_entry = list_entry->next;
-	}
+	if ( found != NULL ) {
+		prev_item = *found;
+		if ( ! allow_replacement )
+			return prev_item;
 
-	if ( ret_val != NULL ) {
 		// Delete previous item's key if it was a pointer and either
 		// items are in-table or should be freed automatically
 		if ( table->key_length == 0 && ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) != 0 )
-			Z_Free( table->KeyFromEntry( t_entry , table->key_offset ) );
+			Z_Free( _HT_KeyFromItem( table , prev_item ) );
 
 		if ( ( table->flags & HT_FLAG_INTABLE ) != 0 ) {
 			// Copy item data
-			memcpy( prev_entry , item , table->item_size );
-			ret_val = NULL;
-		} else {
-			if ( ( table->flags & HT_FLAG_FREE ) != 0 ) {
-				// Free previous item
-				Z_Free( ret_val );
-				ret_val = NULL;
-			}
-			*(void **) prev_entry = item;
+			memcpy( prev_item , item , table->item_size );
+			return NULL;
 		}
-	} else {
-		void * data;
 
-		t_entry = _HT_CreateEntry( table , hash , list_entry , insert_key );
-		data = (void *)( ( (char *)t_entry ) + sizeof( struct tentry_t ) );
-		if ( ( table->flags & HT_FLAG_INTABLE ) != 0 ) {
-			memcpy( data , item , table->item_size );
-		} else {
-			*(void **) data = item;
+		// Replace the item, it keeps its place in the ordered list
+		*found = item;
+		table->order[ table->order.FindIndex( prev_item ) ] = item;
+		if ( ( table->flags & HT_FLAG_FREE ) != 0 ) {
+			// Free previous item
+			Z_Free( prev_item );
+			return NULL;
 		}
+		return prev_item;
+	}
+
+	if ( ( table->flags & HT_FLAG_INTABLE ) != 0 ) {
+		data = _HT_AllocItem( table );
+		memcpy( data , item , table->item_size );
+	} else {
+		data = item;
 	}
+	table->items.Set( insert_key , data );
+	_HT_InsertInOrder( table , data );
 
-	return ret_val;
+	return NULL;
 }
 
 
@@ -391,64 +292,40 @@ qboolean HT_DeleteItem(
 		void **		found
 	)
 {
-	unsigned int		hash;
-	struct listhead_t *	list_head;
-	struct listhead_t *	list_entry;
-	struct tentry_t *	t_entry;
-	void *			data = NULL;
+	void **			item;
+	void *			data;
 
 	// Try finding the item
-	hash = table->GetKey( key );
-	list_head = ( TABLE_START( table ) + ( hash % table->size ) );
-	list_entry = list_head->next;
-	while ( list_entry != list_head ) {
-		t_entry = ( struct tentry_t * ) list_entry;
-
-		if ( t_entry->hash > hash )
-			break;
-
-		if ( t_entry->hash == hash ) {
-			char * item_key = table->KeyFromEntry( t_entry , table->key_offset );
-			if ( ! table->CompareKey( key , item_key ) ) {
-				data = (void *)( ( (char *)t_entry ) + sizeof( struct tentry_t ) );
-				data = ( table->flags & HT_FLAG_INTABLE ) ? data : ( *(void**)data );
-				break;
-			}
-		}
-
-		list_entry = list_entry->next;
-	}
+	item = table->items.Get( key );
 
 	// Did we find it?
-	if ( data == NULL ) {
+	if ( item == NULL ) {
 		if ( found != NULL )
 			*found = NULL;
 		return qfalse;
 	}
 
-	// Detach it from its lists
-	t_entry->loc_list.previous->next = t_entry->loc_list.next;
-	t_entry->loc_list.next->previous = t_entry->loc_list.previous;
-	t_entry->full_list.previous->next = t_entry->full_list.next;
-	t_entry->full_list.next->previous = t_entry->full_list.previous;
+	// Detach it from the table
+	data = *item;
+	table->items.Remove( key );
+	_HT_RemoveFromOrder( table , data );
 
 	// Delete key
 	if ( table->key_length == 0 && ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) != 0 )
-		Z_Free( table->KeyFromEntry( t_entry , table->key_offset ) );
+		Z_Free( _HT_KeyFromItem( table , data ) );
 
 	// Delete item
-	if ( ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) == HT_FLAG_FREE )
+	if ( ( table->flags & HT_FLAG_INTABLE ) != 0 ) {
+		_HT_FreeItem( table , data );
+		data = NULL;
+	} else if ( ( table->flags & HT_FLAG_FREE ) != 0 ) {
 		Z_Free( data );
-
-	// Delete entry
-	Z_Free( t_entry );
+		data = NULL;
+	}
 
 	// Set found pointer
-	if ( found != NULL ) {
-		if ( ( table->flags & ( HT_FLAG_INTABLE | HT_FLAG_FREE ) ) != 0 )
-			data = NULL;
+	if ( found != NULL )
 		*found = data;
-	}
 
 	return qtrue;
 }
@@ -460,194 +337,318 @@ void HT_Apply(
 		void *		data
 	)
 {
-	struct listhead_t *	list_head;
-	struct listhead_t *	list_entry;
-
-	list_head = &( table->all_items );
-	list_entry = list_head->next;
-	while ( list_entry != list_head ) {
-		void * item;
-		item = ( (char *) list_entry ) - HT_OffsetOfField( struct tentry_t , full_list ) + sizeof( struct tentry_t );
-		list_entry = list_entry->next;
-
-		if ( ( table->flags & HT_FLAG_INTABLE ) == 0 )
-			item = *(void**) item;
+	int			i;
+
+	for ( i = 0 ; i < table->order.Num( ) ; i ++ ) {
+		void * item = table->order[ i ];
+
 		if ( ! function( item , data ) )
 			return;
+
+		// The function may have deleted the item
+		if ( i >= table->order.Num( ) || table->order[ i ] != item )
+			i --;
 	}
 }
 
 
+
 /*=============================================*
- * Functions related to prime numbers          *
+ * Key retrieval                               *
  *=============================================*/
 
-static qboolean _HT_IsPrime( size_t n )
-{
-	size_t temp;
-	size_t nsq;
-	size_t inc;
 
-	if ( n == 0 )
-		return qfalse;
-
-	nsq = ceil( sqrt( (double)n ) );
-	for ( inc = 1 , temp = 2 ; temp <= nsq ; temp += inc ) {
-		if ( n % temp == 0 )
-			return qfalse;
-		if ( temp == 3 )
-			inc = 2;
-	}
-	return qtrue;
-}
-
-
-static size_t _HT_NextPrime( size_t n )
+static char * _HT_KeyFromItem( hashtable_t table , void * item )
 {
-	size_t value = n;
-	while ( ! _HT_IsPrime( value ) )
-		value ++;
-	return value;
+	if ( table->key_length )
+		return ( (char *) item ) + table->key_offset;
+	return *(char **)( ( (char *) item ) + table->key_offset );
 }
 
 
 
 /*=============================================*
- * Key computation functions                   *
+ * Other internal functions                    *
  *=============================================*/
 
 
-static unsigned int _HT_GetCIKey( const char * key )
+static void _HT_InsertInOrder( hashtable_t table , void * item )
 {
-	const char * current = key;
-	unsigned int hash = 111119;
-
-	while ( *current ) {
-		hash += (unsigned char)idStr::ToLower( *current );
-		hash += ( hash << 10 );
-		hash ^= ( hash >> 6 );
-		current ++;
+	const char *	key;
+	int		low , high , mid;
+
+	if ( ( table->flags & HT_FLAG_SORTED ) == 0 ) {
+		// Append to the list
+		table->order.Append( item );
+		return;
 	}
 
-	hash += ( hash << 3 );
-	hash ^= ( hash >> 11 );
-	hash += ( hash << 15 );
+	// List must be kept sorted, find insert location
+	key = _HT_KeyFromItem( table , item );
+	low = 0;
+	high = table->order.Num( );
+	while ( low < high ) {
+		int cres;
+
+		mid = ( low + high ) / 2;
+		cres = table->CompareKey( _HT_KeyFromItem( table , table->order[ mid ] ) , key );
+		assert( cres != 0 );
+		if ( cres > 0 )
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	table->order.Insert( item , low );
+}
 
-	return hash;
+
+static void _HT_RemoveFromOrder( hashtable_t table , void * item )
+{
+	int index = table->order.FindIndex( item );
+
+	assert( index >= 0 );
+	table->order.RemoveIndex( index );
 }
 
 
-static unsigned int _HT_GetKey( const char * key )
+static void * _HT_AllocItem( hashtable_t table )
 {
-	const char * current = key;
-	unsigned int hash = 111119;
-
-	while ( *current ) {
-		hash += (unsigned char) *current;
-		hash += ( hash << 10 );
-		hash ^= ( hash >> 6 );
-		current ++;
+	void *		item;
+
+	if ( table->free_items != NULL ) {
+		// Reuse a deleted item
+		item = table->free_items;
+		table->free_items = *(void **) item;
+	} else {
+		// Take the next slot, starting a new block if needed
+		if ( table->block_free == 0 ) {
+			table->blocks.Append( (char *) Z_Malloc( table->slot_size * HT_BLOCK_ITEMS ) );
+			table->block_free = HT_BLOCK_ITEMS;
+		}
+		item = table->blocks[ table->blocks.Num( ) - 1 ] + table->slot_size * ( HT_BLOCK_ITEMS - table->block_free );
+		table->block_free --;
 	}
 
-	hash += ( hash << 3 );
-	hash ^= ( hash >> 11 );
-	hash += ( hash << 15 );
+	memset( item , 0 , table->item_size );
+	return item;
+}
+
 
-	return hash;
+static void _HT_FreeItem( hashtable_t table , void * item )
+{
+	*(void **) item = table->free_items;
+	table->free_items = item;
 }
 
 
 
 /*=============================================*
- * Key retrieval                               *
+ * Benchmark                                   *
  *=============================================*/
 
+#define HT_BENCH_KEY_LENGTH	32
+#define HT_BENCH_CHAIN_SIZE	512
 
-static char * _HT_KeyFromEntryII( struct tentry_t * entry , size_t key_offset )
-{
-	void * item_addr;
-	item_addr = (void*)( ( (char*)entry ) + sizeof( struct tentry_t ) );
-	return (char *)( ( (char*)item_addr ) + key_offset );
-}
 
-static char * _HT_KeyFromEntryIP( struct tentry_t * entry , size_t key_offset )
+/*
+ * Bucket chained table like the ones cvars, commands and sounds used to
+ * have, kept here as the reference for the benchmark
+ */
+
+struct benchchain_t
 {
-	void * item_addr;
-	item_addr = (void*)( ( (char*)entry ) + sizeof( struct tentry_t ) );
-	return *(char **)( ( (char*)item_addr ) + key_offset );
-}
+	const char *		key;
+	int			value;
+	struct benchchain_t *	next;
+};
+
 
-static char * _HT_KeyFromEntryPI( struct tentry_t * entry , size_t key_offset )
+static int _HT_BenchChainHash( const char * key )
 {
-	void * item_addr;
-	item_addr = *(void**)( ( (char*)entry ) + sizeof( struct tentry_t ) );
-	return (char *)( ( (char*)item_addr ) + key_offset );
+	int i , hash = 0;
+
+	for ( i = 0 ; key[ i ] ; i ++ )
+		hash += idStr::ToLower( key[ i ] ) * ( i + 119 );
+	return hash & ( HT_BENCH_CHAIN_SIZE - 1 );
 }
 
-static char * _HT_KeyFromEntryPP( struct tentry_t * entry , size_t key_offset )
+
+static void _HT_BenchReport( const char * name , int inserts , int insert_msec , int lookups , int lookup_msec , int found )
 {
-	void * item_addr;
-	item_addr = *(void**)( ( (char*)entry ) + sizeof( struct tentry_t ) );
-	return *(char **)( ( (char*)item_addr ) + key_offset );
+	Com_Printf( "%-12s insert %6i ms %8.2f Mops/s  lookup %6i ms %8.2f Mops/s  (%i)\n" , name ,
+			insert_msec , insert_msec ? inserts / ( insert_msec * 1000.0f ) : 0.0f ,
+			lookup_msec , lookup_msec ? lookups / ( lookup_msec * 1000.0f ) : 0.0f , found );
 }
 
 
+/*
+ * hashBench [keys] [passes]
+ *
+ * Measures insert and lookup throughput of idStrHashMap against the
+ * chained tables it replaced. Half of the lookups miss.
+ */
+void HT_Benchmark_f( void )
+{
+	int			num_keys , passes , inserts , lookups;
+	int			i , p , start , insert_msec , found;
+	char *			keys;
+	char *			probes;
+
+	num_keys = Cmd_Argc( ) > 1 ? atoi( Cmd_Argv( 1 ) ) : 4096;
+	passes = Cmd_Argc( ) > 2 ? atoi( Cmd_Argv( 2 ) ) : 500;
+	num_keys = Com_Clamp( 16 , 1 << 20 , num_keys );
+	passes = Com_Clamp( 1 , 100000 , passes );
+	inserts = num_keys * ( passes / 10 + 1 );
+	lookups = num_keys * 2 * passes;
+
+	// the probes are copies so no table can get away with comparing pointers,
+	// every other one is a key that was never added
+	keys = (char *)Z_Malloc( num_keys * HT_BENCH_KEY_LENGTH );
+	probes = (char *)Z_Malloc( num_keys * 2 * HT_BENCH_KEY_LENGTH );
+	for ( i = 0 ; i < num_keys ; i ++ ) {
+		Com_sprintf( keys + i * HT_BENCH_KEY_LENGTH , HT_BENCH_KEY_LENGTH , "bench_%s_%i" , ( i & 1 ) ? "var" : "cmd" , i * 7919 );
+		Q_strncpyz( probes + i * 2 * HT_BENCH_KEY_LENGTH , keys + i * HT_BENCH_KEY_LENGTH , HT_BENCH_KEY_LENGTH );
+		Com_sprintf( probes + ( i * 2 + 1 ) * HT_BENCH_KEY_LENGTH , HT_BENCH_KEY_LENGTH , "bench_%s_%i_" , ( i & 1 ) ? "var" : "cmd" , i * 7919 );
+	}
 
-/*=============================================*
- * Other internal functions                    *
- *=============================================*/
+	Com_Printf( "%i keys, %i passes\n" , num_keys , passes );
 
+	// open addressing map
+	{
+		idStrHashMap< int >	map( false );
 
-static struct tentry_t * _HT_CreateEntry(
-	hashtable_t		table ,
-	unsigned int		hash ,
-	struct listhead_t *	list_entry ,
-	const char *		key )
-{
-	// Allocate new entry
-	struct tentry_t * t_entry;
-	size_t	entry_size = sizeof( struct tentry_t );
-	entry_size += ( table->flags & HT_FLAG_INTABLE ) ? table->item_size : sizeof( void * );
-	t_entry = (tentry_t*)Z_Malloc( entry_size );
-	t_entry->hash = hash;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p <= passes / 10 ; p ++ ) {
+			map.Clear( );
+			for ( i = 0 ; i < num_keys ; i ++ )
+				map.Set( keys + i * HT_BENCH_KEY_LENGTH , i );
+		}
+		insert_msec = Sys_Milliseconds( ) - start;
+
+		found = 0;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p < passes ; p ++ ) {
+			for ( i = 0 ; i < num_keys * 2 ; i ++ ) {
+				if ( map.Get( probes + i * HT_BENCH_KEY_LENGTH ) )
+					found ++;
+			}
+		}
+		_HT_BenchReport( "idStrHashMap" , inserts , insert_msec , lookups , Sys_Milliseconds( ) - start , found );
+	}
 
-	// Add entry to local list
-	t_entry->loc_list.previous = list_entry->previous;
-	t_entry->loc_list.next = list_entry;
-	list_entry->previous = t_entry->loc_list.previous->next = &( t_entry->loc_list );
+	// bucket chains
+	{
+		benchchain_t *		heads[ HT_BENCH_CHAIN_SIZE ];
+		benchchain_t *		nodes;
+		benchchain_t *		node;
+		int			hash;
+
+		nodes = (benchchain_t *)Z_Malloc( num_keys * sizeof( benchchain_t ) );
+
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p <= passes / 10 ; p ++ ) {
+			memset( heads , 0 , sizeof( heads ) );
+			for ( i = 0 ; i < num_keys ; i ++ ) {
+				const char * key = keys + i * HT_BENCH_KEY_LENGTH;
+
+				hash = _HT_BenchChainHash( key );
+				for ( node = heads[ hash ] ; node ; node = node->next ) {
+					if ( ! Q_stricmp( node->key , key ) )
+						break;
+				}
+				if ( node == NULL ) {
+					node = &nodes[ i ];
+					node->key = key;
+					node->next = heads[ hash ];
+					heads[ hash ] = node;
+				}
+				node->value = i;
+			}
+		}
+		insert_msec = Sys_Milliseconds( ) - start;
+
+		found = 0;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p < passes ; p ++ ) {
+			for ( i = 0 ; i < num_keys * 2 ; i ++ ) {
+				const char * key = probes + i * HT_BENCH_KEY_LENGTH;
+
+				for ( node = heads[ _HT_BenchChainHash( key ) ] ; node ; node = node->next ) {
+					if ( ! Q_stricmp( node->key , key ) ) {
+						found ++;
+						break;
+					}
+				}
+			}
+		}
+		_HT_BenchReport( "chains" , inserts , insert_msec , lookups , Sys_Milliseconds( ) - start , found );
 
-	_HT_InsertInGlobalList( table , t_entry , key );
+		Z_Free( nodes );
+	}
 
-	return t_entry;
-}
+	// idHashIndex over an array of keys
+	{
+		idHashIndex		index( idMath::CeilPowerOfTwo( num_keys ) , num_keys );
+		int			hash , j;
+
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p <= passes / 10 ; p ++ ) {
+			index.Clear( );
+			for ( i = 0 ; i < num_keys ; i ++ ) {
+				const char * key = keys + i * HT_BENCH_KEY_LENGTH;
+
+				hash = index.GenerateKey( key , false );
+				for ( j = index.First( hash ) ; j != -1 ; j = index.Next( j ) ) {
+					if ( ! idStr::Icmp( keys + j * HT_BENCH_KEY_LENGTH , key ) )
+						break;
+				}
+				if ( j == -1 )
+					index.Add( hash , i );
+			}
+		}
+		insert_msec = Sys_Milliseconds( ) - start;
+
+		found = 0;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p < passes ; p ++ ) {
+			for ( i = 0 ; i < num_keys * 2 ; i ++ ) {
+				const char * key = probes + i * HT_BENCH_KEY_LENGTH;
+
+				hash = index.GenerateKey( key , false );
+				for ( j = index.First( hash ) ; j != -1 ; j = index.Next( j ) ) {
+					if ( ! idStr::Icmp( keys + j * HT_BENCH_KEY_LENGTH , key ) ) {
+						found ++;
+						break;
+					}
+				}
+			}
+		}
+		_HT_BenchReport( "idHashIndex" , inserts , insert_msec , lookups , Sys_Milliseconds( ) - start , found );
+	}
 
+	// idHashTable, case sensitive and allocates a node per key
+	{
+		idHashTable< int >	table( idMath::CeilPowerOfTwo( num_keys ) );
 
-static void _HT_InsertInGlobalList( hashtable_t table , struct tentry_t * t_entry , const char * key )
-{
-	if ( ( table->flags & HT_FLAG_SORTED ) == 0 ) {
-		// Append to global list
-		t_entry->full_list.previous = table->all_items.previous;
-		t_entry->full_list.next = &( table->all_items );
-		table->all_items.previous = t_entry->full_list.previous->next = &( t_entry->full_list );
-	} else {
-		// Global list must be kept sorted, find insert location
-		struct listhead_t * list_entry = table->all_items.next;
-		while ( list_entry != &( table->all_items ) ) {
-			struct tentry_t * ai_entry;
-			const char * ai_key;
-			int cres;
-
-			ai_entry = (struct tentry_t *)( ( (char *) list_entry ) - HT_OffsetOfField( struct tentry_t , full_list )  );
-			ai_key = table->KeyFromEntry( ai_entry , table->key_offset );
-			cres = table->CompareKey( ai_key , key );
-
-			assert( cres != 0 );
-			if ( cres > 0 )
-				break;
-			list_entry = list_entry->next;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p <= passes / 10 ; p ++ ) {
+			table.Clear( );
+			for ( i = 0 ; i < num_keys ; i ++ )
+				table.Set( keys + i * HT_BENCH_KEY_LENGTH , i );
+		}
+		insert_msec = Sys_Milliseconds( ) - start;
+
+		found = 0;
+		start = Sys_Milliseconds( );
+		for ( p = 0 ; p < passes ; p ++ ) {
+			for ( i = 0 ; i < num_keys * 2 ; i ++ ) {
+				if ( table.Get( probes + i * HT_BENCH_KEY_LENGTH ) )
+					found ++;
+			}
 		}
-		t_entry->full_list.previous = list_entry->previous;
-		t_entry->full_list.next = list_entry;
-		list_entry->previous = t_entry->full_list.previous->next = &( t_entry->full_list );
+		_HT_BenchReport( "idHashTable" , inserts , insert_msec , lookups , Sys_Milliseconds( ) - start , found );
 	}
+
+	Z_Free( probes );
+	Z_Free( keys );
 }
@@ -56,7 +56,8 @@ typedef qboolean ( * ht_apply_funct )( void * item , void * extra );
  * Hash table flags                            *
  *=============================================*/
 
-/* Items are stored inside the table */
+/* Items are stored inside the table, in blocks it allocates; an item's
+ * address stays the same until it is deleted */
 #define HT_FLAG_INTABLE		( 1 << 0 )
 /* Free items on table destruction */
 #define HT_FLAG_FREE		( 1 << 1 )
@@ -75,8 +76,7 @@ typedef qboolean ( * ht_apply_funct )( void * item , void * extra );
  * Hash table creation
  *
  * Parameters:
- *	size		size of the table (will be rounded up to the next
- *			prime number)
+ *	size		expected number of items in the table
  *	flags		combination of HT_FLAG_* for the table
  *	item_size	size of the table's items
  *	key_offset	offset of the key in the table's items
@@ -197,5 +197,12 @@ void HT_Apply(
 	);
 
 
+/*
+ * Console command that measures insert and lookup throughput of the
+ * engine's string tables
+ */
+void HT_Benchmark_f( void );
+
+
 
 #endif // __H_HASHTABLE
@@ -0,0 +1,644 @@
+/*
+===========================================================================
+
+OpenWolf GPL Source Code
+Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company. 
+Copyright (C) 2012 Dusan Jocic <dusanjocic@msn.com>
+
+This file is part of the OpenWolf GPL Source Code (OpenWolf Source Code).  
+
+OpenWolf Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenWolf Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenWolf Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the OpenWolf Source Code is also subject to certain additional terms. 
+You should have received a copy of these additional terms immediately following the 
+terms and conditions of the GNU General Public License which accompanied the OpenWolf 
+Source Code.  If not, please request a copy in writing from id Software at the address 
+below.
+
+If you have questions concerning this license or the applicable additional terms, you 
+may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, 
+Maryland 20850 USA.
+
+===========================================================================
+*/
+
+// jobs.cpp -- fixed pool of worker threads with work stealing and job dependencies
+
+#include "../idLib/precompiled.h"
+#include "../qcommon/q_shared.h"
+#include "qcommon.h"
+
+#define MAX_JOB_THREADS		32			// including the main thread
+#define MAX_JOBS			4096
+#define JOB_QUEUE_SIZE		1024		// per thread, has to be a power of two
+
+typedef struct job_s {
+	jobFunc_t       func;
+	void           *data;
+	jobCounter_t   *counter;
+	jobCounter_t   *dependency;
+	struct job_s   *next;				// free or parked list
+} job_t;
+
+// the owning thread pushes and pops at the bottom, the others steal from the top
+typedef struct {
+	volatile int    lock;
+	volatile int    top, bottom;
+	job_t          *jobs[JOB_QUEUE_SIZE];
+} jobQueue_t;
+
+typedef struct {
+	int             jobs;
+	int             steals;
+	int             busyMsec;				// only measured on the workers
+} jobStats_t;
+
+typedef struct {
+	int             index;
+	void           *handle;
+	jobQueue_t      queue;
+	jobStats_t      stats;
+} jobThread_t;
+
+typedef struct {
+	qboolean        initialized;
+	volatile int    quit;
+
+	int             numThreads;
+	jobThread_t     threads[MAX_JOB_THREADS];
+
+	job_t           pool[MAX_JOBS];
+	job_t          *freeJobs;
+	volatile int    freeLock;
+
+	job_t          *parked;				// jobs waiting for their dependency
+	int             numParked;
+	volatile int    parkedLock;
+
+	void           *wake;				// idle workers sleep on it
+	volatile int    sleeping;
+
+	volatile int    queued;
+	int             peakQueued;
+	int             statsTime;
+} jobSystem_t;
+
+static jobSystem_t js;
+static Q_THREAD_LOCAL int job_threadIndex;
+
+static convar_t *com_jobThreads;
+
+/*
+===============================================================================
+
+LOCKS AND QUEUES
+
+===============================================================================
+*/
+
+/*
+============
+Job_Lock
+
+Spin lock, everything it guards is only held for a few instructions
+============
+*/
+static void Job_Lock(volatile int *lock) {
+	while(Sys_AtomicCompareExchange(lock, 1, 0) != 0) {
+		while(*lock) {
+		}
+	}
+}
+
+/*
+============
+Job_Unlock
+============
+*/
+static void Job_Unlock(volatile int *lock) {
+	Sys_MemoryBarrier();
+	*lock = 0;
+}
+
+/*
+============
+Job_Push
+
+Returns qfalse if the queue is full
+============
+*/
+static qboolean Job_Push(jobQueue_t * q, job_t * job) {
+	Job_Lock(&q->lock);
+	if(q->bottom - q->top >= JOB_QUEUE_SIZE) {
+		Job_Unlock(&q->lock);
+		return qfalse;
+	}
+	q->jobs[q->bottom & (JOB_QUEUE_SIZE - 1)] = job;
+	q->bottom++;
+	Job_Unlock(&q->lock);
+
+	return qtrue;
+}
+
+/*
+============
+Job_Pop
+
+Newest job first, its data is most likely still in the cache
+============
+*/
+static job_t *Job_Pop(jobQueue_t * q) {
+	job_t          *job = NULL;
+
+	if(q->bottom == q->top) {
+		return NULL;
+	}
+
+	Job_Lock(&q->lock);
+	if(q->bottom != q->top) {
+		q->bottom--;
+		job = q->jobs[q->bottom & (JOB_QUEUE_SIZE - 1)];
+		if(q->bottom == q->top) {
+			q->top = q->bottom = 0;
+		}
+	}
+	Job_Unlock(&q->lock);
+
+	return job;
+}
+
+/*
+============
+Job_Steal
+
+Oldest job first, the owner keeps working on the other end
+============
+*/
+static job_t *Job_Steal(jobQueue_t * q) {
+	job_t          *job = NULL;
+
+	if(q->bottom == q->top) {
+		return NULL;
+	}
+
+	Job_Lock(&q->lock);
+	if(q->bottom != q->top) {
+		job = q->jobs[q->top & (JOB_QUEUE_SIZE - 1)];
+		q->top++;
+		if(q->bottom == q->top) {
+			q->top = q->bottom = 0;
+		}
+	}
+	Job_Unlock(&q->lock);
+
+	return job;
+}
+
+/*
+============
+Job_Alloc
+============
+*/
+static job_t *Job_Alloc(void) {
+	job_t          *job;
+
+	Job_Lock(&js.freeLock);
+	job = js.freeJobs;
+	if(job) {
+		js.freeJobs = job->next;
+	}
+	Job_Unlock(&js.freeLock);
+
+	return job;
+}
+
+/*
+============
+Job_Free
+============
+*/
+static void Job_Free(job_t * job) {
+	Job_Lock(&js.freeLock);
+	job->next = js.freeJobs;
+	js.freeJobs = job;
+	Job_Unlock(&js.freeLock);
+}
+
+/*
+===============================================================================
+
+RUNNING JOBS
+
+===============================================================================
+*/
+
+static void     Job_Execute(jobThread_t * thread, job_t * job);
+
+/*
+============
+Job_Queue
+
+Puts a job that is ready to run on the queue of the calling thread
+============
+*/
+static void Job_Queue(job_t * job) {
+	jobThread_t    *thread = &js.threads[job_threadIndex];
+	int             queued;
+
+	if(!Job_Push(&thread->queue, job)) {
+		// the queue is full, run it right away
+		Job_Execute(thread, job);
+		return;
+	}
+
+	// the atomic add also orders the push before the check for sleeping workers
+	queued = Sys_AtomicAdd(&js.queued, 1);
+	if(queued > js.peakQueued) {
+		js.peakQueued = queued;
+	}
+
+	if(js.sleeping > 0) {
+		Sys_PostSemaphore(js.wake);
+	}
+}
+
+/*
+============
+Job_Release
+
+Queues the parked jobs whose dependency has been finished
+============
+*/
+static void Job_Release(void) {
+	job_t          *job, **prev, *ready = NULL;
+
+	Job_Lock(&js.parkedLock);
+	for(prev = &js.parked; (job = *prev) != NULL;) {
+		if(job->dependency->count <= 0) {
+			*prev = job->next;
+			job->next = ready;
+			ready = job;
+			js.numParked--;
+		} else {
+			prev = &job->next;
+		}
+	}
+	Job_Unlock(&js.parkedLock);
+
+	while(ready) {
+		job = ready;
+		ready = job->next;
+		Job_Queue(job);
+	}
+}
+
+/*
+============
+Job_Execute
+============
+*/
+static void Job_Execute(jobThread_t * thread, job_t * job) {
+	jobCounter_t   *counter;
+
+	job->func(job->data);
+	thread->stats.jobs++;
+
+	counter = job->counter;
+	Job_Free(job);
+
+	// the counter may be gone as soon as it hits zero, so Job_Release
+	// only looks at the counters of the parked jobs
+	if(counter && Sys_AtomicAdd(&counter->count, -1) == 0) {
+		Job_Release();
+	}
+}
+
+/*
+============
+Job_RunOne
+
+Runs a job from the own queue or steals one from another thread,
+returns qfalse if every queue was empty
+============
+*/
+static qboolean Job_RunOne(jobThread_t * thread) {
+	job_t          *job;
+	int             i;
+
+	job = Job_Pop(&thread->queue);
+
+	for(i = 1; !job && i < js.numThreads; i++) {
+		job = Job_Steal(&js.threads[(thread->index + i) % js.numThreads].queue);
+		if(job) {
+			thread->stats.steals++;
+		}
+	}
+
+	if(!job) {
+		return qfalse;
+	}
+
+	Sys_AtomicAdd(&js.queued, -1);
+	Job_Execute(thread, job);
+
+	return qtrue;
+}
+
+/*
+============
+Job_WorkerThread
+============
+*/
+static int Job_WorkerThread(void *data) {
+	jobThread_t    *thread = (jobThread_t *)data;
+	int             start;
+
+	job_threadIndex = thread->index;
+
+	while(1) {
+		start = Sys_Milliseconds();
+		while(Job_RunOne(thread)) {
+		}
+		thread->stats.busyMsec += Sys_Milliseconds() - start;
+
+		// a job queued after this shows up in js.queued, one queued
+		// before sees the sleeping count and posts the semaphore
+		Sys_AtomicAdd(&js.sleeping, 1);
+		if(js.quit) {
+			Sys_AtomicAdd(&js.sleeping, -1);
+			break;
+		}
+		if(js.queued <= 0) {
+			Sys_WaitSemaphore(js.wake);
+		}
+		Sys_AtomicAdd(&js.sleeping, -1);
+	}
+
+	return 0;
+}
+
+/*
+===============================================================================
+
+PUBLIC INTERFACE
+
+===============================================================================
+*/
+
+/*
+============
+Job_Add
+
+Any thread may add jobs, they go on the queue of the adding thread
+============
+*/
+void Job_Add(jobFunc_t func, void *data, jobCounter_t * counter, jobCounter_t * dependency) {
+	jobThread_t    *thread;
+	job_t          *job;
+
+	if(!js.initialized) {
+		// jobs added so far have all finished, so the dependency has too
+		func(data);
+		return;
+	}
+
+	if(counter) {
+		Sys_AtomicAdd(&counter->count, 1);
+	}
+
+	thread = &js.threads[job_threadIndex];
+	while((job = Job_Alloc()) == NULL) {
+		// every job is in use, help until one is done
+		Job_RunOne(thread);
+	}
+
+	job->func = func;
+	job->data = data;
+	job->counter = counter;
+	job->dependency = dependency;
+
+	if(dependency) {
+		// Job_Execute takes the same lock after the count hits zero,
+		// so the job is either queued here or released there
+		Job_Lock(&js.parkedLock);
+		if(dependency->count > 0) {
+			job->next = js.parked;
+			js.parked = job;
+			js.numParked++;
+			Job_Unlock(&js.parkedLock);
+			return;
+		}
+		Job_Unlock(&js.parkedLock);
+	}
+
+	Job_Queue(job);
+}
+
+/*
+============
+Job_Wait
+
+The waiting thread runs queued jobs instead of blocking
+============
+*/
+void Job_Wait(jobCounter_t * counter) {
+	jobThread_t    *thread = &js.threads[job_threadIndex];
+
+	while(counter->count > 0) {
+		Job_RunOne(thread);
+	}
+
+	// make the results of the jobs visible
+	Sys_MemoryBarrier();
+}
+
+typedef struct {
+	void            (*func) (int index, void *data);
+	void           *data;
+	int             count;
+	volatile int    next;
+} jobParallelFor_t;
+
+/*
+============
+Job_ParallelForJob
+
+Takes one index at a time, so uneven work stays balanced
+============
+*/
+static void Job_ParallelForJob(void *data) {
+	jobParallelFor_t *pf = (jobParallelFor_t *)data;
+	int             i;
+
+	while((i = Sys_AtomicAdd(&pf->next, 1) - 1) < pf->count) {
+		pf->func(i, pf->data);
+	}
+}
+
+/*
+============
+Job_ParallelFor
+
+Calls func for every index from 0 to count - 1 and returns when all are done
+============
+*/
+void Job_ParallelFor(int count, void (*func) (int index, void *data), void *data) {
+	jobParallelFor_t pf;
+	jobCounter_t    counter;
+	int             i, numJobs;
+
+	pf.func = func;
+	pf.data = data;
+	pf.count = count;
+	pf.next = 0;
+	counter.count = 0;
+
+	numJobs = Q_min(count, Job_NumThreads());
+	for(i = 1; i < numJobs; i++) {
+		Job_Add(Job_ParallelForJob, &pf, &counter, NULL);
+	}
+
+	// the calling thread takes part as well
+	Job_ParallelForJob(&pf);
+	Job_Wait(&counter);
+}
+
+/*
+============
+Job_NumThreads
+============
+*/
+int Job_NumThreads(void) {
+	return js.initialized ? js.numThreads : 1;
+}
+
+/*
+============
+Job_ThreadIndex
+============
+*/
+int Job_ThreadIndex(void) {
+	return job_threadIndex;
+}
+
+/*
+============
+Job_Stats_f
+
+Prints the queue depth and how busy each thread was since the last call
+============
+*/
+static void Job_Stats_f(void) {
+	jobThread_t    *thread;
+	int             i, msec;
+
+	msec = Sys_Milliseconds() - js.statsTime;
+
+	Com_Printf("thread     jobs   steals  busy\n");
+	for(i = 0, thread = js.threads; i < js.numThreads; i++, thread++) {
+		if(!i) {
+			Com_Printf("main   %8i %8i     -\n", thread->stats.jobs, thread->stats.steals);
+		} else {
+			Com_Printf("%4i   %8i %8i  %3i%%\n", i, thread->stats.jobs, thread->stats.steals,
+					   msec > 0 ? thread->stats.busyMsec * 100 / msec : 0);
+		}
+		Com_Memset(&thread->stats, 0, sizeof(thread->stats));
+	}
+	Com_Printf("%i queued, %i peak, %i parked over %i msec\n", js.queued, js.peakQueued, js.numParked, msec);
+
+	js.peakQueued = js.queued;
+	js.statsTime = Sys_Milliseconds();
+}
+
+/*
+============
+Job_Init
+============
+*/
+void Job_Init(void) {
+	jobThread_t    *thread;
+	int             i, numWorkers;
+
+	if(js.initialized) {
+		return;
+	}
+
+	com_jobThreads = Cvar_Get("com_jobThreads", "0", CVAR_ARCHIVE | CVAR_LATCH, "Number of job worker threads, 0 uses one less than the number of processors");
+
+	numWorkers = com_jobThreads->integer;
+	if(numWorkers <= 0) {
+		numWorkers = Sys_ProcessorCount() - 1;
+	}
+	numWorkers = Com_Clamp(0, MAX_JOB_THREADS - 1, numWorkers);
+
+	Com_Memset(&js, 0, sizeof(js));
+	for(i = 0; i < MAX_JOBS - 1; i++) {
+		js.pool[i].next = &js.pool[i + 1];
+	}
+	js.freeJobs = js.pool;
+	js.wake = Sys_CreateSemaphore();
+	js.numThreads = 1;
+	js.initialized = qtrue;
+
+	for(i = 0; i < numWorkers; i++) {
+		thread = &js.threads[js.numThreads];
+		thread->index = js.numThreads;
+		thread->handle = Sys_CreateThread(Job_WorkerThread, thread);
+		if(!thread->handle) {
+			Com_Printf(S_COLOR_YELLOW "WARNING: only %i of %i job threads started\n", i, numWorkers);
+			break;
+		}
+		js.numThreads++;
+	}
+
+	js.statsTime = Sys_Milliseconds();
+
+	Cmd_AddCommand("jobstats", Job_Stats_f, "^1Prints the job queue depth and how busy every job thread was since the last call");
+
+	Com_Printf("%i job worker threads\n", js.numThreads - 1);
+}
+
+/*
+============
+Job_Shutdown
+
+The workers finish the queued jobs before they exit
+============
+*/
+void Job_Shutdown(void) {
+	int             i;
+
+	if(!js.initialized || job_threadIndex) {
+		return;
+	}
+
+	js.quit = 1;
+	Sys_MemoryBarrier();
+
+	for(i = 1; i < js.numThreads; i++) {
+		Sys_PostSemaphore(js.wake);
+	}
+	for(i = 1; i < js.numThreads; i++) {
+		Sys_JoinThread(js.threads[i].handle);
+	}
+
+	// whatever the main thread queued without a worker to run it
+	while(Job_RunOne(&js.threads[0])) {
+	}
+
+	Sys_DestroySemaphore(js.wake);
+	Cmd_RemoveCommand("jobstats");
+
+	js.initialized = qfalse;
+}
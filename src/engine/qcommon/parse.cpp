@@ -207,6 +207,60 @@ typedef struct indent_s
   struct indent_s *next;  //next indent on the indent stack
 } indent_t;
 
+//token stream cache
+//
+//a source loaded through a handle is read to the end at once and the
+//finished tokens are written to tokencache/<name hash><define hash>.tok
+//in the home path, together with the hashes of the file and everything
+//it included.  The next load with the same global defines reads that
+//file in one go and hands out its tokens in place, without running the
+//lexer and precompiler again.  The files are machine local.
+#define TOKENCACHE_IDENT      (('K' << 24) + ('O' << 16) + ('T' << 8) + 'P')
+#define TOKENCACHE_VERSION    1
+#define MAX_TOKENCACHE_FILES  64
+
+typedef struct tokenCacheHeader_s
+{
+  int ident;
+  int version;
+  unsigned int definehash;      //hash of the global defines
+  char filename[MAX_QPATH];     //file name of the source
+  int numfiles;                 //source and included files
+  int numtokens;
+  int stringsize;               //size of the string table
+  int eofline;                  //line after the last token
+} tokenCacheHeader_t;
+
+typedef struct tokenCacheFile_s
+{
+  char filename[MAX_QPATH];
+  unsigned int hash;            //hash of the file contents
+} tokenCacheFile_t;
+
+typedef struct tokenCacheToken_s
+{
+  int type;
+  int subtype;
+  int intvalue;
+  float floatvalue;
+  int string;                   //offset in the string table
+  int line;                     //line the token was read on
+} tokenCacheToken_t;
+
+typedef struct tokenStream_s
+{
+  byte *data;                   //cache file image
+  qboolean fromfile;            //data came from FS_HomeReadFile
+  tokenCacheToken_t *tokens;
+  char *strings;
+  int numtokens;
+  int eofline;
+  int next;                     //next token to hand out
+  int last;                     //last token handed out
+  int unread;                   //times the last token was unread
+  int line;                     //line reported by Parse_SourceFileAndLine
+} tokenStream_t;
+
 //source file
 typedef struct source_s
 {
@@ -220,6 +274,10 @@ typedef struct source_s
   indent_t *indentstack;        //stack with indents
   int skip;                     // > 0 if skipping conditional code
   token_t token;                //last read token
+  tokenCacheFile_t files[MAX_TOKENCACHE_FILES]; //files read for the source
+  int numfiles;
+  qboolean nocache;             //tokens can't be cached
+  tokenStream_t *stream;        //tokens read ahead or from the cache
 } source_t;
 
 #define MAX_DEFINEPARMS     128
@@ -238,6 +296,8 @@ static qboolean Parse_AddDefineToSourceFromString( source_t *source,
                                                    char *string );
 
 int numtokens;
+//errors and warnings printed, sources that had any are not cached
+int numparseerrors;
 
 //list with global defines added to every source loaded
 define_t *globaldefines;
@@ -370,6 +430,7 @@ static __attribute__((format(printf, 2, 3))) void QDECL Parse_ScriptError(script
 
   if (script->flags & SCFL_NOERRORS) return;
 
+  numparseerrors++;
   va_start(ap, str);
   vsprintf(text, str, ap);
   va_end(ap);
@@ -388,6 +449,7 @@ static __attribute__((format(printf, 2, 3))) void QDECL Parse_ScriptWarning(scri
 
   if (script->flags & SCFL_NOWARNINGS) return;
 
+  numparseerrors++;
   va_start(ap, str);
   vsprintf(text, str, ap);
   va_end(ap);
@@ -1109,6 +1171,7 @@ static __attribute__((format(printf, 2, 3))) void QDECL Parse_SourceError(source
   char text[1024];
   va_list ap;
 
+  numparseerrors++;
   va_start(ap, str);
   vsprintf(text, str, ap);
   va_end(ap);
@@ -1125,6 +1188,7 @@ static __attribute__((format(printf, 2, 3))) void QDECL Parse_SourceWarning(sour
   char text[1024];
   va_list ap;
 
+  numparseerrors++;
   va_start(ap, str);
   vsprintf(text, str, ap);
   va_end(ap);
@@ -1196,6 +1260,48 @@ static void Parse_PushScript(source_t *source, script_t *script)
   source->scriptstack = script;
 }
 
+/*
+===============
+Parse_CacheHash
+
+FNV-1a, start with 2166136261
+===============
+*/
+static unsigned int Parse_CacheHash(unsigned int hash, const void *data, int size)
+{
+  const byte *bytes = (const byte *) data;
+  int i;
+
+  for (i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*
+===============
+Parse_AddSourceFile
+
+remembers a file read for the source, a cached token stream is only
+used while all of them are unchanged
+===============
+*/
+static void Parse_AddSourceFile(source_t *source, script_t *script)
+{
+  tokenCacheFile_t *file;
+
+  if (source->numfiles >= MAX_TOKENCACHE_FILES || strlen(script->filename) >= MAX_QPATH)
+  {
+    source->nocache = qtrue;
+    return;
+  }
+  file = &source->files[source->numfiles++];
+  strcpy(file->filename, script->filename);
+  file->hash = Parse_CacheHash(2166136261u, script->buffer, script->length);
+}
+
 /*
 ===============
 Parse_CopyToken
@@ -1583,6 +1689,7 @@ static int Parse_ExpandBuiltinDefine(source_t *source, token_t *deftoken, define
     }
     case BUILTIN_DATE:
     {
+      source->nocache = qtrue;
       t = time(NULL);
       curtime = ctime(&t);
       strcpy(token->string, "\"");
@@ -1598,6 +1705,7 @@ static int Parse_ExpandBuiltinDefine(source_t *source, token_t *deftoken, define
     }
     case BUILTIN_TIME:
     {
+      source->nocache = qtrue;
       t = time(NULL);
       curtime = ctime(&t);
       strcpy(token->string, "\"");
@@ -2588,6 +2696,7 @@ static int Parse_Directive_include(source_t *source)
     return qfalse;
   }
   Parse_PushScript(source, script);
+  Parse_AddSourceFile(source, script);
   return qtrue;
 }
 
@@ -3608,6 +3717,7 @@ static source_t *Parse_LoadSourceFile(const char *filename)
   source->definehash = (define_t**)Z_Malloc(DEFINEHASHSIZE * sizeof(define_t *));
   Com_Memset( source->definehash, 0, DEFINEHASHSIZE * sizeof(define_t *));
   Parse_AddGlobalDefinesToSource(source);
+  Parse_AddSourceFile(source, script);
   return source;
 }
 
@@ -3639,7 +3749,7 @@ static void Parse_FreeSource(source_t *source)
     source->tokens = source->tokens->next;
     Parse_FreeToken(token);
   }
-  for (i = 0; i < DEFINEHASHSIZE; i++)
+  for (i = 0; source->definehash && i < DEFINEHASHSIZE; i++)
   {
     while(source->definehash[i])
     {
@@ -3655,6 +3765,13 @@ static void Parse_FreeSource(source_t *source)
     source->indentstack = source->indentstack->next;
     Z_Free(indent);
   }
+  //free the token stream
+  if (source->stream)
+  {
+    if (source->stream->fromfile) FS_FreeFile(source->stream->data);
+    else Z_Free(source->stream->data);
+    Z_Free(source->stream);
+  }
   //
   if (source->definehash) Z_Free(source->definehash);
   //free the source itself
@@ -3665,6 +3782,299 @@ static void Parse_FreeSource(source_t *source)
 
 source_t *sourceFiles[MAX_SOURCEFILES];
 
+convar_t *pc_tokenCache;
+
+/*
+===============
+Parse_TokenToPC
+===============
+*/
+static void Parse_TokenToPC(token_t *token, pc_token_t *pc_token)
+{
+  strcpy(pc_token->string, token->string);
+  pc_token->type = token->type;
+  pc_token->subtype = token->subtype;
+  pc_token->intvalue = token->intvalue;
+  pc_token->floatvalue = token->floatvalue;
+  if (pc_token->type == TT_STRING)
+    Parse_StripDoubleQuotes(pc_token->string);
+}
+
+/*
+===============
+Parse_GlobalDefineHash
+===============
+*/
+static unsigned int Parse_GlobalDefineHash(void)
+{
+  define_t *define;
+  token_t *token;
+  unsigned int hash;
+
+  hash = 2166136261u;
+  for (define = globaldefines; define; define = define->next)
+  {
+    hash = Parse_CacheHash(hash, define->name, strlen(define->name) + 1);
+    hash = Parse_CacheHash(hash, &define->numparms, sizeof(define->numparms));
+    for (token = define->parms; token; token = token->next)
+      hash = Parse_CacheHash(hash, token->string, strlen(token->string) + 1);
+    for (token = define->tokens; token; token = token->next)
+      hash = Parse_CacheHash(hash, token->string, strlen(token->string) + 1);
+  }
+  return hash;
+}
+
+/*
+===============
+Parse_TokenCachePath
+===============
+*/
+static const char *Parse_TokenCachePath(const char *filename, unsigned int definehash)
+{
+  char name[MAX_QPATH];
+
+  Q_strncpyz(name, filename, sizeof(name));
+  Q_strlwr(name);
+  Parse_ConvertPath(name);
+  return va("tokencache/%08x%08x.tok", Parse_CacheHash(2166136261u, name, strlen(name)), definehash);
+}
+
+/*
+===============
+Parse_LoadCachedSource
+
+returns NULL unless the cache file for the source exists and all the
+files it was made from are unchanged
+===============
+*/
+static source_t *Parse_LoadCachedSource(const char *filename, unsigned int definehash)
+{
+  tokenCacheHeader_t *header;
+  tokenCacheFile_t *files;
+  tokenCacheToken_t *tokens;
+  tokenStream_t *stream;
+  source_t *source;
+  void *buffer, *filebuffer;
+  int length, filelength, i;
+
+  //the cache never goes through the search path, it would be subject
+  //to sv_pure and end up in the pure checksums
+  length = FS_HomeReadFile(Parse_TokenCachePath(filename, definehash), &buffer);
+  if (!buffer) return NULL;
+
+  header = (tokenCacheHeader_t *) buffer;
+  files = (tokenCacheFile_t *) (header + 1);
+  if (length < (int) sizeof(tokenCacheHeader_t))
+  {
+    FS_FreeFile(buffer);
+    return NULL;
+  }
+  header->filename[sizeof(header->filename) - 1] = '\0';
+  if (header->ident != TOKENCACHE_IDENT ||
+      header->version != TOKENCACHE_VERSION ||
+      header->definehash != definehash ||
+      Q_stricmp(header->filename, filename) ||
+      header->numfiles < 1 || header->numfiles > MAX_TOKENCACHE_FILES ||
+      header->numtokens < 0 || header->numtokens > length / (int) sizeof(tokenCacheToken_t) ||
+      header->stringsize < 1 || header->stringsize > length ||
+      length != (int) (sizeof(tokenCacheHeader_t) + header->numfiles * sizeof(tokenCacheFile_t) +
+                       header->numtokens * sizeof(tokenCacheToken_t)) + header->stringsize)
+  {
+    FS_FreeFile(buffer);
+    return NULL;
+  }
+
+  //a damaged file must not send Parse_ReadStreamToken out of the string table
+  tokens = (tokenCacheToken_t *) (files + header->numfiles);
+  for (i = 0; i < header->numtokens; i++)
+  {
+    if (tokens[i].string < 0 || tokens[i].string >= header->stringsize)
+    {
+      FS_FreeFile(buffer);
+      return NULL;
+    }
+  }
+
+  for (i = 0; i < header->numfiles; i++)
+  {
+    files[i].filename[sizeof(files[i].filename) - 1] = '\0';
+    filelength = FS_ReadFile(files[i].filename, &filebuffer);
+    if (!filebuffer)
+    {
+      FS_FreeFile(buffer);
+      return NULL;
+    }
+    if (Parse_CacheHash(2166136261u, filebuffer, filelength) != files[i].hash)
+    {
+      FS_FreeFile(filebuffer);
+      FS_FreeFile(buffer);
+      return NULL;
+    }
+    FS_FreeFile(filebuffer);
+  }
+
+  stream = (tokenStream_t *) Z_Malloc(sizeof(tokenStream_t));
+  Com_Memset(stream, 0, sizeof(tokenStream_t));
+  stream->data = (byte *) buffer;
+  stream->fromfile = qtrue;
+  stream->tokens = tokens;
+  stream->strings = (char *) (tokens + header->numtokens);
+  stream->strings[header->stringsize - 1] = '\0';
+  stream->numtokens = header->numtokens;
+  stream->eofline = header->eofline;
+  stream->last = -1;
+  stream->line = 1;
+
+  source = (source_t *) Z_Malloc(sizeof(source_t));
+  Com_Memset(source, 0, sizeof(source_t));
+  Q_strncpyz(source->filename, filename, sizeof(source->filename));
+  source->stream = stream;
+  return source;
+}
+
+/*
+===============
+Parse_ReadSourceToEnd
+
+reads all tokens of a freshly loaded source into a stream and writes
+it to the token cache if nothing went wrong on the way
+===============
+*/
+static void Parse_ReadSourceToEnd(source_t *source, unsigned int definehash)
+{
+  tokenCacheHeader_t *header;
+  tokenCacheToken_t *tokens, *newtokens;
+  tokenStream_t *stream;
+  token_t token;
+  pc_token_t pc_token;
+  char *strings, *newstrings;
+  int numtokens, maxtokens, stringsize, maxstringsize, length, size, errors;
+
+  errors = numparseerrors;
+  numtokens = 0;
+  maxtokens = 256;
+  tokens = (tokenCacheToken_t *) Z_Malloc(maxtokens * sizeof(tokenCacheToken_t));
+  stringsize = 0;
+  maxstringsize = 4096;
+  strings = (char *) Z_Malloc(maxstringsize);
+
+  while (Parse_ReadToken(source, &token))
+  {
+    Parse_TokenToPC(&token, &pc_token);
+    length = strlen(pc_token.string) + 1;
+
+    if (numtokens == maxtokens)
+    {
+      maxtokens *= 2;
+      newtokens = (tokenCacheToken_t *) Z_Malloc(maxtokens * sizeof(tokenCacheToken_t));
+      Com_Memcpy(newtokens, tokens, numtokens * sizeof(tokenCacheToken_t));
+      Z_Free(tokens);
+      tokens = newtokens;
+    }
+    if (stringsize + length > maxstringsize)
+    {
+      while (stringsize + length > maxstringsize) maxstringsize *= 2;
+      newstrings = (char *) Z_Malloc(maxstringsize);
+      Com_Memcpy(newstrings, strings, stringsize);
+      Z_Free(strings);
+      strings = newstrings;
+    }
+
+    tokens[numtokens].type = pc_token.type;
+    tokens[numtokens].subtype = pc_token.subtype;
+    tokens[numtokens].intvalue = pc_token.intvalue;
+    tokens[numtokens].floatvalue = pc_token.floatvalue;
+    tokens[numtokens].string = stringsize;
+    tokens[numtokens].line = source->scriptstack ? source->scriptstack->line : 0;
+    Com_Memcpy(strings + stringsize, pc_token.string, length);
+    stringsize += length;
+    numtokens++;
+  }
+  //keep an empty string at the end so the table is never empty
+  if (stringsize == maxstringsize)
+  {
+    newstrings = (char *) Z_Malloc(maxstringsize + 1);
+    Com_Memcpy(newstrings, strings, stringsize);
+    Z_Free(strings);
+    strings = newstrings;
+  }
+  strings[stringsize++] = '\0';
+
+  //lay the stream out like the cache file
+  size = sizeof(tokenCacheHeader_t) + source->numfiles * sizeof(tokenCacheFile_t) +
+         numtokens * sizeof(tokenCacheToken_t) + stringsize;
+
+  stream = (tokenStream_t *) Z_Malloc(sizeof(tokenStream_t));
+  Com_Memset(stream, 0, sizeof(tokenStream_t));
+  stream->data = (byte *) Z_Malloc(size);
+  stream->fromfile = qfalse;
+
+  header = (tokenCacheHeader_t *) stream->data;
+  Com_Memset(header, 0, sizeof(tokenCacheHeader_t));
+  header->ident = TOKENCACHE_IDENT;
+  header->version = TOKENCACHE_VERSION;
+  header->definehash = definehash;
+  Q_strncpyz(header->filename, source->filename, sizeof(header->filename));
+  header->numfiles = source->numfiles;
+  header->numtokens = numtokens;
+  header->stringsize = stringsize;
+  header->eofline = source->scriptstack ? source->scriptstack->line : 0;
+  Com_Memcpy(header + 1, source->files, source->numfiles * sizeof(tokenCacheFile_t));
+
+  stream->tokens = (tokenCacheToken_t *) ((tokenCacheFile_t *) (header + 1) + source->numfiles);
+  stream->strings = (char *) (stream->tokens + numtokens);
+  Com_Memcpy(stream->tokens, tokens, numtokens * sizeof(tokenCacheToken_t));
+  Com_Memcpy(stream->strings, strings, stringsize);
+  stream->numtokens = numtokens;
+  stream->eofline = header->eofline;
+  stream->last = -1;
+  stream->line = 1;
+  source->stream = stream;
+
+  Z_Free(tokens);
+  Z_Free(strings);
+
+  if (!source->nocache && numparseerrors == errors && source->numfiles > 0)
+  {
+    FS_HomeWriteFile(Parse_TokenCachePath(source->filename, definehash), stream->data, size);
+  }
+}
+
+/*
+===============
+Parse_ReadStreamToken
+===============
+*/
+static int Parse_ReadStreamToken(tokenStream_t *stream, pc_token_t *pc_token)
+{
+  tokenCacheToken_t *token;
+
+  if (stream->unread > 0 && stream->last >= 0)
+  {
+    stream->unread--;
+  }
+  else if (stream->next < stream->numtokens)
+  {
+    stream->last = stream->next++;
+  }
+  else
+  {
+    stream->unread = 0;
+    stream->line = stream->eofline;
+    pc_token->string[0] = '\0';
+    return qfalse;
+  }
+
+  token = &stream->tokens[stream->last];
+  stream->line = token->line;
+  Q_strncpyz(pc_token->string, stream->strings + token->string, sizeof(pc_token->string));
+  pc_token->type = token->type;
+  pc_token->subtype = token->subtype;
+  pc_token->intvalue = token->intvalue;
+  pc_token->floatvalue = token->floatvalue;
+  return qtrue;
+}
+
 /*
 ===============
 Parse_LoadSourceHandle
@@ -3673,7 +4083,8 @@ Parse_LoadSourceHandle
 int Parse_LoadSourceHandle(const char *filename)
 {
   source_t *source;
-  int i;
+  unsigned int definehash;
+  int i, start;
 
   for (i = 1; i < MAX_SOURCEFILES; i++)
   {
@@ -3682,9 +4093,35 @@ int Parse_LoadSourceHandle(const char *filename)
   }
   if (i >= MAX_SOURCEFILES)
     return 0;
-  source = Parse_LoadSourceFile(filename);
+
+  if (!pc_tokenCache)
+    pc_tokenCache = Cvar_Get("pc_tokenCache", "1", CVAR_ARCHIVE, "test");
+
+  start = Sys_Milliseconds();
+  source = NULL;
+  definehash = 0;
+  if (pc_tokenCache->integer)
+  {
+    definehash = Parse_GlobalDefineHash();
+    source = Parse_LoadCachedSource(filename, definehash);
+    if (source)
+    {
+      Com_DPrintf("%s: %i tokens from the token cache in %i msec\n", filename,
+                  source->stream->numtokens, Sys_Milliseconds() - start);
+    }
+  }
   if (!source)
-    return 0;
+  {
+    source = Parse_LoadSourceFile(filename);
+    if (!source)
+      return 0;
+    if (pc_tokenCache->integer)
+    {
+      Parse_ReadSourceToEnd(source, definehash);
+      Com_DPrintf("%s: %i tokens parsed in %i msec\n", filename,
+                  source->stream->numtokens, Sys_Milliseconds() - start);
+    }
+  }
   sourceFiles[i] = source;
   return i;
 }
@@ -3721,14 +4158,11 @@ int Parse_ReadTokenHandle(int handle, pc_token_t *pc_token)
   if (!sourceFiles[handle])
     return 0;
 
+  if (sourceFiles[handle]->stream)
+    return Parse_ReadStreamToken(sourceFiles[handle]->stream, pc_token);
+
   ret = Parse_ReadToken(sourceFiles[handle], &token);
-  strcpy(pc_token->string, token.string);
-  pc_token->type = token.type;
-  pc_token->subtype = token.subtype;
-  pc_token->intvalue = token.intvalue;
-  pc_token->floatvalue = token.floatvalue;
-  if (pc_token->type == TT_STRING)
-    Parse_StripDoubleQuotes(pc_token->string);
+  Parse_TokenToPC(&token, pc_token);
   return ret;
 }
 
@@ -3739,13 +4173,18 @@ Parse_SourceFileAndLine
 */
 int Parse_SourceFileAndLine(int handle, char *filename, int *line)
 {
+  tokenStream_t *stream;
+
   if (handle < 1 || handle >= MAX_SOURCEFILES)
     return qfalse;
   if (!sourceFiles[handle])
     return qfalse;
 
   strcpy(filename, sourceFiles[handle]->filename);
-  if (sourceFiles[handle]->scriptstack)
+  stream = sourceFiles[handle]->stream;
+  if (stream)
+    *line = stream->line;
+  else if (sourceFiles[handle]->scriptstack)
     *line = sourceFiles[handle]->scriptstack->line;
   else
     *line = 0;
@@ -3772,5 +4211,10 @@ void Parse_UnreadLastTokenHandle(int handle) {
 		return;
 	}
 
+	if ( sourceFiles[handle]->stream ) {
+		sourceFiles[handle]->stream->unread++;
+		return;
+	}
+
 	Parse_UnreadSourceToken( sourceFiles[handle], &sourceFiles[handle]->token );
 }
\ No newline at end of file
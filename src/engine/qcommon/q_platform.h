@@ -419,6 +419,15 @@ Maryland 20850 USA.
 #error "DLL_EXT not defined"
 #endif
 
+//thread local storage
+#ifndef Q3_VM
+#if defined( _MSC_VER )
+#define Q_THREAD_LOCAL __declspec( thread )
+#else
+#define Q_THREAD_LOCAL __thread
+#endif
+#endif
+
 //platform string
 #ifdef NDEBUG
 #define PLATFORM_STRING OS_STRING "-" ARCH_STRING
@@ -1940,6 +1940,158 @@ void Info_NextPair( const char **head, char *key, char *value ) {
 }
 
 
+/*
+===================
+Info_HashKey
+
+Case insensitive, matching the Q_stricmp compare used by Info_ValueForKey
+===================
+*/
+static unsigned int Info_HashKey( const char *key ) {
+	unsigned int hash;
+	int c;
+
+	hash = 2166136261u;
+	while ( *key ) {
+		c = *key++;
+		if ( c >= 'A' && c <= 'Z' ) {
+			c += 'a' - 'A';
+		}
+		hash = ( hash ^ (byte)c ) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+===================
+Info_CacheInvalidate
+===================
+*/
+void Info_CacheInvalidate( infoCache_t *cache ) {
+	cache->valid = qfalse;
+	cache->source = NULL;
+}
+
+/*
+===================
+Info_CacheParse
+
+Splits the info string into NUL terminated keys and values and hashes
+the keys.  The first instance of a duplicated key wins, like it does in
+Info_ValueForKey.
+===================
+*/
+void Info_CacheParse( infoCache_t *cache, const char *s ) {
+	char        *o;
+	int key, value, slot;
+	unsigned int hash;
+
+	cache->valid = qtrue;
+	cache->overflowed = qfalse;
+	cache->source = s;
+	cache->numPairs = 0;
+	memset( cache->slots, 0, sizeof( cache->slots ) );
+
+	if ( !s ) {
+		return;
+	}
+
+	if ( strlen( s ) >= BIG_INFO_STRING ) {
+		Com_Error( ERR_DROP, "Info_CacheParse: oversize infostring [%s]", s );
+	}
+
+	o = cache->buffer;
+	if ( *s == '\\' ) {
+		s++;
+	}
+	while ( *s )
+	{
+		key = o - cache->buffer;
+		while ( *s != '\\' )
+		{
+			if ( !*s ) {
+				// a trailing key without a value is never found
+				return;
+			}
+			*o++ = *s++;
+		}
+		*o++ = 0;
+		s++;
+
+		value = o - cache->buffer;
+		while ( *s != '\\' && *s )
+		{
+			*o++ = *s++;
+		}
+		*o++ = 0;
+
+		hash = Info_HashKey( cache->buffer + key );
+		slot = hash & ( MAX_INFO_CACHE_SLOTS - 1 );
+		while ( cache->slots[slot] ) {
+			int i = cache->slots[slot] - 1;
+
+			if ( cache->hashes[i] == hash && !Q_stricmp( cache->buffer + cache->keys[i], cache->buffer + key ) ) {
+				break;
+			}
+			slot = ( slot + 1 ) & ( MAX_INFO_CACHE_SLOTS - 1 );
+		}
+
+		if ( !cache->slots[slot] ) {
+			if ( cache->numPairs == MAX_INFO_CACHE_PAIRS ) {
+				cache->overflowed = qtrue;
+				return;
+			}
+			cache->keys[cache->numPairs] = key;
+			cache->values[cache->numPairs] = value;
+			cache->hashes[cache->numPairs] = hash;
+			cache->slots[slot] = ++cache->numPairs;
+		}
+
+		if ( !*s ) {
+			break;
+		}
+		s++;
+	}
+}
+
+/*
+===================
+Info_CacheValueForKey
+
+Same result as Info_ValueForKey, but the string is only parsed once.
+The returned value stays valid until the cache is parsed again.
+===================
+*/
+const char *Info_CacheValueForKey( infoCache_t *cache, const char *s, const char *key ) {
+	unsigned int hash;
+	int slot, i;
+
+	if ( !s || !key ) {
+		return "";
+	}
+
+	if ( !cache->valid || cache->source != s ) {
+		Info_CacheParse( cache, s );
+	}
+
+	if ( cache->overflowed ) {
+		return Info_ValueForKey( s, key );
+	}
+
+	hash = Info_HashKey( key );
+	slot = hash & ( MAX_INFO_CACHE_SLOTS - 1 );
+	while ( cache->slots[slot] ) {
+		i = cache->slots[slot] - 1;
+		if ( cache->hashes[i] == hash && !Q_stricmp( cache->buffer + cache->keys[i], key ) ) {
+			return cache->buffer + cache->values[i];
+		}
+		slot = ( slot + 1 ) & ( MAX_INFO_CACHE_SLOTS - 1 );
+	}
+
+	return "";
+}
+
+
 /*
 ===================
 Info_RemoveKey
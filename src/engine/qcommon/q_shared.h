@@ -1435,6 +1435,31 @@ void Info_SetValueForKey_Big( char *s, const char *key, const char *value );
 qboolean Info_Validate( const char *s );
 void Info_NextPair( const char **s, char *key, char *value );
 
+//
+// parsed key / value info strings, for callers that look up several keys
+// from the same string.  The cache is rebuilt when a different string is
+// passed in or after Info_CacheInvalidate, so anyone modifying the string
+// in place must invalidate it.
+//
+#define MAX_INFO_CACHE_PAIRS    512
+#define MAX_INFO_CACHE_SLOTS    1024    // must be a power of two
+
+typedef struct infoCache_s {
+	qboolean valid;
+	qboolean overflowed;                // too many pairs, lookups rescan the source
+	const char      *source;
+	int numPairs;
+	char buffer[BIG_INFO_STRING];       // NUL terminated keys and values
+	unsigned short keys[MAX_INFO_CACHE_PAIRS];
+	unsigned short values[MAX_INFO_CACHE_PAIRS];
+	unsigned int hashes[MAX_INFO_CACHE_PAIRS];
+	unsigned short slots[MAX_INFO_CACHE_SLOTS];     // pair index + 1, 0 is empty
+} infoCache_t;
+
+void Info_CacheInvalidate( infoCache_t *cache );
+void Info_CacheParse( infoCache_t *cache, const char *s );
+const char *Info_CacheValueForKey( infoCache_t *cache, const char *s, const char *key );
+
 // this is only here so the functions in q_shared.c and bg_*.c can link
 void QDECL Com_Error( int level, const char *error, ... ) _attribute( ( format( printf,2,3 ), noreturn ) );
 void QDECL Com_FatalError( const char *error, ... );
@@ -1514,7 +1539,6 @@ typedef struct convar_s
 	float           max;
 
 	struct convar_s  *next;
-	struct convar_s  *hashNext;
 } convar_t;
 
 #define MAX_CVAR_VALUE_STRING   256
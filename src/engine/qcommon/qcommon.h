@@ -398,6 +398,32 @@ enum svc_ops_e
 };
 
 
+//
+// server side demos, recorded from all clients at once into
+// demos/<name>.svdm_<protocol>: a header of the magic, the protocol and
+// sv_maxclients, then Huffman compressed blocks, each prefixed by its length
+//
+#define SVDEMO_MAGIC				(('M'<<24)+('D'<<16)+('V'<<8)+'S')	// "SVDM"
+#define SVDEMO_BLOCKLEN				(MAX_MSGLEN * 4)
+
+enum svdm_ops_e
+{
+	svdm_bad,
+	svdm_gamestate,				// [long] checksumFeed, configstrings, baselines
+	svdm_configstring,			// [short] [bigstring]
+	svdm_serverCommand,			// [byte] client (255 for everyone) [string]
+	svdm_frame,					// [long] time [byte] snapFlags, playerstates, entities, entity filters
+	svdm_EOF
+};
+
+#define SVDEMO_BROADCAST			255
+
+// the client filters of entities that don't go to everyone
+#define SVDEMO_FILTER_SINGLE		1	// [byte] client
+#define SVDEMO_FILTER_NOTSINGLE		2	// [byte] client
+#define SVDEMO_FILTER_MASK			3	// [long] loMask [long] hiMask
+
+
 //
 // client to server
 //
@@ -915,6 +941,11 @@ unsigned int    FS_ChecksumOSPath(char *OSPath);
 void			FS_HomeRemove(const char *homePath);
 // XreaL END
 
+// engine written caches, these only look at the gamedir in fs_homepath
+int             FS_HomeReadFile(const char *homePath, void **buffer);
+void            FS_HomeWriteFile(const char *homePath, const void *buffer, int size);
+char          **FS_HomeListFiles(const char *homePath, const char *extension, int *numFiles);
+
 void            FS_FilenameCompletion( const char *dir, const char *ext, qboolean stripExt, void(*callback)(const char *s) );
 
 const char     *FS_GetCurrentGameDir(void);
@@ -1187,6 +1218,34 @@ void			SV_ShutdownGameProgs( void );
 /*
 ==============================================================
 
+JOB SYSTEM
+
+==============================================================
+*/
+
+// Jobs run on a fixed pool of worker threads plus the main thread while it
+// waits. The same rules as for Sys_CreateThread apply, a job may only touch
+// state it owns. Every job added with a counter increments it and decrements
+// it once it is done, a job added with a dependency doesn't start before that
+// counter has dropped to zero, so the dependency has to stay around until
+// the jobs waiting for it have started.
+typedef void    (*jobFunc_t)(void *data);
+
+typedef struct {
+	volatile int    count;
+} jobCounter_t;
+
+void            Job_Init(void);
+void            Job_Shutdown(void);
+void            Job_Add(jobFunc_t func, void *data, jobCounter_t * counter, jobCounter_t * dependency);
+void            Job_Wait(jobCounter_t * counter);	// runs queued jobs until the counter is zero
+void            Job_ParallelFor(int count, void (*func) (int index, void *data), void *data);
+int             Job_NumThreads(void);	// workers + the main thread
+int             Job_ThreadIndex(void);	// 0 on the main thread, 1 - Job_NumThreads()-1 on the workers
+
+/*
+==============================================================
+
 CLIENT / SERVER SYSTEMS
 
 ==============================================================
@@ -1408,6 +1467,27 @@ void            Sys_FreeFileList(char **list);
 
 void			Sys_Sleep( int msec );
 
+// threads only for work that touches state it owns, the common code
+// (cvars, zone, commands, ...) is not thread safe
+typedef int     (*sysThreadFunc_t)(void *data);
+
+void           *Sys_CreateThread(sysThreadFunc_t function, void *data);
+void            Sys_JoinThread(void *thread);
+
+// full memory barrier for handing data between threads without a lock
+void            Sys_MemoryBarrier(void);
+
+// both are full barriers, Sys_AtomicAdd returns the new value and
+// Sys_AtomicCompareExchange the value before the exchange
+int             Sys_AtomicAdd(volatile int *value, int add);
+int             Sys_AtomicCompareExchange(volatile int *value, int exchange, int comparand);
+
+// counting semaphore, Sys_WaitSemaphore blocks until the count is above zero
+void           *Sys_CreateSemaphore(void);
+void            Sys_DestroySemaphore(void *sem);
+void            Sys_PostSemaphore(void *sem);
+void            Sys_WaitSemaphore(void *sem);
+
 qboolean        Sys_OpenUrl( const char *url );
 
 qboolean        Sys_LowPhysicalMemory();
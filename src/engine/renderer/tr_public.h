@@ -274,6 +274,12 @@ typedef struct
 	void            (*IN_Shutdown)(void);
 	void            (*IN_Restart)(void);
 
+	void            (*FS_FCloseFile) (fileHandle_t f);
+	void            (*FS_HomeRemove) (const char *homePath);
+	int             (*FS_HomeReadFile) (const char *homePath, void **buffer);
+	void            (*FS_HomeWriteFile) (const char *homePath, const void *buffer, int size);
+	char          **(*FS_HomeListFiles) (const char *homePath, const char *extension, int *numFiles);
+	const char     *(*FS_LoadedPakChecksums) (void);
 } refimport_t;
 
 
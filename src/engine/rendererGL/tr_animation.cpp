@@ -23,6 +23,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_animation.c
 #include "tr_local.h"
 
+#if !defined(C_ONLY) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SKELETON_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SKELETON_SIMD_SSE2 0
+#endif
+
+// md5 skeletons are built four channels at a time when the SSE2 path is
+// compiled in, animbench clears this to time the scalar loop
+static qboolean skeletonSSE2 = (qboolean) SKELETON_SIMD_SSE2;
+
 /*
 ===========================================================================
 All bones should be an identity orientation to display the mesh exactly
@@ -70,6 +81,236 @@ void R_InitAnimations(void)
 	strcpy(anim->name, "<default animation>");
 }
 
+/*
+===========================================================================
+The first time a .md5anim is parsed the result is written to
+animcache/<name hash>.xanm in the home path. Later loads of a file with the
+same checksum read the channels, bounds and components straight from there
+instead of running the text parser again. The values are stored exactly as
+parsed, so a cached animation is identical to a parsed one.
+
+The files are machine local and never byte swapped. They are only read and
+written through the FS_Home* calls, so sv_pure never sees them.
+===========================================================================
+*/
+
+#define ANIMCACHE_IDENT			(('M' << 24) + ('N' << 16) + ('A' << 8) + 'X')
+#define ANIMCACHE_VERSION		1
+
+typedef struct
+{
+	int             ident;
+	int             version;
+	unsigned        sourceHash;
+	char            name[MAX_QPATH];
+
+	int             numFrames;
+	int             numChannels;
+	int             frameRate;
+	int             numAnimatedComponents;
+
+	// followed by numChannels md5Channel_t, numFrames bounds and
+	// numFrames * numAnimatedComponents floats
+} animCacheHeader_t;
+
+static void R_AnimationCacheFileName(const char *name, char *fileName, int size)
+{
+	char            lowerName[MAX_QPATH];
+
+	Q_strncpyz(lowerName, name, sizeof(lowerName));
+	Q_strlwr(lowerName);
+
+	Com_sprintf(fileName, size, "animcache/%08x.xanm", R_CacheHash(CACHEHASH_BASIS, lowerName, strlen(lowerName)));
+}
+
+/*
+===============
+R_SetupMD5ComponentMap
+
+Resolves which frame component feeds each channel value, so building a
+skeleton doesn't have to walk the component bits
+===============
+*/
+static void R_SetupMD5ComponentMap(md5Animation_t * anim)
+{
+	int             i, j, componentsApplied;
+	md5Channel_t   *channel;
+	int16_t        *map;
+
+	anim->componentMap = (int16_t *) ri.Hunk_Alloc(sizeof(int16_t) * 6 * anim->numChannels, h_low);
+
+	for(i = 0, channel = anim->channels; i < anim->numChannels; i++, channel++)
+	{
+		map = &anim->componentMap[i * 6];
+		componentsApplied = 0;
+
+		for(j = 0; j < 6; j++)
+		{
+			if(channel->componentsBits & (1 << j))
+			{
+				map[j] = channel->componentsOffset + componentsApplied;
+				componentsApplied++;
+			}
+			else
+			{
+				map[j] = -1;
+			}
+		}
+	}
+}
+
+/*
+===============
+R_LoadCachedMD5Anim
+===============
+*/
+static qboolean R_LoadCachedMD5Anim(skelAnimation_t * skelAnim, unsigned sourceHash, const char *name)
+{
+	char            fileName[MAX_QPATH];
+	animCacheHeader_t *header;
+	md5Animation_t *anim;
+	md5Channel_t   *channel;
+	md5Frame_t     *frame;
+	byte           *buffer;
+	float          *data;
+	float          *components;
+	int             len, i, j, numComponents;
+
+	R_AnimationCacheFileName(name, fileName, sizeof(fileName));
+
+	len = ri.FS_HomeReadFile(fileName, (void **)&buffer);
+	if(!buffer)
+	{
+		return qfalse;
+	}
+
+	// stale entries are simply overwritten by R_WriteCachedMD5Anim
+	header = (animCacheHeader_t *) buffer;
+	if(len < (int)sizeof(*header))
+	{
+		ri.FS_FreeFile(buffer);
+		return qfalse;
+	}
+
+	header->name[sizeof(header->name) - 1] = '\0';
+	if(header->ident != ANIMCACHE_IDENT || header->version != ANIMCACHE_VERSION ||
+	   header->sourceHash != sourceHash || Q_stricmp(header->name, name) ||
+	   header->numFrames <= 0 || header->numFrames > 65535 || header->numChannels <= 0 || header->numChannels > 255 ||
+	   header->numAnimatedComponents < 0 || header->numAnimatedComponents > 6 * header->numChannels ||
+	   len != (int)(sizeof(*header) + sizeof(md5Channel_t) * header->numChannels +
+					sizeof(float) * header->numFrames * (6 + header->numAnimatedComponents)))
+	{
+		ri.FS_FreeFile(buffer);
+		return qfalse;
+	}
+
+	// the component map and the skeleton code index with these unchecked
+	for(i = 0, channel = (md5Channel_t *) (header + 1); i < header->numChannels; i++, channel++)
+	{
+		channel->name[sizeof(channel->name) - 1] = '\0';
+
+		for(j = 0, numComponents = 0; j < 6; j++)
+		{
+			if(channel->componentsBits & (1 << j))
+			{
+				numComponents++;
+			}
+		}
+
+		if(channel->parentIndex < -1 || channel->parentIndex >= header->numChannels ||
+		   (channel->componentsBits & ~63) || channel->componentsOffset + numComponents > header->numAnimatedComponents)
+		{
+			ri.FS_FreeFile(buffer);
+			return qfalse;
+		}
+	}
+
+	skelAnim->type = AT_MD5;
+	skelAnim->md5 = anim = (md5Animation_t *) ri.Hunk_Alloc(sizeof(*anim), h_low);
+
+	anim->numFrames = header->numFrames;
+	anim->numChannels = header->numChannels;
+	anim->frameRate = header->frameRate;
+	anim->numAnimatedComponents = header->numAnimatedComponents;
+
+	anim->channels = (md5Channel_t *) ri.Hunk_Alloc(sizeof(md5Channel_t) * anim->numChannels, h_low);
+	Com_Memcpy(anim->channels, header + 1, sizeof(md5Channel_t) * anim->numChannels);
+
+	data = (float *)((byte *) (header + 1) + sizeof(md5Channel_t) * anim->numChannels);
+
+	anim->frames = (md5Frame_t *) ri.Hunk_Alloc(sizeof(md5Frame_t) * anim->numFrames, h_low);
+	components = (float *)ri.Hunk_Alloc(sizeof(float) * anim->numFrames * anim->numAnimatedComponents, h_low);
+
+	for(i = 0, frame = anim->frames; i < anim->numFrames; i++, frame++)
+	{
+		VectorCopy(data, frame->bounds[0]);
+		VectorCopy(data + 3, frame->bounds[1]);
+		data += 6;
+
+		frame->components = components + i * anim->numAnimatedComponents;
+	}
+
+	Com_Memcpy(components, data, sizeof(float) * anim->numFrames * anim->numAnimatedComponents);
+
+	R_SetupMD5ComponentMap(anim);
+
+	ri.FS_FreeFile(buffer);
+
+	return qtrue;
+}
+
+/*
+===============
+R_WriteCachedMD5Anim
+===============
+*/
+static void R_WriteCachedMD5Anim(const md5Animation_t * anim, unsigned sourceHash, const char *name)
+{
+	char            fileName[MAX_QPATH];
+	animCacheHeader_t *header;
+	md5Frame_t     *frame;
+	byte           *buffer;
+	float          *data;
+	int             len, i;
+
+	len = sizeof(*header) + sizeof(md5Channel_t) * anim->numChannels +
+		sizeof(float) * anim->numFrames * (6 + anim->numAnimatedComponents);
+
+	buffer = (byte *) Com_Allocate(len);
+	Com_Memset(buffer, 0, len);
+
+	header = (animCacheHeader_t *) buffer;
+	header->ident = ANIMCACHE_IDENT;
+	header->version = ANIMCACHE_VERSION;
+	header->sourceHash = sourceHash;
+	Q_strncpyz(header->name, name, sizeof(header->name));
+	header->numFrames = anim->numFrames;
+	header->numChannels = anim->numChannels;
+	header->frameRate = anim->frameRate;
+	header->numAnimatedComponents = anim->numAnimatedComponents;
+
+	Com_Memcpy(header + 1, anim->channels, sizeof(md5Channel_t) * anim->numChannels);
+
+	data = (float *)((byte *) (header + 1) + sizeof(md5Channel_t) * anim->numChannels);
+	for(i = 0, frame = anim->frames; i < anim->numFrames; i++, frame++)
+	{
+		VectorCopy(frame->bounds[0], data);
+		VectorCopy(frame->bounds[1], data + 3);
+		data += 6;
+	}
+
+	for(i = 0, frame = anim->frames; i < anim->numFrames; i++, frame++)
+	{
+		Com_Memcpy(data, frame->components, sizeof(float) * anim->numAnimatedComponents);
+		data += anim->numAnimatedComponents;
+	}
+
+	R_AnimationCacheFileName(name, fileName, sizeof(fileName));
+	ri.FS_HomeWriteFile(fileName, buffer, len);
+
+	Com_Dealloc(buffer);
+}
+
 static qboolean R_LoadMD5Anim(skelAnimation_t * skelAnim, byte *buffer, int bufferSize, const char *name)
 {
 	int             i, j;
@@ -79,6 +320,7 @@ static qboolean R_LoadMD5Anim(skelAnimation_t * skelAnim, byte *buffer, int buff
 	char           *token;
 	int             version;
 	char           *buf_p;
+	float          *components;
 
 	buf_p = (char*)buffer;
 
@@ -333,6 +575,9 @@ static qboolean R_LoadMD5Anim(skelAnimation_t * skelAnim, byte *buffer, int buff
 		return qfalse;
 	}
 
+	// all frames in one block, they are walked frame after frame
+	components = (float *)ri.Hunk_Alloc(sizeof(float) * anim->numFrames * anim->numAnimatedComponents, h_low);
+
 	for(i = 0, frame = anim->frames; i < anim->numFrames; i++, frame++)
 	{
 		// parse frame <number> {
@@ -357,7 +602,7 @@ static qboolean R_LoadMD5Anim(skelAnimation_t * skelAnim, byte *buffer, int buff
 			return qfalse;
 		}
 
-		frame->components = (float*)ri.Hunk_Alloc(sizeof(float) * anim->numAnimatedComponents, h_low);
+		frame->components = components + i * anim->numAnimatedComponents;
 		for(j = 0; j < anim->numAnimatedComponents; j++)
 		{
 			token = COM_ParseExt2(&buf_p, qtrue);
@@ -373,6 +618,8 @@ static qboolean R_LoadMD5Anim(skelAnimation_t * skelAnim, byte *buffer, int buff
 		}
 	}
 
+	R_SetupMD5ComponentMap(anim);
+
 	// everything went ok
 	return qtrue;
 }
@@ -711,6 +958,7 @@ qhandle_t RE_RegisterAnimation(const char *name)
 	skelAnimation_t *anim;
 	byte           *buffer;
 	int             bufferLen;
+	unsigned        sourceHash;
 	qboolean        loaded = qfalse;
 
 	if(!name || !name[0])
@@ -776,7 +1024,24 @@ qhandle_t RE_RegisterAnimation(const char *name)
 
 	if(!Q_stricmpn((const char *)buffer, "MD5Version", 10))
 	{
-		loaded = R_LoadMD5Anim(anim, buffer, bufferLen, name);
+		if(r_animationCache->integer)
+		{
+			sourceHash = R_CacheHash(CACHEHASH_BASIS, buffer, bufferLen);
+
+			loaded = R_LoadCachedMD5Anim(anim, sourceHash, name);
+			if(!loaded)
+			{
+				loaded = R_LoadMD5Anim(anim, buffer, bufferLen, name);
+				if(loaded)
+				{
+					R_WriteCachedMD5Anim(anim->md5, sourceHash, name);
+				}
+			}
+		}
+		else
+		{
+			loaded = R_LoadMD5Anim(anim, buffer, bufferLen, name);
+		}
 	}
 	else if(!Q_stricmpn((const char *)buffer, "ANIMHEAD", 8))
 	{
@@ -848,6 +1113,108 @@ void R_AnimationList_f(void)
 	ri.Printf(PRINT_ALL, "%8i : Total animations\n", tr.numAnimations);
 }
 
+/*
+================
+R_AnimationBench_f
+
+animbench [skeletons] [animation ...]
+
+Builds the given number of skeletons from every loaded md5 animation with
+the scalar and with the SSE2 channel code, walking all frames and lerp
+fractions. Animations named on the command line are registered first, so
+it runs without a map. The checksums make sure both paths agree.
+
+Nothing here touches GL, but the command lives in the renderer, so it
+needs a client with the renderer started; there is no headless build of it.
+================
+*/
+void R_AnimationBench_f(void)
+{
+	static refSkeleton_t skel;
+	skelAnimation_t *anim;
+	unsigned        checksum[2];
+	int             msec[2];
+	int             numSkeletons, numAnimations, numFrames;
+	int             startTime;
+	int             i, j, pass;
+
+	numSkeletons = (ri.Cmd_Argc() > 1) ? atoi(ri.Cmd_Argv(1)) : 10000;
+	if(numSkeletons <= 0)
+	{
+		ri.Printf(PRINT_ALL, "usage: animbench [skeletons] [animation ...]\n");
+		return;
+	}
+
+	for(i = 2; i < ri.Cmd_Argc(); i++)
+	{
+		if(!RE_RegisterAnimation(ri.Cmd_Argv(i)))
+		{
+			ri.Printf(PRINT_ALL, "animbench: couldn't load '%s'\n", ri.Cmd_Argv(i));
+		}
+	}
+
+	numAnimations = 0;
+	for(i = 0; i < tr.numAnimations; i++)
+	{
+		if(tr.animations[i]->type == AT_MD5 && tr.animations[i]->md5)
+		{
+			numAnimations++;
+		}
+	}
+
+	if(!numAnimations)
+	{
+		ri.Printf(PRINT_ALL, "animbench: no md5 animations loaded\n");
+		return;
+	}
+
+	for(pass = 0; pass < 2; pass++)
+	{
+		if(pass == 1 && !SKELETON_SIMD_SSE2)
+		{
+			msec[1] = 0;
+			checksum[1] = checksum[0];
+			break;
+		}
+
+		skeletonSSE2 = (qboolean) pass;
+		checksum[pass] = CACHEHASH_BASIS;
+		startTime = ri.Milliseconds();
+
+		for(i = 0; i < tr.numAnimations; i++)
+		{
+			anim = tr.animations[i];
+			if(anim->type != AT_MD5 || !anim->md5)
+			{
+				continue;
+			}
+
+			numFrames = anim->md5->numFrames;
+			for(j = 0; j < numSkeletons; j++)
+			{
+				RE_BuildSkeleton(&skel, i, j % numFrames, (j + 1) % numFrames, (j & 15) / 16.0f, (qboolean) (j & 1));
+				checksum[pass] = R_CacheHash(checksum[pass], skel.bones, sizeof(refBone_t) * skel.numBones);
+			}
+		}
+
+		msec[pass] = ri.Milliseconds() - startTime;
+	}
+
+	skeletonSSE2 = (qboolean) SKELETON_SIMD_SSE2;
+
+	ri.Printf(PRINT_ALL, "%i skeletons from each of %i animations\n", numSkeletons, numAnimations);
+	ri.Printf(PRINT_ALL, "scalar: %5i msec\n", msec[0]);
+	if(SKELETON_SIMD_SSE2)
+	{
+		ri.Printf(PRINT_ALL, "SSE2:   %5i msec\n", msec[1]);
+	}
+	else
+	{
+		ri.Printf(PRINT_ALL, "SSE2:   not compiled in\n");
+	}
+	ri.Printf(PRINT_ALL, "bones %s\n", checksum[0] == checksum[1] ? "match" : "DIFFER");
+}
+
 /*
 =============
 R_CullMD5
@@ -1301,6 +1668,164 @@ int RE_CheckSkeleton(refSkeleton_t * skel, qhandle_t hModel, qhandle_t hAnim)
 	return qfalse;
 }
 
+/*
+==============
+R_LerpMD5Channels
+
+Interpolated origin and rotation of every channel between two frames
+==============
+*/
+static void R_LerpMD5Channels(const md5Animation_t * anim, const md5Frame_t * oldFrame, const md5Frame_t * newFrame, float frac,
+							  vec3_t * lerpedOrigins, quat_t * lerpedQuats)
+{
+	int             i, j, numChannels;
+	const md5Channel_t *channel;
+	const int16_t  *map;
+	vec3_t          newOrigin, oldOrigin;
+	quat_t          newQuat, oldQuat;
+
+	numChannels = Q_min(anim->numChannels, MAX_BONES);
+
+	for(i = 0, channel = anim->channels; i < numChannels; i++, channel++)
+	{
+		map = &anim->componentMap[i * 6];
+
+		// baseframe values, replaced by the animated components
+		for(j = 0; j < 3; j++)
+		{
+			oldOrigin[j] = map[j] >= 0 ? oldFrame->components[map[j]] : channel->baseOrigin[j];
+			newOrigin[j] = map[j] >= 0 ? newFrame->components[map[j]] : channel->baseOrigin[j];
+
+			oldQuat[j] = map[3 + j] >= 0 ? oldFrame->components[map[3 + j]] : channel->baseQuat[j];
+			newQuat[j] = map[3 + j] >= 0 ? newFrame->components[map[3 + j]] : channel->baseQuat[j];
+		}
+
+		QuatCalcW(oldQuat);
+		QuatNormalize(oldQuat);
+
+		QuatCalcW(newQuat);
+		QuatNormalize(newQuat);
+
+		VectorLerp(oldOrigin, newOrigin, frac, lerpedOrigins[i]);
+		QuatSlerp(oldQuat, newQuat, frac, lerpedQuats[i]);
+	}
+}
+
+#if SKELETON_SIMD_SSE2
+/*
+==============
+R_CalcWNormalize_SSE2
+
+QuatCalcW and QuatNormalize on four quaternions, rounded like the scalar code
+==============
+*/
+static ID_INLINE void R_CalcWNormalize_SSE2(float *x, float *y, float *z, float *w)
+{
+	__m128          qx, qy, qz, qw, term, length, scale, nonZero;
+	const __m128    zero = _mm_setzero_ps();
+	const __m128    one = _mm_set1_ps(1.0f);
+	const __m128    sign = _mm_set1_ps(-0.0f);
+
+	qx = _mm_loadu_ps(x);
+	qy = _mm_loadu_ps(y);
+	qz = _mm_loadu_ps(z);
+
+	// w = -sqrt(1 - (x * x + y * y + z * z)), 0 where that is negative
+	term = _mm_sub_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_mul_ps(qz, qz)));
+	qw = _mm_xor_ps(_mm_sqrt_ps(_mm_max_ps(term, zero)), sign);
+	qw = _mm_andnot_ps(_mm_cmplt_ps(term, zero), qw);
+
+	length = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_mul_ps(qz, qz)), _mm_mul_ps(qw, qw));
+	length = _mm_sqrt_ps(length);
+
+	// scale by 1 / length, zero length quaternions are left alone
+	nonZero = _mm_cmpneq_ps(length, zero);
+	scale = _mm_div_ps(one, _mm_or_ps(_mm_and_ps(nonZero, length), _mm_andnot_ps(nonZero, one)));
+
+	_mm_storeu_ps(x, _mm_mul_ps(qx, scale));
+	_mm_storeu_ps(y, _mm_mul_ps(qy, scale));
+	_mm_storeu_ps(z, _mm_mul_ps(qz, scale));
+	_mm_storeu_ps(w, _mm_mul_ps(qw, scale));
+}
+
+/*
+==============
+R_LerpMD5Channels_SSE2
+
+Same results as R_LerpMD5Channels. The channels are gathered into arrays
+per component first, so the quaternion setup and the origin lerp run on
+four channels at once. Only the slerp stays per channel.
+==============
+*/
+static void R_LerpMD5Channels_SSE2(const md5Animation_t * anim, const md5Frame_t * oldFrame, const md5Frame_t * newFrame,
+								   float frac, vec3_t * lerpedOrigins, quat_t * lerpedQuats)
+{
+	int             i, j, numChannels, numPadded;
+	const md5Channel_t *channel;
+	const int16_t  *map;
+	float           oldOrigins[3][MAX_BONES], newOrigins[3][MAX_BONES], origins[3][MAX_BONES];
+	float           oldQuats[4][MAX_BONES], newQuats[4][MAX_BONES];
+	quat_t          oldQuat, newQuat;
+	__m128          f, from, to;
+
+	// MAX_BONES is a multiple of four, so the padding fits
+	numChannels = Q_min(anim->numChannels, MAX_BONES);
+	numPadded = (numChannels + 3) & ~3;
+
+	for(i = 0, channel = anim->channels; i < numChannels; i++, channel++)
+	{
+		map = &anim->componentMap[i * 6];
+
+		for(j = 0; j < 3; j++)
+		{
+			oldOrigins[j][i] = map[j] >= 0 ? oldFrame->components[map[j]] : channel->baseOrigin[j];
+			newOrigins[j][i] = map[j] >= 0 ? newFrame->components[map[j]] : channel->baseOrigin[j];
+
+			oldQuats[j][i] = map[3 + j] >= 0 ? oldFrame->components[map[3 + j]] : channel->baseQuat[j];
+			newQuats[j][i] = map[3 + j] >= 0 ? newFrame->components[map[3 + j]] : channel->baseQuat[j];
+		}
+	}
+
+	for(; i < numPadded; i++)
+	{
+		for(j = 0; j < 3; j++)
+		{
+			oldOrigins[j][i] = newOrigins[j][i] = 0;
+			oldQuats[j][i] = newQuats[j][i] = 0;
+		}
+	}
+
+	f = _mm_set1_ps(frac);
+	for(i = 0; i < numPadded; i += 4)
+	{
+		R_CalcWNormalize_SSE2(&oldQuats[0][i], &oldQuats[1][i], &oldQuats[2][i], &oldQuats[3][i]);
+		R_CalcWNormalize_SSE2(&newQuats[0][i], &newQuats[1][i], &newQuats[2][i], &newQuats[3][i]);
+
+		for(j = 0; j < 3; j++)
+		{
+			from = _mm_loadu_ps(&oldOrigins[j][i]);
+			to = _mm_loadu_ps(&newOrigins[j][i]);
+			_mm_storeu_ps(&origins[j][i], _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), f)));
+		}
+	}
+
+	for(i = 0; i < numChannels; i++)
+	{
+		lerpedOrigins[i][0] = origins[0][i];
+		lerpedOrigins[i][1] = origins[1][i];
+		lerpedOrigins[i][2] = origins[2][i];
+
+		for(j = 0; j < 4; j++)
+		{
+			oldQuat[j] = oldQuats[j][i];
+			newQuat[j] = newQuats[j][i];
+		}
+
+		QuatSlerp(oldQuat, newQuat, frac, lerpedQuats[i]);
+	}
+}
+#endif
+
 /*
 ==============
 RE_BuildSkeleton
@@ -1318,9 +1843,8 @@ int RE_BuildSkeleton(refSkeleton_t * skel, qhandle_t hAnim, int startFrame, int
 		md5Animation_t *anim;
 		md5Channel_t   *channel;
 		md5Frame_t     *newFrame, *oldFrame;
-		vec3_t          newOrigin, oldOrigin, lerpedOrigin;
-		quat_t          newQuat, oldQuat, lerpedQuat;
-		int             componentsApplied;
+		vec3_t          lerpedOrigins[MAX_BONES];
+		quat_t          lerpedQuats[MAX_BONES];
 
 		anim = skelAnim->md5;
 
@@ -1353,74 +1877,22 @@ int RE_BuildSkeleton(refSkeleton_t * skel, qhandle_t hAnim, int startFrame, int
 				oldFrame->bounds[1][i] > newFrame->bounds[1][i] ? oldFrame->bounds[1][i] : newFrame->bounds[1][i];
 		}
 
-		for(i = 0, channel = anim->channels; i < anim->numChannels; i++, channel++)
+#if SKELETON_SIMD_SSE2
+		if(skeletonSSE2)
 		{
-			// set baseframe values
-			VectorCopy(channel->baseOrigin, newOrigin);
-			VectorCopy(channel->baseOrigin, oldOrigin);
-
-			QuatCopy(channel->baseQuat, newQuat);
-			QuatCopy(channel->baseQuat, oldQuat);
-
-			componentsApplied = 0;
-
-			// update tranlation bits
-			if(channel->componentsBits & COMPONENT_BIT_TX)
-			{
-				oldOrigin[0] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				newOrigin[0] = newFrame->components[channel->componentsOffset + componentsApplied];
-				componentsApplied++;
-			}
-
-			if(channel->componentsBits & COMPONENT_BIT_TY)
-			{
-				oldOrigin[1] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				newOrigin[1] = newFrame->components[channel->componentsOffset + componentsApplied];
-				componentsApplied++;
-			}
-
-			if(channel->componentsBits & COMPONENT_BIT_TZ)
-			{
-				oldOrigin[2] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				newOrigin[2] = newFrame->components[channel->componentsOffset + componentsApplied];
-				componentsApplied++;
-			}
-
-			// update quaternion rotation bits
-			if(channel->componentsBits & COMPONENT_BIT_QX)
-			{
-				((vec_t *) oldQuat)[0] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				((vec_t *) newQuat)[0] = newFrame->components[channel->componentsOffset + componentsApplied];
-				componentsApplied++;
-			}
-
-			if(channel->componentsBits & COMPONENT_BIT_QY)
-			{
-				((vec_t *) oldQuat)[1] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				((vec_t *) newQuat)[1] = newFrame->components[channel->componentsOffset + componentsApplied];
-				componentsApplied++;
-			}
-
-			if(channel->componentsBits & COMPONENT_BIT_QZ)
-			{
-				((vec_t *) oldQuat)[2] = oldFrame->components[channel->componentsOffset + componentsApplied];
-				((vec_t *) newQuat)[2] = newFrame->components[channel->componentsOffset + componentsApplied];
-			}
-
-			QuatCalcW(oldQuat);
-			QuatNormalize(oldQuat);
-
-			QuatCalcW(newQuat);
-			QuatNormalize(newQuat);
-
-#if 1
-			VectorLerp(oldOrigin, newOrigin, frac, lerpedOrigin);
-			QuatSlerp(oldQuat, newQuat, frac, lerpedQuat);
-#else
-			VectorCopy(newOrigin, lerpedOrigin);
-			QuatCopy(newQuat, lerpedQuat);
+			R_LerpMD5Channels_SSE2(anim, oldFrame, newFrame, frac, lerpedOrigins, lerpedQuats);
+		}
+		else
 #endif
+		{
+			R_LerpMD5Channels(anim, oldFrame, newFrame, frac, lerpedOrigins, lerpedQuats);
+		}
 
+		// refSkeleton_t can't hold more
+		skel->numBones = Q_min(anim->numChannels, MAX_BONES);
+
+		for(i = 0, channel = anim->channels; i < skel->numBones; i++, channel++)
+		{
 			// copy lerped information to the bone + extra data
 			skel->bones[i].parentIndex = channel->parentIndex;
 
@@ -1430,22 +1902,21 @@ int RE_BuildSkeleton(refSkeleton_t * skel, qhandle_t hAnim, int startFrame, int
 				QuatClear(skel->bones[i].rotation);
 
 				// move bounding box back
-				VectorSubtract(skel->bounds[0], lerpedOrigin, skel->bounds[0]);
-				VectorSubtract(skel->bounds[1], lerpedOrigin, skel->bounds[1]);
+				VectorSubtract(skel->bounds[0], lerpedOrigins[i], skel->bounds[0]);
+				VectorSubtract(skel->bounds[1], lerpedOrigins[i], skel->bounds[1]);
 			}
 			else
 			{
-				VectorCopy(lerpedOrigin, skel->bones[i].origin);
+				VectorCopy(lerpedOrigins[i], skel->bones[i].origin);
 			}
 
-			QuatCopy(lerpedQuat, skel->bones[i].rotation);
+			QuatCopy(lerpedQuats[i], skel->bones[i].rotation);
 
 #if defined(REFBONE_NAMES)
 			Q_strncpyz(skel->bones[i].name, channel->name, sizeof(skel->bones[i].name));
 #endif
 		}
 
-		skel->numBones = anim->numChannels;
 		skel->type = SK_RELATIVE;
 		return qtrue;
 	}
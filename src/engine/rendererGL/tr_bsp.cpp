@@ -5418,6 +5418,29 @@ static void R_LoadShaders(lump_t * l)
 }
 
 
+/*
+=================
+R_PrefetchWorldImages
+
+Decodes the images of all BSP shaders on the image loader threads before
+R_LoadSurfaces creates the shaders one after another
+=================
+*/
+static void R_PrefetchWorldImages(void)
+{
+	int             i;
+
+	R_FreePrefetchedImages();
+
+	for(i = 0; i < s_worldData.numShaders; i++)
+	{
+		R_PrefetchShaderImages(s_worldData.shaders[i].shader);
+	}
+
+	R_PrefetchImages();
+}
+
+
 /*
 =================
 R_LoadMarksurfaces
@@ -9150,6 +9173,62 @@ void R_BuildCubeMaps(void)
 #endif
 }
 
+/*
+=================
+R_EndLoadStage
+
+Times the steps of a world map load so slow ones show up on big maps
+=================
+*/
+#define MAX_LOAD_STAGES 20
+
+static struct
+{
+	const char     *name;
+	int             msec;
+} s_loadStages[MAX_LOAD_STAGES];
+static int      s_numLoadStages;
+static int      s_loadStageStartTime;
+
+static void R_BeginLoadStages(void)
+{
+	s_numLoadStages = 0;
+	s_loadStageStartTime = ri.Milliseconds();
+}
+
+static void R_EndLoadStage(const char *name)
+{
+	int             time;
+
+	time = ri.Milliseconds();
+	if(s_numLoadStages < MAX_LOAD_STAGES)
+	{
+		s_loadStages[s_numLoadStages].name = name;
+		s_loadStages[s_numLoadStages].msec = time - s_loadStageStartTime;
+		s_numLoadStages++;
+	}
+	s_loadStageStartTime = time;
+}
+
+static void R_PrintLoadStages(void)
+{
+	int             i, total;
+
+	total = 0;
+	for(i = 0; i < s_numLoadStages; i++)
+	{
+		total += s_loadStages[i].msec;
+	}
+
+	ri.Printf(PRINT_ALL, "world load time breakdown:\n");
+	for(i = 0; i < s_numLoadStages; i++)
+	{
+		ri.Printf(PRINT_ALL, "%-20s %6i msec %5.1f%%\n", s_loadStages[i].name, s_loadStages[i].msec,
+				  total ? s_loadStages[i].msec * 100.0f / total : 0.0f);
+	}
+	ri.Printf(PRINT_ALL, "%-20s %6i msec\n", "total", total);
+}
+
 /*
 =================
 RE_LoadWorldMap
@@ -9207,12 +9286,15 @@ void RE_LoadWorldMap(const char *name)
 
 	tr.worldMapLoaded = qtrue;
 
+	R_BeginLoadStages();
+
 	// load it
 	ri.FS_ReadFile(name, (void **)&buffer);
 	if(!buffer)
 	{
 		ri.Error(ERR_DROP, "RE_LoadWorldMap: %s not found", name);
 	}
+	R_EndLoadStage("read file");
 
 	// clear tr.world so if the level fails to load, the next
 	// try will not look at the partially loaded version
@@ -9249,46 +9331,64 @@ void RE_LoadWorldMap(const char *name)
 	// load into heap
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadEntities(&header->lumps[LUMP_ENTITIES]);
+	R_EndLoadStage("entities");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadShaders(&header->lumps[LUMP_SHADERS]);
+	R_EndLoadStage("shaders");
+
+	R_PrefetchWorldImages();
+	R_EndLoadStage("image prefetch");
 	
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadLightmaps(&header->lumps[LUMP_LIGHTMAPS], name);
+	R_EndLoadStage("lightmaps");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadPlanes(&header->lumps[LUMP_PLANES]);
+	R_EndLoadStage("planes");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadSurfaces(&header->lumps[LUMP_SURFACES], &header->lumps[LUMP_DRAWVERTS], &header->lumps[LUMP_DRAWINDEXES]);
+	R_EndLoadStage("surfaces");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadMarksurfaces(&header->lumps[LUMP_LEAFSURFACES]);
+	R_EndLoadStage("marksurfaces");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadNodesAndLeafs(&header->lumps[LUMP_NODES], &header->lumps[LUMP_LEAFS]);
+	R_EndLoadStage("nodes and leafs");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadSubmodels(&header->lumps[LUMP_MODELS]);
+	R_EndLoadStage("submodels");
 
 	// moved fog lump loading here, so fogs can be tagged with a model num
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadFogs(&header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES]);
+	R_EndLoadStage("fogs");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadVisibility(&header->lumps[LUMP_VISIBILITY]);
+	R_EndLoadStage("visibility");
 
 //	ri.Cmd_ExecuteText(EXEC_NOW, "updatescreen\n");
 	R_LoadLightGrid(&header->lumps[LUMP_LIGHTGRID]);
+	R_EndLoadStage("light grid");
 
 	// create static VBOS from the world
 	R_CreateWorldVBO();
+	R_EndLoadStage("world VBO");
 	R_CreateClusters();
+	R_EndLoadStage("clusters");
 	R_CreateSubModelVBOs();
+	R_EndLoadStage("submodel VBOs");
 
 	// we precache interactions between lights and surfaces
 	// to reduce the polygon count
 	R_PrecacheInteractions();
+	R_EndLoadStage("interactions");
 
 	s_worldData.dataSize = (byte *) ri.Hunk_Alloc(0, h_low) - startMarker;
 
@@ -9323,5 +9423,10 @@ void RE_LoadWorldMap(const char *name)
 	ClearLink(&tr.occlusionQueryQueue);
 	ClearLink(&tr.occlusionQueryList);
 
+	// anything the shaders did not ask for after all
+	R_FreePrefetchedImages();
+
 	ri.FS_FreeFile(buffer);
+
+	R_PrintLoadStages();
 }
@@ -23,6 +23,19 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_image.c
 #include "tr_local.h"
 
+#include <SDL_thread.h>
+
+#if !defined(C_ONLY) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMAGE_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define IMAGE_SIMD_SSE2 0
+#endif
+
+// the resample and mipmap filters use their SSE2 kernels when they are
+// compiled in, imagebench clears this to time the scalar loops
+static qboolean imageSSE2 = (qboolean) IMAGE_SIMD_SSE2;
+
 
 static byte     s_intensitytable[256];
 static unsigned char s_gammatable[256];
@@ -385,6 +398,55 @@ void R_ImageList_f(void)
 
 //=======================================================================
 
+#if IMAGE_SIMD_SSE2
+/*
+================
+ResampleTextureRow_SSE2
+
+Averages the four samples of two output texels per iteration
+================
+*/
+static void ResampleTextureRow_SSE2(const unsigned *inrow, const unsigned *inrow2, unsigned *out, int outwidth,
+									const unsigned *p1, const unsigned *p2)
+{
+	const byte     *row = (const byte *)inrow;
+	const byte     *row2 = (const byte *)inrow2;
+	const __m128i   zero = _mm_setzero_si128();
+	__m128i         top, bottom, lo, hi, sum;
+	int             x;
+
+	for(x = 0; x + 1 < outwidth; x += 2)
+	{
+		top = _mm_set_epi32(*(const int *)(row + p2[x + 1]), *(const int *)(row + p1[x + 1]),
+							*(const int *)(row + p2[x]), *(const int *)(row + p1[x]));
+		bottom = _mm_set_epi32(*(const int *)(row2 + p2[x + 1]), *(const int *)(row2 + p1[x + 1]),
+							   *(const int *)(row2 + p2[x]), *(const int *)(row2 + p1[x]));
+
+		// 16 bit lanes: texel x in lo, texel x + 1 in hi
+		lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+		sum = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+		_mm_storel_epi64((__m128i *) (out + x), _mm_packus_epi16(sum, sum));
+	}
+
+	for(; x < outwidth; x++)
+	{
+		const byte     *pix1 = row + p1[x];
+		const byte     *pix2 = row + p2[x];
+		const byte     *pix3 = row2 + p1[x];
+		const byte     *pix4 = row2 + p2[x];
+
+		((byte *) (out + x))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0]) >> 2;
+		((byte *) (out + x))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1]) >> 2;
+		((byte *) (out + x))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2]) >> 2;
+		((byte *) (out + x))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3]) >> 2;
+	}
+}
+#endif
+
 /*
 ================
 ResampleTexture
@@ -481,6 +543,14 @@ static void ResampleTexture(unsigned *in, int inwidth, int inheight, unsigned *o
 			inrow = in + inwidth * (int)((y + 0.25) * inheight / outheight);
 			inrow2 = in + inwidth * (int)((y + 0.75) * inheight / outheight);
 
+#if IMAGE_SIMD_SSE2
+			if(imageSSE2)
+			{
+				ResampleTextureRow_SSE2(inrow, inrow2, out, outwidth, p1, p2);
+				continue;
+			}
+#endif
+
 			//frac = fracstep >> 1;
 
 			for(x = 0; x < outwidth; x++)
@@ -564,6 +634,78 @@ void R_LightScaleTexture(unsigned *in, int inwidth, int inheight, bool onlyGamma
 
 
 
+#if IMAGE_SIMD_SSE2
+/*
+================
+R_MipMap2_SSE2
+
+Same 4x4 filter as R_MipMap2 with all four channels in 16 bit lanes,
+the weighted sums stay below 9180 so the divide by 36 can be done with
+an exact multiply high
+================
+*/
+static void R_MipMap2_SSE2(const unsigned *in, unsigned *out, int inWidth, int inHeight)
+{
+	const __m128i   zero = _mm_setzero_si128();
+	const __m128i   weightLo = _mm_set_epi16(2, 2, 2, 2, 1, 1, 1, 1);
+	const __m128i   weightHi = _mm_set_epi16(1, 1, 1, 1, 2, 2, 2, 2);
+	const __m128i   div36 = _mm_set1_epi16((short)58255);
+	const unsigned *rows[4];
+	__m128i         taps, sum, acc;
+	int             inWidthMask, inHeightMask;
+	int             outWidth, outHeight;
+	int             i, j, k, c;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	inWidthMask = inWidth - 1;
+	inHeightMask = inHeight - 1;
+
+	for(i = 0; i < outHeight; i++)
+	{
+		for(k = 0; k < 4; k++)
+		{
+			rows[k] = in + ((i * 2 - 1 + k) & inHeightMask) * inWidth;
+		}
+
+		for(j = 0; j < outWidth; j++)
+		{
+			acc = zero;
+			c = j * 2 - 1;
+
+			for(k = 0; k < 4; k++)
+			{
+				if(c >= 0 && c + 3 < inWidth)
+				{
+					taps = _mm_loadu_si128((const __m128i *)(rows[k] + c));
+				}
+				else
+				{
+					taps = _mm_set_epi32(rows[k][(c + 3) & inWidthMask], rows[k][(c + 2) & inWidthMask],
+										 rows[k][(c + 1) & inWidthMask], rows[k][c & inWidthMask]);
+				}
+
+				// 1 2 2 1 across the row, texels 0 + 2 in the low lanes, 1 + 3 in the high lanes
+				sum = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(taps, zero), weightLo),
+									_mm_mullo_epi16(_mm_unpackhi_epi8(taps, zero), weightHi));
+
+				// 1 2 2 1 down the columns
+				if(k == 1 || k == 2)
+				{
+					sum = _mm_slli_epi16(sum, 1);
+				}
+				acc = _mm_add_epi16(acc, sum);
+			}
+
+			acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+			acc = _mm_srli_epi16(_mm_mulhi_epu16(acc, div36), 5);
+			out[i * outWidth + j] = (unsigned)_mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+		}
+	}
+}
+#endif
+
 /*
 ================
 R_MipMap2
@@ -585,6 +727,17 @@ static void R_MipMap2(unsigned *in, int inWidth, int inHeight)
 	outHeight = inHeight >> 1;
 	temp = (unsigned int*)ri.Hunk_AllocateTempMemory(outWidth * outHeight * 4);
 
+#if IMAGE_SIMD_SSE2
+	if(imageSSE2)
+	{
+		R_MipMap2_SSE2(in, temp, inWidth, inHeight);
+
+		Com_Memcpy(in, temp, outWidth * outHeight * 4);
+		ri.Hunk_FreeTempMemory(temp);
+		return;
+	}
+#endif
+
 	inWidthMask = inWidth - 1;
 	inHeightMask = inHeight - 1;
 
@@ -663,6 +816,42 @@ static void R_MipMap(byte * in, int width, int height)
 		return;
 	}
 
+#if IMAGE_SIMD_SSE2
+	if(imageSSE2)
+	{
+		const __m128i   zero = _mm_setzero_si128();
+		__m128i         top, bottom, lo, hi, sum;
+
+		for(i = 0; i < height; i++, in += row)
+		{
+			// two output texels per iteration, the stores never pass the loads
+			// because the output row is at most half as far into the buffer
+			for(j = 0; j + 1 < width; j += 2, out += 8, in += 16)
+			{
+				top = _mm_loadu_si128((const __m128i *)in);
+				bottom = _mm_loadu_si128((const __m128i *)(in + row));
+
+				lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+				lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+				hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+				sum = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+				_mm_storel_epi64((__m128i *) out, _mm_packus_epi16(sum, sum));
+			}
+
+			for(; j < width; j++, out += 4, in += 8)
+			{
+				out[0] = (in[0] + in[4] + in[row + 0] + in[row + 4]) >> 2;
+				out[1] = (in[1] + in[5] + in[row + 1] + in[row + 5]) >> 2;
+				out[2] = (in[2] + in[6] + in[row + 2] + in[row + 6]) >> 2;
+				out[3] = (in[3] + in[7] + in[row + 3] + in[row + 7]) >> 2;
+			}
+		}
+		return;
+	}
+#endif
+
 	for(i = 0; i < height; i++, in += row)
 	{
 		for(j = 0; j < width; j++, out += 4, in += 8)
@@ -1044,6 +1233,87 @@ byte            mipBlendColors[16][4] = {
 };
 
 
+/*
+================
+R_SetImageParameters
+
+Filter and wrap state of a freshly uploaded image, the image must be bound
+================
+*/
+void R_SetImageParameters(image_t * image)
+{
+#if !defined(USE_D3D10)
+	vec4_t          zeroClampBorder = { 0, 0, 0, 1 };
+	vec4_t          alphaZeroClampBorder = { 0, 0, 0, 0 };
+
+	// set filter type
+	switch (image->filterType)
+	{
+		case FT_DEFAULT:
+			// set texture anisotropy
+			if(glConfig2.textureAnisotropyAvailable)
+				glTexParameterf(image->type, GL_TEXTURE_MAX_ANISOTROPY_EXT, r_ext_texture_filter_anisotropic->value);
+
+			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, gl_filter_min);
+			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, gl_filter_max);
+			break;
+
+		case FT_LINEAR:
+			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			break;
+
+		case FT_NEAREST:
+			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			break;
+
+		default:
+			ri.Printf(PRINT_WARNING, "WARNING: unknown filter type for image '%s'\n", image->name);
+			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			break;
+	}
+
+	GL_CheckErrors();
+
+	// set wrap type
+	switch (image->wrapType)
+	{
+		case WT_REPEAT:
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			break;
+
+		case WT_CLAMP:
+		case WT_EDGE_CLAMP:
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			break;
+
+		case WT_ZERO_CLAMP:
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTexParameterfv(image->type, GL_TEXTURE_BORDER_COLOR, zeroClampBorder);
+			break;
+
+		case WT_ALPHA_ZERO_CLAMP:
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTexParameterfv(image->type, GL_TEXTURE_BORDER_COLOR, alphaZeroClampBorder);
+			break;
+
+		default:
+			ri.Printf(PRINT_WARNING, "WARNING: unknown wrap type for image '%s'\n", image->name);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			break;
+	}
+
+	GL_CheckErrors();
+#endif
+}
+
 /*
 ===============
 R_UploadImage
@@ -1063,8 +1333,6 @@ void R_UploadImage(const byte ** dataArray, int numData, image_t * image)
 	GLenum          format = GL_RGBA;
 	GLenum          internalFormat = GL_RGB;
 	float           rMax = 0, gMax = 0, bMax = 0;
-	vec4_t          zeroClampBorder = { 0, 0, 0, 1 };
-	vec4_t          alphaZeroClampBorder = { 0, 0, 0, 0 };
 
 	if(glConfig2.textureNPOTAvailable)
 	{
@@ -1397,71 +1665,7 @@ void R_UploadImage(const byte ** dataArray, int numData, image_t * image)
 
 	GL_CheckErrors();
 
-	// set filter type
-	switch (image->filterType)
-	{
-		case FT_DEFAULT:
-			// set texture anisotropy
-			if(glConfig2.textureAnisotropyAvailable)
-				glTexParameterf(image->type, GL_TEXTURE_MAX_ANISOTROPY_EXT, r_ext_texture_filter_anisotropic->value);
-
-			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, gl_filter_min);
-			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, gl_filter_max);
-			break;
-
-		case FT_LINEAR:
-			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			break;
-
-		case FT_NEAREST:
-			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			break;
-
-		default:
-			ri.Printf(PRINT_WARNING, "WARNING: unknown filter type for image '%s'\n", image->name);
-			glTexParameterf(image->type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameterf(image->type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			break;
-	}
-
-	GL_CheckErrors();
-
-	// set wrap type
-	switch (image->wrapType)
-	{
-		case WT_REPEAT:
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			break;
-
-		case WT_CLAMP:
-		case WT_EDGE_CLAMP:
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			break;
-
-		case WT_ZERO_CLAMP:
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-			glTexParameterfv(image->type, GL_TEXTURE_BORDER_COLOR, zeroClampBorder);
-			break;
-
-		case WT_ALPHA_ZERO_CLAMP:
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-			glTexParameterfv(image->type, GL_TEXTURE_BORDER_COLOR, alphaZeroClampBorder);
-			break;
-
-		default:
-			ri.Printf(PRINT_WARNING, "WARNING: unknown wrap type for image '%s'\n", image->name);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameterf(image->type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			break;
-	}
-
-	GL_CheckErrors();
+	R_SetImageParameters(image);
 
 	if(scaledBuffer != 0)
 		ri.Hunk_FreeTempMemory(scaledBuffer);
@@ -1680,251 +1884,927 @@ static qboolean ParseDisplaceMap(char **text, byte ** pic, int *width, int *heig
 		return qfalse;
 	}
 
-	R_LoadImage(text, &pic2, &width2, &height2, bits, materialName);
-	if(!pic2)
+	R_LoadImage(text, &pic2, &width2, &height2, bits, materialName);
+	if(!pic2)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of second image for displaceMap\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for displaceMap\n", token);
+	}
+
+	if(*width != width2 || *height != height2)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: images for displaceMap have different dimensions (%i x %i != %i x %i)\n",
+				  *width, *height, width2, height2);
+
+		//ri.Free(*pic);
+		//*pic = NULL;
+
+		Com_Dealloc(pic2);
+		return qfalse;
+	}
+
+	R_DisplaceMap(*pic, pic2, *width, *height);
+
+	Com_Dealloc(pic2);
+
+	*bits &= ~IF_ALPHA;
+	*bits |= IF_NORMALMAP;
+	*bits |= IF_DISPLACEMAP;
+
+	return qtrue;
+}
+
+static qboolean ParseAddNormals(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+{
+	char           *token;
+	byte           *pic2;
+	int             width2, height2;
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != '(')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for addNormals\n", token);
+		return qfalse;
+	}
+
+	R_LoadImage(text, pic, width, height, bits, materialName);
+	if(!pic)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of first image for addNormals\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ',')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: no matching ',' found for addNormals\n");
+		return qfalse;
+	}
+
+	R_LoadImage(text, &pic2, &width2, &height2, bits, materialName);
+	if(!pic2)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of second image for addNormals\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for addNormals\n", token);
+	}
+
+	if(*width != width2 || *height != height2)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: images for addNormals have different dimensions (%i x %i != %i x %i)\n",
+				  *width, *height, width2, height2);
+
+		//ri.Free(*pic);
+		//*pic = NULL;
+
+		Com_Dealloc(pic2);
+		return qfalse;
+	}
+
+	R_AddNormals(*pic, pic2, *width, *height);
+
+	Com_Dealloc(pic2);
+
+	*bits &= ~IF_ALPHA;
+	*bits |= IF_NORMALMAP;
+
+	return qtrue;
+}
+
+static qboolean ParseInvertAlpha(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+{
+	char           *token;
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != '(')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for invertAlpha\n", token);
+		return qfalse;
+	}
+
+	R_LoadImage(text, pic, width, height, bits, materialName);
+	if(!pic)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for invertAlpha\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for invertAlpha\n", token);
+		return qfalse;
+	}
+
+	R_InvertAlpha(*pic, *width, *height);
+
+	return qtrue;
+}
+
+static qboolean ParseInvertColor(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+{
+	char           *token;
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != '(')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for invertColor\n", token);
+		return qfalse;
+	}
+
+	R_LoadImage(text, pic, width, height, bits, materialName);
+	if(!pic)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for invertColor\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for invertColor\n", token);
+		return qfalse;
+	}
+
+	R_InvertColor(*pic, *width, *height);
+
+	return qtrue;
+}
+
+static qboolean ParseMakeIntensity(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+{
+	char           *token;
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != '(')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for makeIntensity\n", token);
+		return qfalse;
+	}
+
+	R_LoadImage(text, pic, width, height, bits, materialName);
+	if(!pic)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for makeIntensity\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for makeIntensity\n", token);
+		return qfalse;
+	}
+
+	R_MakeIntensity(*pic, *width, *height);
+
+	*bits &= ~IF_ALPHA;
+	*bits &= ~IF_NORMALMAP;
+
+	return qtrue;
+}
+
+static qboolean ParseMakeAlpha(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+{
+	char           *token;
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != '(')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for makeAlpha\n", token);
+		return qfalse;
+	}
+
+	R_LoadImage(text, pic, width, height, bits, materialName);
+	if(!pic)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for makeAlpha\n");
+		return qfalse;
+	}
+
+	token = COM_ParseExt2(text, qfalse);
+	if(token[0] != ')')
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for makeAlpha\n", token);
+		return qfalse;
+	}
+
+	R_MakeAlpha(*pic, *width, *height);
+
+//	*bits |= IF_ALPHA;
+	*bits &= IF_NORMALMAP;
+
+	return qtrue;
+}
+
+typedef struct
+{
+	char           *ext;
+	void            (*ImageLoader) (const char *, unsigned char **, int *, int *, byte);
+	qboolean        (*ImageDecoder) (const char *, const byte *, int, unsigned char **, int *, int *, byte, char *, int);
+} imageExtToLoaderMap_t;
+
+// Note that the ordering indicates the order of preference used
+// when there are multiple images of different formats available
+static imageExtToLoaderMap_t imageLoaders[] = {
+#ifdef USE_WEBP
+	{"webp", LoadWEBP, DecodeWEBP},
+#endif
+	{"png", LoadPNG, DecodePNG},
+	{"tga", LoadTGA, DecodeTGA},
+	{"jpg", LoadJPG, DecodeJPG},
+	{"jpeg", LoadJPG, DecodeJPG},
+//	{"dds", LoadDDS},	// need to write some direct uploader routines first
+//	{"hdr", LoadRGBE}	// RGBE just sucks
+};
+
+static int      numImageLoaders = sizeof(imageLoaders) / sizeof(imageLoaders[0]);
+
+/*
+===============================================================================
+
+IMAGE PREFETCHING
+
+The shaders of a map queue the images they reference with R_AddPrefetchImage,
+R_PrefetchImages then reads the files on the main thread and decodes them on
+r_imageThreads loader threads. R_LoadImage picks the decoded pixels up instead
+of decoding them again, so only the upload is left for R_CreateImage.
+
+===============================================================================
+*/
+
+#define MAX_PREFETCH_IMAGES		2048
+#define PREFETCH_HASH_SIZE		1024
+#define PREFETCH_CHUNK_IMAGES	32
+#define PREFETCH_CHUNK_BYTES	(16 * 1024 * 1024)
+#define MAX_PREFETCH_THREADS	16
+
+typedef enum
+{
+	PREFETCH_QUEUED,
+	PREFETCH_READ,				// file is in memory, waiting for a loader thread
+	PREFETCH_DECODED,			// pic is valid
+	PREFETCH_MISSING,			// no file with any supported extension
+	PREFETCH_SKIPPED,			// decode failed or over budget, left to R_LoadImage
+	PREFETCH_TAKEN
+} prefetchState_t;
+
+typedef struct prefetchImage_s
+{
+	char            name[MAX_QPATH];
+	byte            alphaByte;
+	prefetchState_t state;
+
+	int             loader;
+	char            fileName[MAX_QPATH];
+	byte           *file;
+	int             fileSize;
+
+	byte           *pic;
+	int             width;
+	int             height;
+	char            error[256];
+
+	struct prefetchImage_s *next;
+} prefetchImage_t;
+
+static struct
+{
+	prefetchImage_t *images;
+	int             numImages;
+	prefetchImage_t *hashTable[PREFETCH_HASH_SIZE];
+
+	// shared with the loader threads, guarded by mutex
+	SDL_mutex      *mutex;
+	int             nextJob;
+	int             lastJob;
+	int             memory;
+	int             memoryLimit;
+	qboolean        overBudget;
+} s_prefetch;
+
+static int R_PrefetchHash(const char *name, byte alphaByte)
+{
+	return (GenerateImageHashValue(name) ^ alphaByte) & (PREFETCH_HASH_SIZE - 1);
+}
+
+static prefetchImage_t *R_FindPrefetchImage(const char *name, byte alphaByte)
+{
+	prefetchImage_t *img;
+
+	if(!s_prefetch.images)
+	{
+		return NULL;
+	}
+
+	for(img = s_prefetch.hashTable[R_PrefetchHash(name, alphaByte)]; img; img = img->next)
+	{
+		if(img->alphaByte == alphaByte && !Q_stricmp(img->name, name))
+		{
+			return img;
+		}
+	}
+	return NULL;
+}
+
+/*
+=================
+R_AddPrefetchImage
+
+alphaByte is 0x00 for normal maps, as R_LoadImage clears their alpha
+=================
+*/
+static void     R_QueuePrefetchImage(const char *name, byte alphaByte);
+
+void R_AddPrefetchImage(const char *name, byte alphaByte)
+{
+	image_t        *image;
+
+	if(!r_imageThreads->integer || !name || !name[0])
+	{
+		return;
+	}
+
+	// builtin images and image expressions are not plain files
+	if(name[0] == '_' || name[0] == '$' || name[0] == '*' || strchr(name, '(') || strlen(name) >= MAX_QPATH)
+	{
+		return;
+	}
+
+	// already loaded by an earlier shader or map
+	for(image = r_imageHashTable[GenerateImageHashValue(name)]; image; image = image->next)
+	{
+		if(!Q_stricmp(name, image->name))
+		{
+			return;
+		}
+	}
+
+	// most likely uploaded straight from the image cache
+	if(R_ImageCacheContains(name))
+	{
+		return;
+	}
+
+	R_QueuePrefetchImage(name, alphaByte);
+}
+
+static void R_QueuePrefetchImage(const char *name, byte alphaByte)
+{
+	prefetchImage_t *img;
+	int             hash;
+
+	if(R_FindPrefetchImage(name, alphaByte))
+	{
+		return;
+	}
+
+	if(!s_prefetch.images)
+	{
+		s_prefetch.images = (prefetchImage_t *) Com_Allocate(MAX_PREFETCH_IMAGES * sizeof(prefetchImage_t));
+		s_prefetch.numImages = 0;
+		Com_Memset(s_prefetch.hashTable, 0, sizeof(s_prefetch.hashTable));
+	}
+
+	if(s_prefetch.numImages == MAX_PREFETCH_IMAGES)
+	{
+		return;
+	}
+
+	img = &s_prefetch.images[s_prefetch.numImages++];
+	Com_Memset(img, 0, sizeof(*img));
+	Q_strncpyz(img->name, name, sizeof(img->name));
+	img->alphaByte = alphaByte;
+	img->state = PREFETCH_QUEUED;
+	img->loader = -1;
+
+	hash = R_PrefetchHash(name, alphaByte);
+	img->next = s_prefetch.hashTable[hash];
+	s_prefetch.hashTable[hash] = img;
+}
+
+/*
+=================
+R_ReadImageSource
+
+Reads the file R_LoadImage would decode for a plain image name, trying the
+other extensions the same way. Returns the loader index or -1 if there is
+no such file, main thread only.
+=================
+*/
+int R_ReadImageSource(const char *name, char *fileName, int fileNameSize, byte ** buffer, int *size)
+{
+	char            filename[MAX_QPATH];
+	const char     *ext;
+	int             i;
+
+	*buffer = NULL;
+	*size = 0;
+
+	Q_strncpyz(filename, name, sizeof(filename));
+
+	ext = COM_GetExtension(filename);
+	if(*ext)
+	{
+		for(i = 0; i < numImageLoaders; i++)
+		{
+			if(!Q_stricmp(ext, imageLoaders[i].ext))
+			{
+				break;
+			}
+		}
+
+		if(i < numImageLoaders)
+		{
+			*size = ri.FS_ReadFile(filename, (void **)buffer);
+			if(*buffer)
+			{
+				Q_strncpyz(fileName, filename, fileNameSize);
+				return i;
+			}
+
+			COM_StripExtension3(name, filename, sizeof(filename));
+		}
+	}
+
+	for(i = 0; i < numImageLoaders; i++)
+	{
+		Com_sprintf(fileName, fileNameSize, "%s.%s", filename, imageLoaders[i].ext);
+
+		*size = ri.FS_ReadFile(fileName, (void **)buffer);
+		if(*buffer)
+		{
+			return i;
+		}
+	}
+
+	*size = 0;
+	return -1;
+}
+
+static void R_ReadPrefetchImage(prefetchImage_t * img)
+{
+	img->loader = R_ReadImageSource(img->name, img->fileName, sizeof(img->fileName), &img->file, &img->fileSize);
+	img->state = (img->loader < 0) ? PREFETCH_MISSING : PREFETCH_READ;
+}
+
+static prefetchImage_t *R_NextPrefetchJob(void)
+{
+	prefetchImage_t *img = NULL;
+
+	SDL_mutexP(s_prefetch.mutex);
+	while(!s_prefetch.overBudget && s_prefetch.nextJob < s_prefetch.lastJob)
+	{
+		img = &s_prefetch.images[s_prefetch.nextJob++];
+		if(img->state == PREFETCH_READ)
+		{
+			break;
+		}
+		img = NULL;
+	}
+	SDL_mutexV(s_prefetch.mutex);
+
+	return img;
+}
+
+/*
+=================
+R_PrefetchWorker
+
+Runs on the loader threads and on the main thread, touches nothing but the
+job it took and the budget
+=================
+*/
+static int R_PrefetchWorker(void *data)
+{
+	prefetchImage_t *img;
+	qboolean        decoded;
+	int             size;
+
+	while((img = R_NextPrefetchJob()) != NULL)
+	{
+		decoded = imageLoaders[img->loader].ImageDecoder(img->fileName, img->file, img->fileSize, &img->pic,
+														 &img->width, &img->height, img->alphaByte,
+														 img->error, sizeof(img->error));
+
+		// warnings and errors are printed by the loader when R_LoadImage retries
+		if(!decoded || img->error[0])
+		{
+			if(img->pic)
+			{
+				Com_Dealloc(img->pic);
+				img->pic = NULL;
+			}
+			img->state = PREFETCH_SKIPPED;
+			continue;
+		}
+
+		size = img->width * img->height * 4;
+
+		SDL_mutexP(s_prefetch.mutex);
+		if(size > s_prefetch.memoryLimit - s_prefetch.memory)
+		{
+			// stop handing out jobs, everything left loads the usual way
+			s_prefetch.overBudget = qtrue;
+			decoded = qfalse;
+		}
+		else
+		{
+			s_prefetch.memory += size;
+		}
+		SDL_mutexV(s_prefetch.mutex);
+
+		if(!decoded)
+		{
+			Com_Dealloc(img->pic);
+			img->pic = NULL;
+			img->state = PREFETCH_SKIPPED;
+			continue;
+		}
+
+		img->state = PREFETCH_DECODED;
+	}
+
+	return 0;
+}
+
+/*
+=================
+R_DecodePrefetchImages
+
+Decodes every queued image. The files are read in small chunks because
+FS_ReadFile allocates them from the temp hunk, which is only reclaimed when
+they are freed in reverse order. Returns the number of threads used.
+=================
+*/
+static int R_DecodePrefetchImages(int numThreads, int memoryLimit)
+{
+	SDL_Thread     *threads[MAX_PREFETCH_THREADS];
+	prefetchImage_t *img;
+	int             first, last;
+	int             bytes;
+	int             i;
+
+	if(numThreads < 1)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of second image for displaceMap\n");
-		return qfalse;
+		numThreads = 1;
+	}
+	else if(numThreads > MAX_PREFETCH_THREADS)
+	{
+		numThreads = MAX_PREFETCH_THREADS;
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	s_prefetch.mutex = SDL_CreateMutex();
+	if(!s_prefetch.mutex)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for displaceMap\n", token);
+		numThreads = 1;
 	}
+	s_prefetch.memory = 0;
+	s_prefetch.memoryLimit = memoryLimit;
+	s_prefetch.overBudget = qfalse;
 
-	if(*width != width2 || *height != height2)
+	for(first = 0; first < s_prefetch.numImages && !s_prefetch.overBudget; first = last)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: images for displaceMap have different dimensions (%i x %i != %i x %i)\n",
-				  *width, *height, width2, height2);
+		bytes = 0;
+		for(last = first; last < s_prefetch.numImages && last - first < PREFETCH_CHUNK_IMAGES && bytes < PREFETCH_CHUNK_BYTES; last++)
+		{
+			img = &s_prefetch.images[last];
+			if(img->state == PREFETCH_QUEUED)
+			{
+				R_ReadPrefetchImage(img);
+				bytes += img->fileSize;
+			}
+		}
 
-		//ri.Free(*pic);
-		//*pic = NULL;
+		s_prefetch.nextJob = first;
+		s_prefetch.lastJob = last;
 
-		ri.Free(pic2);
-		return qfalse;
-	}
+		for(i = 0; i < numThreads - 1; i++)
+		{
+			threads[i] = SDL_CreateThread(R_PrefetchWorker, NULL);
+		}
 
-	R_DisplaceMap(*pic, pic2, *width, *height);
+		R_PrefetchWorker(NULL);
 
-	ri.Free(pic2);
+		for(i = 0; i < numThreads - 1; i++)
+		{
+			if(threads[i])
+			{
+				SDL_WaitThread(threads[i], NULL);
+			}
+		}
 
-	*bits &= ~IF_ALPHA;
-	*bits |= IF_NORMALMAP;
-	*bits |= IF_DISPLACEMAP;
+		for(i = last - 1; i >= first; i--)
+		{
+			img = &s_prefetch.images[i];
+			if(img->file)
+			{
+				ri.FS_FreeFile(img->file);
+				img->file = NULL;
+			}
+		}
+	}
 
-	return qtrue;
+	if(s_prefetch.mutex)
+	{
+		SDL_DestroyMutex(s_prefetch.mutex);
+		s_prefetch.mutex = NULL;
+	}
+
+	return numThreads;
 }
 
-static qboolean ParseAddNormals(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+/*
+=================
+R_PrefetchImages
+
+Decodes every image queued with R_AddPrefetchImage
+=================
+*/
+void R_PrefetchImages(void)
 {
-	char           *token;
-	byte           *pic2;
-	int             width2, height2;
+	int             numThreads;
+	int             numDecoded;
+	int             startTime;
+	int             i;
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != '(')
+	if(!s_prefetch.images || !s_prefetch.numImages)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for addNormals\n", token);
-		return qfalse;
+		return;
 	}
 
-	R_LoadImage(text, pic, width, height, bits, materialName);
-	if(!pic)
+	startTime = ri.Milliseconds();
+
+	numThreads = R_DecodePrefetchImages(r_imageThreads->integer, r_imagePrefetchMemory->integer * 1024 * 1024);
+
+	numDecoded = 0;
+	for(i = 0; i < s_prefetch.numImages; i++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of first image for addNormals\n");
-		return qfalse;
+		if(s_prefetch.images[i].state == PREFETCH_DECODED)
+		{
+			numDecoded++;
+		}
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ',')
+	ri.Printf(PRINT_ALL, "...prefetched %i of %i images on %i threads in %i msec (%i KB)\n", numDecoded,
+			  s_prefetch.numImages, numThreads, ri.Milliseconds() - startTime, s_prefetch.memory / 1024);
+	if(s_prefetch.overBudget)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: no matching ',' found for addNormals\n");
-		return qfalse;
+		ri.Printf(PRINT_DEVELOPER, "...r_imagePrefetchMemory exceeded, loading the remaining images on demand\n");
 	}
+}
 
-	R_LoadImage(text, &pic2, &width2, &height2, bits, materialName);
-	if(!pic2)
+/*
+=================
+R_TakePrefetchedImage
+
+Hands the decoded pixels over to the caller, who frees them with Com_Dealloc.
+Returns qfalse if the image was not prefetched and has to be loaded.
+=================
+*/
+static qboolean R_TakePrefetchedImage(const char *name, byte alphaByte, byte ** pic, int *width, int *height)
+{
+	prefetchImage_t *img;
+
+	img = R_FindPrefetchImage(name, alphaByte);
+	if(!img)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of second image for addNormals\n");
 		return qfalse;
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	if(img->state == PREFETCH_MISSING)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for addNormals\n", token);
+		*pic = NULL;
+		return qtrue;
 	}
 
-	if(*width != width2 || *height != height2)
+	if(img->state != PREFETCH_DECODED)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: images for addNormals have different dimensions (%i x %i != %i x %i)\n",
-				  *width, *height, width2, height2);
-
-		//ri.Free(*pic);
-		//*pic = NULL;
-
-		ri.Free(pic2);
 		return qfalse;
 	}
 
-	R_AddNormals(*pic, pic2, *width, *height);
-
-	ri.Free(pic2);
-
-	*bits &= ~IF_ALPHA;
-	*bits |= IF_NORMALMAP;
+	*pic = img->pic;
+	*width = img->width;
+	*height = img->height;
 
+	img->pic = NULL;
+	img->state = PREFETCH_TAKEN;
 	return qtrue;
 }
 
-static qboolean ParseInvertAlpha(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+/*
+=================
+R_FreePrefetchedImages
+=================
+*/
+void R_FreePrefetchedImages(void)
 {
-	char           *token;
-
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != '(')
-	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for invertAlpha\n", token);
-		return qfalse;
-	}
+	int             i;
 
-	R_LoadImage(text, pic, width, height, bits, materialName);
-	if(!pic)
+	if(!s_prefetch.images)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for invertAlpha\n");
-		return qfalse;
+		return;
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	for(i = 0; i < s_prefetch.numImages; i++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for invertAlpha\n", token);
-		return qfalse;
+		if(s_prefetch.images[i].pic)
+		{
+			Com_Dealloc(s_prefetch.images[i].pic);
+		}
 	}
 
-	R_InvertAlpha(*pic, *width, *height);
-
-	return qtrue;
+	Com_Dealloc(s_prefetch.images);
+	s_prefetch.images = NULL;
+	s_prefetch.numImages = 0;
 }
+/*
+=================
+R_ImageBench_f
 
-static qboolean ParseInvertColor(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
+imagebench <directory> [threads]
+
+Runs the CPU side of texture loading on every image in a directory without
+touching GL: decoding on one and on the loader threads, then resampling to
+power of two sizes and building the mip chains with the scalar and the SSE2
+filters.
+=================
+*/
+void R_ImageBench_f(void)
 {
-	char           *token;
+	char          **fileList;
+	char            dir[MAX_QPATH];
+	char            name[MAX_QPATH];
+	char            ext[16];
+	prefetchImage_t *img;
+	byte           *buffer;
+	unsigned        checksum[2];
+	int             msec[2];
+	int             numFiles;
+	int             numThreads;
+	int             numDecoded, decodedBytes;
+	int             singleTime, threadedTime;
+	int             startTime;
+	int             scaledWidth, scaledHeight;
+	int             mipWidth, mipHeight;
+	int             i, j, pass;
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != '(')
+	if(ri.Cmd_Argc() < 2)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for invertColor\n", token);
-		return qfalse;
+		ri.Printf(PRINT_ALL, "usage: imagebench <directory> [threads]\n");
+		return;
 	}
 
-	R_LoadImage(text, pic, width, height, bits, materialName);
-	if(!pic)
+	R_FreePrefetchedImages();
+
+	Q_strncpyz(dir, ri.Cmd_Argv(1), sizeof(dir));
+	numThreads = (ri.Cmd_Argc() > 2) ? atoi(ri.Cmd_Argv(2)) : r_imageThreads->integer;
+
+	for(i = 0; i < numImageLoaders; i++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for invertColor\n");
-		return qfalse;
+		Com_sprintf(ext, sizeof(ext), ".%s", imageLoaders[i].ext);
+
+		fileList = ri.FS_ListFiles(dir, ext, &numFiles);
+		for(j = 0; j < numFiles; j++)
+		{
+			Com_sprintf(name, sizeof(name), "%s/%s", dir, fileList[j]);
+			R_QueuePrefetchImage(name, 0xFF);
+		}
+		ri.FS_FreeFileList(fileList);
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	if(!s_prefetch.numImages)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for invertColor\n", token);
-		return qfalse;
+		ri.Printf(PRINT_ALL, "imagebench: no images found in '%s'\n", dir);
+		return;
 	}
 
-	R_InvertColor(*pic, *width, *height);
-
-	return qtrue;
-}
-
-static qboolean ParseMakeIntensity(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
-{
-	char           *token;
+	// decoding
+	startTime = ri.Milliseconds();
+	R_DecodePrefetchImages(1, 0x7FFFFFFF);
+	singleTime = ri.Milliseconds() - startTime;
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != '(')
+	for(i = 0; i < s_prefetch.numImages; i++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for makeIntensity\n", token);
-		return qfalse;
+		img = &s_prefetch.images[i];
+		if(img->pic)
+		{
+			Com_Dealloc(img->pic);
+			img->pic = NULL;
+		}
+		img->state = PREFETCH_QUEUED;
 	}
 
-	R_LoadImage(text, pic, width, height, bits, materialName);
-	if(!pic)
+	startTime = ri.Milliseconds();
+	numThreads = R_DecodePrefetchImages(numThreads, 0x7FFFFFFF);
+	threadedTime = ri.Milliseconds() - startTime;
+
+	numDecoded = 0;
+	decodedBytes = 0;
+	for(i = 0; i < s_prefetch.numImages; i++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for makeIntensity\n");
-		return qfalse;
+		img = &s_prefetch.images[i];
+		if(img->state == PREFETCH_DECODED)
+		{
+			numDecoded++;
+			decodedBytes += img->width * img->height * 4;
+		}
 	}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	// resampling and mipmaps the way R_UploadImage does without NPOT support,
+	// the checksum makes sure both filter sets produce the same texels
+	for(pass = 0; pass < 2; pass++)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for makeIntensity\n", token);
-		return qfalse;
-	}
+		if(pass == 1 && !IMAGE_SIMD_SSE2)
+		{
+			msec[1] = 0;
+			checksum[1] = checksum[0];
+			break;
+		}
 
-	R_MakeIntensity(*pic, *width, *height);
+		imageSSE2 = (qboolean) pass;
+		checksum[pass] = 0;
+		startTime = ri.Milliseconds();
 
-	*bits &= ~IF_ALPHA;
-	*bits &= ~IF_NORMALMAP;
+		for(i = 0; i < s_prefetch.numImages; i++)
+		{
+			img = &s_prefetch.images[i];
+			if(img->state != PREFETCH_DECODED)
+			{
+				continue;
+			}
 
-	return qtrue;
-}
+			for(scaledWidth = 1; scaledWidth < img->width && scaledWidth < 2048; scaledWidth <<= 1);
+			for(scaledHeight = 1; scaledHeight < img->height && scaledHeight < 2048; scaledHeight <<= 1);
 
-static qboolean ParseMakeAlpha(char **text, byte ** pic, int *width, int *height, int *bits, const char *materialName)
-{
-	char           *token;
+			buffer = (byte *) Com_Allocate(scaledWidth * scaledHeight * 4);
+			if(scaledWidth == img->width && scaledHeight == img->height)
+			{
+				Com_Memcpy(buffer, img->pic, scaledWidth * scaledHeight * 4);
+			}
+			else
+			{
+				ResampleTexture((unsigned *)img->pic, img->width, img->height, (unsigned *)buffer, scaledWidth, scaledHeight,
+								false);
+			}
 
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != '(')
-	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting '(', found '%s' for makeAlpha\n", token);
-		return qfalse;
+			mipWidth = scaledWidth;
+			mipHeight = scaledHeight;
+			while(mipWidth > 1 || mipHeight > 1)
+			{
+				R_MipMap(buffer, mipWidth, mipHeight);
+
+				mipWidth >>= 1;
+				mipHeight >>= 1;
+
+				if(mipWidth < 1)
+					mipWidth = 1;
+
+				if(mipHeight < 1)
+					mipHeight = 1;
+			}
+
+			// the chain works in place, so the buffer still holds the tail of every level
+			for(j = 0; j < scaledWidth * scaledHeight; j++)
+			{
+				checksum[pass] = checksum[pass] * 33 ^ ((unsigned *)buffer)[j];
+			}
+
+			Com_Dealloc(buffer);
+		}
+
+		msec[pass] = ri.Milliseconds() - startTime;
 	}
 
-	R_LoadImage(text, pic, width, height, bits, materialName);
-	if(!pic)
+	imageSSE2 = (qboolean) IMAGE_SIMD_SSE2;
+
+	ri.Printf(PRINT_ALL, "imagebench: %i of %i images in '%s' decoded, %i KB\n", numDecoded, s_prefetch.numImages, dir,
+			  decodedBytes / 1024);
+	ri.Printf(PRINT_ALL, "decode: %i msec on 1 thread, %i msec on %i threads\n", singleTime, threadedTime, numThreads);
+	if(IMAGE_SIMD_SSE2)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: failed loading of image for makeAlpha\n");
-		return qfalse;
+		ri.Printf(PRINT_ALL, "resample + mipmaps: %i msec scalar, %i msec SSE2, %s\n", msec[0], msec[1],
+				  checksum[0] == checksum[1] ? "results match" : S_COLOR_YELLOW "results differ");
 	}
-
-	token = COM_ParseExt2(text, qfalse);
-	if(token[0] != ')')
+	else
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: expecting ')', found '%s' for makeAlpha\n", token);
-		return qfalse;
+		ri.Printf(PRINT_ALL, "resample + mipmaps: %i msec, SSE2 filters not compiled in\n", msec[0]);
 	}
 
-	R_MakeAlpha(*pic, *width, *height);
-
-//	*bits |= IF_ALPHA;
-	*bits &= IF_NORMALMAP;
-
-	return qtrue;
+	R_FreePrefetchedImages();
 }
 
-typedef struct
-{
-	char           *ext;
-	void            (*ImageLoader) (const char *, unsigned char **, int *, int *, byte);
-} imageExtToLoaderMap_t;
-
-// Note that the ordering indicates the order of preference used
-// when there are multiple images of different formats available
-static imageExtToLoaderMap_t imageLoaders[] = {
-#ifdef USE_WEBP
-	{"webp", LoadWEBP},
-#endif
-	{"png", LoadPNG},
-	{"tga", LoadTGA},
-	{"jpg", LoadJPG},
-	{"jpeg", LoadJPG},
-//	{"dds", LoadDDS},	// need to write some direct uploader routines first
-//	{"hdr", LoadRGBE}	// RGBE just sucks
-};
-
-static int      numImageLoaders = sizeof(imageLoaders) / sizeof(imageLoaders[0]);
 
 /*
 =================
@@ -2059,6 +2939,12 @@ static void R_LoadImage(char **buffer, byte ** pic, int *width, int *height, int
 
 		Q_strncpyz(filename, token, sizeof(filename));
 
+		// decoded by the image loader threads already
+		if(R_TakePrefetchedImage(filename, alphaByte, pic, width, height))
+		{
+			return;
+		}
+
 		ext = COM_GetExtension(filename);
 
 		if(*ext)
@@ -2132,6 +3018,7 @@ image_t        *R_FindImageFile(const char *imageName, int bits, filterType_t fi
 	char            ddsName[1024];
 	char           *buffer_p;
 	unsigned long   diff;
+	imageCacheKey_t cacheKey;
 
 	if(!imageName)
 	{
@@ -2140,6 +3027,7 @@ image_t        *R_FindImageFile(const char *imageName, int bits, filterType_t fi
 
 	Q_strncpyz(buffer, imageName, sizeof(buffer));
 	hash = GenerateImageHashValue(buffer);
+	cacheKey.valid = qfalse;
 
 //  ri.Printf(PRINT_ALL, "R_FindImageFile: buffer '%s'\n", buffer);
 
@@ -2211,6 +3099,16 @@ image_t        *R_FindImageFile(const char *imageName, int bits, filterType_t fi
 	}
 #endif
 
+	// try the preprocessed mip chain
+	if(R_ImageCacheKey(buffer, bits, filterType, wrapType, &cacheKey))
+	{
+		image = R_LoadCachedImage(buffer, bits, filterType, wrapType, &cacheKey);
+		if(image != NULL)
+		{
+			return image;
+		}
+	}
+
 	// load the pic from disk
 	buffer_p = &buffer[0];
 	R_LoadImage(&buffer_p, &pic, &width, &height, &bits, materialName);
@@ -2237,7 +3135,12 @@ image_t        *R_FindImageFile(const char *imageName, int bits, filterType_t fi
 #endif
 
 	image = R_CreateImage((char *)buffer, pic, width, height, bits, filterType, wrapType);
-	ri.Free(pic);
+	Com_Dealloc(pic);
+
+	if(image && cacheKey.valid)
+	{
+		R_WriteCachedImage(image, &cacheKey);
+	}
 	return image;
 }
 
@@ -2601,7 +3504,7 @@ image_t        *R_FindCubeImage(const char *imageName, int bits, filterType_t fi
 	for(i = 0; i < 6; i++)
 	{
 		if(pic[i])
-			ri.Free(pic[i]);
+			Com_Dealloc(pic[i]);
 	}
 	return image;
 }
@@ -3681,6 +4584,8 @@ void R_InitImages(void)
 	Com_InitGrowList(&tr.lightmaps, 128);
 	Com_InitGrowList(&tr.deluxemaps, 128);
 
+	R_InitImageCache();
+
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -3719,6 +4624,9 @@ void R_ShutdownImages(void)
 
 	ri.Printf(PRINT_ALL, "------- R_ShutdownImages -------\n");
 
+	R_FreePrefetchedImages();
+	R_ShutdownImageCache();
+
 	for(i = 0; i < tr.images.currentElements; i++)
 	{
 		image = (image_t*)Com_GrowListElement(&tr.images, i);
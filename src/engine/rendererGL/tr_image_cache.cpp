@@ -0,0 +1,943 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+Copyright (C) 2006-2011 Robert Beckebans <trebor_7@users.sourceforge.net>
+
+This file is part of OpenWolf source code.
+
+OpenWolf source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+OpenWolf source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenWolf source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_image_cache.cpp -- uploaded mip chains kept on disk between runs
+#include "../idLib/precompiled.h"
+#include "tr_local.h"
+
+/*
+The first time an image is loaded its final mip chain is read back from the
+driver and written to imagecache/<name hash><options hash>.ximg in the home
+path, already resampled, light scaled and compressed if r_ext_compressed_textures
+is on. Later loads upload the levels straight from that file.
+
+A cache file is only used while the checksum of every source file of the image
+and the options hash still match, so changed textures or renderer settings
+simply write a new entry. The cache is bounded by r_imageCacheSize, the least
+recently used entries are removed first.
+
+The files are machine local and never byte swapped. They are only read and
+written through the FS_Home* calls, going through the search path would make
+them subject to sv_pure and add them to the pure checksums.
+*/
+
+#define IMAGECACHE_IDENT		(('C' << 24) + ('M' << 16) + ('I' << 8) + 'X')
+#define IMAGECACHE_VERSION		1
+#define IMAGECACHE_INDEX		"imagecache/index.dat"
+#define IMAGECACHE_INDEX_IDENT	(('X' << 24) + ('D' << 16) + ('N' << 8) + 'I')
+#define MAX_IMAGECACHE_NAME		256
+#define MAX_IMAGECACHE_LEVELS	16
+
+typedef struct
+{
+	int             ident;
+	int             version;
+	unsigned        sourceHash;
+	unsigned        optionsHash;
+	char            name[MAX_IMAGECACHE_NAME];
+
+	int             bits;
+	int             width, height;
+	int             uploadWidth, uploadHeight;
+	int             internalFormat;
+	int             compressed;
+	int             numLevels;
+	int             levelSizes[MAX_IMAGECACHE_LEVELS];
+} imageCacheHeader_t;
+
+typedef struct
+{
+	unsigned        nameHash;
+	unsigned        optionsHash;
+	int             lastUsed;
+} imageCacheIndexEntry_t;
+
+typedef struct
+{
+	unsigned        nameHash;
+	unsigned        optionsHash;
+	int             size;
+	int             lastUsed;
+} imageCacheEntry_t;
+
+static struct
+{
+	imageCacheEntry_t *entries;
+	int             numEntries;
+	int             maxEntries;
+	int             totalSize;
+	int             sequence;
+	qboolean        dirty;
+
+	int             hits;
+	int             writes;
+	int             evictions;
+} s_imageCache;
+
+
+/*
+=================
+R_CacheHash
+
+FNV-1a, start with CACHEHASH_BASIS. Also keys the shader cache.
+=================
+*/
+unsigned R_CacheHash(unsigned hash, const void *data, int size)
+{
+	const byte     *bytes = (const byte *)data;
+	int             i;
+
+	for(i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static unsigned R_ImageCacheNameHash(const char *name)
+{
+	unsigned        hash;
+	char            letter;
+
+	hash = CACHEHASH_BASIS;
+	for(; *name; name++)
+	{
+		letter = tolower(*name);
+		if(letter == '\\')
+		{
+			letter = '/';
+		}
+
+		hash ^= (byte) letter;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static imageCacheEntry_t *R_FindImageCacheEntry(unsigned nameHash, unsigned optionsHash)
+{
+	int             i;
+
+	for(i = 0; i < s_imageCache.numEntries; i++)
+	{
+		if(s_imageCache.entries[i].nameHash == nameHash && s_imageCache.entries[i].optionsHash == optionsHash)
+		{
+			return &s_imageCache.entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+static imageCacheEntry_t *R_AddImageCacheEntry(unsigned nameHash, unsigned optionsHash)
+{
+	imageCacheEntry_t *entry;
+
+	entry = R_FindImageCacheEntry(nameHash, optionsHash);
+	if(entry)
+	{
+		return entry;
+	}
+
+	if(s_imageCache.numEntries == s_imageCache.maxEntries)
+	{
+		imageCacheEntry_t *entries;
+
+		s_imageCache.maxEntries = s_imageCache.maxEntries ? s_imageCache.maxEntries * 2 : 256;
+		entries = (imageCacheEntry_t *) Com_Allocate(s_imageCache.maxEntries * sizeof(imageCacheEntry_t));
+		if(s_imageCache.entries)
+		{
+			Com_Memcpy(entries, s_imageCache.entries, s_imageCache.numEntries * sizeof(imageCacheEntry_t));
+			Com_Dealloc(s_imageCache.entries);
+		}
+		s_imageCache.entries = entries;
+	}
+
+	entry = &s_imageCache.entries[s_imageCache.numEntries++];
+	entry->nameHash = nameHash;
+	entry->optionsHash = optionsHash;
+	entry->size = 0;
+	entry->lastUsed = 0;
+
+	return entry;
+}
+
+static void R_TouchImageCacheEntry(imageCacheEntry_t * entry)
+{
+	entry->lastUsed = ++s_imageCache.sequence;
+	s_imageCache.dirty = qtrue;
+}
+
+static int R_ImageCacheEntryCompare(const void *a, const void *b)
+{
+	return ((const imageCacheEntry_t *)a)->lastUsed - ((const imageCacheEntry_t *)b)->lastUsed;
+}
+
+/*
+=================
+R_TrimImageCache
+
+Removes the least recently used files until the cache is back under 90% of
+r_imageCacheSize, so a full cache isn't trimmed again by every new image.
+=================
+*/
+static void R_TrimImageCache(void)
+{
+	imageCacheEntry_t *entry;
+	char            fileName[MAX_QPATH];
+	int             limit, target;
+	int             i;
+
+	if(r_imageCacheSize->integer <= 0)
+	{
+		return;
+	}
+
+	limit = Q_min(r_imageCacheSize->integer, 2047) * 1024 * 1024;
+	if(s_imageCache.totalSize <= limit)
+	{
+		return;
+	}
+
+	qsort(s_imageCache.entries, s_imageCache.numEntries, sizeof(imageCacheEntry_t), R_ImageCacheEntryCompare);
+
+	target = limit - limit / 10;
+	for(i = 0; i < s_imageCache.numEntries && s_imageCache.totalSize > target; i++)
+	{
+		entry = &s_imageCache.entries[i];
+
+		Com_sprintf(fileName, sizeof(fileName), "imagecache/%08x%08x.ximg", entry->nameHash, entry->optionsHash);
+		ri.FS_HomeRemove(fileName);
+
+		s_imageCache.totalSize -= entry->size;
+		s_imageCache.evictions++;
+	}
+
+	memmove(s_imageCache.entries, s_imageCache.entries + i, (s_imageCache.numEntries - i) * sizeof(imageCacheEntry_t));
+	s_imageCache.numEntries -= i;
+	s_imageCache.dirty = qtrue;
+}
+
+/*
+=================
+R_InitImageCache
+
+Builds the LRU list from the files in imagecache/ and the last use
+sequence numbers saved by R_ShutdownImageCache.
+=================
+*/
+void R_InitImageCache(void)
+{
+	char          **fileList;
+	char            fileName[MAX_QPATH];
+	int             numFiles;
+	unsigned        nameHash, optionsHash;
+	imageCacheEntry_t *entry;
+	int            *index;
+	imageCacheIndexEntry_t *records;
+	int             len;
+	int             i;
+
+	Com_Memset(&s_imageCache, 0, sizeof(s_imageCache));
+
+#if defined(USE_D3D10)
+	return;
+#else
+	if(!r_imageCache->integer)
+	{
+		return;
+	}
+
+	fileList = ri.FS_HomeListFiles("imagecache", ".ximg", &numFiles);
+	for(i = 0; i < numFiles; i++)
+	{
+		if(sscanf(fileList[i], "%8x%8x.ximg", &nameHash, &optionsHash) != 2)
+		{
+			continue;
+		}
+
+		Com_sprintf(fileName, sizeof(fileName), "imagecache/%s", fileList[i]);
+		len = ri.FS_HomeReadFile(fileName, NULL);
+		if(len <= 0)
+		{
+			continue;
+		}
+
+		entry = R_AddImageCacheEntry(nameHash, optionsHash);
+		entry->size = len;
+		s_imageCache.totalSize += len;
+	}
+	ri.FS_FreeFileList(fileList);
+
+	len = ri.FS_HomeReadFile(IMAGECACHE_INDEX, (void **)&index);
+	if(index)
+	{
+		if(len >= 4 * (int)sizeof(int) && index[0] == IMAGECACHE_INDEX_IDENT && index[1] == IMAGECACHE_VERSION &&
+		   index[3] >= 0 && index[3] <= (len - 4 * (int)sizeof(int)) / (int)sizeof(imageCacheIndexEntry_t))
+		{
+			s_imageCache.sequence = index[2];
+			records = (imageCacheIndexEntry_t *) (index + 4);
+
+			for(i = 0; i < index[3]; i++)
+			{
+				entry = R_FindImageCacheEntry(records[i].nameHash, records[i].optionsHash);
+				if(entry)
+				{
+					entry->lastUsed = records[i].lastUsed;
+				}
+			}
+		}
+		ri.FS_FreeFile(index);
+	}
+
+	ri.Printf(PRINT_DEVELOPER, "image cache: %i files, %i KB\n", s_imageCache.numEntries, s_imageCache.totalSize / 1024);
+
+	R_TrimImageCache();
+#endif
+}
+
+/*
+=================
+R_ShutdownImageCache
+=================
+*/
+void R_ShutdownImageCache(void)
+{
+	int            *index;
+	imageCacheIndexEntry_t *records;
+	int             len;
+	int             i;
+
+	if(s_imageCache.dirty)
+	{
+		len = 4 * sizeof(int) + s_imageCache.numEntries * sizeof(imageCacheIndexEntry_t);
+		index = (int *)Com_Allocate(len);
+
+		index[0] = IMAGECACHE_INDEX_IDENT;
+		index[1] = IMAGECACHE_VERSION;
+		index[2] = s_imageCache.sequence;
+		index[3] = s_imageCache.numEntries;
+
+		records = (imageCacheIndexEntry_t *) (index + 4);
+		for(i = 0; i < s_imageCache.numEntries; i++)
+		{
+			records[i].nameHash = s_imageCache.entries[i].nameHash;
+			records[i].optionsHash = s_imageCache.entries[i].optionsHash;
+			records[i].lastUsed = s_imageCache.entries[i].lastUsed;
+		}
+
+		ri.FS_HomeWriteFile(IMAGECACHE_INDEX, index, len);
+		Com_Dealloc(index);
+	}
+
+	if(s_imageCache.hits || s_imageCache.writes)
+	{
+		ri.Printf(PRINT_DEVELOPER, "image cache: %i hits, %i written, %i removed\n", s_imageCache.hits, s_imageCache.writes,
+				  s_imageCache.evictions);
+	}
+
+	if(s_imageCache.entries)
+	{
+		Com_Dealloc(s_imageCache.entries);
+	}
+	Com_Memset(&s_imageCache, 0, sizeof(s_imageCache));
+}
+
+static qboolean R_IsImageExpressionToken(const char *token)
+{
+	static const char *keywords[] = {
+		"heightMap", "displaceMap", "addNormals", "smoothNormals", "add", "scale",
+		"invertAlpha", "invertColor", "makeIntensity", "makeAlpha"
+	};
+	int             i;
+
+	if(!token[1] && strchr("(),", token[0]))
+	{
+		return qtrue;
+	}
+
+	// numeric arguments
+	if(strspn(token, "0123456789.-+") == strlen(token))
+	{
+		return qtrue;
+	}
+
+	for(i = 0; i < ARRAY_LEN(keywords); i++)
+	{
+		if(!Q_stricmp(token, keywords[i]))
+		{
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+static unsigned R_ImageCacheOptionsHash(int bits, filterType_t filterType, wrapType_t wrapType)
+{
+	char            options[512];
+
+	Com_sprintf(options, sizeof(options), "%i %i %i %i %i %i %i %i %i %i %i %i %i %i %g %g %i",
+				bits, filterType, wrapType,
+				(bits & IF_NOPICMIP) ? 0 : r_picmip->integer, r_roundImagesDown->integer, r_simpleMipMaps->integer,
+				glConfig.textureCompression, glConfig.maxTextureSize, glConfig.driverType, glConfig.deviceSupportsGamma,
+				glConfig2.textureNPOTAvailable, glConfig2.framebufferObjectAvailable, glConfig2.generateMipmapAvailable,
+				glConfig2.ARBTextureCompressionAvailable,
+				glConfig.deviceSupportsGamma ? 1.0f : r_gamma->value, r_intensity->value, r_mapOverBrightBits->integer);
+
+	return R_CacheHash(CACHEHASH_BASIS, options, strlen(options));
+}
+
+/*
+=================
+R_ImageCacheKey
+
+Checksums every file the image name or expression refers to. Returns qfalse
+if the image can't be cached, a source is missing or the cache is off.
+=================
+*/
+qboolean R_ImageCacheKey(const char *name, int bits, filterType_t filterType, wrapType_t wrapType, imageCacheKey_t * key)
+{
+	char            expression[MAX_IMAGECACHE_NAME];
+	char            fileName[MAX_QPATH];
+	char           *text_p;
+	char           *token;
+	byte           *data;
+	int             size;
+	int             numSources;
+
+	key->valid = qfalse;
+
+#if defined(USE_D3D10)
+	return qfalse;
+#else
+	if(!r_imageCache->integer || r_colorMipLevels->integer || strlen(name) >= MAX_IMAGECACHE_NAME)
+	{
+		return qfalse;
+	}
+
+	if(bits & (IF_DEPTH16 | IF_DEPTH24 | IF_DEPTH32 | IF_PACKED_DEPTH24_STENCIL8))
+	{
+		return qfalse;
+	}
+
+	key->sourceHash = CACHEHASH_BASIS;
+	numSources = 0;
+
+	Q_strncpyz(expression, name, sizeof(expression));
+	text_p = expression;
+	while(1)
+	{
+		token = COM_ParseExt2(&text_p, qfalse);
+		if(!token[0])
+		{
+			break;
+		}
+
+		if(R_IsImageExpressionToken(token))
+		{
+			continue;
+		}
+
+		if(R_ReadImageSource(token, fileName, sizeof(fileName), &data, &size) < 0)
+		{
+			return qfalse;
+		}
+
+		key->sourceHash = R_CacheHash(key->sourceHash, fileName, strlen(fileName));
+		key->sourceHash = R_CacheHash(key->sourceHash, data, size);
+		ri.FS_FreeFile(data);
+		numSources++;
+	}
+
+	if(!numSources)
+	{
+		return qfalse;
+	}
+
+	key->nameHash = R_ImageCacheNameHash(name);
+	key->optionsHash = R_ImageCacheOptionsHash(bits, filterType, wrapType);
+	Com_sprintf(key->fileName, sizeof(key->fileName), "imagecache/%08x%08x.ximg", key->nameHash, key->optionsHash);
+	key->valid = qtrue;
+
+	return qtrue;
+#endif
+}
+
+/*
+=================
+R_ImageCacheContains
+
+Cheap test for the prefetcher, doesn't checksum the sources.
+=================
+*/
+qboolean R_ImageCacheContains(const char *name)
+{
+	unsigned        nameHash;
+	int             i;
+
+	if(!s_imageCache.numEntries)
+	{
+		return qfalse;
+	}
+
+	nameHash = R_ImageCacheNameHash(name);
+	for(i = 0; i < s_imageCache.numEntries; i++)
+	{
+		if(s_imageCache.entries[i].nameHash == nameHash)
+		{
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+=================
+R_CachedLevelSize
+
+Bytes R_WriteCachedImage stores for a mip level, -1 for a format it never writes
+=================
+*/
+static int R_CachedLevelSize(int internalFormat, qboolean compressed, int width, int height)
+{
+	if(compressed)
+	{
+		switch (internalFormat)
+		{
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+				return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+
+			default:
+				return -1;
+		}
+	}
+
+	switch (internalFormat)
+	{
+		case GL_RGBA8:
+		case GL_RGB8:
+		case GL_ALPHA8:
+			// always read back as GL_RGBA
+			return width * height * 4;
+
+		default:
+			return -1;
+	}
+}
+
+/*
+=================
+R_LoadCachedImage
+=================
+*/
+image_t        *R_LoadCachedImage(const char *name, int bits, filterType_t filterType, wrapType_t wrapType,
+								  const imageCacheKey_t * key)
+{
+#if defined(USE_D3D10)
+	return NULL;
+#else
+	imageCacheHeader_t *header;
+	imageCacheEntry_t *entry;
+	image_t        *image;
+	byte           *buffer;
+	byte           *data;
+	int             len, dataSize;
+	int             width, height;
+	int             i;
+
+	len = ri.FS_HomeReadFile(key->fileName, (void **)&buffer);
+	if(!buffer)
+	{
+		return NULL;
+	}
+
+	// stale entries are simply overwritten by R_WriteCachedImage
+	header = (imageCacheHeader_t *) buffer;
+	if(len < (int)sizeof(*header) || header->ident != IMAGECACHE_IDENT || header->version != IMAGECACHE_VERSION ||
+	   header->sourceHash != key->sourceHash || header->optionsHash != key->optionsHash ||
+	   Q_strncmp(header->name, name, sizeof(header->name)) || header->numLevels < 1 || header->numLevels > MAX_IMAGECACHE_LEVELS ||
+	   (header->compressed && !glConfig2.ARBTextureCompressionAvailable))
+	{
+		ri.FS_FreeFile(buffer);
+		return NULL;
+	}
+
+	if(header->uploadWidth < 1 || header->uploadWidth > glConfig.maxTextureSize ||
+	   header->uploadHeight < 1 || header->uploadHeight > glConfig.maxTextureSize)
+	{
+		ri.FS_FreeFile(buffer);
+		return NULL;
+	}
+
+	// every level has to be exactly as large as the upload reads,
+	// a damaged file would otherwise make the driver read past the buffer
+	dataSize = len - sizeof(*header);
+	width = header->uploadWidth;
+	height = header->uploadHeight;
+	for(i = 0; i < header->numLevels; i++)
+	{
+		if(header->levelSizes[i] != R_CachedLevelSize(header->internalFormat, header->compressed ? qtrue : qfalse, width, height) ||
+		   header->levelSizes[i] <= 0 || header->levelSizes[i] > dataSize)
+		{
+			ri.FS_FreeFile(buffer);
+			return NULL;
+		}
+		dataSize -= header->levelSizes[i];
+		width = Q_max(width >> 1, 1);
+		height = Q_max(height >> 1, 1);
+	}
+
+	image = R_AllocImage(name, qtrue);
+	if(!image)
+	{
+		ri.FS_FreeFile(buffer);
+		return NULL;
+	}
+
+	image->type = GL_TEXTURE_2D;
+	image->width = header->width;
+	image->height = header->height;
+	image->bits = header->bits;
+	image->filterType = filterType;
+	image->wrapType = wrapType;
+	image->uploadWidth = header->uploadWidth;
+	image->uploadHeight = header->uploadHeight;
+	image->internalFormat = header->internalFormat;
+
+	GL_Bind(image);
+
+	data = buffer + sizeof(*header);
+	width = header->uploadWidth;
+	height = header->uploadHeight;
+	for(i = 0; i < header->numLevels; i++)
+	{
+		if(header->compressed)
+		{
+			glCompressedTexImage2DARB(GL_TEXTURE_2D, i, header->internalFormat, width, height, 0, header->levelSizes[i], data);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, i, header->internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		}
+
+		data += header->levelSizes[i];
+		width = Q_max(width >> 1, 1);
+		height = Q_max(height >> 1, 1);
+	}
+
+	if(filterType == FT_DEFAULT)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->numLevels - 1);
+	}
+
+	R_SetImageParameters(image);
+
+	glBindTexture(image->type, 0);
+
+	ri.FS_FreeFile(buffer);
+
+	entry = R_AddImageCacheEntry(key->nameHash, key->optionsHash);
+	if(!entry->size)
+	{
+		entry->size = len;
+		s_imageCache.totalSize += len;
+	}
+	R_TouchImageCacheEntry(entry);
+	s_imageCache.hits++;
+
+	return image;
+#endif
+}
+
+/*
+=================
+R_WriteCachedImage
+
+Reads the mip chain R_UploadImage just built back from the driver. Only the
+8 bit and S3TC formats are kept, the float and depth formats aren't worth it.
+=================
+*/
+void R_WriteCachedImage(image_t * image, const imageCacheKey_t * key)
+{
+#if !defined(USE_D3D10)
+	imageCacheHeader_t *header;
+	imageCacheEntry_t *entry;
+	byte           *buffer;
+	byte           *data;
+	GLint           compressed, width, height, size;
+	int             len;
+	int             i;
+
+	if(!key->valid || image->type != GL_TEXTURE_2D)
+	{
+		return;
+	}
+
+	switch (image->internalFormat)
+	{
+		case GL_RGBA8:
+		case GL_RGB8:
+		case GL_ALPHA8:
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			break;
+
+		default:
+			return;
+	}
+
+	GL_Bind(image);
+
+	compressed = 0;
+	if(glConfig2.ARBTextureCompressionAvailable)
+	{
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_ARB, &compressed);
+	}
+
+	header = (imageCacheHeader_t *) Com_Allocate(sizeof(*header));
+	Com_Memset(header, 0, sizeof(*header));
+
+	len = sizeof(*header);
+	for(i = 0; i < MAX_IMAGECACHE_LEVELS; i++)
+	{
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &height);
+		if(width <= 0 || height <= 0)
+		{
+			break;
+		}
+
+		if(compressed)
+		{
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE_ARB, &size);
+		}
+		else
+		{
+			size = width * height * 4;
+		}
+
+		// skip images R_LoadCachedImage would reject, the levels have to
+		// halve from the upload size like the loader assumes
+		if(size != R_CachedLevelSize(image->internalFormat, compressed ? qtrue : qfalse, Q_max(image->uploadWidth >> i, 1),
+									 Q_max(image->uploadHeight >> i, 1)))
+		{
+			Com_Dealloc(header);
+			glBindTexture(image->type, 0);
+			return;
+		}
+
+		header->levelSizes[i] = size;
+		len += size;
+
+		// only FT_DEFAULT images have more than the base level
+		if(image->filterType != FT_DEFAULT || (width == 1 && height == 1))
+		{
+			i++;
+			break;
+		}
+	}
+
+	if(i == 0)
+	{
+		Com_Dealloc(header);
+		glBindTexture(image->type, 0);
+		return;
+	}
+
+	header->ident = IMAGECACHE_IDENT;
+	header->version = IMAGECACHE_VERSION;
+	header->sourceHash = key->sourceHash;
+	header->optionsHash = key->optionsHash;
+	Q_strncpyz(header->name, image->name, sizeof(header->name));
+	header->bits = image->bits;
+	header->width = image->width;
+	header->height = image->height;
+	header->uploadWidth = image->uploadWidth;
+	header->uploadHeight = image->uploadHeight;
+	header->internalFormat = image->internalFormat;
+	header->compressed = compressed ? 1 : 0;
+	header->numLevels = i;
+
+	buffer = (byte *) Com_Allocate(len);
+	Com_Memcpy(buffer, header, sizeof(*header));
+
+	data = buffer + sizeof(*header);
+	for(i = 0; i < header->numLevels; i++)
+	{
+		if(compressed)
+		{
+			glGetCompressedTexImageARB(GL_TEXTURE_2D, i, data);
+		}
+		else
+		{
+			glGetTexImage(GL_TEXTURE_2D, i, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		}
+		data += header->levelSizes[i];
+	}
+
+	glBindTexture(image->type, 0);
+
+	ri.FS_HomeWriteFile(key->fileName, buffer, len);
+
+	Com_Dealloc(buffer);
+	Com_Dealloc(header);
+
+	entry = R_AddImageCacheEntry(key->nameHash, key->optionsHash);
+	s_imageCache.totalSize += len - entry->size;
+	entry->size = len;
+	R_TouchImageCacheEntry(entry);
+	s_imageCache.writes++;
+
+	R_TrimImageCache();
+#endif
+}
+
+/*
+=================
+R_CacheMapImages
+
+Loads every shader a map's surfaces use, which loads and caches their images.
+=================
+*/
+static int R_CacheMapImages(const char *mapName)
+{
+	char            fileName[MAX_QPATH];
+	byte           *buffer;
+	dheader_t      *header;
+	dshader_t      *shaders;
+	int             fileofs, filelen;
+	int             len;
+	int             i, count;
+
+	if(strchr(mapName, '/'))
+	{
+		Q_strncpyz(fileName, mapName, sizeof(fileName));
+	}
+	else
+	{
+		Com_sprintf(fileName, sizeof(fileName), "maps/%s", mapName);
+	}
+	COM_DefaultExtension(fileName, sizeof(fileName), ".bsp");
+
+	len = ri.FS_ReadFile(fileName, (void **)&buffer);
+	if(!buffer)
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: R_CacheMapImages: couldn't load '%s'\n", fileName);
+		return 0;
+	}
+
+	header = (dheader_t *) buffer;
+	fileofs = LittleLong(header->lumps[LUMP_SHADERS].fileofs);
+	filelen = LittleLong(header->lumps[LUMP_SHADERS].filelen);
+
+	if(len < (int)sizeof(*header) || fileofs < 0 || filelen < 0 || fileofs > len - filelen || filelen % sizeof(dshader_t))
+	{
+		ri.Printf(PRINT_WARNING, "WARNING: R_CacheMapImages: '%s' has a bad shader lump\n", fileName);
+		ri.FS_FreeFile(buffer);
+		return 0;
+	}
+
+	shaders = (dshader_t *) (buffer + fileofs);
+	count = filelen / sizeof(dshader_t);
+	for(i = 0; i < count; i++)
+	{
+		R_FindShader(shaders[i].shader, SHADER_3D_STATIC, qtrue);
+	}
+
+	ri.FS_FreeFile(buffer);
+
+	return count;
+}
+
+/*
+=================
+R_BuildImageCache_f
+
+buildimagecache <map> [map ...]
+buildimagecache *
+=================
+*/
+void R_BuildImageCache_f(void)
+{
+	char          **mapList;
+	int             numMaps, numShaders;
+	int             hits, writes;
+	int             startTime;
+	int             i, j;
+
+	if(ri.Cmd_Argc() < 2)
+	{
+		ri.Printf(PRINT_ALL, "usage: buildimagecache <map> [map ...], or * for all maps\n");
+		return;
+	}
+
+	if(!r_imageCache->integer)
+	{
+		ri.Printf(PRINT_ALL, "buildimagecache: r_imageCache is 0\n");
+		return;
+	}
+
+	startTime = ri.Milliseconds();
+	hits = s_imageCache.hits;
+	writes = s_imageCache.writes;
+	numMaps = numShaders = 0;
+
+	for(i = 1; i < ri.Cmd_Argc(); i++)
+	{
+		if(!strcmp(ri.Cmd_Argv(i), "*"))
+		{
+			mapList = ri.FS_ListFiles("maps", ".bsp", &j);
+			// there is no list at all when no maps are found
+			if(mapList)
+			{
+				for(j = 0; mapList[j]; j++)
+				{
+					numShaders += R_CacheMapImages(mapList[j]);
+					numMaps++;
+				}
+				ri.FS_FreeFileList(mapList);
+			}
+		}
+		else
+		{
+			numShaders += R_CacheMapImages(ri.Cmd_Argv(i));
+			numMaps++;
+		}
+	}
+
+	ri.Printf(PRINT_ALL, "%i maps, %i shaders, %i images written, %i already cached, %i KB in cache, %i msec\n",
+			  numMaps, numShaders, s_imageCache.writes - writes, s_imageCache.hits - hits, s_imageCache.totalSize / 1024,
+			  ri.Milliseconds() - startTime);
+	ri.Printf(PRINT_ALL, "the images stay loaded until the next vid_restart\n");
+}
@@ -37,6 +37,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #include <jpeglib.h>
+#include <setjmp.h>
 
 #ifndef USE_INTERNAL_JPEG
 #if JPEG_LIB_VERSION < 80
@@ -52,30 +53,47 @@ JPEG LOADING
 =========================================================
 */
 
-static void R_JPGErrorExit(j_common_ptr cinfo)
+typedef struct
 {
-	char            buffer[JMSG_LENGTH_MAX];
+	struct jpeg_error_mgr pub;
+	jmp_buf         setjmpBuffer;
+	char           *error;
+	int             errorSize;
+	byte           *out;
+} jpgErrorManager_t;
 
-	(*cinfo->err->format_message) (cinfo, buffer);
+static void R_JPGErrorExit(j_common_ptr cinfo)
+{
+	jpgErrorManager_t *err = (jpgErrorManager_t *) cinfo->err;
 
-	/* Let the memory manager delete any temp files before we die */
-	jpeg_destroy(cinfo);
+	(*cinfo->err->format_message) (cinfo, err->error);
 
-	ri.Error(ERR_FATAL, "%s", buffer);
+	// back to DecodeJPG, which cleans up
+	longjmp(err->setjmpBuffer, 1);
 }
 
 static void R_JPGOutputMessage(j_common_ptr cinfo)
 {
-	char            buffer[JMSG_LENGTH_MAX];
-
-	/* Create the message */
-	(*cinfo->err->format_message) (cinfo, buffer);
+	jpgErrorManager_t *err = (jpgErrorManager_t *) cinfo->err;
 
-	/* Send it to stderr, adding a newline */
-	ri.Printf(PRINT_ALL, "%s\n", buffer);
+	// keep the first warning
+	if(!err->error[0])
+	{
+		(*cinfo->err->format_message) (cinfo, err->error);
+		Q_strcat(err->error, err->errorSize, "\n");
+	}
 }
 
-void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height, byte alphaByte)
+/*
+=============
+DecodeJPG
+
+Decodes a JPG file that is already in memory, safe to call from the image
+loader threads
+=============
+*/
+qboolean DecodeJPG(const char *filename, const byte * data, int len, byte ** pic, int *width, int *height, byte alphaByte,
+				   char *error, int errorSize)
 {
 	/* This struct contains the JPEG decompression parameters and pointers to
 	 * working space (which is allocated as needed by the JPEG library).
@@ -86,40 +104,21 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 	 * Note that this struct must live as long as the main JPEG parameter
 	 * struct, to avoid dangling-pointer problems.
 	 */
-	/* This struct represents a JPEG error handler.  It is declared separately
-	 * because applications often want to supply a specialized error handler
-	 * (see the second half of this file for an example).  But here we just
-	 * take the easy way out and use the standard error handler, which will
-	 * print a message on stderr and call exit() if compression fails.
-	 * Note that this struct must live as long as the main JPEG parameter
-	 * struct, to avoid dangling-pointer problems.
-	 */
-	struct jpeg_error_mgr jerr;
+	jpgErrorManager_t jerr;
 
 	/* More stuff */
 	JSAMPARRAY      buffer;		/* Output row buffer */
 	unsigned int    row_stride;	/* physical row width in output buffer */
 	unsigned int    pixelcount, memcount;
 	unsigned int    sindex, dindex;
-	byte           *out;
-	int             len;
-	union
-	{
-		byte           *b;
-		void           *v;
-	} fbuffer;
 	byte           *buf;
 
-	/* In this example we want to open the input file before doing anything else,
-	 * so that the setjmp() error recovery below can assume the file is open.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to read binary files.
-	 */
+	*pic = NULL;
+	error[0] = '\0';
 
-	len = ri.FS_ReadFile((char *)filename, &fbuffer.v);
-	if(!fbuffer.b || len < 0)
+	if(errorSize < JMSG_LENGTH_MAX)
 	{
-		return;
+		return qfalse;
 	}
 
 	/* Step 1: allocate and initialize JPEG decompression object */
@@ -129,16 +128,30 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 	 * This routine fills in the contents of struct jerr, and returns jerr's
 	 * address which we place into the link field in cinfo.
 	 */
-	cinfo.err = jpeg_std_error(&jerr);
+	cinfo.err = jpeg_std_error(&jerr.pub);
 	cinfo.err->error_exit = R_JPGErrorExit;
 	cinfo.err->output_message = R_JPGOutputMessage;
+	jerr.error = error;
+	jerr.errorSize = errorSize;
+	jerr.out = NULL;
+
+	if(setjmp(jerr.setjmpBuffer))
+	{
+		// libjpeg failed, the message is in error already
+		jpeg_destroy_decompress(&cinfo);
+		if(jerr.out)
+		{
+			Com_Dealloc(jerr.out);
+		}
+		return qfalse;
+	}
 
 	/* Now we can initialize the JPEG decompression object. */
 	jpeg_create_decompress(&cinfo);
 
 	/* Step 2: specify data source (eg, a file) */
 
-	jpeg_mem_src(&cinfo, fbuffer.b, len);
+	jpeg_mem_src(&cinfo, (unsigned char *)data, len);
 
 	/* Step 3: read file parameters with jpeg_read_header() */
 
@@ -178,18 +191,18 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 	   || ((pixelcount * 4) / cinfo.output_width) / 4 != cinfo.output_height
 	   || pixelcount > 0x1FFFFFFF || cinfo.output_components != 3)
 	{
+		Com_sprintf(error, errorSize, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
+					cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+
 		// Free the memory to make sure we don't leak memory
-		ri.FS_FreeFile(fbuffer.v);
 		jpeg_destroy_decompress(&cinfo);
-
-		ri.Error(ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
-				 cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components);
+		return qfalse;
 	}
 
 	memcount = pixelcount * 4;
 	row_stride = cinfo.output_width * cinfo.output_components;
 
-	out = (byte*)ri.Z_Malloc(memcount);
+	jerr.out = (byte*)Com_Allocate(memcount);
 
 	*width = cinfo.output_width;
 	*height = cinfo.output_height;
@@ -206,12 +219,12 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 		 * Here the array is only one element long, but you could ask for
 		 * more than one scanline at a time if that's more convenient.
 		 */
-		buf = ((out + (row_stride * cinfo.output_scanline)));
+		buf = ((jerr.out + (row_stride * cinfo.output_scanline)));
 		buffer = &buf;
 		(void)jpeg_read_scanlines(&cinfo, buffer, 1);
 	}
 
-	buf = out;
+	buf = jerr.out;
 
 	// Expand from RGB to RGBA
 	sindex = pixelcount * cinfo.output_components;
@@ -225,8 +238,6 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 		buf[--dindex] = buf[--sindex];
 	} while(sindex);
 
-	*pic = out;
-
 	/* Step 7: Finish decompression */
 
 	jpeg_finish_decompress(&cinfo);
@@ -239,18 +250,44 @@ void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height,
 	/* This is an important step since it will release a good deal of memory. */
 	jpeg_destroy_decompress(&cinfo);
 
-	/* After finish_decompress, we can close the input file.
-	 * Here we postpone it until after no more JPEG errors are possible,
-	 * so as to simplify the setjmp error logic above.  (Actually, I don't
-	 * think that jpeg_destroy can do an error exit, but why assume anything...)
-	 */
-	ri.FS_FreeFile(fbuffer.v);
-
 	/* At this point you may want to check to see whether any corrupt-data
 	 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
 	 */
 
 	/* And we're done! */
+	*pic = jerr.out;
+	return qtrue;
+}
+
+void LoadJPG(const char *filename, unsigned char **pic, int *width, int *height, byte alphaByte)
+{
+	int             len;
+	union
+	{
+		byte           *b;
+		void           *v;
+	} fbuffer;
+	char            error[MAX_STRING_CHARS];
+
+	*pic = NULL;
+
+	len = ri.FS_ReadFile((char *)filename, &fbuffer.v);
+	if(!fbuffer.b || len < 0)
+	{
+		return;
+	}
+
+	if(!DecodeJPG(filename, fbuffer.b, len, pic, width, height, alphaByte, error, sizeof(error)))
+	{
+		ri.FS_FreeFile(fbuffer.v);
+		ri.Error(ERR_DROP, "%s", error);
+	}
+	ri.FS_FreeFile(fbuffer.v);
+
+	if(error[0])
+	{
+		ri.Printf(PRINT_ALL, "%s", error);
+	}
 }
 
 
@@ -41,56 +41,72 @@ static void png_read_data(png_structp png, png_bytep data, png_size_t length)
 	png_init_io(png, (png_FILE_p)(io_ptr + length));
 }
 
+typedef struct
+{
+	char           *error;
+	int             errorSize;
+} pngErrorBuffer_t;
+
 static void png_user_warning_fn(png_structp png_ptr, png_const_charp warning_message)
 {
-	ri.Printf(PRINT_WARNING, "libpng warning: %s\n", warning_message);
+	pngErrorBuffer_t *buffer = (pngErrorBuffer_t *) png_get_error_ptr(png_ptr);
+
+	if(!buffer->error[0])
+	{
+		Com_sprintf(buffer->error, buffer->errorSize, "libpng warning: %s\n", warning_message);
+	}
 }
 
 static void png_user_error_fn(png_structp png_ptr, png_const_charp error_message)
 {
-	ri.Printf(PRINT_ERROR, "libpng error: %s\n", error_message);
+	pngErrorBuffer_t *buffer = (pngErrorBuffer_t *) png_get_error_ptr(png_ptr);
+
+	Com_sprintf(buffer->error, buffer->errorSize, "libpng error: %s\n", error_message);
 	longjmp(png_jmpbuf(png_ptr), 0);
 }
 
-void LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaByte)
+/*
+=============
+DecodePNG
+
+Decodes a PNG file that is already in memory, safe to call from the image
+loader threads
+=============
+*/
+qboolean DecodePNG(const char *name, const byte * data, int size, byte ** pic, int *width, int *height, byte alphaByte,
+				   char *error, int errorSize)
 {
 	int             bit_depth;
 	int             color_type;
 	png_uint_32     w;
 	png_uint_32     h;
 	unsigned int    row;
-	size_t          rowbytes;
 	png_infop       info;
 	png_structp     png;
 	png_bytep      *row_pointers;
-	byte           *data;
 	byte           *out;
-	int             size;
-
-	// load png
-	size = ri.FS_ReadFile(name, (void **)&data);
+	pngErrorBuffer_t errorBuffer;
 
-	if(!data)
-		return;
+	*pic = NULL;
+	error[0] = '\0';
+	errorBuffer.error = error;
+	errorBuffer.errorSize = errorSize;
 
-	//png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp) NULL, png_user_error_fn, png_user_warning_fn);
+	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp) &errorBuffer, png_user_error_fn, png_user_warning_fn);
 
 	if(!png)
 	{
-		ri.Printf(PRINT_WARNING, "LoadPNG: png_create_write_struct() failed for (%s)\n", name);
-		ri.FS_FreeFile(data);
-		return;
+		Com_sprintf(error, errorSize, "LoadPNG: png_create_write_struct() failed for (%s)\n", name);
+		return qfalse;
 	}
 
 	// allocate/initialize the memory for image information.  REQUIRED
 	info = png_create_info_struct(png);
 	if(!info)
 	{
-		ri.Printf(PRINT_WARNING, "LoadPNG: png_create_info_struct() failed for (%s)\n", name);
-		ri.FS_FreeFile(data);
+		Com_sprintf(error, errorSize, "LoadPNG: png_create_info_struct() failed for (%s)\n", name);
 		png_destroy_read_struct(&png, (png_infopp) NULL, (png_infopp) NULL);
-		return;
+		return qfalse;
 	}
 
 	/*
@@ -101,14 +117,13 @@ void LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaB
 	if(setjmp(png_jmpbuf(png)))
 	{
 		// if we get here, we had a problem reading the file
-		ri.Printf(PRINT_WARNING, "LoadPNG: first exception handler called for (%s)\n", name);
-		ri.FS_FreeFile(data);
+		Com_sprintf(error + strlen(error), errorSize - strlen(error), "LoadPNG: first exception handler called for (%s)\n", name);
 		png_destroy_read_struct(&png, (png_infopp) & info, (png_infopp) NULL);
-		return;
+		return qfalse;
 	}
 
 	//png_set_write_fn(png, buffer, png_write_data, png_flush_data);
-	png_set_read_fn(png, data, png_read_data);
+	png_set_read_fn(png, (png_voidp) data, png_read_data);
 
 	png_set_sig_bytes(png, 0);
 
@@ -153,22 +168,19 @@ void LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaB
 	// allocate the memory to hold the image
 	*width = w;
 	*height = h;
-	*pic = out = (byte *) ri.Z_Malloc(w * h * 4);
-
-	row_pointers = (png_bytep *) ri.Hunk_AllocateTempMemory(sizeof(png_bytep) * h);
+	out = (byte *) Com_Allocate(w * h * 4);
+	row_pointers = (png_bytep *) Com_Allocate(sizeof(png_bytep) * h);
 
 	// set a new exception handler
 	if(setjmp(png_jmpbuf(png)))
 	{
-		ri.Printf(PRINT_WARNING, "LoadPNG: second exception handler called for (%s)\n", name);
-		ri.Hunk_FreeTempMemory(row_pointers);
-		ri.FS_FreeFile(data);
+		Com_sprintf(error + strlen(error), errorSize - strlen(error), "LoadPNG: second exception handler called for (%s)\n", name);
+		Com_Dealloc(row_pointers);
+		Com_Dealloc(out);
 		png_destroy_read_struct(&png, (png_infopp) & info, (png_infopp) NULL);
-		return;
+		return qfalse;
 	}
 
-	rowbytes = png_get_rowbytes(png, info);
-
 	for(row = 0; row < h; row++)
 		row_pointers[row] = (png_bytep) (out + (row * 4 * w));
 
@@ -181,7 +193,32 @@ void LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaB
 	// clean up after the read, and free any memory allocated
 	png_destroy_read_struct(&png, &info, (png_infopp) NULL);
 
-	ri.Hunk_FreeTempMemory(row_pointers);
+	Com_Dealloc(row_pointers);
+
+	*pic = out;
+	return qtrue;
+}
+
+void LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaByte)
+{
+	byte           *data;
+	int             size;
+	char            error[MAX_STRING_CHARS];
+
+	*pic = NULL;
+
+	// load png
+	size = ri.FS_ReadFile(name, (void **)&data);
+
+	if(!data)
+		return;
+
+	DecodePNG(name, data, size, pic, width, height, alphaByte, error, sizeof(error));
+	if(error[0])
+	{
+		ri.Printf(PRINT_WARNING, "%s", error);
+	}
+
 	ri.FS_FreeFile(data);
 }
 
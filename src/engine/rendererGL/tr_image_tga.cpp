@@ -27,28 +27,29 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 /*
 =============
-LoadTGA
+DecodeTGA
+
+Decodes a TGA file that is already in memory, safe to call from the image
+loader threads
 =============
 */
-void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaByte)
+qboolean DecodeTGA(const char *name, const byte * buffer, int size, byte ** pic, int *width, int *height, byte alphaByte,
+				   char *error, int errorSize)
 {
 	int             columns, rows, numPixels;
 	byte           *pixbuf;
 	int             row, column;
-	byte           *buf_p;
-	byte           *buffer;
+	const byte     *buf_p;
 	TargaHeader     targa_header;
 	byte           *targa_rgba;
 
 	*pic = NULL;
+	error[0] = '\0';
 
-	//
-	// load the file
-	//
-	ri.FS_ReadFile((char *)name, (void **)&buffer);
-	if(!buffer)
+	if(size < 18)
 	{
-		return;
+		Com_sprintf(error, errorSize, "LoadTGA: %s is truncated\n", name);
+		return qfalse;
 	}
 
 	buf_p = buffer;
@@ -57,35 +58,38 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 	targa_header.colormap_type = *buf_p++;
 	targa_header.image_type = *buf_p++;
 
-	targa_header.colormap_index = LittleShort(*(short *)buf_p);
+	targa_header.colormap_index = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
-	targa_header.colormap_length = LittleShort(*(short *)buf_p);
+	targa_header.colormap_length = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
 	targa_header.colormap_size = *buf_p++;
-	targa_header.x_origin = LittleShort(*(short *)buf_p);
+	targa_header.x_origin = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
-	targa_header.y_origin = LittleShort(*(short *)buf_p);
+	targa_header.y_origin = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
-	targa_header.width = LittleShort(*(short *)buf_p);
+	targa_header.width = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
-	targa_header.height = LittleShort(*(short *)buf_p);
+	targa_header.height = LittleShort(*(const short *)buf_p);
 	buf_p += 2;
 	targa_header.pixel_size = *buf_p++;
 	targa_header.attributes = *buf_p++;
 
 	if(targa_header.image_type != 2 && targa_header.image_type != 10 && targa_header.image_type != 3)
 	{
-		ri.Error(ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported (%s)\n", name);
+		Com_sprintf(error, errorSize, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported (%s)\n", name);
+		return qfalse;
 	}
 
 	if(targa_header.colormap_type != 0)
 	{
-		ri.Error(ERR_DROP, "LoadTGA: colormaps not supported (%s)\n", name);
+		Com_sprintf(error, errorSize, "LoadTGA: colormaps not supported (%s)\n", name);
+		return qfalse;
 	}
 
 	if((targa_header.pixel_size != 32 && targa_header.pixel_size != 24) && targa_header.image_type != 3)
 	{
-		ri.Error(ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps) (%s)\n", name);
+		Com_sprintf(error, errorSize, "LoadTGA: Only 32 or 24 bit images supported (no colormaps) (%s)\n", name);
+		return qfalse;
 	}
 
 	columns = targa_header.width;
@@ -99,10 +103,12 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 
 	if(!columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows)
 	{
-		ri.Error(ERR_DROP, "LoadTGA: %s has an invalid image size\n", name);
+		Com_sprintf(error, errorSize, "LoadTGA: %s has an invalid image size\n", name);
+		return qfalse;
 	}
 
-	targa_rgba = (byte*)ri.Z_Malloc(numPixels);
+	targa_rgba = (byte*)Com_Allocate(numPixels);
+	Com_Memset(targa_rgba, 0, numPixels);
 
 	*pic = targa_rgba;
 
@@ -152,8 +158,10 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 						*pixbuf++ = alpha;
 						break;
 					default:
-						ri.Error(ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
-						break;
+						Com_sprintf(error, errorSize, "LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
+						Com_Dealloc(targa_rgba);
+						*pic = NULL;
+						return qfalse;
 				}
 			}
 		}
@@ -191,8 +199,10 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 							alpha = *buf_p++;
 							break;
 						default:
-							ri.Error(ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
-							break;
+							Com_sprintf(error, errorSize, "LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
+							Com_Dealloc(targa_rgba);
+							*pic = NULL;
+							return qfalse;
 					}
 
 					for(j = 0; j < packetSize; j++)
@@ -239,9 +249,11 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 								*pixbuf++ = alpha;
 								break;
 							default:
-								ri.Error(ERR_DROP,
-										 "LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
-								break;
+								Com_sprintf(error, errorSize,
+											"LoadTGA: illegal pixel_size '%d' in file '%s'\n", targa_header.pixel_size, name);
+								Com_Dealloc(targa_rgba);
+								*pic = NULL;
+								return qfalse;
 						}
 						column++;
 						if(column == columns)
@@ -287,11 +299,46 @@ void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaB
 	// instead we just print a warning
 	if(targa_header.attributes & 0x20)
 	{
-		ri.Printf(PRINT_WARNING, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
+		Com_sprintf(error, errorSize, "WARNING: '%s' TGA file header declares top-down image, ignoring\n", name);
 	}
 #endif
 
+	return qtrue;
+}
+
+/*
+=============
+LoadTGA
+=============
+*/
+void LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaByte)
+{
+	byte           *buffer;
+	int             size;
+	char            error[MAX_STRING_CHARS];
+
+	*pic = NULL;
+
+	//
+	// load the file
+	//
+	size = ri.FS_ReadFile((char *)name, (void **)&buffer);
+	if(!buffer)
+	{
+		return;
+	}
+
+	if(!DecodeTGA(name, buffer, size, pic, width, height, alphaByte, error, sizeof(error)))
+	{
+		ri.FS_FreeFile(buffer);
+		ri.Error(ERR_DROP, "%s", error);
+	}
 	ri.FS_FreeFile(buffer);
+
+	if(error[0])
+	{
+		ri.Printf(PRINT_WARNING, "%s", error);
+	}
 }
 
 
@@ -35,18 +35,53 @@ LoadWEBP
 =========================================================
 */
 
-void LoadWEBP(const char *filename, unsigned char **pic, int *width, int *height, byte alphaByte)
+/*
+=============
+DecodeWEBP
+
+Decodes a WebP file that is already in memory, safe to call from the image
+loader threads
+=============
+*/
+qboolean DecodeWEBP(const char *filename, const byte * data, int len, byte ** pic, int *width, int *height, byte alphaByte,
+					char *error, int errorSize)
 {
 	byte           *out;
-	int             len;
 	int		stride;
 	int		size;
+
+	*pic = NULL;
+	error[0] = '\0';
+
+	/* validate data and query image size */
+	if( !WebPGetInfo( data, len, width, height ) )
+		return qfalse;
+
+	stride = *width * sizeof( color4ub_t );
+	size = *height * stride;
+
+	out = (byte*)Com_Allocate( size );
+	if( !WebPDecodeRGBAInto( data, len, out, size, stride ) ) {
+		Com_Dealloc( out );
+		return qfalse;
+	}
+
+	*pic = out;
+	return qtrue;
+}
+
+void LoadWEBP(const char *filename, unsigned char **pic, int *width, int *height, byte alphaByte)
+{
+	int             len;
+	char            error[MAX_STRING_CHARS];
 	union
 	{
 		byte           *b;
 		void           *v;
 	} fbuffer;
 
+	*pic = NULL;
+
 	/* read compressed data */
 	len = ri.FS_ReadFile((char *)filename, &fbuffer.v);
 	if(!fbuffer.b || len < 0)
@@ -54,20 +89,7 @@ void LoadWEBP(const char *filename, unsigned char **pic, int *width, int *height
 		return;
 	}
 
-	/* validate data and query image size */
-	if( !WebPGetInfo( fbuffer.b, len, width, height ) )
-		return;
-
-	stride = *width * sizeof( color4ub_t );
-	size = *height * stride;
-
-	out = (byte*)ri.Z_Malloc( size );
-	if( !WebPDecodeRGBAInto( fbuffer.b, len, out, size, stride ) ) {
-		ri.Free( out );
-		return;
-	}
-
+	DecodeWEBP(filename, fbuffer.b, len, pic, width, height, alphaByte, error, sizeof(error));
 	ri.FS_FreeFile(fbuffer.v);
-	*pic = out;
 }
 #endif
@@ -219,6 +219,12 @@ convar_t         *r_mapOverBrightBits;
 
 convar_t         *r_debugSurface;
 convar_t         *r_simpleMipMaps;
+convar_t         *r_imageThreads;
+convar_t         *r_imagePrefetchMemory;
+convar_t         *r_imageCache;
+convar_t         *r_imageCacheSize;
+convar_t         *r_shaderCache;
+convar_t         *r_animationCache;
 
 convar_t         *r_showImages;
 
@@ -1407,6 +1413,12 @@ void R_Register(void)
 	r_customheight = ri.Cvar_Get("r_customheight", "1024", CVAR_ARCHIVE | CVAR_LATCH, "test");
 	r_customaspect = ri.Cvar_Get("r_customaspect", "1", CVAR_ARCHIVE | CVAR_LATCH, "test");
 	r_simpleMipMaps = ri.Cvar_Get("r_simpleMipMaps", "0", CVAR_ARCHIVE | CVAR_LATCH, "test");
+	r_imageThreads = ri.Cvar_Get("r_imageThreads", "4", CVAR_ARCHIVE, "Number of threads decoding the images of a map while it loads, 0 decodes them one by one as the shaders ask for them.");
+	r_imagePrefetchMemory = ri.Cvar_Get("r_imagePrefetchMemory", "256", CVAR_ARCHIVE, "Megabytes of decoded images the loader threads may hold before the shaders pick them up.");
+	r_imageCache = ri.Cvar_Get("r_imageCache", "1", CVAR_ARCHIVE | CVAR_LATCH, "Keep the uploaded mip chains of loaded images in imagecache/ so later loads skip decoding, resampling and compression.");
+	r_imageCacheSize = ri.Cvar_Get("r_imageCacheSize", "512", CVAR_ARCHIVE, "Megabytes the image cache may grow to before the least recently used entries are removed, 0 never removes any.");
+	r_shaderCache = ri.Cvar_Get("r_shaderCache", "1", CVAR_ARCHIVE | CVAR_LATCH, "Keep the combined shader text and its name index in shadercache.dat so later starts with the same shader files skip scanning them.");
+	r_animationCache = ri.Cvar_Get("r_animationCache", "1", CVAR_ARCHIVE, "Keep parsed .md5anim files in animcache/ so later loads of the same file skip the text parser.");
 	r_uiFullScreen = ri.Cvar_Get("r_uifullscreen", "0", 0, "test");
 	r_subdivisions = ri.Cvar_Get("r_subdivisions", "4", CVAR_ARCHIVE | CVAR_LATCH, "test");
 	r_deferredShading = ri.Cvar_Get("r_deferredShading", "0", CVAR_CHEAT | CVAR_SHADER, "test");
@@ -1725,6 +1737,8 @@ void R_Register(void)
 	r_detailTextures = ri.Cvar_Get("r_detailtextures", "1", CVAR_ARCHIVE | CVAR_LATCH, "test");
 
 	// make sure all the commands added here are also removed in R_Shutdown
+	ri.Cmd_AddCommand("imagebench", R_ImageBench_f, "^1Times decoding, resampling and mipmapping every image in a directory, single threaded and on r_imageThreads threads.");
+	ri.Cmd_AddCommand("buildimagecache", R_BuildImageCache_f, "^1Loads every image the given maps reference so they are written to the image cache, use * for all maps.");
 	ri.Cmd_AddCommand("imagelist", R_ImageList_f, "^1List currently open images/textures used by the current map. also displays the amount of texture memory the map is using which is the last number displayed.");
 	ri.Cmd_AddCommand("shaderlist", R_ShaderList_f, "^1List of currently open shaders.");
 	ri.Cmd_AddCommand("shaderexp", R_ShaderExp_f, "^1List of currentlytest shaders.");
@@ -1734,6 +1748,7 @@ void R_Register(void)
 
 #if defined(USE_REFENTITY_ANIMATIONSYSTEM)
 	ri.Cmd_AddCommand("animationlist", R_AnimationList_f, "^1List of total animations.");
+	ri.Cmd_AddCommand("animbench", R_AnimationBench_f, "^1Times building skeletons from the loaded md5 animations with the scalar and the SSE2 bone code.");
 #endif
 
 	ri.Cmd_AddCommand("fbolist", R_FBOList_f, "^1List of avaiable frame buffer object.");
@@ -2117,6 +2132,8 @@ void RE_Shutdown(qboolean destroyWindow)
 {
 	ri.Printf(PRINT_ALL, "RE_Shutdown( destroyWindow = %i )\n", destroyWindow);
 
+	ri.Cmd_RemoveCommand("imagebench");
+	ri.Cmd_RemoveCommand("buildimagecache");
 	ri.Cmd_RemoveCommand("modellist");
 	ri.Cmd_RemoveCommand("screenshotPNG");
 	ri.Cmd_RemoveCommand("screenshotJPEG");
@@ -2129,6 +2146,7 @@ void RE_Shutdown(qboolean destroyWindow)
 	ri.Cmd_RemoveCommand("modelist");
 	ri.Cmd_RemoveCommand("shaderstate");
 	ri.Cmd_RemoveCommand("animationlist");
+	ri.Cmd_RemoveCommand("animbench");
 	ri.Cmd_RemoveCommand("fbolist");
 	ri.Cmd_RemoveCommand("vbolist");
 	ri.Cmd_RemoveCommand("generatemtr");
@@ -3420,6 +3420,10 @@ typedef struct md5Animation_s
 	int16_t        frameRate;
 
 	uint32_t        numAnimatedComponents;
+
+	// component index of tx, ty, tz, qx, qy, qz for every channel,
+	// -1 where the baseframe value is used
+	int16_t        *componentMap;
 } md5Animation_t;
 
 
@@ -4162,6 +4166,12 @@ extern convar_t  *r_mapOverBrightBits;
 
 extern convar_t  *r_debugSurface;
 extern convar_t  *r_simpleMipMaps;
+extern convar_t  *r_imageThreads;
+extern convar_t  *r_imagePrefetchMemory;
+extern convar_t  *r_imageCache;
+extern convar_t  *r_imageCacheSize;
+extern convar_t  *r_shaderCache;
+extern convar_t  *r_animationCache;
 
 extern convar_t  *r_showImages;
 extern convar_t  *r_debugSort;
@@ -4480,6 +4490,42 @@ image_t        *R_CreateCubeImage(const char *name,
 
 image_t        *R_AllocImage(const char *name, qboolean linkIntoHashTable);
 void			R_UploadImage(const byte ** dataArray, int numData, image_t * image);
+void			R_SetImageParameters(image_t * image);
+int				R_ReadImageSource(const char *name, char *fileName, int fileNameSize, byte ** buffer, int *size);
+
+void            R_AddPrefetchImage(const char *name, byte alphaByte);
+void            R_PrefetchImages(void);
+void            R_FreePrefetchedImages(void);
+void            R_ImageBench_f(void);
+
+/*
+============================================================
+
+IMAGE CACHE
+
+============================================================
+*/
+
+typedef struct
+{
+	qboolean        valid;
+	unsigned        nameHash;		// case insensitive hash of the image name or expression
+	unsigned        optionsHash;	// everything besides the sources that changes the uploaded texels
+	unsigned        sourceHash;		// contents of every file the image is built from
+	char            fileName[MAX_QPATH];
+} imageCacheKey_t;
+
+#define CACHEHASH_BASIS		2166136261u
+
+unsigned        R_CacheHash(unsigned hash, const void *data, int size);
+void            R_InitImageCache(void);
+void            R_ShutdownImageCache(void);
+qboolean        R_ImageCacheKey(const char *name, int bits, filterType_t filterType, wrapType_t wrapType, imageCacheKey_t * key);
+qboolean        R_ImageCacheContains(const char *name);
+image_t        *R_LoadCachedImage(const char *name, int bits, filterType_t filterType, wrapType_t wrapType,
+								  const imageCacheKey_t * key);
+void            R_WriteCachedImage(image_t * image, const imageCacheKey_t * key);
+void            R_BuildImageCache_f(void);
 
 int				RE_GetTextureId(const char *name);
 
@@ -4505,6 +4551,7 @@ shader_t       *R_FindShader(const char *name, shaderType_t type, qboolean mipRa
 shader_t       *R_GetShaderByHandle(qhandle_t hShader);
 shader_t       *R_GetShaderByState(int index, long *cycleTime);
 shader_t       *R_FindShaderByName(const char *name);
+void            R_PrefetchShaderImages(const char *name);
 void            R_InitShaders(void);
 void            R_ShaderList_f(void);
 void            R_ShaderExp_f(void);
@@ -4914,6 +4961,7 @@ qhandle_t       RE_RegisterAnimation(const char *name);
 
 skelAnimation_t *R_GetAnimationByHandle(qhandle_t hAnim);
 void            R_AnimationList_f(void);
+void            R_AnimationBench_f(void);
 
 void            R_AddMD5Surfaces(trRefEntity_t * ent);
 void            R_AddMD5Interactions(trRefEntity_t * ent, trRefLight_t * light);
@@ -5198,16 +5246,24 @@ void            RE_EndFrame(int *frontEndMsec, int *backEndMsec);
 
 
 void            LoadTGA(const char *name, byte ** pic, int *width, int *height, byte alphaByte);
+qboolean        DecodeTGA(const char *name, const byte * buffer, int size, byte ** pic, int *width, int *height, byte alphaByte,
+						  char *error, int errorSize);
 
 void            LoadJPG(const char *filename, unsigned char **pic, int *width, int *height, byte alphaByte);
+qboolean        DecodeJPG(const char *filename, const byte * buffer, int size, byte ** pic, int *width, int *height,
+						  byte alphaByte, char *error, int errorSize);
 void            SaveJPG(char *filename, int quality, int image_width, int image_height, unsigned char *image_buffer);
 int             SaveJPGToBuffer(byte * buffer, size_t bufferSize, int quality, int image_width, int image_height, byte * image_buffer);
 
 void            LoadPNG(const char *name, byte ** pic, int *width, int *height, byte alphaByte);
+qboolean        DecodePNG(const char *name, const byte * data, int size, byte ** pic, int *width, int *height, byte alphaByte,
+						  char *error, int errorSize);
 void            SavePNG(const char *name, const byte * pic, int width, int height, int numBytes, qboolean flip);
 
 #ifdef USE_WEBP
 void            LoadWEBP(const char *name, byte ** pic, int *width, int *height, byte alphaByte);
+qboolean        DecodeWEBP(const char *name, const byte * data, int size, byte ** pic, int *width, int *height,
+						   byte alphaByte, char *error, int errorSize);
 #endif
 
 // video stuff
@@ -5672,6 +5672,164 @@ shader_t       *R_FindShaderByName(const char *name)
 }
 
 
+/*
+===============
+R_PrefetchShaderMapName
+
+Joins the rest of the line the same way ParseMap does
+===============
+*/
+static void R_PrefetchShaderMapName(char **text, char *buffer, int bufferSize)
+{
+	char           *token;
+	int             len;
+
+	buffer[0] = '\0';
+	while(1)
+	{
+		token = COM_ParseExt2(text, qfalse);
+		if(!token[0])
+		{
+			break;
+		}
+
+		Q_strcat(buffer, bufferSize, token);
+		Q_strcat(buffer, bufferSize, " ");
+	}
+
+	len = strlen(buffer);
+	if(len)
+	{
+		buffer[len - 1] = '\0';
+	}
+}
+
+/*
+===============
+R_PrefetchShaderImages
+
+Queues the images a shader is going to load for R_PrefetchImages
+without creating the shader, so the decoding can happen on the image
+loader threads before the world surfaces call R_FindShader
+===============
+*/
+void R_PrefetchShaderImages(const char *name)
+{
+	char            strippedName[MAX_QPATH];
+	char            stageMap[MAX_QPATH];
+	char            buffer[MAX_QPATH];
+	char           *text;
+	char           *token;
+	int             depth;
+	qboolean        normalStage;
+
+	if(!name || !name[0])
+	{
+		return;
+	}
+
+	COM_StripExtension3(name, strippedName, sizeof(strippedName));
+
+	text = FindShaderInShaderText(strippedName);
+	if(!text)
+	{
+		// implicit shader, R_FindShader loads the image of the same name
+		R_AddPrefetchImage(strippedName, 0xFF);
+		return;
+	}
+
+	depth = 0;
+	stageMap[0] = '\0';
+	normalStage = qfalse;
+
+	while(1)
+	{
+		token = COM_ParseExt2(&text, qtrue);
+		if(!token[0])
+		{
+			break;
+		}
+
+		if(token[0] == '{')
+		{
+			depth++;
+			if(depth == 2)
+			{
+				stageMap[0] = '\0';
+				normalStage = qfalse;
+			}
+			continue;
+		}
+
+		if(token[0] == '}')
+		{
+			if(depth == 2 && stageMap[0])
+			{
+				R_AddPrefetchImage(stageMap, normalStage ? 0x00 : 0xFF);
+			}
+
+			if(--depth <= 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if(depth == 1)
+		{
+			if(!Q_stricmp(token, "diffuseMap") || !Q_stricmp(token, "specularMap") || !Q_stricmp(token, "glowMap"))
+			{
+				R_PrefetchShaderMapName(&text, buffer, sizeof(buffer));
+				R_AddPrefetchImage(buffer, 0xFF);
+			}
+			else if(!Q_stricmp(token, "normalMap") || !Q_stricmp(token, "bumpMap"))
+			{
+				R_PrefetchShaderMapName(&text, buffer, sizeof(buffer));
+				R_AddPrefetchImage(buffer, 0x00);
+			}
+			else if(!Q_stricmp(token, "implicitMap") || !Q_stricmp(token, "implicitMask") || !Q_stricmp(token, "implicitBlend"))
+			{
+				token = COM_ParseExt(&text, qfalse);
+				if(token[0] != '\0' && token[0] != '-')
+				{
+					R_AddPrefetchImage(token, 0xFF);
+				}
+				else
+				{
+					R_AddPrefetchImage(strippedName, 0xFF);
+				}
+			}
+		}
+		else if(depth == 2)
+		{
+			if(!Q_stricmp(token, "map"))
+			{
+				R_PrefetchShaderMapName(&text, stageMap, sizeof(stageMap));
+			}
+			else if(!Q_stricmp(token, "clampmap"))
+			{
+				token = COM_ParseExt2(&text, qfalse);
+				R_AddPrefetchImage(token, 0xFF);
+			}
+			else if(!Q_stricmp(token, "stage"))
+			{
+				token = COM_ParseExt2(&text, qfalse);
+				normalStage = (qboolean)(!Q_stricmp(token, "normalMap") || !Q_stricmp(token, "bumpMap") ||
+										 !Q_stricmp(token, "heathazeMap") || !Q_stricmp(token, "liquidMap"));
+			}
+			else if(!Q_stricmp(token, "blendfunc"))
+			{
+				token = COM_ParseExt2(&text, qfalse);
+				if(!Q_stricmp(token, "bumpMap"))
+				{
+					normalStage = qtrue;
+				}
+			}
+		}
+	}
+}
+
+
 /*
 ===============
 R_FindShader
@@ -6528,6 +6686,334 @@ static void ScanAndLoadGuideFiles(void)
 	ri.FS_FreeFileList(guideFiles);
 }
 
+/*
+====================
+ParseShaderTextTable
+
+Parses a "table" from the shader text, text points behind the keyword
+=====================
+*/
+static void ParseShaderTextTable(char **text)
+{
+	char           *token;
+	int             depth;
+	float           values[FUNCTABLE_SIZE];
+	int             numValues;
+	shaderTable_t  *tb;
+	qboolean        alreadyCreated;
+	int             hash;
+
+	Com_Memset(&table, 0, sizeof(table));
+
+	token = COM_ParseExt2(text, qtrue);
+
+	Q_strncpyz(table.name, token, sizeof(table.name));
+
+	// check if already created
+	alreadyCreated = qfalse;
+	hash = generateHashValue(table.name, MAX_SHADERTABLE_HASH);
+	for(tb = shaderTableHashTable[hash]; tb; tb = tb->next)
+	{
+		if(Q_stricmp(tb->name, table.name) == 0)
+		{
+			// match found
+			alreadyCreated = qtrue;
+			break;
+		}
+	}
+
+	depth = 0;
+	numValues = 0;
+	do
+	{
+		token = COM_ParseExt2(text, qtrue);
+
+		if(!Q_stricmp(token, "snap"))
+		{
+			table.snap = qtrue;
+		}
+		else if(!Q_stricmp(token, "clamp"))
+		{
+			table.clamp = qtrue;
+		}
+		else if(token[0] == '{')
+		{
+			depth++;
+		}
+		else if(token[0] == '}')
+		{
+			depth--;
+		}
+		else if(token[0] == ',')
+		{
+			continue;
+		}
+		else
+		{
+			if(numValues == FUNCTABLE_SIZE)
+			{
+				ri.Printf(PRINT_WARNING, "WARNING: FUNCTABLE_SIZE hit\n");
+				break;
+			}
+			values[numValues++] = atof(token);
+		}
+	} while(depth && *text);
+
+	if(!alreadyCreated)
+	{
+		ri.Printf(PRINT_DEVELOPER, "...generating '%s'\n", table.name);
+		GeneratePermanentShaderTable(values, numValues);
+	}
+}
+
+/*
+=====================================================================
+
+SHADER TEXT CACHE
+
+The combined and compressed shader text is stored in shadercache.dat along with
+the offsets of every shader name and table in it, so later starts with the same
+shader files skip reading, compressing and tokenizing all of them. The shaders
+themselves are still parsed from the text when they are first used, their
+stages point at images and GLSL programs that only exist at runtime.
+
+=====================================================================
+*/
+
+#define SHADERCACHE_FILE		"shadercache.dat"
+#define SHADERCACHE_IDENT		(('C' << 24) + ('H' << 16) + ('S' << 8) + 'X')
+#define SHADERCACHE_VERSION		1
+
+typedef struct
+{
+	int             ident;
+	int             version;
+	unsigned        key;
+	int             numShaders;
+	int             numTables;
+	int             textLength;
+} shaderCacheHeader_t;
+
+typedef struct
+{
+	int             hash;
+	int             offset;
+} shaderCacheEntry_t;
+
+/*
+====================
+R_ShaderCacheKey
+
+Checksum of the loaded pk3s and the name and size of every shader file. Loose
+files aren't covered by a pk3 checksum, so their contents are hashed as well.
+=====================
+*/
+static unsigned R_ShaderCacheKey(char **shaderFiles, int numShaderFiles, const char *dir)
+{
+	const char     *paks;
+	char            filename[MAX_QPATH];
+	void           *buffer;
+	unsigned        key;
+	int             i, size;
+
+	paks = ri.FS_LoadedPakChecksums();
+
+	key = R_CacheHash(CACHEHASH_BASIS, paks, strlen(paks));
+	key = R_CacheHash(key, dir, strlen(dir));
+
+	for(i = 0; i < numShaderFiles; i++)
+	{
+		Com_sprintf(filename, sizeof(filename), "%s/%s", dir, shaderFiles[i]);
+
+		if(ri.FS_FileIsInPAK(filename, NULL) == 1)
+		{
+			size = ri.FS_ReadFile(filename, NULL);
+		}
+		else
+		{
+			size = ri.FS_ReadFile(filename, &buffer);
+			if(buffer)
+			{
+				key = R_CacheHash(key, buffer, size);
+				ri.FS_FreeFile(buffer);
+			}
+		}
+
+		key = R_CacheHash(key, filename, strlen(filename));
+		key = R_CacheHash(key, &size, sizeof(size));
+	}
+
+	return key;
+}
+
+/*
+====================
+R_LoadShaderCache
+=====================
+*/
+static qboolean R_LoadShaderCache(unsigned key)
+{
+	shaderCacheHeader_t *header;
+	shaderCacheEntry_t *entries;
+	byte           *buffer;
+	int            *tables;
+	char           *text, *p, *hashMem;
+	int             shaderTextHashTableSizes[MAX_SHADERTEXT_HASH];
+	int             len;
+	int             i;
+
+	if(!r_shaderCache->integer)
+	{
+		return qfalse;
+	}
+
+	len = ri.FS_ReadFile(SHADERCACHE_FILE, (void **)&buffer);
+	if(!buffer)
+	{
+		return qfalse;
+	}
+
+	header = (shaderCacheHeader_t *) buffer;
+	if(len < (int)sizeof(*header) || header->ident != SHADERCACHE_IDENT || header->version != SHADERCACHE_VERSION ||
+	   header->key != key || header->numShaders < 0 || header->numTables < 0 || header->textLength < 0 ||
+	   len != (int)(sizeof(*header) + header->numShaders * sizeof(shaderCacheEntry_t) + header->numTables * sizeof(int)) +
+	   header->textLength + 1)
+	{
+		ri.FS_FreeFile(buffer);
+		return qfalse;
+	}
+
+	entries = (shaderCacheEntry_t *) (buffer + sizeof(*header));
+	tables = (int *)(entries + header->numShaders);
+	text = (char *)(tables + header->numTables);
+
+	if(text[header->textLength])
+	{
+		ri.FS_FreeFile(buffer);
+		return qfalse;
+	}
+
+	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	for(i = 0; i < header->numShaders; i++)
+	{
+		if(entries[i].hash < 0 || entries[i].hash >= MAX_SHADERTEXT_HASH || entries[i].offset < 0 ||
+		   entries[i].offset >= header->textLength)
+		{
+			ri.FS_FreeFile(buffer);
+			return qfalse;
+		}
+		shaderTextHashTableSizes[entries[i].hash]++;
+	}
+
+	for(i = 0; i < header->numTables; i++)
+	{
+		if(tables[i] < 0 || tables[i] >= header->textLength)
+		{
+			ri.FS_FreeFile(buffer);
+			return qfalse;
+		}
+	}
+
+	s_shaderText = (char *)ri.Hunk_Alloc(header->textLength + 1, h_low);
+	Com_Memcpy(s_shaderText, text, header->textLength + 1);
+
+	hashMem = (char *)ri.Hunk_Alloc((header->numShaders + MAX_SHADERTEXT_HASH) * sizeof(char *), h_low);
+	for(i = 0; i < MAX_SHADERTEXT_HASH; i++)
+	{
+		shaderTextHashTable[i] = (char **)hashMem;
+		hashMem = ((char *)hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
+	}
+
+	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	for(i = 0; i < header->numShaders; i++)
+	{
+		shaderTextHashTable[entries[i].hash][shaderTextHashTableSizes[entries[i].hash]++] = s_shaderText + entries[i].offset;
+	}
+
+	for(i = 0; i < header->numTables; i++)
+	{
+		// skip the table keyword
+		p = s_shaderText + tables[i];
+		COM_ParseExt2(&p, qtrue);
+
+		ParseShaderTextTable(&p);
+	}
+
+	ri.Printf(PRINT_ALL, "...loaded %i shaders from %s\n", header->numShaders, SHADERCACHE_FILE);
+
+	ri.FS_FreeFile(buffer);
+
+	return qtrue;
+}
+
+/*
+====================
+R_WriteShaderCache
+=====================
+*/
+static void R_WriteShaderCache(unsigned key, growList_t * tableOffsets)
+{
+	shaderCacheHeader_t *header;
+	shaderCacheEntry_t *entries;
+	byte           *buffer;
+	int            *tables;
+	int             numShaders;
+	int             textLength;
+	int             len;
+	int             i, j;
+
+	if(!r_shaderCache->integer)
+	{
+		return;
+	}
+
+	numShaders = 0;
+	for(i = 0; i < MAX_SHADERTEXT_HASH; i++)
+	{
+		for(j = 0; shaderTextHashTable[i][j]; j++)
+		{
+			numShaders++;
+		}
+	}
+
+	textLength = strlen(s_shaderText);
+
+	len = sizeof(*header) + numShaders * sizeof(shaderCacheEntry_t) + tableOffsets->currentElements * sizeof(int) + textLength + 1;
+	buffer = (byte *) Com_Allocate(len);
+
+	header = (shaderCacheHeader_t *) buffer;
+	header->ident = SHADERCACHE_IDENT;
+	header->version = SHADERCACHE_VERSION;
+	header->key = key;
+	header->numShaders = numShaders;
+	header->numTables = tableOffsets->currentElements;
+	header->textLength = textLength;
+
+	// keep the order inside each hash chain so lookups find the same shader
+	entries = (shaderCacheEntry_t *) (buffer + sizeof(*header));
+	for(i = 0; i < MAX_SHADERTEXT_HASH; i++)
+	{
+		for(j = 0; shaderTextHashTable[i][j]; j++)
+		{
+			entries->hash = i;
+			entries->offset = shaderTextHashTable[i][j] - s_shaderText;
+			entries++;
+		}
+	}
+
+	tables = (int *)entries;
+	for(i = 0; i < tableOffsets->currentElements; i++)
+	{
+		tables[i] = (int)(intptr_t) Com_GrowListElement(tableOffsets, i);
+	}
+
+	Com_Memcpy(tables + tableOffsets->currentElements, s_shaderText, textLength + 1);
+
+	ri.FS_WriteFile(SHADERCACHE_FILE, buffer, len);
+
+	Com_Dealloc(buffer);
+}
+
 /*
 ====================
 ScanAndLoadShaderFiles
@@ -6548,6 +7034,8 @@ static void ScanAndLoadShaderFiles(void)
 	int             shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
 	char            filename[MAX_QPATH];
 	long            sum = 0, summand;
+	unsigned        cacheKey;
+	growList_t      tableOffsets;
 
 	ri.Printf(PRINT_ALL, "----- ScanAndLoadShaderFiles -----\n");
 
@@ -6564,6 +7052,18 @@ static void ScanAndLoadShaderFiles(void)
 		return;
 	}
 
+#if defined(COMPAT_Q3A) || defined(COMPAT_ET)
+	cacheKey = R_ShaderCacheKey(shaderFiles, numShaderFiles, "scripts");
+#else
+	cacheKey = R_ShaderCacheKey(shaderFiles, numShaderFiles, "materials");
+#endif
+
+	if(R_LoadShaderCache(cacheKey))
+	{
+		ri.FS_FreeFileList(shaderFiles);
+		return;
+	}
+
 	// build single large buffer
 	for(i = 0; i < numShaderFiles; i++)
 	{
@@ -6728,6 +7228,7 @@ static void ScanAndLoadShaderFiles(void)
 	}
 
 	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
+	Com_InitGrowList(&tableOffsets, 64);
 
 	p = s_shaderText;
 
@@ -6742,73 +7243,8 @@ static void ScanAndLoadShaderFiles(void)
 		// parse shader tables
 		if(!Q_stricmp(token, "table"))
 		{
-			int             depth;
-			float           values[FUNCTABLE_SIZE];
-			int             numValues;
-			shaderTable_t  *tb;
-			qboolean        alreadyCreated;
-
-			Com_Memset(&table, 0, sizeof(table));
-
-			token = COM_ParseExt2(&p, qtrue);
-
-			Q_strncpyz(table.name, token, sizeof(table.name));
-
-			// check if already created
-			alreadyCreated = qfalse;
-			hash = generateHashValue(table.name, MAX_SHADERTABLE_HASH);
-			for(tb = shaderTableHashTable[hash]; tb; tb = tb->next)
-			{
-				if(Q_stricmp(tb->name, table.name) == 0)
-				{
-					// match found
-					alreadyCreated = qtrue;
-					break;
-				}
-			}
-
-			depth = 0;
-			numValues = 0;
-			do
-			{
-				token = COM_ParseExt2(&p, qtrue);
-
-				if(!Q_stricmp(token, "snap"))
-				{
-					table.snap = qtrue;
-				}
-				else if(!Q_stricmp(token, "clamp"))
-				{
-					table.clamp = qtrue;
-				}
-				else if(token[0] == '{')
-				{
-					depth++;
-				}
-				else if(token[0] == '}')
-				{
-					depth--;
-				}
-				else if(token[0] == ',')
-				{
-					continue;
-				}
-				else
-				{
-					if(numValues == FUNCTABLE_SIZE)
-					{
-						ri.Printf(PRINT_WARNING, "WARNING: FUNCTABLE_SIZE hit\n");
-						break;
-					}
-					values[numValues++] = atof(token);
-				}
-			} while(depth && p);
-
-			if(!alreadyCreated)
-			{
-				ri.Printf(PRINT_DEVELOPER, "...generating '%s'\n", table.name);
-				GeneratePermanentShaderTable(values, numValues);
-			}
+			Com_AddToGrowList(&tableOffsets, (void *)(intptr_t) (oldp - s_shaderText));
+			ParseShaderTextTable(&p);
 		}
 		// support shader templates
 		else if(!Q_stricmp(token, "guide"))
@@ -6860,6 +7296,9 @@ static void ScanAndLoadShaderFiles(void)
 			SkipBracedSection(&p);
 		}
 	}
+
+	R_WriteShaderCache(cacheKey, &tableOffsets);
+	Com_DestroyGrowList(&tableOffsets);
 }
 
 
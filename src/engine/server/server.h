@@ -556,6 +556,16 @@ void            SV_Heartbeat_f(void);
 qboolean        SV_TempBanIsBanned(netadr_t address);
 void            SV_TempBanNetAddress(netadr_t address, int length);
 
+//
+// sv_demo.c
+//
+void            SV_DemoRecord_f(void);
+void            SV_DemoStopRecord_f(void);
+void            SV_DemoStopRecord(void);
+void            SV_DemoServerCommand(client_t * client, const char *cmd);
+void            SV_DemoConfigstring(int index);
+void            SV_DemoWriteFrame(void);
+
 //
 // sv_snapshot.c
 //
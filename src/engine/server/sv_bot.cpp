@@ -43,6 +43,7 @@ static bot_debugpoly_t debugpolygons[MAX_DEBUGPOLYS];
 
 extern botlib_export_t *botlib_export;
 int             bot_enable;
+static convar_t *bot_maxroutingcache, *bot_routingcachestats, *bot_batchtraveltimes;
 
 /*
 ==================
@@ -283,6 +284,96 @@ void BotImport_EntityTrace(bsp_trace_t * bsptrace, vec3_t start, vec3_t mins, ve
 }
 
 
+#define MAX_BOTLIB_THREADS		32
+
+typedef struct {
+	cmTraceContext_t *ctx;
+	void            (*func) (int index, void *data);
+	void           *data;
+	int             first;
+	int             count;
+	int             stride;
+} botParallelWork_t;
+
+/*
+==================
+BotImport_ParallelThread
+==================
+*/
+static int BotImport_ParallelThread(void *data) {
+	botParallelWork_t *w = (botParallelWork_t *)data;
+	int             i;
+
+	CM_SetThreadTraceContext(w->ctx);
+
+	// interleaved so work that gets cheaper with the index stays balanced
+	for(i = w->first; i < w->count; i += w->stride) {
+		w->func(i, w->data);
+	}
+
+	CM_SetThreadTraceContext(NULL);
+	return 0;
+}
+
+/*
+==================
+BotImport_ParallelFor
+
+Used for the load time AAS builds, every worker gets its own collision trace context
+==================
+*/
+void BotImport_ParallelFor(int count, void (*func) (int index, void *data), void *data) {
+	botParallelWork_t work[MAX_BOTLIB_THREADS];
+	void           *handles[MAX_BOTLIB_THREADS];
+	int             numThreads, i;
+
+	numThreads = Cvar_VariableIntegerValue("bot_loadthreads");
+	if(numThreads <= 0) {
+		numThreads = Sys_ProcessorCount();
+	}
+	numThreads = Com_Clamp(1, MAX_BOTLIB_THREADS, numThreads);
+	if(numThreads > count) {
+		numThreads = count;
+	}
+
+	if(numThreads <= 1) {
+		for(i = 0; i < count; i++) {
+			func(i, data);
+		}
+		return;
+	}
+
+	// the trace contexts have to be created and freed on the main thread
+	for(i = 0; i < numThreads; i++) {
+		work[i].ctx = i ? CM_CreateTraceContext() : NULL;
+		work[i].func = func;
+		work[i].data = data;
+		work[i].first = i;
+		work[i].count = count;
+		work[i].stride = numThreads;
+	}
+
+	// the main thread does the first slice with its own context
+	handles[0] = NULL;
+	for(i = 1; i < numThreads; i++) {
+		handles[i] = Sys_CreateThread(BotImport_ParallelThread, &work[i]);
+	}
+
+	for(i = 0; i < work[0].count; i += work[0].stride) {
+		func(i, data);
+	}
+
+	for(i = 1; i < numThreads; i++) {
+		if(handles[i]) {
+			Sys_JoinThread(handles[i]);
+		} else {
+			// couldn't start the thread, run its slice here instead
+			BotImport_ParallelThread(&work[i]);
+		}
+		CM_FreeTraceContext(work[i].ctx);
+	}
+}
+
 /*
 ==================
 BotImport_PointContents
@@ -561,6 +652,19 @@ void SV_BotFrame(int time) {
 	if(!gvm) {
 		return;
 	}
+	// routing cache budget, statistics and batched travel times can be changed while bots are running
+	if(bot_maxroutingcache && bot_maxroutingcache->modified) {
+		botlib_export->BotLibVarSet("max_routingcache", bot_maxroutingcache->string);
+		bot_maxroutingcache->modified = qfalse;
+	}
+	if(bot_routingcachestats && bot_routingcachestats->modified) {
+		botlib_export->BotLibVarSet("bot_routingcachestats", bot_routingcachestats->string);
+		bot_routingcachestats->modified = qfalse;
+	}
+	if(bot_batchtraveltimes && bot_batchtraveltimes->modified) {
+		botlib_export->BotLibVarSet("bot_batchtraveltimes", bot_batchtraveltimes->string);
+		bot_batchtraveltimes->modified = qfalse;
+	}
 	VM_Call(gvm, BOTAI_START_FRAME, time);
 }
 
@@ -597,6 +701,19 @@ int SV_BotLibSetup(void) {
 	}
 	botlib_export->BotLibVarSet("bot_frameroutingupdates", bot_frameroutingupdates->string);
 
+	// routing cache memory budget in KB
+	bot_maxroutingcache = Cvar_Get("bot_maxroutingcache", "16384", 0, "Maximum amount of memory in KB used for bot routing caches");
+	botlib_export->BotLibVarSet("max_routingcache", bot_maxroutingcache->string);
+	bot_maxroutingcache->modified = qfalse;
+	bot_routingcachestats = Cvar_Get("bot_routingcachestats", "0", 0, "Print bot routing cache hits, misses and evictions every frame");
+	botlib_export->BotLibVarSet("bot_routingcachestats", bot_routingcachestats->string);
+	bot_routingcachestats->modified = qfalse;
+
+	// batched travel times for item goal selection, 2 compares them with the routing cache
+	bot_batchtraveltimes = Cvar_Get("bot_batchtraveltimes", "1", 0, "Share the routes to the cluster portals between the travel times to all item goals");
+	botlib_export->BotLibVarSet("bot_batchtraveltimes", bot_batchtraveltimes->string);
+	bot_batchtraveltimes->modified = qfalse;
+
 // START    Arnout changes, 28-08-2002.
 // added single player
 	return botlib_export->BotLibSetup((qboolean)(SV_GameIsSinglePlayer() || SV_GameIsCoop()));
@@ -639,6 +756,7 @@ void SV_BotInitCvars(void) {
 	Cvar_Get("bot_grapple", "0", 0, "test");			//enable grapple
 	Cvar_Get("bot_rocketjump", "0", 0, "test");			//enable rocket jumping
 	Cvar_Get("bot_norcd", "0", 0, "test");				//enable creation of RCD file
+	Cvar_Get("bot_loadthreads", "0", 0, "Number of threads used to build the AAS visibility at map load, 0 uses all processors");
 
 	bot_enable = Cvar_VariableIntegerValue("bot_enable");
 }
@@ -704,6 +822,7 @@ void SV_BotInitBotLib(void) {
 	botlib_import.BotCheckAttackAtPos = BotImport_BotCheckAttackAtPos;
 
 	botlib_import.BotDrawPolygon = BotImport_DrawPolygon;
+	botlib_import.ParallelFor = BotImport_ParallelFor;
 
 	// singleplayer check
 	// Arnout: no need for this
@@ -463,6 +463,8 @@ static void SV_MapRestart_f(void) {
 	sv.state = SS_GAME;
 	sv.restarting = qfalse;
 
+	SV_DemoServerCommand(NULL, "map_restart\n");
+
 	// connect and begin all the clients
 	for(i = 0; i < sv_maxclients->integer; i++) {
 		client = &svs.clients[i];
@@ -968,4 +970,6 @@ void SV_AddOperatorCommands(void) {
 		Cmd_AddCommand("say", SV_ConSay_f, "^1Say something to everyone on the server.");
 	}
 	Cmd_AddCommand("rehashrconwhitelist", SV_RehashRconWhitelist_f, "^1Load RCON whitelist from file.");
+	Cmd_AddCommand("sv_record", SV_DemoRecord_f, "^1Records a demo of all clients on the server.");
+	Cmd_AddCommand("sv_stoprecord", SV_DemoStopRecord_f, "^1Stop recording a server demo.");
 }
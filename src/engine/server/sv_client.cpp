@@ -1319,7 +1319,8 @@ into a more C friendly form.
 =================
 */
 void SV_UserinfoChanged(client_t * cl) {
-	char           *val;
+	static infoCache_t info;
+	const char     *val;
 	int             i;
 
 	// In the ugly [commented out] code below, handicap is supposed to be
@@ -1338,8 +1339,11 @@ void SV_UserinfoChanged(client_t * cl) {
 		oldInfoLen = newInfoLen;
 	}
 
+	// parse the userinfo once for all the keys below
+	Info_CacheParse(&info, cl->userinfo);
+
 	// name for C code
-	Q_strncpyz(cl->name, Info_ValueForKey(cl->userinfo, "name"), sizeof(cl->name));
+	Q_strncpyz(cl->name, Info_CacheValueForKey(&info, cl->userinfo, "name"), sizeof(cl->name));
 
 	// rate command
 	// if the client is on the same subnet as the server and we aren't running an
@@ -1347,7 +1351,7 @@ void SV_UserinfoChanged(client_t * cl) {
 	if(Sys_IsLANAddress(cl->netchan.remoteAddress) && com_dedicated->integer != 2 && sv_lanForceRate->integer == 1) {
 		cl->rate = 99999; // lans should not rate limit
 	} else {
-		val = Info_ValueForKey(cl->userinfo, "rate");
+		val = Info_CacheValueForKey(&info, cl->userinfo, "rate");
 		if(strlen(val)) {
 			i = atoi(val);
 			cl->rate = i;
@@ -1361,18 +1365,19 @@ void SV_UserinfoChanged(client_t * cl) {
 		}
 	}
 	
-	val = Info_ValueForKey(cl->userinfo, "handicap");
+	val = Info_CacheValueForKey(&info, cl->userinfo, "handicap");
 	if(strlen(val))
 	{
 		i = atoi(val);
 		if(i <= -100 || i > 100 || strlen(val) > 4)
 		{
 			Info_SetValueForKey(cl->userinfo, "handicap", "0");
+			Info_CacheInvalidate(&info);
 		}
 	}
 
 	// snaps command
-	val = Info_ValueForKey(cl->userinfo, "snaps");
+	val = Info_CacheValueForKey(&info, cl->userinfo, "snaps");
 	if(strlen(val)) {
 		i = atoi(val);
 		if(i < 1) {
@@ -1388,7 +1393,7 @@ void SV_UserinfoChanged(client_t * cl) {
 #ifdef USE_VOIP
 	// in the future, (val) will be a protocol version string, so only
 	//  accept explicitly 1, not generally non-zero.
-	val = Info_ValueForKey (cl->userinfo, "cl_voip");
+	val = Info_CacheValueForKey(&info, cl->userinfo, "cl_voip");
 	cl->hasVoip = (atoi(val) == 1) ? qtrue : qfalse;
 #endif	
 	
@@ -1405,10 +1410,11 @@ void SV_UserinfoChanged(client_t * cl) {
 		// force the "ip" info key to "localhost" for local clients
 		Info_SetValueForKey(cl->userinfo, "ip", "localhost");
 	}
+	Info_CacheInvalidate(&info);
 
 	// TTimo
 	// download prefs of the client
-	val = Info_ValueForKey(cl->userinfo, "cl_wwwDownload");
+	val = Info_CacheValueForKey(&info, cl->userinfo, "cl_wwwDownload");
 	cl->bDlOK = qfalse;
 	if(strlen(val)) {
 		i = atoi(val);
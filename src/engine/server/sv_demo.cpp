@@ -0,0 +1,526 @@
+/*
+===========================================================================
+
+OpenWolf GPL Source Code
+Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company. 
+
+This file is part of the OpenWolf GPL Source Code (OpenWolf Source Code).  
+
+OpenWolf Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OpenWolf Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenWolf Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the OpenWolf Source Code is also subject to certain additional terms. 
+You should have received a copy of these additional terms immediately following the 
+terms and conditions of the GNU General Public License which accompanied the OpenWolf 
+Source Code.  If not, please request a copy in writing from id Software at the address 
+below.
+
+If you have questions concerning this license or the applicable additional terms, you 
+may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, 
+Maryland 20850 USA.
+
+===========================================================================
+*/
+
+// sv_demo.c -- server side demo recording
+
+#include "../idLib/precompiled.h"
+#include "server.h"
+
+/*
+=============================================================================
+
+Server side demos record the whole game once instead of one client's view
+of it: every frame the playerstates of all active clients are delta
+compressed against their last frame and all entities a client could see
+against the entities of the last frame.  The client demo player turns
+this back into snapshots for the client it plays the demo from.
+
+SV_Frame only encodes into blocks of a ring, a writer thread owns the demo
+file and puts the blocks on disk.  FS_Write doesn't touch anything but
+the handle, which belongs to the writer until the recording stops.
+
+=============================================================================
+*/
+
+#define SVDEMO_QUEUE		16			// must be a power of two
+
+typedef struct {
+	int				size;
+	byte			data[SVDEMO_BLOCKLEN];
+} svDemoBlock_t;
+
+typedef struct {
+	qboolean		recording;
+	fileHandle_t	file;
+	char			name[MAX_OSPATH];
+
+	svDemoBlock_t	*blocks;					// [SVDEMO_QUEUE]
+	unsigned int	write;						// main thread only
+	volatile unsigned int commit;				// published by the main thread
+	volatile unsigned int read;					// published by the writer thread
+	void			*thread;
+	volatile int	quit;
+
+	msg_t			msg;						// the block being encoded
+	qboolean		blockOpen;
+
+	int				lastTime;
+	qboolean		psValid[MAX_CLIENTS];
+	playerState_t	ps[MAX_CLIENTS];
+	entityState_t	entities[2][MAX_GENTITIES];	// this and the last frame
+	int				numEntities[2];
+	int				current;
+
+	int				frames;
+	int				bytes;
+	int				stalls;
+	int				startTime;
+} svDemo_t;
+
+static svDemo_t svDemo;
+
+/*
+==================
+SV_DemoWriterThread
+==================
+*/
+static int SV_DemoWriterThread(void *data) {
+	svDemoBlock_t	*block;
+	unsigned int	commit;
+	int				len, quit;
+
+	while(1) {
+		quit = svDemo.quit;
+		commit = svDemo.commit;
+		Sys_MemoryBarrier();
+
+		while(svDemo.read != commit) {
+			block = &svDemo.blocks[svDemo.read & (SVDEMO_QUEUE - 1)];
+			len = LittleLong(block->size);
+			FS_Write(&len, 4, svDemo.file);
+			FS_Write(block->data, block->size, svDemo.file);
+
+			Sys_MemoryBarrier();
+			svDemo.read = svDemo.read + 1;
+		}
+
+		// the quit flag was read before the last commit, nothing follows it
+		if(quit) {
+			break;
+		}
+		Sys_Sleep(1);
+	}
+
+	return 0;
+}
+
+/*
+==================
+SV_DemoOpenBlock
+
+Starts encoding a block into the next free slot of the ring
+==================
+*/
+static msg_t *SV_DemoOpenBlock(void) {
+	svDemoBlock_t	*block;
+
+	if(svDemo.blockOpen) {
+		return &svDemo.msg;
+	}
+
+	// only waits when the disk can't keep up with a full ring
+	if(svDemo.write - svDemo.read >= SVDEMO_QUEUE) {
+		svDemo.stalls++;
+		while(svDemo.write - svDemo.read >= SVDEMO_QUEUE) {
+			Sys_Sleep(1);
+		}
+		Sys_MemoryBarrier();
+	}
+
+	block = &svDemo.blocks[svDemo.write & (SVDEMO_QUEUE - 1)];
+	MSG_Init(&svDemo.msg, block->data, sizeof(block->data));
+	MSG_Bitstream(&svDemo.msg);
+	svDemo.blockOpen = qtrue;
+
+	return &svDemo.msg;
+}
+
+/*
+==================
+SV_DemoCloseBlock
+
+Hands the block over to the writer thread
+==================
+*/
+static void SV_DemoCloseBlock(void) {
+	svDemoBlock_t	*block;
+
+	if(!svDemo.blockOpen) {
+		return;
+	}
+	svDemo.blockOpen = qfalse;
+
+	MSG_WriteByte(&svDemo.msg, svdm_EOF);
+	if(svDemo.msg.overflowed) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: server demo frame overflowed, stopping the recording\n");
+		SV_DemoStopRecord();
+		return;
+	}
+
+	block = &svDemo.blocks[svDemo.write & (SVDEMO_QUEUE - 1)];
+	block->size = svDemo.msg.cursize;
+	svDemo.bytes += block->size + 4;
+	svDemo.write++;
+
+	Sys_MemoryBarrier();
+	svDemo.commit = svDemo.write;
+}
+
+/*
+==================
+SV_DemoWriteGamestate
+==================
+*/
+static void SV_DemoWriteGamestate(void) {
+	msg_t			*msg;
+	entityState_t	nullstate, *base;
+	int				i;
+
+	msg = SV_DemoOpenBlock();
+
+	MSG_WriteByte(msg, svdm_gamestate);
+	MSG_WriteLong(msg, sv.checksumFeed);
+
+	for(i = 0; i < MAX_CONFIGSTRINGS; i++) {
+		if(!sv.configstrings[i].s[0]) {
+			continue;
+		}
+		MSG_WriteShort(msg, i);
+		MSG_WriteBigString(msg, sv.configstrings[i].s);
+	}
+	MSG_WriteShort(msg, MAX_CONFIGSTRINGS);
+
+	Com_Memset(&nullstate, 0, sizeof(nullstate));
+	for(i = 0; i < MAX_GENTITIES; i++) {
+		base = &sv.svEntities[i].baseline;
+		if(!base->number) {
+			continue;
+		}
+		MSG_WriteDeltaEntity(msg, &nullstate, base, qtrue);
+	}
+	MSG_WriteBits(msg, (MAX_GENTITIES - 1), GENTITYNUM_BITS);
+
+	SV_DemoCloseBlock();
+}
+
+/*
+==================
+SV_DemoRecord
+==================
+*/
+static void SV_DemoRecord(const char *name) {
+	int				header[3];
+
+	if(svDemo.recording) {
+		Com_Printf("Already recording a server demo.\n");
+		return;
+	}
+
+	if(sv.state != SS_GAME) {
+		Com_Printf("The server must be running a map to record.\n");
+		return;
+	}
+
+	Com_Memset(&svDemo, 0, sizeof(svDemo));
+
+	svDemo.file = FS_FOpenFileWrite(name);
+	if(!svDemo.file) {
+		Com_Printf("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+	Q_strncpyz(svDemo.name, name, sizeof(svDemo.name));
+
+	header[0] = LittleLong(SVDEMO_MAGIC);
+	header[1] = LittleLong(com_protocol->integer);
+	header[2] = LittleLong(sv_maxclients->integer);
+	FS_Write(header, sizeof(header), svDemo.file);
+	svDemo.bytes = sizeof(header);
+
+	// from here on the file belongs to the writer thread
+	svDemo.blocks = (svDemoBlock_t *)Z_Malloc(sizeof(svDemoBlock_t) * SVDEMO_QUEUE);
+	Sys_MemoryBarrier();
+
+	svDemo.thread = Sys_CreateThread(SV_DemoWriterThread, NULL);
+	if(!svDemo.thread) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: couldn't start the server demo writer thread\n");
+		Z_Free(svDemo.blocks);
+		FS_FCloseFile(svDemo.file);
+		Com_Memset(&svDemo, 0, sizeof(svDemo));
+		return;
+	}
+
+	svDemo.recording = qtrue;
+	svDemo.startTime = svs.time;
+	svDemo.lastTime = svs.time;
+
+	Com_Printf("recording server demo to %s.\n", name);
+
+	SV_DemoWriteGamestate();
+}
+
+/*
+==================
+SV_DemoStopRecord
+
+Waits for the writer thread to put the rest of the demo on disk
+==================
+*/
+void SV_DemoStopRecord(void) {
+	if(!svDemo.recording) {
+		return;
+	}
+
+	// commands recorded since the last frame
+	SV_DemoCloseBlock();
+	svDemo.recording = qfalse;
+
+	Sys_MemoryBarrier();
+	svDemo.quit = 1;
+	Sys_JoinThread(svDemo.thread);
+	svDemo.thread = NULL;
+
+	FS_FCloseFile(svDemo.file);
+	svDemo.file = 0;
+	Z_Free(svDemo.blocks);
+	svDemo.blocks = NULL;
+
+	Com_Printf("Stopped server demo %s: %i frames, %i seconds, %i KB, %i stalls.\n", svDemo.name, svDemo.frames,
+			   (svDemo.lastTime - svDemo.startTime) / 1000, svDemo.bytes / 1024, svDemo.stalls);
+}
+
+/*
+==================
+SV_DemoServerCommand
+
+Records a reliable command for one client, or for everyone
+==================
+*/
+void SV_DemoServerCommand(client_t *client, const char *cmd) {
+	msg_t			*msg;
+
+	if(!svDemo.recording) {
+		return;
+	}
+
+	msg = SV_DemoOpenBlock();
+	MSG_WriteByte(msg, svdm_serverCommand);
+	MSG_WriteByte(msg, client ? client - svs.clients : SVDEMO_BROADCAST);
+	MSG_WriteString(msg, cmd);
+}
+
+/*
+==================
+SV_DemoConfigstring
+
+Records a configstring change, once instead of the per client commands
+==================
+*/
+void SV_DemoConfigstring(int index) {
+	msg_t			*msg;
+
+	if(!svDemo.recording) {
+		return;
+	}
+
+	msg = SV_DemoOpenBlock();
+	MSG_WriteByte(msg, svdm_configstring);
+	MSG_WriteShort(msg, index);
+	MSG_WriteBigString(msg, sv.configstrings[index].s);
+}
+
+/*
+==================
+SV_DemoWriteEntities
+
+Delta compresses the entities of this frame against the last one
+==================
+*/
+static void SV_DemoWriteEntities(msg_t *msg, entityState_t *from, int numFrom, entityState_t *to, int numTo) {
+	entityState_t	*oldent, *newent;
+	int				oldindex, newindex, oldnum, newnum;
+
+	newent = NULL;
+	oldent = NULL;
+	newindex = 0;
+	oldindex = 0;
+	while(newindex < numTo || oldindex < numFrom) {
+		if(newindex >= numTo) {
+			newnum = 9999;
+		} else {
+			newent = &to[newindex];
+			newnum = newent->number;
+		}
+
+		if(oldindex >= numFrom) {
+			oldnum = 9999;
+		} else {
+			oldent = &from[oldindex];
+			oldnum = oldent->number;
+		}
+
+		if(newnum == oldnum) {
+			MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			oldindex++;
+			newindex++;
+			continue;
+		}
+
+		if(newnum < oldnum) {
+			MSG_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
+			newindex++;
+			continue;
+		}
+
+		MSG_WriteDeltaEntity(msg, oldent, NULL, qtrue);
+		oldindex++;
+	}
+
+	MSG_WriteBits(msg, (MAX_GENTITIES - 1), GENTITYNUM_BITS);	// end of packetentities
+}
+
+/*
+==================
+SV_DemoWriteFrame
+
+Called after the game ran, records the frame it produced
+==================
+*/
+void SV_DemoWriteFrame(void) {
+	msg_t			*msg;
+	client_t		*cl;
+	sharedEntity_t	*ent;
+	entityState_t	*entities;
+	int				i, numEntities, previous;
+
+	if(!svDemo.recording || svs.time == svDemo.lastTime) {
+		return;
+	}
+	svDemo.lastTime = svs.time;
+
+	msg = SV_DemoOpenBlock();
+	MSG_WriteByte(msg, svdm_frame);
+	MSG_WriteLong(msg, svs.time);
+	MSG_WriteByte(msg, svs.snapFlagServerBit);
+
+	// the playerstates of everyone in the game
+	for(i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++) {
+		if(cl->state != CS_ACTIVE || !cl->gentity) {
+			svDemo.psValid[i] = qfalse;
+			MSG_WriteBits(msg, 0, 1);
+			continue;
+		}
+
+		MSG_WriteBits(msg, 1, 1);
+		MSG_WriteDeltaPlayerstate(msg, svDemo.psValid[i] ? &svDemo.ps[i] : NULL, SV_GameClientNum(i));
+		svDemo.ps[i] = *SV_GameClientNum(i);
+		svDemo.psValid[i] = qtrue;
+	}
+
+	// every entity that could be sent to some client, the visibility
+	// checks are left to the playback
+	previous = svDemo.current;
+	svDemo.current ^= 1;
+	entities = svDemo.entities[svDemo.current];
+	numEntities = 0;
+	for(i = 0; i < sv.num_entities; i++) {
+		ent = SV_GentityNum(i);
+		if(!ent->r.linked || (ent->r.svFlags & SVF_NOCLIENT)) {
+			continue;
+		}
+		entities[numEntities] = ent->s;
+		entities[numEntities].number = i;
+		numEntities++;
+	}
+	svDemo.numEntities[svDemo.current] = numEntities;
+
+	SV_DemoWriteEntities(msg, svDemo.entities[previous], svDemo.numEntities[previous], entities, numEntities);
+
+	// the entities that only some clients get
+	for(i = 0; i < numEntities; i++) {
+		ent = SV_GentityNum(entities[i].number);
+		if(ent->r.svFlags & SVF_SINGLECLIENT) {
+			MSG_WriteBits(msg, entities[i].number, GENTITYNUM_BITS);
+			MSG_WriteByte(msg, SVDEMO_FILTER_SINGLE);
+			MSG_WriteByte(msg, ent->r.singleClient);
+		} else if(ent->r.svFlags & SVF_NOTSINGLECLIENT) {
+			MSG_WriteBits(msg, entities[i].number, GENTITYNUM_BITS);
+			MSG_WriteByte(msg, SVDEMO_FILTER_NOTSINGLE);
+			MSG_WriteByte(msg, ent->r.singleClient);
+		} else if(ent->r.svFlags & SVF_CLIENTMASK) {
+			MSG_WriteBits(msg, entities[i].number, GENTITYNUM_BITS);
+			MSG_WriteByte(msg, SVDEMO_FILTER_MASK);
+			MSG_WriteLong(msg, ent->r.loMask);
+			MSG_WriteLong(msg, ent->r.hiMask);
+		}
+	}
+	MSG_WriteBits(msg, (MAX_GENTITIES - 1), GENTITYNUM_BITS);
+
+	svDemo.frames++;
+	SV_DemoCloseBlock();
+}
+
+/*
+==================
+SV_DemoRecord_f
+
+sv_record [demoname]
+==================
+*/
+void SV_DemoRecord_f(void) {
+	char			name[MAX_OSPATH];
+	int				number;
+
+	if(Cmd_Argc() > 2) {
+		Com_Printf("sv_record [demoname]\n");
+		return;
+	}
+
+	if(Cmd_Argc() == 2) {
+		Com_sprintf(name, sizeof(name), "demos/%s.svdm_%d", Cmd_Argv(1), com_protocol->integer);
+	} else {
+		// scan for a free demo name
+		for(number = 0; number <= 9999; number++) {
+			Com_sprintf(name, sizeof(name), "demos/server%04i.svdm_%d", number, com_protocol->integer);
+			if(!FS_FileExists(name)) {
+				break;
+			}
+		}
+	}
+
+	SV_DemoRecord(name);
+}
+
+/*
+==================
+SV_DemoStopRecord_f
+==================
+*/
+void SV_DemoStopRecord_f(void) {
+	if(!svDemo.recording) {
+		Com_Printf("Not recording a server demo.\n");
+		return;
+	}
+
+	SV_DemoStopRecord();
+}
@@ -202,6 +202,7 @@ void SV_SetConfigstring (int index, const char *val) {
 	// change the string in sv
 	Z_Free( sv.configstrings[index].s );
 	sv.configstrings[index].s = CopyString( val );
+	SV_DemoConfigstring( index );
 
 	// send it to all the clients if we aren't
 	// spawning a new server
@@ -612,6 +613,9 @@ void SV_SpawnServer(char *server, qboolean killBots) {
 	}
 #endif
 
+	// a server demo ends with its map
+	SV_DemoStopRecord();
+
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
 
@@ -1168,6 +1172,7 @@ void SV_Shutdown(char *finalmsg) {
 		SV_FinalCommand(va("print \"%s\"", finalmsg), qtrue);
 	}
 
+	SV_DemoStopRecord();
 	SV_MasterShutdown();
 	SV_ShutdownGameProgs();
 
@@ -243,10 +243,16 @@ void QDECL SV_SendServerCommand(client_t * cl, const char *fmt, ...) {
 	}
 
 	if(cl != NULL) {
+		// server demos record configstrings as they change
+		if(strncmp((char *)message, "cs ", 3) && strncmp((char *)message, "bcs", 3)) {
+			SV_DemoServerCommand(cl, (char *)message);
+		}
 		SV_AddServerCommand(cl, (char *)message);
 		return;
 	}
 
+	SV_DemoServerCommand(NULL, (char *)message);
+
 	// hack to echo broadcast prints to console
 	if(com_dedicated->integer && !strncmp((char *)message, "print", 5)) {
 		Com_Printf("broadcast: %s\n", SV_ExpandNewlines((char *)message));
@@ -1571,6 +1577,8 @@ void SV_Frame(int msec) {
 		time_game = Sys_Milliseconds() - startTime;
 	}
 
+	SV_DemoWriteFrame();
+
 	// check timeouts
 	SV_CheckTimeouts();
 
@@ -52,6 +52,22 @@ char    *S_FileExtension(const char *fni)
 }
 
 
+/*
+=================
+S_CodecOpen
+
+Loads the sound when info is given, opens it as a stream otherwise
+=================
+*/
+static void *S_CodecOpen(snd_codec_t *codec, const char *filename, snd_info_t *info, qboolean memory)
+{
+	if( info )
+		return codec->load(filename, info);
+	if( memory )
+		return codec->openMemory(filename);
+	return codec->open(filename);
+}
+
 /*
 =================
 S_CodecGetSound
@@ -60,7 +76,7 @@ Opens/loads a sound, tries codec based on the sound's file extension
 then tries all supported codecs.
 =================
 */
-static void *S_CodecGetSound(const char *filename, snd_info_t *info)
+static void *S_CodecGetSound(const char *filename, snd_info_t *info, qboolean memory)
 {
 	snd_codec_t *codec;
 	snd_codec_t *orgCodec = NULL;
@@ -82,10 +98,7 @@ static void *S_CodecGetSound(const char *filename, snd_info_t *info)
 			if( !Q_stricmp( ext, codec->ext ) )
 			{
 				// Load
-				if( info )
-					rtn = codec->load(localName, info);
-				else
-					rtn = codec->open(localName);
+				rtn = S_CodecOpen(codec, localName, info, memory);
 				break;
 			}
 		}
@@ -119,10 +132,7 @@ static void *S_CodecGetSound(const char *filename, snd_info_t *info)
 		Com_sprintf( altName, sizeof (altName), "%s.%s", localName, codec->ext );
 
 		// Load
-		if( info )
-			rtn = codec->load(altName, info);
-		else
-			rtn = codec->open(altName);
+		rtn = S_CodecOpen(codec, altName, info, memory);
 
 		if( rtn )
 		{
@@ -186,7 +196,7 @@ S_CodecLoad
 */
 void *S_CodecLoad(const char *filename, snd_info_t *info)
 {
-	return S_CodecGetSound(filename, info);
+	return S_CodecGetSound(filename, info, qfalse);
 }
 
 /*
@@ -196,7 +206,21 @@ S_CodecOpenStream
 */
 snd_stream_t *S_CodecOpenStream(const char *filename)
 {
-	return (snd_stream_t*)S_CodecGetSound(filename, NULL);
+	return (snd_stream_t*)S_CodecGetSound(filename, NULL, qfalse);
+}
+
+/*
+=================
+S_CodecOpenMemoryStream
+
+Like S_CodecOpenStream, but the whole file is read in first.  Reading and
+decoding such a stream doesn't touch the filesystem or the zone, so it may
+be done by any one thread at a time; opening and closing it may not.
+=================
+*/
+snd_stream_t *S_CodecOpenMemoryStream(const char *filename)
+{
+	return (snd_stream_t*)S_CodecGetSound(filename, NULL, qtrue);
 }
 
 void S_CodecCloseStream(snd_stream_t *stream)
@@ -243,6 +267,52 @@ snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec)
 	stream->codec = codec;
 	stream->file = hnd;
 	stream->length = length;
+	stream->buffer = NULL;
+	return stream;
+}
+
+/*
+=================
+S_CodecUtilOpenMemory
+=================
+*/
+snd_stream_t *S_CodecUtilOpenMemory(const char *filename, snd_codec_t *codec)
+{
+	snd_stream_t *stream;
+	fileHandle_t hnd;
+	int length;
+
+	// Try to open the file
+	length = FS_FOpenFileRead(filename, &hnd, qtrue);
+	if(!hnd)
+	{
+		Com_DPrintf("Can't read sound file %s\n", filename);
+		return NULL;
+	}
+
+	if(length <= 0)
+	{
+		FS_FCloseFile(hnd);
+		return NULL;
+	}
+
+	// Allocate a stream and read the whole file into it
+	stream = (snd_stream_t*)Z_Malloc(sizeof(snd_stream_t) + length);
+	if(!stream)
+	{
+		FS_FCloseFile(hnd);
+		return NULL;
+	}
+
+	stream->buffer = (byte *)(stream + 1);
+	length = FS_Read(stream->buffer, length, hnd);
+	FS_FCloseFile(hnd);
+
+	// Copy over, return
+	stream->codec = codec;
+	stream->file = 0;
+	stream->length = length;
+	stream->bufferPos = 0;
 	return stream;
 }
 
@@ -253,7 +323,75 @@ S_CodecUtilClose
 */
 void S_CodecUtilClose(snd_stream_t **stream)
 {
-	FS_FCloseFile((*stream)->file);
+	if(!(*stream)->buffer)
+		FS_FCloseFile((*stream)->file);
 	Z_Free(*stream);
 	*stream = NULL;
 }
+
+/*
+=================
+S_CodecUtilRead
+=================
+*/
+int S_CodecUtilRead(snd_stream_t *stream, void *buffer, int len)
+{
+	if(!stream->buffer)
+		return FS_Read(buffer, len, stream->file);
+
+	if(len > stream->length - stream->bufferPos)
+		len = stream->length - stream->bufferPos;
+	if(len <= 0)
+		return 0;
+
+	Com_Memcpy(buffer, stream->buffer + stream->bufferPos, len);
+	stream->bufferPos += len;
+	return len;
+}
+
+/*
+=================
+S_CodecUtilSeek
+=================
+*/
+int S_CodecUtilSeek(snd_stream_t *stream, long offset, int origin)
+{
+	long pos;
+
+	if(!stream->buffer)
+		return FS_Seek(stream->file, offset, origin);
+
+	switch(origin)
+	{
+		case FS_SEEK_SET:
+			pos = offset;
+			break;
+		case FS_SEEK_CUR:
+			pos = stream->bufferPos + offset;
+			break;
+		case FS_SEEK_END:
+			pos = stream->length + offset;
+			break;
+		default:
+			return -1;
+	}
+
+	if(pos < 0 || pos > stream->length)
+		return -1;
+
+	stream->bufferPos = (int)pos;
+	return 0;
+}
+
+/*
+=================
+S_CodecUtilTell
+=================
+*/
+int S_CodecUtilTell(snd_stream_t *stream)
+{
+	if(!stream->buffer)
+		return FS_FTell(stream->file);
+
+	return stream->bufferPos;
+}
@@ -47,6 +47,8 @@ typedef struct snd_stream_s
 	int length;
 	int pos;
 	void *ptr;
+	byte *buffer;		// file image of a memory stream, file is 0
+	int bufferPos;
 } snd_stream_t;
 
 // Codec functions
@@ -63,6 +65,7 @@ struct snd_codec_s
 	CODEC_OPEN open;
 	CODEC_READ read;
 	CODEC_CLOSE close;
+	CODEC_OPEN openMemory;
 	snd_codec_t *next;
 };
 
@@ -72,17 +75,23 @@ void S_CodecShutdown( void );
 void S_CodecRegister(snd_codec_t *codec);
 void *S_CodecLoad(const char *filename, snd_info_t *info);
 snd_stream_t *S_CodecOpenStream(const char *filename);
+snd_stream_t *S_CodecOpenMemoryStream(const char *filename);
 void S_CodecCloseStream(snd_stream_t *stream);
 int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
 
 // Util functions (used by codecs)
 snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec);
+snd_stream_t *S_CodecUtilOpenMemory(const char *filename, snd_codec_t *codec);
 void S_CodecUtilClose(snd_stream_t **stream);
+int S_CodecUtilRead(snd_stream_t *stream, void *buffer, int len);
+int S_CodecUtilSeek(snd_stream_t *stream, long offset, int origin);
+int S_CodecUtilTell(snd_stream_t *stream);
 
 // WAV Codec
 extern snd_codec_t wav_codec;
 void *S_WAV_CodecLoad(const char *filename, snd_info_t *info);
 snd_stream_t *S_WAV_CodecOpenStream(const char *filename);
+snd_stream_t *S_WAV_CodecOpenMemoryStream(const char *filename);
 void S_WAV_CodecCloseStream(snd_stream_t *stream);
 int S_WAV_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
 
@@ -91,6 +100,7 @@ int S_WAV_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
 extern snd_codec_t ogg_codec;
 void *S_OGG_CodecLoad(const char *filename, snd_info_t *info);
 snd_stream_t *S_OGG_CodecOpenStream(const char *filename);
+snd_stream_t *S_OGG_CodecOpenMemoryStream(const char *filename);
 void S_OGG_CodecCloseStream(snd_stream_t *stream);
 int S_OGG_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
 #endif // USE_CODEC_VORBIS
@@ -46,6 +46,7 @@ snd_codec_t ogg_codec =
 	S_OGG_CodecOpenStream,
 	S_OGG_CodecReadStream,
 	S_OGG_CodecCloseStream,
+	S_OGG_CodecOpenMemoryStream,
 	NULL
 };
 
@@ -85,8 +86,8 @@ size_t S_OGG_Callback_read(void *ptr, size_t size, size_t nmemb, void *datasourc
 	// FS_Read does not support multi-byte elements
 	byteSize = nmemb * size;
 
-	// read it with the Q3 function FS_Read()
-	bytesRead = FS_Read(ptr, byteSize, stream->file);
+	// read it from the file or the memory image
+	bytesRead = S_CodecUtilRead(stream, ptr, byteSize);
 
 	// update the file position
 	stream->pos += bytesRead;
@@ -125,8 +126,8 @@ int S_OGG_Callback_seek(void *datasource, ogg_int64_t offset, int whence)
 	{
 		case SEEK_SET :
 		{
-			// set the file position in the actual file with the Q3 function
-			retVal = FS_Seek(stream->file, (long) offset, FS_SEEK_SET);
+			// set the position in the file or the memory image
+			retVal = S_CodecUtilSeek(stream, (long) offset, FS_SEEK_SET);
 
 			// something has gone wrong, so we return here
 			if(retVal < 0)
@@ -141,8 +142,8 @@ int S_OGG_Callback_seek(void *datasource, ogg_int64_t offset, int whence)
   
 		case SEEK_CUR :
 		{
-			// set the file position in the actual file with the Q3 function
-			retVal = FS_Seek(stream->file, (long) offset, FS_SEEK_CUR);
+			// set the position in the file or the memory image
+			retVal = S_CodecUtilSeek(stream, (long) offset, FS_SEEK_CUR);
 
 			// something has gone wrong, so we return here
 			if(retVal < 0)
@@ -160,8 +161,8 @@ int S_OGG_Callback_seek(void *datasource, ogg_int64_t offset, int whence)
 			// Quake 3 seems to have trouble with FS_SEEK_END 
 			// so we use the file length and FS_SEEK_SET
 
-			// set the file position in the actual file with the Q3 function
-			retVal = FS_Seek(stream->file, (long) stream->length + (long) offset, FS_SEEK_SET);
+			// set the position in the file or the memory image
+			retVal = S_CodecUtilSeek(stream, (long) stream->length + (long) offset, FS_SEEK_SET);
 
 			// something has gone wrong, so we return here
 			if(retVal < 0)
@@ -211,7 +212,7 @@ long S_OGG_Callback_tell(void *datasource)
 	// snd_stream_t in the generic pointer
 	stream = (snd_stream_t *) datasource;
 
-	return (long) FS_FTell(stream->file);
+	return (long) S_CodecUtilTell(stream);
 }
 
 // the callback structure
@@ -225,13 +226,13 @@ const ov_callbacks S_OGG_Callbacks =
 
 /*
 =================
-S_OGG_CodecOpenStream
+S_OGG_CodecAttachStream
+
+Sets up the decoder on a stream opened by S_CodecUtilOpen/S_CodecUtilOpenMemory
 =================
 */
-snd_stream_t *S_OGG_CodecOpenStream(const char *filename)
+static snd_stream_t *S_OGG_CodecAttachStream(snd_stream_t *stream)
 {
-	snd_stream_t *stream;
-
 	// OGG codec control structure
 	OggVorbis_File *vf;
 
@@ -240,13 +241,6 @@ snd_stream_t *S_OGG_CodecOpenStream(const char *filename)
 	ogg_int64_t numSamples;
 
 	// check if input is valid
-	if(!filename)
-	{
-		return NULL;
-	}
-
-	// Open the stream
-	stream = S_CodecUtilOpen(filename, &ogg_codec);
 	if(!stream)
 	{
 		return NULL;
@@ -328,6 +322,38 @@ snd_stream_t *S_OGG_CodecOpenStream(const char *filename)
 	return stream;
 }
 
+/*
+=================
+S_OGG_CodecOpenStream
+=================
+*/
+snd_stream_t *S_OGG_CodecOpenStream(const char *filename)
+{
+	// check if input is valid
+	if(!filename)
+	{
+		return NULL;
+	}
+
+	return S_OGG_CodecAttachStream(S_CodecUtilOpen(filename, &ogg_codec));
+}
+
+/*
+=================
+S_OGG_CodecOpenMemoryStream
+=================
+*/
+snd_stream_t *S_OGG_CodecOpenMemoryStream(const char *filename)
+{
+	// check if input is valid
+	if(!filename)
+	{
+		return NULL;
+	}
+
+	return S_OGG_CodecAttachStream(S_CodecUtilOpenMemory(filename, &ogg_codec));
+}
+
 /*
 =================
 S_OGG_CodecCloseStream
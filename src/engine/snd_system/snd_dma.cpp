@@ -75,8 +75,8 @@ int   		s_paintedtime; 		// sample PAIRS
 sfx_t		s_knownSfx[MAX_SFX];
 int			s_numSfx = 0;
 
-#define		LOOP_HASH		128
-static	sfx_t		*sfxHash[LOOP_HASH];
+// sound names are case insensitive
+static	idStrHashMap< sfx_t * >	sfxHash( false );
 
 convar_t		*s_testsound;
 convar_t		*s_show;
@@ -90,6 +90,113 @@ int						s_rawend[MAX_RAW_STREAMS];
 
 portable_samplepair_t s_rawsamples[MAX_RAW_STREAMS][MAX_RAW_SAMPLES];
 
+convar_t		*s_mixThread;
+
+/*
+With s_mixThread set the channels, looping sounds and listener belong to
+a mixing thread.  The main thread hands the per frame calls to it as
+commands through a single producer / single consumer ring, publishes them
+once per frame from S_Update, and stops the mixer with S_LockMixer for
+anything that loads, frees or resets sound data.
+*/
+typedef enum {
+	SCMD_START_SOUND,
+	SCMD_START_LOCAL_SOUND,
+	SCMD_START_SOUND_EX,
+	SCMD_CLEAR_LOOPING_SOUNDS,
+	SCMD_ADD_LOOPING_SOUND,
+	SCMD_ADD_REAL_LOOPING_SOUND,
+	SCMD_STOP_LOOPING_SOUND,
+	SCMD_UPDATE_ENTITY_POSITION,
+	SCMD_RESPATIALIZE,
+	SCMD_NULL_OUTPUT_FRAME
+} soundCommandType_t;
+
+typedef struct {
+	soundCommandType_t	type;
+	int					entityNum;
+	int					entchannel;		// also inwater and killall
+	int					flags;
+	int					volume;
+	int					framecount;
+	int					time;
+	sfx_t				*sfx;
+	sfxHandle_t			sfxHandle;
+	qboolean			hasOrigin;
+	vec3_t				origin;
+	vec3_t				velocity;
+	vec3_t				axis[3];
+} soundCommand_t;
+
+#define MAX_SOUND_COMMANDS		4096		// must be a power of two
+
+static soundCommand_t			s_commands[MAX_SOUND_COMMANDS];
+static unsigned int				s_commandWrite;		// main thread only
+static volatile unsigned int	s_commandCommit;	// published by the main thread
+static volatile unsigned int	s_commandRead;		// published by the mixing thread
+
+static void						*s_mixThreadHandle;
+static volatile int				s_mixQuit;
+static volatile int				s_mixPauseRequest;
+static volatile int				s_mixPaused;
+static int						s_mixLockDepth;
+static Q_THREAD_LOCAL qboolean	s_onMixThread;
+
+// null output for s_mixThreadTest, the dma position and the clock are
+// scripted and every sample that gets played is captured
+static qboolean			s_nullOutput;
+static int				s_nullOutputTime;
+static int				s_nullOutputPairs;
+static short			*s_nullCapture;
+static int				s_nullCaptureMax;
+
+// dma position tracking, at file scope so the null output can reset it
+static int				s_dmaBuffers;
+static int				s_dmaOldSamplePos;
+static int				s_lastMixSoundtime = -1;
+static float			s_lastMixTime;
+
+static void S_IssueCommand( const soundCommand_t *cmd );
+static void S_CommitCommands( void );
+static void S_StartMixThread( void );
+static void S_StopMixThread( void );
+static void S_MixThreadTest_f( void );
+
+/*
+================
+S_Milliseconds
+
+Com_Milliseconds pumps the event loop, which only the main thread may do
+================
+*/
+static int S_Milliseconds( void ) {
+	if ( s_nullOutput ) {
+		return s_nullOutputTime;
+	}
+	if ( s_onMixThread ) {
+		return Sys_Milliseconds();
+	}
+	return Com_Milliseconds();
+}
+
+/*
+================
+S_LoadCommandSound
+
+Sounds are loaded by the main thread before a command refers to them
+================
+*/
+static void S_LoadCommandSound( sfx_t *sfx ) {
+	if ( sfx->inMemory == qfalse ) {
+		S_WaitForDecode( sfx );
+	}
+	if ( sfx->inMemory == qfalse ) {
+		S_LockMixer();
+		S_memoryLoad( sfx );
+		S_UnlockMixer();
+	}
+}
+
 
 // ====================================================================
 // User-setable variables
@@ -197,7 +304,7 @@ channel_t*	S_ChannelMalloc( void ) {
 	}
 	v = freelist;
 	freelist = *(channel_t **)freelist;
-	v->allocTime = Com_Milliseconds();
+	v->allocTime = S_Milliseconds();
 	return v;
 }
 
@@ -224,29 +331,6 @@ void S_ChannelSetup( void ) {
 // Load a sound
 // =======================================================================
 
-/*
-================
-return a hash value for the sfx name
-================
-*/
-static long S_HashSFXName(const char *name) {
-	int		i;
-	long	hash;
-	char	letter;
-
-	hash = 0;
-	i = 0;
-	while (name[i] != '\0') {
-		letter = tolower(name[i]);
-		if (letter =='.') break;				// don't include extension
-		if (letter =='\\') letter = '/';		// damn path names
-		hash+=(long)(letter)*(i+119);
-		i++;
-	}
-	hash &= (LOOP_HASH-1);
-	return hash;
-}
-
 /*
 ==================
 S_FindName
@@ -256,9 +340,7 @@ Will allocate a new sfx if it isn't found
 */
 static sfx_t *S_FindName( const char *name ) {
 	int		i;
-	int		hash;
-
-	sfx_t	*sfx;
+	sfx_t	*sfx, **found;
 
 	if (!name) {
 		Com_Error (ERR_FATAL, "S_FindName: NULL");
@@ -271,15 +353,10 @@ static sfx_t *S_FindName( const char *name ) {
 		Com_Error (ERR_FATAL, "Sound name too long: %s", name);
 	}
 
-	hash = S_HashSFXName(name);
-
-	sfx = sfxHash[hash];
 	// see if already loaded
-	while (sfx) {
-		if (!Q_stricmp(sfx->soundName, name) ) {
-			return sfx;
-		}
-		sfx = sfx->next;
+	found = sfxHash.Get(name);
+	if (found) {
+		return *found;
 	}
 
 	// find a free sfx
@@ -300,8 +377,7 @@ static sfx_t *S_FindName( const char *name ) {
 	Com_Memset (sfx, 0, sizeof(*sfx));
 	strcpy (sfx->soundName, name);
 
-	sfx->next = sfxHash[hash];
-	sfxHash[hash] = sfx;
+	sfxHash.Set(sfx->soundName, sfx);
 
 	return sfx;
 }
@@ -360,7 +436,7 @@ sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
 	}
 
 	sfx = S_FindName( name );
-	if ( sfx->soundData ) {
+	if ( sfx->soundData || sfx->soundLength ) {
 		if ( sfx->defaultSound ) {
 			Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
 			return 0;
@@ -371,7 +447,14 @@ sfxHandle_t	S_Base_RegisterSound( const char *name, qboolean compressed ) {
 	sfx->inMemory = qfalse;
 	sfx->soundCompressed = compressed;
 
-  S_memoryLoad(sfx);
+	// the samples are decoded in the background or when the sound is played
+	if ( s_decodeThread->integer && !compressed ) {
+		S_RegisterSoundInfo( sfx );
+	} else {
+		S_LockMixer();
+		S_memoryLoad(sfx);
+		S_UnlockMixer();
+	}
 
 	if ( sfx->defaultSound ) {
 		Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
@@ -391,10 +474,12 @@ void S_Base_BeginRegistration( void ) {
 	s_soundMuted = qfalse;		// we can play again
 
 	if (s_numSfx == 0) {
+		S_LockMixer();
 		SND_setup();
 
 		Com_Memset(s_knownSfx, '\0', sizeof(s_knownSfx));
-		Com_Memset(sfxHash, '\0', sizeof(sfx_t *) * LOOP_HASH);
+		sfxHash.Clear();
+		S_UnlockMixer();
 
 		S_Base_RegisterSound("sound/feedback/hit.wav", qfalse);		// changed to a sound in baseq3
 	}
@@ -484,10 +569,8 @@ Entchannel 0 will never override a playing sound
 ====================
 */
 void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle ) {
-	channel_t	*ch;
-	sfx_t		*sfx;
-  int i, oldest, chosen, time;
-  int	inplay, allowed;
+	soundCommand_t	cmd;
+	sfx_t			*sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
@@ -504,15 +587,40 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 
 	sfx = &s_knownSfx[ sfxHandle ];
 
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
+	S_LoadCommandSound( sfx );
 
 	if ( s_show->integer == 1 ) {
 		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
 	}
 
-	time = Com_Milliseconds();
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_START_SOUND;
+	if ( origin ) {
+		cmd.hasOrigin = qtrue;
+		VectorCopy( origin, cmd.origin );
+	}
+	cmd.entityNum = entityNum;
+	cmd.entchannel = entchannel;
+	cmd.sfx = sfx;
+	S_IssueCommand( &cmd );
+}
+
+/*
+====================
+S_StartSoundCmd
+====================
+*/
+static void S_StartSoundCmd( const soundCommand_t *cmd ) {
+	channel_t	*ch;
+	sfx_t		*sfx;
+	int			entityNum;
+	int i, oldest, chosen, time;
+	int	inplay, allowed;
+
+	sfx = cmd->sfx;
+	entityNum = cmd->entityNum;
+
+	time = S_Milliseconds();
 
 //	Com_Printf("playing %s\n", sfx->soundName);
 	// pick a channel to play on
@@ -573,7 +681,9 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 					}
 				}
 				if (chosen == -1) {
-					Com_Printf("dropping sound\n");
+					if ( !s_onMixThread ) {
+						Com_Printf("dropping sound\n");
+					}
 					return;
 				}
 			}
@@ -582,8 +692,8 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 		ch->allocTime = sfx->lastTimeUsed;
 	}
 
-	if (origin) {
-		VectorCopy (origin, ch->origin);
+	if (cmd->hasOrigin) {
+		VectorCopy (cmd->origin, ch->origin);
 		ch->fixed_origin = qtrue;
 	} else {
 		ch->fixed_origin = qfalse;
@@ -593,7 +703,7 @@ void S_Base_StartSound(vec3_t origin, int entityNum, int entchannel, sfxHandle_t
 	ch->entnum = entityNum;
 	ch->thesfx = sfx;
 	ch->startSample = START_SAMPLE_IMMEDIATE;
-	ch->entchannel = entchannel;
+	ch->entchannel = cmd->entchannel;
 	ch->leftvol = ch->master_vol;		// these will get calced at next spatialize
 	ch->rightvol = ch->master_vol;		// unless the game isn't running
 	ch->doppler = qfalse;
@@ -606,6 +716,9 @@ S_StartLocalSound
 ==================
 */
 void S_Base_StartLocalSound( sfxHandle_t sfxHandle, int channelNum ) {
+	soundCommand_t	cmd;
+	sfx_t			*sfx;
+
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
@@ -615,7 +728,20 @@ void S_Base_StartLocalSound( sfxHandle_t sfxHandle, int channelNum ) {
 		return;
 	}
 
-	S_Base_StartSound (NULL, listener_number, channelNum, sfxHandle );
+	sfx = &s_knownSfx[ sfxHandle ];
+
+	S_LoadCommandSound( sfx );
+
+	if ( s_show->integer == 1 ) {
+		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
+	}
+
+	// the listener is resolved when the command runs
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_START_LOCAL_SOUND;
+	cmd.entchannel = channelNum;
+	cmd.sfx = sfx;
+	S_IssueCommand( &cmd );
 }
 
 
@@ -633,6 +759,8 @@ void S_Base_ClearSoundBuffer( void ) {
 	if (!s_soundStarted)
 		return;
 
+	S_LockMixer();
+
 	// stop looping sounds
 	Com_Memset(loopSounds, 0, MAX_GENTITIES*sizeof(loopSound_t));
 	Com_Memset(loop_channels, 0, MAX_CHANNELS*sizeof(channel_t));
@@ -647,10 +775,16 @@ void S_Base_ClearSoundBuffer( void ) {
 	else
 		clear = 0;
 
-	SNDDMA_BeginPainting ();
-	if (dma.buffer)
+	if (s_nullOutput) {
 		Com_Memset(dma.buffer, clear, dma.samples * dma.samplebits/8);
-	SNDDMA_Submit ();
+	} else {
+		SNDDMA_BeginPainting ();
+		if (dma.buffer)
+			Com_Memset(dma.buffer, clear, dma.samples * dma.samplebits/8);
+		SNDDMA_Submit ();
+	}
+
+	S_UnlockMixer();
 }
 
 /*
@@ -663,10 +797,14 @@ void S_Base_StopAllSounds(void) {
 		return;
 	}
 
+	S_LockMixer();
+
 	// stop the background music
 	S_Base_StopBackgroundTrack();
 
 	S_Base_ClearSoundBuffer ();
+
+	S_UnlockMixer();
 }
 
 /*
@@ -677,29 +815,47 @@ continuous looping sounds are added each frame
 ==============================================================
 */
 
-void S_Base_StopLoopingSound(int entityNum) {
+static void S_StopLoopingSoundCmd(int entityNum) {
 	loopSounds[entityNum].active = qfalse;
 //	loopSounds[entityNum].sfx = 0;
 	loopSounds[entityNum].kill = qfalse;
 }
 
+void S_Base_StopLoopingSound(int entityNum) {
+	soundCommand_t	cmd;
+
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_STOP_LOOPING_SOUND;
+	cmd.entityNum = entityNum;
+	S_IssueCommand( &cmd );
+}
+
 /*
 ==================
 S_ClearLoopingSounds
 
 ==================
 */
-void S_Base_ClearLoopingSounds( qboolean killall ) {
+static void S_ClearLoopingSoundsCmd( qboolean killall ) {
 	int i;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
 		if (killall || loopSounds[i].kill == qtrue || (loopSounds[i].sfx && loopSounds[i].sfx->soundLength == 0)) {
 			loopSounds[i].kill = qfalse;
-			S_Base_StopLoopingSound(i);
+			S_StopLoopingSoundCmd(i);
 		}
 	}
 	numLoopChannels = 0;
 }
 
+void S_Base_ClearLoopingSounds( qboolean killall ) {
+	soundCommand_t	cmd;
+
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_CLEAR_LOOPING_SOUNDS;
+	cmd.entchannel = killall;
+	S_IssueCommand( &cmd );
+}
+
 /*
 ==================
 S_AddLoopingSound
@@ -709,7 +865,8 @@ Include velocity in case I get around to doing doppler...
 ==================
 */
 void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
-	sfx_t *sfx;
+	soundCommand_t	cmd;
+	sfx_t			*sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
@@ -722,14 +879,32 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 
 	sfx = &s_knownSfx[ sfxHandle ];
 
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
+	S_LoadCommandSound( sfx );
 
 	if ( !sfx->soundLength ) {
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
 
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_ADD_LOOPING_SOUND;
+	cmd.entityNum = entityNum;
+	VectorCopy( origin, cmd.origin );
+	VectorCopy( velocity, cmd.velocity );
+	cmd.sfx = sfx;
+	cmd.framecount = cls.framecount;
+	S_IssueCommand( &cmd );
+}
+
+static void S_AddLoopingSoundCmd( const soundCommand_t *cmd ) {
+	int				entityNum;
+	const vec_t		*origin, *velocity;
+	sfx_t			*sfx;
+
+	entityNum = cmd->entityNum;
+	origin = cmd->origin;
+	velocity = cmd->velocity;
+	sfx = cmd->sfx;
+
 	VectorCopy( origin, loopSounds[entityNum].origin );
 	VectorCopy( velocity, loopSounds[entityNum].velocity );
 	loopSounds[entityNum].active = qtrue;
@@ -747,7 +922,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		lena = DistanceSquared(loopSounds[listener_number].origin, loopSounds[entityNum].origin);
 		VectorAdd(loopSounds[entityNum].origin, loopSounds[entityNum].velocity, out);
 		lenb = DistanceSquared(loopSounds[listener_number].origin, out);
-		if ((loopSounds[entityNum].framenum+1) != cls.framecount) {
+		if ((loopSounds[entityNum].framenum+1) != cmd->framecount) {
 			loopSounds[entityNum].oldDopplerScale = 1.0;
 		} else {
 			loopSounds[entityNum].oldDopplerScale = loopSounds[entityNum].dopplerScale;
@@ -760,7 +935,7 @@ void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t ve
 		}
 	}
 
-	loopSounds[entityNum].framenum = cls.framecount;
+	loopSounds[entityNum].framenum = cmd->framecount;
 }
 
 /*
@@ -772,7 +947,8 @@ Include velocity in case I get around to doing doppler...
 ==================
 */
 void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocity, sfxHandle_t sfxHandle ) {
-	sfx_t *sfx;
+	soundCommand_t	cmd;
+	sfx_t			*sfx;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
@@ -785,16 +961,28 @@ void S_Base_AddRealLoopingSound( int entityNum, const vec3_t origin, const vec3_
 
 	sfx = &s_knownSfx[ sfxHandle ];
 
-	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
-	}
+	S_LoadCommandSound( sfx );
 
 	if ( !sfx->soundLength ) {
 		Com_Error( ERR_DROP, "%s has length 0", sfx->soundName );
 	}
-	VectorCopy( origin, loopSounds[entityNum].origin );
-	VectorCopy( velocity, loopSounds[entityNum].velocity );
-	loopSounds[entityNum].sfx = sfx;
+
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_ADD_REAL_LOOPING_SOUND;
+	cmd.entityNum = entityNum;
+	VectorCopy( origin, cmd.origin );
+	VectorCopy( velocity, cmd.velocity );
+	cmd.sfx = sfx;
+	S_IssueCommand( &cmd );
+}
+
+static void S_AddRealLoopingSoundCmd( const soundCommand_t *cmd ) {
+	int		entityNum;
+
+	entityNum = cmd->entityNum;
+	VectorCopy( cmd->origin, loopSounds[entityNum].origin );
+	VectorCopy( cmd->velocity, loopSounds[entityNum].velocity );
+	loopSounds[entityNum].sfx = cmd->sfx;
 	loopSounds[entityNum].active = qtrue;
 	loopSounds[entityNum].kill = qfalse;
 	loopSounds[entityNum].doppler = qfalse;
@@ -821,7 +1009,7 @@ void S_AddLoopSounds (void) {
 
 	numLoopChannels = 0;
 
-	time = Com_Milliseconds();
+	time = S_Milliseconds();
 
 	loopFrame++;
 	for ( i = 0 ; i < MAX_GENTITIES ; i++) {
@@ -924,6 +1112,7 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 	int		src, dst;
 	float	scale;
 	int		intVolume;
+	int		rawend;
 	portable_samplepair_t *rawsamples;
 
 	if ( !s_soundStarted || s_soundMuted ) {
@@ -947,9 +1136,12 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 	else
 		intVolume = 256 * volume * s_volume->value;
 
-	if ( s_rawend[stream] < s_soundtime ) {
-		Com_DPrintf( "S_Base_RawSamples: resetting minimum: %i < %i\n", s_rawend[stream], s_soundtime );
-		s_rawend[stream] = s_soundtime;
+	// the samples are written past the end the mixer reads up to and the
+	// new end is only published once they are in place
+	rawend = s_rawend[stream];
+	if ( rawend < s_soundtime ) {
+		Com_DPrintf( "S_Base_RawSamples: resetting minimum: %i < %i\n", rawend, s_soundtime );
+		rawend = s_soundtime;
 	}
 
 	scale = (float)rate / dma.speed;
@@ -961,8 +1153,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 		{	// optimized case
 			for (i=0 ; i<samples ; i++)
 			{
-				dst = s_rawend[stream]&(MAX_RAW_SAMPLES-1);
-				s_rawend[stream]++;
+				dst = rawend&(MAX_RAW_SAMPLES-1);
+				rawend++;
 				rawsamples[dst].left = ((short *)data)[i*2] * intVolume;
 				rawsamples[dst].right = ((short *)data)[i*2+1] * intVolume;
 			}
@@ -974,8 +1166,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 				src = i*scale;
 				if (src >= samples)
 					break;
-				dst = s_rawend[stream]&(MAX_RAW_SAMPLES-1);
-				s_rawend[stream]++;
+				dst = rawend&(MAX_RAW_SAMPLES-1);
+				rawend++;
 				rawsamples[dst].left = ((short *)data)[src*2] * intVolume;
 				rawsamples[dst].right = ((short *)data)[src*2+1] * intVolume;
 			}
@@ -988,8 +1180,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 			src = i*scale;
 			if (src >= samples)
 				break;
-			dst = s_rawend[stream]&(MAX_RAW_SAMPLES-1);
-			s_rawend[stream]++;
+			dst = rawend&(MAX_RAW_SAMPLES-1);
+			rawend++;
 			rawsamples[dst].left = ((short *)data)[src] * intVolume;
 			rawsamples[dst].right = ((short *)data)[src] * intVolume;
 		}
@@ -1003,8 +1195,8 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 			src = i*scale;
 			if (src >= samples)
 				break;
-			dst = s_rawend[stream]&(MAX_RAW_SAMPLES-1);
-			s_rawend[stream]++;
+			dst = rawend&(MAX_RAW_SAMPLES-1);
+			rawend++;
 			rawsamples[dst].left = ((char *)data)[src*2] * intVolume;
 			rawsamples[dst].right = ((char *)data)[src*2+1] * intVolume;
 		}
@@ -1018,15 +1210,18 @@ void S_Base_RawSamples( int stream, int samples, int rate, int width, int s_chan
 			src = i*scale;
 			if (src >= samples)
 				break;
-			dst = s_rawend[stream]&(MAX_RAW_SAMPLES-1);
-			s_rawend[stream]++;
+			dst = rawend&(MAX_RAW_SAMPLES-1);
+			rawend++;
 			rawsamples[dst].left = (((byte *)data)[src]-128) * intVolume;
 			rawsamples[dst].right = (((byte *)data)[src]-128) * intVolume;
 		}
 	}
 
-	if ( s_rawend[stream] > s_soundtime + MAX_RAW_SAMPLES ) {
-		Com_DPrintf( "S_Base_RawSamples: overflowed %i > %i\n", s_rawend[stream], s_soundtime );
+	Sys_MemoryBarrier();
+	s_rawend[stream] = rawend;
+
+	if ( rawend > s_soundtime + MAX_RAW_SAMPLES ) {
+		Com_DPrintf( "S_Base_RawSamples: overflowed %i > %i\n", rawend, s_soundtime );
 	}
 }
 
@@ -1040,10 +1235,17 @@ let the sound system know where an entity currently is
 ======================
 */
 void S_Base_UpdateEntityPosition( int entityNum, const vec3_t origin ) {
+	soundCommand_t	cmd;
+
 	if ( entityNum < 0 || entityNum > MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "S_UpdateEntityPosition: bad entitynum %i", entityNum );
 	}
-	VectorCopy( origin, loopSounds[entityNum].origin );
+
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_UPDATE_ENTITY_POSITION;
+	cmd.entityNum = entityNum;
+	VectorCopy( origin, cmd.origin );
+	S_IssueCommand( &cmd );
 }
 
 
@@ -1055,19 +1257,33 @@ Change the volumes of all the playing sounds for changes in their positions
 ============
 */
 void S_Base_Respatialize( int entityNum, const vec3_t head, vec3_t axis[3], int inwater ) {
-	int			i;
-	channel_t	*ch;
-	vec3_t		origin;
+	soundCommand_t	cmd;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
 
-	listener_number = entityNum;
-	VectorCopy(head, listener_origin);
-	VectorCopy(axis[0], listener_axis[0]);
-	VectorCopy(axis[1], listener_axis[1]);
-	VectorCopy(axis[2], listener_axis[2]);
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_RESPATIALIZE;
+	cmd.entityNum = entityNum;
+	cmd.entchannel = inwater;
+	VectorCopy( head, cmd.origin );
+	VectorCopy( axis[0], cmd.axis[0] );
+	VectorCopy( axis[1], cmd.axis[1] );
+	VectorCopy( axis[2], cmd.axis[2] );
+	S_IssueCommand( &cmd );
+}
+
+static void S_RespatializeCmd( const soundCommand_t *cmd ) {
+	int			i;
+	channel_t	*ch;
+	vec3_t		origin;
+
+	listener_number = cmd->entityNum;
+	VectorCopy(cmd->origin, listener_origin);
+	VectorCopy(cmd->axis[0], listener_axis[0]);
+	VectorCopy(cmd->axis[1], listener_axis[1]);
+	VectorCopy(cmd->axis[2], listener_axis[2]);
 
 	// update spatialization for dynamic sounds	
 	ch = s_channels;
@@ -1143,12 +1359,21 @@ void S_Base_Update( void ) {
 	int			i;
 	int			total;
 	channel_t	*ch;
+	qboolean	threaded;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 //		Com_DPrintf ("not started or muted\n");
 		return;
 	}
 
+	// avi recording writes the mixed audio from the main thread
+	threaded = (qboolean)( s_mixThread->integer && !CL_VideoRecording() );
+	if ( threaded && !s_mixThreadHandle ) {
+		S_StartMixThread();
+	} else if ( !threaded && s_mixThreadHandle ) {
+		S_StopMixThread();
+	}
+
 	//
 	// debugging output
 	//
@@ -1165,18 +1390,23 @@ void S_Base_Update( void ) {
 		Com_Printf ("----(%i)---- painted: %i\n", total, s_paintedtime);
 	}
 
+	// move decoded sounds into sound memory and queue more
+	S_UpdateDecoding();
+
 	// add raw data from streamed samples
 	S_UpdateBackgroundTrack();
 
-	// mix some sound
-	S_Update_();
+	// mix some sound, or hand this frame's commands to the mixing thread
+	if ( s_mixThreadHandle ) {
+		S_CommitCommands();
+	} else {
+		S_Update_();
+	}
 }
 
 void S_GetSoundtime(void)
 {
 	int		samplepos;
-	static	int		buffers;
-	static	int		oldsamplepos;
 	int		fullsamples;
 	
 	fullsamples = dma.samples / dma.channels;
@@ -1189,21 +1419,30 @@ void S_GetSoundtime(void)
 
 	// it is possible to miscount buffers if it has wrapped twice between
 	// calls to S_Update.  Oh well.
-	samplepos = SNDDMA_GetDMAPos();
-	if (samplepos < oldsamplepos)
+	if (s_nullOutput) {
+		samplepos = (s_nullOutputPairs * dma.channels) & (dma.samples - 1);
+	} else {
+		samplepos = SNDDMA_GetDMAPos();
+	}
+	if (samplepos < s_dmaOldSamplePos)
 	{
-		buffers++;					// buffer wrapped
+		s_dmaBuffers++;					// buffer wrapped
 		
 		if (s_paintedtime > 0x40000000)
 		{	// time to chop things off to avoid 32 bit limits
-			buffers = 0;
+			s_dmaBuffers = 0;
 			s_paintedtime = fullsamples;
-			S_Base_StopAllSounds ();
+			// the background track belongs to the main thread
+			if (s_onMixThread) {
+				S_Base_ClearSoundBuffer ();
+			} else {
+				S_Base_StopAllSounds ();
+			}
 		}
 	}
-	oldsamplepos = samplepos;
+	s_dmaOldSamplePos = samplepos;
 
-	s_soundtime = buffers*fullsamples + samplepos/dma.channels;
+	s_soundtime = s_dmaBuffers*fullsamples + samplepos/dma.channels;
 
 #if 0
 // check to make sure that we haven't overshot
@@ -1225,30 +1464,28 @@ void S_GetSoundtime(void)
 void S_Update_(void) {
 	unsigned        endtime;
 	int				samps;
-	static			float	lastTime = 0.0f;
 	float			ma, op;
 	float			thisTime, sane;
-	static			int ot = -1;
 
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
 
-	thisTime = Com_Milliseconds();
+	thisTime = S_Milliseconds();
 
 	// Updates s_soundtime
 	S_GetSoundtime();
 
-	if (s_soundtime == ot) {
+	if (s_soundtime == s_lastMixSoundtime) {
 		return;
 	}
-	ot = s_soundtime;
+	s_lastMixSoundtime = s_soundtime;
 
 	// clear any sound effects that end before the current time,
 	// and start any new sounds
 	S_ScanChannelStarts();
 
-	sane = thisTime - lastTime;
+	sane = thisTime - s_lastMixTime;
 	if (sane<11) {
 		sane = 11;			// 85hz
 	}
@@ -1274,13 +1511,17 @@ void S_Update_(void) {
 
 
 
-	SNDDMA_BeginPainting ();
+	if (s_nullOutput) {
+		S_PaintChannels (endtime);
+	} else {
+		SNDDMA_BeginPainting ();
 
-	S_PaintChannels (endtime);
+		S_PaintChannels (endtime);
 
-	SNDDMA_Submit ();
+		SNDDMA_Submit ();
+	}
 
-	lastTime = thisTime;
+	s_lastMixTime = thisTime;
 }
 
 
@@ -1303,7 +1544,9 @@ void S_Base_StopBackgroundTrack( void ) {
 		return;
 	S_CodecCloseStream(s_backgroundStream);
 	s_backgroundStream = NULL;
+	S_LockMixer();
 	s_rawend[0] = 0;
+	S_UnlockMixer();
 }
 
 /*
@@ -1475,13 +1718,19 @@ void S_Base_Shutdown( void ) {
 		return;
 	}
 
+	S_StopMixThread();
+	S_ShutdownDecoding();
+
 	SNDDMA_Shutdown();
 	SND_shutdown();
 
 	s_soundStarted = 0;
 	s_numSfx = 0;
+	sfxHash.Free();
 
 	Cmd_RemoveCommand("s_info");
+	Cmd_RemoveCommand("s_mixBench");
+	Cmd_RemoveCommand("s_mixThreadTest");
 }
 
 int S_GetCurrentSoundTime( void ) {
@@ -1489,12 +1738,40 @@ int S_GetCurrentSoundTime( void ) {
 }
 
 void S_StartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle, int flags, int volume ) {
+	soundCommand_t	cmd;
+
 	if ( !s_soundStarted || s_soundMuted || ( cls.state != CA_ACTIVE && cls.state != CA_DISCONNECTED ) ) {
 		return;
 	}
 
-	// RF, make the call now, or else we could override following streaming sounds in the same frame, due to the delay
-	S_ThreadStartSoundEx( origin, entityNum, entchannel, sfxHandle, flags, volume );
+	if ( !origin && ( entityNum < 0 || entityNum > MAX_GENTITIES ) ) {
+		Com_Error( ERR_DROP, "S_StartSound: bad entitynum %i", entityNum );
+	}
+
+	if ( sfxHandle < 0 || sfxHandle >= s_numSfx ) {
+		Com_Printf( S_COLOR_YELLOW "S_StartSound: handle %i out of range\n", sfxHandle );
+		return;
+	}
+
+	// sounds registered from their headers are decoded on first use
+	S_LoadCommandSound( &s_knownSfx[ sfxHandle ] );
+
+	if ( s_show->integer == 1 ) {
+		Com_Printf( "%i : %s\n", s_paintedtime, s_knownSfx[ sfxHandle ].soundName );
+	}
+
+	Com_Memset( &cmd, 0, sizeof( cmd ) );
+	cmd.type = SCMD_START_SOUND_EX;
+	if ( origin ) {
+		cmd.hasOrigin = qtrue;
+		VectorCopy( origin, cmd.origin );
+	}
+	cmd.entityNum = entityNum;
+	cmd.entchannel = entchannel;
+	cmd.sfxHandle = sfxHandle;
+	cmd.flags = flags;
+	cmd.volume = volume;
+	S_IssueCommand( &cmd );
 }
 
 void S_ThreadStartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHandle_t sfxHandle, int flags, int volume ) {
@@ -1520,7 +1797,7 @@ void S_ThreadStartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHand
 
 	sfx = &s_knownSfx[ sfxHandle ];
 
-	if ( s_show->integer == 1 ) {
+	if ( s_show->integer == 1 && !s_onMixThread ) {
 		Com_Printf( "%i : %s\n", s_paintedtime, sfx->soundName );
 	}
 
@@ -1638,7 +1915,9 @@ void S_ThreadStartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHand
 					}
 				}
 				if ( chosen == -1 ) {
-					Com_Printf("dropping sound\n");
+					if ( !s_onMixThread ) {
+						Com_Printf("dropping sound\n");
+					}
 					return;
 				}
 			}
@@ -1680,6 +1959,524 @@ void S_ThreadStartSoundEx( vec3_t origin, int entityNum, int entchannel, sfxHand
 	ch->threadReady = qtrue;
 }
 
+/*
+===============================================================================
+
+MIXING THREAD
+
+===============================================================================
+*/
+
+/*
+================
+S_ExecuteCommand
+
+Runs a command on whichever thread owns the mixing state
+================
+*/
+static void S_NullOutputFrame( int msec );
+
+static void S_ExecuteCommand( const soundCommand_t *cmd ) {
+	soundCommand_t	local;
+	vec3_t			origin;
+
+	switch ( cmd->type ) {
+	case SCMD_START_SOUND:
+		S_StartSoundCmd( cmd );
+		break;
+	case SCMD_START_LOCAL_SOUND:
+		local = *cmd;
+		local.entityNum = listener_number;
+		S_StartSoundCmd( &local );
+		break;
+	case SCMD_START_SOUND_EX:
+		VectorCopy( cmd->origin, origin );
+		S_ThreadStartSoundEx( cmd->hasOrigin ? origin : NULL, cmd->entityNum, cmd->entchannel, cmd->sfxHandle, cmd->flags, cmd->volume );
+		break;
+	case SCMD_CLEAR_LOOPING_SOUNDS:
+		S_ClearLoopingSoundsCmd( (qboolean)cmd->entchannel );
+		break;
+	case SCMD_ADD_LOOPING_SOUND:
+		S_AddLoopingSoundCmd( cmd );
+		break;
+	case SCMD_ADD_REAL_LOOPING_SOUND:
+		S_AddRealLoopingSoundCmd( cmd );
+		break;
+	case SCMD_STOP_LOOPING_SOUND:
+		S_StopLoopingSoundCmd( cmd->entityNum );
+		break;
+	case SCMD_UPDATE_ENTITY_POSITION:
+		VectorCopy( cmd->origin, loopSounds[cmd->entityNum].origin );
+		break;
+	case SCMD_RESPATIALIZE:
+		S_RespatializeCmd( cmd );
+		break;
+	case SCMD_NULL_OUTPUT_FRAME:
+		S_NullOutputFrame( cmd->time );
+		break;
+	}
+}
+
+/*
+================
+S_IssueCommand
+
+Runs the command right away unless the mixing thread owns the state, then
+it is queued until the end of the frame.  While the mixer is locked the
+queue is empty and the command can run directly without reordering.
+================
+*/
+static void S_IssueCommand( const soundCommand_t *cmd ) {
+	if ( !s_mixThreadHandle || s_mixLockDepth ) {
+		S_ExecuteCommand( cmd );
+		return;
+	}
+
+	// hand over what we have and wait for room if the mixer fell behind
+	if ( s_commandWrite - s_commandRead >= MAX_SOUND_COMMANDS ) {
+		S_CommitCommands();
+		while ( s_commandWrite - s_commandRead >= MAX_SOUND_COMMANDS ) {
+			Sys_Sleep( 1 );
+		}
+		Sys_MemoryBarrier();
+	}
+
+	s_commands[s_commandWrite & ( MAX_SOUND_COMMANDS - 1 )] = *cmd;
+	s_commandWrite++;
+}
+
+/*
+================
+S_CommitCommands
+
+Makes the commands issued so far visible to the mixing thread
+================
+*/
+static void S_CommitCommands( void ) {
+	if ( !s_mixThreadHandle ) {
+		return;
+	}
+
+	Sys_MemoryBarrier();
+	s_commandCommit = s_commandWrite;
+}
+
+/*
+================
+S_RunCommands
+
+Mixing thread side of the queue
+================
+*/
+static void S_RunCommands( void ) {
+	unsigned int	commit;
+
+	commit = s_commandCommit;
+	Sys_MemoryBarrier();
+
+	while ( s_commandRead != commit ) {
+		S_ExecuteCommand( &s_commands[s_commandRead & ( MAX_SOUND_COMMANDS - 1 )] );
+		Sys_MemoryBarrier();
+		s_commandRead = s_commandRead + 1;
+	}
+}
+
+/*
+================
+S_LockMixer
+
+Stops the mixing thread once it has run every command issued so far, so
+the caller may change sound data and mixing state.  Nests, and does
+nothing without a mixing thread or on the mixing thread itself.
+================
+*/
+void S_LockMixer( void ) {
+	if ( !s_mixThreadHandle || s_onMixThread ) {
+		return;
+	}
+	if ( s_mixLockDepth++ ) {
+		return;
+	}
+
+	S_CommitCommands();
+	s_mixPauseRequest = 1;
+	Sys_MemoryBarrier();
+
+	while ( !s_mixPaused ) {
+		Sys_Sleep( 1 );
+	}
+	Sys_MemoryBarrier();
+}
+
+/*
+================
+S_UnlockMixer
+================
+*/
+void S_UnlockMixer( void ) {
+	if ( !s_mixThreadHandle || s_onMixThread ) {
+		return;
+	}
+	if ( --s_mixLockDepth ) {
+		return;
+	}
+
+	Sys_MemoryBarrier();
+	s_mixPauseRequest = 0;
+
+	// wait for the resume so the next lock doesn't see a stale pause
+	while ( s_mixPaused ) {
+		Sys_Sleep( 1 );
+	}
+}
+
+/*
+================
+S_MixThread
+================
+*/
+static int S_MixThread( void *data ) {
+	s_onMixThread = qtrue;
+
+	while ( !s_mixQuit ) {
+		S_RunCommands();
+
+		if ( s_mixPauseRequest ) {
+			// the lock committed everything issued before it
+			S_RunCommands();
+			Sys_MemoryBarrier();
+			s_mixPaused = 1;
+
+			while ( s_mixPauseRequest ) {
+				Sys_Sleep( 1 );
+			}
+
+			Sys_MemoryBarrier();
+			s_mixPaused = 0;
+			continue;
+		}
+
+		S_Update_();
+		Sys_Sleep( 1 );
+	}
+
+	S_RunCommands();
+	return 0;
+}
+
+/*
+================
+S_StartMixThread
+================
+*/
+static void S_StartMixThread( void ) {
+	if ( s_mixThreadHandle ) {
+		return;
+	}
+
+	s_commandWrite = 0;
+	s_commandCommit = 0;
+	s_commandRead = 0;
+	s_mixQuit = 0;
+	s_mixPauseRequest = 0;
+	s_mixPaused = 0;
+	s_mixLockDepth = 0;
+	Sys_MemoryBarrier();
+
+	s_mixThreadHandle = Sys_CreateThread( S_MixThread, NULL );
+	if ( !s_mixThreadHandle ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start the sound mixing thread\n" );
+		Cvar_Set( "s_mixThread", "0" );
+	}
+}
+
+/*
+================
+S_StopMixThread
+
+The thread runs whatever is left in the queue before it exits
+================
+*/
+static void S_StopMixThread( void ) {
+	if ( !s_mixThreadHandle ) {
+		return;
+	}
+
+	S_CommitCommands();
+	s_mixQuit = 1;
+	Sys_MemoryBarrier();
+
+	Sys_JoinThread( s_mixThreadHandle );
+	s_mixThreadHandle = NULL;
+}
+
+/*
+================
+S_NullOutputFrame
+
+Moves the scripted dma position of the null output to msec, captures the
+samples that have been played up to there and mixes ahead like S_Update
+================
+*/
+static void S_NullOutputFrame( int msec ) {
+	int		pairs, t, mask;
+	short	*ring;
+
+	pairs = (int)( (double)msec * dma.speed / 1000 );
+	ring = (short *)dma.buffer;
+	mask = ( dma.samples >> 1 ) - 1;
+
+	for ( t = s_nullOutputPairs; t < pairs && t < s_nullCaptureMax; t++ ) {
+		s_nullCapture[t * 2] = ring[( t & mask ) * 2];
+		s_nullCapture[t * 2 + 1] = ring[( t & mask ) * 2 + 1];
+	}
+
+	s_nullOutputPairs = pairs;
+	s_nullOutputTime = msec;
+
+	S_Update_();
+}
+
+#define MIXTEST_FRAMES			300
+#define MIXTEST_FRAME_MSEC		16
+#define MIXTEST_SOUNDS			3
+#define MIXTEST_DMA_SAMPLES		16384
+#define MIXTEST_DMA_SPEED		22050
+
+/*
+================
+S_MixTestRun
+
+Plays a scripted sequence of commands into the null output, either
+directly or through the mixing thread
+================
+*/
+static void S_MixTestRun( sfx_t *sounds, qboolean threaded ) {
+	int				frame;
+	float			yaw;
+	soundCommand_t	cmd;
+
+	// start from silence with the dma position and the clocks at zero
+	s_nullOutputTime = 0;
+	s_nullOutputPairs = 0;
+	s_dmaBuffers = 0;
+	s_dmaOldSamplePos = 0;
+	s_lastMixSoundtime = -1;
+	s_lastMixTime = 0;
+	s_soundtime = 0;
+	s_paintedtime = 0;
+	listener_number = 0;
+	VectorClear( listener_origin );
+	AxisClear( listener_axis );
+	S_Base_ClearSoundBuffer();
+
+	if ( threaded ) {
+		S_StartMixThread();
+	}
+
+	for ( frame = 0; frame < MIXTEST_FRAMES; frame++ ) {
+		Com_Memset( &cmd, 0, sizeof( cmd ) );
+		cmd.type = SCMD_CLEAR_LOOPING_SOUNDS;
+		S_IssueCommand( &cmd );
+
+		Com_Memset( &cmd, 0, sizeof( cmd ) );
+		cmd.type = SCMD_ADD_LOOPING_SOUND;
+		cmd.entityNum = 10;
+		VectorSet( cmd.origin, frame * 8 - 1200, 200, 0 );
+		VectorSet( cmd.velocity, 8, 0, 0 );
+		cmd.sfx = &sounds[1];
+		cmd.framecount = frame;
+		S_IssueCommand( &cmd );
+
+		if ( frame < MIXTEST_FRAMES / 2 ) {
+			Com_Memset( &cmd, 0, sizeof( cmd ) );
+			cmd.type = SCMD_ADD_REAL_LOOPING_SOUND;
+			cmd.entityNum = 11;
+			VectorSet( cmd.origin, -300, -300, 0 );
+			cmd.sfx = &sounds[2];
+			S_IssueCommand( &cmd );
+		}
+
+		Com_Memset( &cmd, 0, sizeof( cmd ) );
+		cmd.type = SCMD_UPDATE_ENTITY_POSITION;
+		cmd.entityNum = 12;
+		VectorSet( cmd.origin, 0, frame * 4 - 600, 0 );
+		S_IssueCommand( &cmd );
+
+		if ( frame % 7 == 0 ) {
+			Com_Memset( &cmd, 0, sizeof( cmd ) );
+			cmd.type = SCMD_START_SOUND;
+			cmd.hasOrigin = qtrue;
+			VectorSet( cmd.origin, frame * 10 - 1500, 50, 0 );
+			cmd.entityNum = 20 + frame % 5;
+			cmd.entchannel = CHAN_AUTO;
+			cmd.sfx = &sounds[frame % MIXTEST_SOUNDS];
+			S_IssueCommand( &cmd );
+		}
+
+		if ( frame % 11 == 0 ) {
+			Com_Memset( &cmd, 0, sizeof( cmd ) );
+			cmd.type = SCMD_START_SOUND;
+			cmd.entityNum = 12;
+			cmd.entchannel = CHAN_VOICE;
+			cmd.sfx = &sounds[0];
+			S_IssueCommand( &cmd );
+		}
+
+		if ( frame % 13 == 0 ) {
+			Com_Memset( &cmd, 0, sizeof( cmd ) );
+			cmd.type = SCMD_START_LOCAL_SOUND;
+			cmd.entchannel = CHAN_LOCAL_SOUND;
+			cmd.sfx = &sounds[2];
+			S_IssueCommand( &cmd );
+		}
+
+		// the listener slowly turns around
+		yaw = frame * 0.02f;
+		Com_Memset( &cmd, 0, sizeof( cmd ) );
+		cmd.type = SCMD_RESPATIALIZE;
+		cmd.entityNum = 1;
+		VectorSet( cmd.axis[0], cos( yaw ), sin( yaw ), 0 );
+		VectorSet( cmd.axis[1], -sin( yaw ), cos( yaw ), 0 );
+		VectorSet( cmd.axis[2], 0, 0, 1 );
+		S_IssueCommand( &cmd );
+
+		Com_Memset( &cmd, 0, sizeof( cmd ) );
+		cmd.type = SCMD_NULL_OUTPUT_FRAME;
+		cmd.time = ( frame + 1 ) * MIXTEST_FRAME_MSEC;
+		S_IssueCommand( &cmd );
+
+		S_CommitCommands();
+	}
+
+	if ( threaded ) {
+		S_StopMixThread();
+	}
+}
+
+/*
+================
+S_MixThreadTest_f
+
+Mixes a scripted command sequence into a null output on the main thread
+and through the mixing thread, and checks both play the same samples
+================
+*/
+static void S_MixThreadTest_f( void ) {
+	static const int	lengths[MIXTEST_SOUNDS] = { 5000, 12000, 30000 };
+	dma_t				oldDma;
+	int					oldSoundtime, oldPaintedtime;
+	int					oldBuffers, oldSamplePos, oldMixSoundtime;
+	float				oldMixTime;
+	qboolean			oldMuted;
+	sfx_t				sounds[MIXTEST_SOUNDS];
+	sndBuffer			*chunks;
+	short				*ref, *out;
+	int					i, j, k, n, numChunks, pairs, differ, first;
+	unsigned int		seed;
+
+	// the real mixer is stopped and restarted by the next S_Update
+	S_StopMixThread();
+
+	numChunks = 0;
+	for ( i = 0; i < MIXTEST_SOUNDS; i++ ) {
+		numChunks += ( lengths[i] + SND_CHUNK_SIZE - 1 ) / SND_CHUNK_SIZE;
+	}
+	chunks = (sndBuffer *)Z_Malloc( sizeof( *chunks ) * numChunks );
+
+	seed = 0x5eed;
+	Com_Memset( sounds, 0, sizeof( sounds ) );
+	for ( i = 0, j = 0; i < MIXTEST_SOUNDS; i++ ) {
+		Com_sprintf( sounds[i].soundName, sizeof( sounds[i].soundName ), "*mixtest%i", i );
+		sounds[i].soundData = &chunks[j];
+		sounds[i].soundLength = lengths[i];
+		sounds[i].inMemory = qtrue;
+
+		for ( k = 0; k < lengths[i]; k += SND_CHUNK_SIZE, j++ ) {
+			chunks[j].next = ( k + SND_CHUNK_SIZE < lengths[i] ) ? &chunks[j + 1] : NULL;
+			chunks[j].size = SND_CHUNK_SIZE;
+			for ( n = 0; n < SND_CHUNK_SIZE; n++ ) {
+				seed = seed * 1664525 + 1013904223;
+				chunks[j].sndChunk[n] = (short)( seed >> 16 ) >> ( i + 1 );
+			}
+		}
+	}
+
+	pairs = MIXTEST_FRAMES * MIXTEST_FRAME_MSEC * MIXTEST_DMA_SPEED / 1000;
+	ref = (short *)Z_Malloc( sizeof( *ref ) * pairs * 2 * 2 );
+	out = ref + pairs * 2;
+
+	oldDma = dma;
+	oldSoundtime = s_soundtime;
+	oldPaintedtime = s_paintedtime;
+	oldBuffers = s_dmaBuffers;
+	oldSamplePos = s_dmaOldSamplePos;
+	oldMixSoundtime = s_lastMixSoundtime;
+	oldMixTime = s_lastMixTime;
+	oldMuted = s_soundMuted;
+
+	// keep the device away from the swapped dma buffer
+	SNDDMA_BeginPainting();
+
+	dma.channels = 2;
+	dma.samples = MIXTEST_DMA_SAMPLES;
+	dma.submission_chunk = 1;
+	dma.samplebits = 16;
+	dma.speed = MIXTEST_DMA_SPEED;
+	dma.buffer = (byte *)Z_Malloc( MIXTEST_DMA_SAMPLES * 2 );
+
+	s_soundMuted = qfalse;
+	s_nullOutput = qtrue;
+	s_nullCaptureMax = pairs;
+
+	s_nullCapture = ref;
+	S_MixTestRun( sounds, qfalse );
+
+	s_nullCapture = out;
+	S_MixTestRun( sounds, qtrue );
+
+	// drop the test channels before their sounds go away
+	S_Base_ClearSoundBuffer();
+
+	s_nullOutput = qfalse;
+	s_nullCapture = NULL;
+	s_nullCaptureMax = 0;
+
+	Z_Free( dma.buffer );
+	dma = oldDma;
+
+	SNDDMA_Submit();
+
+	s_soundtime = oldSoundtime;
+	s_paintedtime = oldPaintedtime;
+	s_dmaBuffers = oldBuffers;
+	s_dmaOldSamplePos = oldSamplePos;
+	s_lastMixSoundtime = oldMixSoundtime;
+	s_lastMixTime = oldMixTime;
+	s_soundMuted = oldMuted;
+	S_Base_ClearSoundBuffer();
+
+	differ = 0;
+	first = -1;
+	for ( i = 0; i < pairs * 2; i++ ) {
+		if ( ref[i] != out[i] ) {
+			if ( first < 0 ) {
+				first = i / 2;
+			}
+			differ++;
+		}
+	}
+
+	if ( differ ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: threaded mix differs in %i of %i samples, first at %i\n", differ, pairs * 2, first );
+	} else {
+		Com_Printf( "%i frames, %i samples: threaded mix matches\n", MIXTEST_FRAMES, pairs );
+	}
+
+	Z_Free( ref );
+	Z_Free( chunks );
+}
+
 /*
 ================
 S_Init
@@ -1696,6 +2493,10 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 	s_mixPreStep = Cvar_Get ("s_mixPreStep", "0.05", CVAR_ARCHIVE, "test");
 	s_show = Cvar_Get ("s_show", "0", CVAR_CHEAT, "test");
 	s_testsound = Cvar_Get ("s_testsound", "0", CVAR_CHEAT, "test");
+	s_mixThread = Cvar_Get ("s_mixThread", "1", CVAR_ARCHIVE, "Mix sound on its own thread");
+
+	S_InitMixer();
+	S_InitDecoding();
 
 	r = SNDDMA_Init();
 
@@ -1704,12 +2505,14 @@ qboolean S_Base_Init( soundInterface_t *si ) {
 		s_soundMuted = (qboolean)1;
 //		s_numSfx = 0;
 
-		Com_Memset(sfxHash, 0, sizeof(sfx_t *)*LOOP_HASH);
+		sfxHash.Clear();
 
 		s_soundtime = 0;
 		s_paintedtime = 0;
 
 		S_Base_StopAllSounds( );
+
+		Cmd_AddCommand( "s_mixThreadTest", S_MixThreadTest_f, "Check that the mixing thread plays the same samples as mixing on the main thread" );
 	} else {
 		return qfalse;
 	}
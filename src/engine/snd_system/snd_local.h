@@ -58,7 +58,6 @@ typedef struct sfx_s {
 	int 			soundLength;
 	char 			soundName[MAX_QPATH];
 	int				lastTimeUsed;
-	struct sfx_s	*next;
 } sfx_t;
 
 typedef struct {
@@ -219,6 +218,7 @@ extern convar_t *s_muted;
 extern convar_t *s_doppler;
 
 extern convar_t *s_testsound;
+extern convar_t *s_mixSIMD;
 
 qboolean S_LoadSound( sfx_t *sfx );
 
@@ -228,9 +228,23 @@ void		SND_setup( void );
 void		SND_shutdown(void);
 
 void S_PaintChannels(int endtime);
+void S_InitMixer( void );
+
+// stop the mixing thread while sound data or mixing state is changed
+void S_LockMixer( void );
+void S_UnlockMixer( void );
 
 void S_memoryLoad(sfx_t *sfx);
 
+// metadata-only registration and background decoding
+extern convar_t *s_decodeThread;
+
+void S_InitDecoding( void );
+void S_ShutdownDecoding( void );
+void S_UpdateDecoding( void );
+void S_RegisterSoundInfo( sfx_t *sfx );
+void S_WaitForDecode( sfx_t *sfx );
+
 // spatializes a channel
 void S_Spatialize(channel_t *ch);
 
@@ -267,6 +267,542 @@ qboolean S_LoadSound( sfx_t *sfx )
 	return qtrue;
 }
 
+/*
+===============================================================================
+
+background decoding
+
+With s_decodeThread set, registering a sound only opens it to read its
+format.  The sound is queued, and S_UpdateDecoding reads the queued files
+into memory streams on the main thread, a few at a time.  The decoding
+thread decodes and resamples them into buffers the main thread allocated,
+and never touches the filesystem, the zone or the sound memory; the main
+thread then copies the samples into sndBuffer chunks shared by every
+channel that plays the sound.
+
+The prefetch only takes chunks from the free list, so it never pushes out
+a sound that has been played.  A sound started before its turn comes is
+loaded right away by S_LoadCommandSound, like before.
+
+===============================================================================
+*/
+
+#define	MAX_DECODE_JOBS		8		// sounds decoded ahead at once
+#define	MAX_DECODE_QUEUE	4096
+
+typedef enum {
+	DECODE_FREE,
+	DECODE_QUEUED,		// handed to the decoding thread
+	DECODE_DONE			// decoded, owned by the main thread again
+} decodeState_t;
+
+typedef struct {
+	sfx_t			*sfx;
+	snd_stream_t	*stream;
+	int				outrate;
+	byte			*data;			// samples in the file's format
+	short			*samples;		// resampled to outrate
+	int				outcount;
+	volatile int	state;
+} decodeJob_t;
+
+convar_t		*s_decodeThread;
+
+static decodeJob_t	s_decodeJobs[MAX_DECODE_JOBS];
+static sfx_t		*s_decodeQueue[MAX_DECODE_QUEUE];
+static int			s_decodeHead;		// written by S_QueueDecode
+static int			s_decodeTail;		// read by S_UpdateDecoding
+
+static void			*s_decodeThreadHandle;
+static volatile int	s_decodeQuit;
+
+/*
+================
+S_ResampledLength
+
+Number of samples ResampleSfx makes out of a sound
+================
+*/
+static int S_ResampledLength( int inrate, int outrate, int samples ) {
+	float	stepscale;
+
+	stepscale = (float)inrate / outrate;
+	return samples / stepscale;
+}
+
+/*
+================
+S_ResampleSamples
+
+Same as ResampleSfx, into a linear buffer
+================
+*/
+static void S_ResampleSamples( short *out, int outcount, int inrate, int outrate, int inwidth, const byte *data ) {
+	float	stepscale;
+	int		i;
+	int		srcsample, samplefrac, fracstep;
+
+	stepscale = (float)inrate / outrate;
+	samplefrac = 0;
+	fracstep = stepscale * 256;
+
+	for ( i = 0 ; i < outcount ; i++ ) {
+		srcsample = samplefrac >> 8;
+		samplefrac += fracstep;
+		if( inwidth == 2 ) {
+			out[i] = ((short *)data)[srcsample];
+		} else {
+			out[i] = (int)( (unsigned char)(data[srcsample]) - 128) << 8;
+		}
+	}
+}
+
+/*
+================
+S_DecodeJob
+
+Runs on the decoding thread
+================
+*/
+static void S_DecodeJob( decodeJob_t *job ) {
+	snd_info_t	*info;
+	int			bytes;
+
+	info = &job->stream->info;
+
+	bytes = S_CodecReadStream( job->stream, info->size, job->data );
+	if ( bytes < 0 ) {
+		bytes = 0;
+	}
+	if ( bytes < info->size ) {
+		memset( job->data + bytes, 0, info->size - bytes );
+	}
+
+	S_ResampleSamples( job->samples, job->outcount, info->rate, job->outrate, info->width, job->data );
+}
+
+/*
+================
+S_DecodeThread
+================
+*/
+static int S_DecodeThread( void *data ) {
+	int			i;
+	qboolean	busy;
+	decodeJob_t	*job;
+
+	while ( !s_decodeQuit ) {
+		busy = qfalse;
+		for ( i = 0, job = s_decodeJobs ; i < MAX_DECODE_JOBS ; i++, job++ ) {
+			if ( job->state != DECODE_QUEUED ) {
+				continue;
+			}
+			Sys_MemoryBarrier();
+			S_DecodeJob( job );
+			Sys_MemoryBarrier();
+			job->state = DECODE_DONE;
+			busy = qtrue;
+		}
+
+		if ( !busy ) {
+			Sys_Sleep( 1 );
+		}
+	}
+
+	return 0;
+}
+
+/*
+================
+S_FreeDecodeJob
+================
+*/
+static void S_FreeDecodeJob( decodeJob_t *job ) {
+	if ( job->stream ) {
+		S_CodecCloseStream( job->stream );
+	}
+	free( job->data );
+	free( job->samples );
+	Com_Memset( job, 0, sizeof( *job ) );
+}
+
+/*
+================
+S_GetFreeDecodeJob
+================
+*/
+static decodeJob_t *S_GetFreeDecodeJob( void ) {
+	int		i;
+
+	for ( i = 0 ; i < MAX_DECODE_JOBS ; i++ ) {
+		if ( s_decodeJobs[i].state == DECODE_FREE ) {
+			return &s_decodeJobs[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+================
+S_SubmitDecodeJob
+
+Reads the sound into memory and hands it to the decoding thread, if the
+decoded sound fits in the free sound memory
+================
+*/
+static qboolean S_SubmitDecodeJob( decodeJob_t *job, sfx_t *sfx ) {
+	snd_stream_t	*stream;
+
+	if ( ( sfx->soundLength + SND_CHUNK_SIZE - 1 ) / SND_CHUNK_SIZE > inUse / (int)sizeof( sndBuffer ) ) {
+		return qfalse;
+	}
+
+	stream = S_CodecOpenMemoryStream( sfx->soundName );
+	if ( !stream ) {
+		return qfalse;
+	}
+
+	job->sfx = sfx;
+	job->stream = stream;
+	job->outrate = dma.speed;
+	job->outcount = S_ResampledLength( stream->info.rate, dma.speed, stream->info.samples );
+	job->data = (byte *)malloc( stream->info.size + 1 );
+	job->samples = (short *)malloc( job->outcount * sizeof( short ) + 1 );
+	if ( !job->data || !job->samples ) {
+		S_FreeDecodeJob( job );
+		return qfalse;
+	}
+
+	Sys_MemoryBarrier();
+	job->state = DECODE_QUEUED;
+	return qtrue;
+}
+
+/*
+================
+S_FinishDecodeJob
+
+Copies the decoded samples of a finished job into sound memory
+================
+*/
+static void S_FinishDecodeJob( decodeJob_t *job ) {
+	sfx_t		*sfx;
+	sndBuffer	*chunk, *newchunk;
+	int			i, count;
+
+	Sys_MemoryBarrier();
+	sfx = job->sfx;
+
+	// the sound may have been loaded while it was decoded, or the memory
+	// may have been taken by other sounds
+	if ( sfx->inMemory || ( job->outcount + SND_CHUNK_SIZE - 1 ) / SND_CHUNK_SIZE > inUse / (int)sizeof( sndBuffer ) ) {
+		S_FreeDecodeJob( job );
+		return;
+	}
+
+	// no channel refers to a sound that isn't in memory yet, and the
+	// chunks come off the free list without evicting anything, so the
+	// mixer doesn't have to be stopped
+	chunk = NULL;
+	for ( i = 0 ; i < job->outcount ; i += SND_CHUNK_SIZE ) {
+		newchunk = SND_malloc();
+		if ( chunk == NULL ) {
+			sfx->soundData = newchunk;
+		} else {
+			chunk->next = newchunk;
+		}
+		chunk = newchunk;
+
+		count = job->outcount - i;
+		if ( count > SND_CHUNK_SIZE ) {
+			count = SND_CHUNK_SIZE;
+		}
+		Com_Memcpy( chunk->sndChunk, job->samples + i, count * sizeof( short ) );
+	}
+
+	// lastTimeUsed stays 0 until the sound is played, so prefetched sounds
+	// are the first to go when the memory runs out
+	sfx->soundCompressionMethod = 0;
+	sfx->soundLength = job->outcount;
+	sfx->inMemory = qtrue;
+
+	S_FreeDecodeJob( job );
+}
+
+/*
+================
+S_QueueDecode
+================
+*/
+static void S_QueueDecode( sfx_t *sfx ) {
+	if ( s_decodeHead - s_decodeTail >= MAX_DECODE_QUEUE ) {
+		return;		// loaded when it is first played
+	}
+	s_decodeQueue[s_decodeHead & ( MAX_DECODE_QUEUE - 1 )] = sfx;
+	s_decodeHead++;
+}
+
+/*
+================
+S_RegisterSoundInfo
+
+Only reads the format of a sound and queues it for decoding
+================
+*/
+void S_RegisterSoundInfo( sfx_t *sfx ) {
+	snd_stream_t	*stream;
+
+	// player specific sounds are never directly loaded
+	if ( sfx->soundName[0] == '*' ) {
+		stream = NULL;
+	} else {
+		stream = S_CodecOpenStream( sfx->soundName );
+	}
+
+	if ( !stream ) {
+		sfx->defaultSound = qtrue;
+		sfx->inMemory = qtrue;
+		return;
+	}
+
+	sfx->soundLength = S_ResampledLength( stream->info.rate, dma.speed, stream->info.samples );
+	S_CodecCloseStream( stream );
+
+	if ( sfx->soundLength <= 0 ) {
+		sfx->defaultSound = qtrue;
+		sfx->inMemory = qtrue;
+		return;
+	}
+
+	S_QueueDecode( sfx );
+}
+
+/*
+================
+S_WaitForDecode
+
+Finishes the decoding of a sound that is about to be played
+================
+*/
+void S_WaitForDecode( sfx_t *sfx ) {
+	int				i;
+	decodeJob_t		*job;
+
+	for ( i = 0, job = s_decodeJobs ; i < MAX_DECODE_JOBS ; i++, job++ ) {
+		if ( job->state != DECODE_FREE && job->sfx == sfx ) {
+			break;
+		}
+	}
+	if ( i == MAX_DECODE_JOBS ) {
+		return;
+	}
+
+	while ( job->state != DECODE_DONE ) {
+		Sys_Sleep( 1 );
+	}
+	S_FinishDecodeJob( job );
+}
+
+/*
+================
+S_StopDecoding
+
+Stops the decoding thread and drops the jobs and the queue
+================
+*/
+static void S_StopDecoding( void ) {
+	int		i;
+
+	if ( s_decodeThreadHandle ) {
+		s_decodeQuit = 1;
+		Sys_MemoryBarrier();
+		Sys_JoinThread( s_decodeThreadHandle );
+		s_decodeThreadHandle = NULL;
+	}
+
+	for ( i = 0 ; i < MAX_DECODE_JOBS ; i++ ) {
+		S_FreeDecodeJob( &s_decodeJobs[i] );
+	}
+	s_decodeHead = s_decodeTail = 0;
+}
+
+/*
+================
+S_UpdateDecoding
+
+Called every frame on the main thread
+================
+*/
+void S_UpdateDecoding( void ) {
+	int			i;
+	sfx_t		*sfx;
+	decodeJob_t	*job;
+
+	if ( !s_decodeThread->integer ) {
+		if ( s_decodeThreadHandle || s_decodeHead != s_decodeTail ) {
+			S_StopDecoding();
+		}
+		return;
+	}
+
+	if ( !s_decodeThreadHandle ) {
+		s_decodeQuit = 0;
+		Sys_MemoryBarrier();
+		s_decodeThreadHandle = Sys_CreateThread( S_DecodeThread, NULL );
+		if ( !s_decodeThreadHandle ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: couldn't start the sound decoding thread\n" );
+			Cvar_Set( "s_decodeThread", "0" );
+			return;
+		}
+	}
+
+	for ( i = 0 ; i < MAX_DECODE_JOBS ; i++ ) {
+		if ( s_decodeJobs[i].state == DECODE_DONE ) {
+			S_FinishDecodeJob( &s_decodeJobs[i] );
+		}
+	}
+
+	// sounds that can't be decoded ahead are loaded when they are played
+	while ( s_decodeTail != s_decodeHead && ( job = S_GetFreeDecodeJob() ) != NULL ) {
+		sfx = s_decodeQueue[s_decodeTail & ( MAX_DECODE_QUEUE - 1 )];
+		s_decodeTail++;
+		if ( !sfx->inMemory ) {
+			S_SubmitDecodeJob( job, sfx );
+		}
+	}
+}
+
+/*
+================
+S_DecodeTest_f
+
+Decodes sounds both ways and compares the samples
+================
+*/
+static void S_DecodeTest_f( void ) {
+	int			i, j, n, start, syncMsec, threadMsec, mismatches;
+	sfx_t		sync, threaded;
+	sndBuffer	*a, *b, *next;
+	qboolean	started;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: s_decodeTest <sound> [sound ...]\n" );
+		return;
+	}
+
+	started = (qboolean)( s_decodeThreadHandle == NULL );
+	if ( started ) {
+		s_decodeQuit = 0;
+		Sys_MemoryBarrier();
+		s_decodeThreadHandle = Sys_CreateThread( S_DecodeThread, NULL );
+		if ( !s_decodeThreadHandle ) {
+			Com_Printf( "couldn't start the sound decoding thread\n" );
+			return;
+		}
+	}
+
+	// get the jobs out of the way
+	for ( i = 0 ; i < MAX_DECODE_JOBS ; i++ ) {
+		if ( s_decodeJobs[i].state != DECODE_FREE ) {
+			S_WaitForDecode( s_decodeJobs[i].sfx );
+		}
+	}
+
+	for ( i = 1 ; i < Cmd_Argc() ; i++ ) {
+		Com_Memset( &sync, 0, sizeof( sync ) );
+		Com_Memset( &threaded, 0, sizeof( threaded ) );
+		Q_strncpyz( sync.soundName, Cmd_Argv( i ), sizeof( sync.soundName ) );
+		Q_strncpyz( threaded.soundName, Cmd_Argv( i ), sizeof( threaded.soundName ) );
+
+		// the synchronous load may evict sounds
+		start = Sys_Milliseconds();
+		S_LockMixer();
+		S_memoryLoad( &sync );
+		S_UnlockMixer();
+		syncMsec = Sys_Milliseconds() - start;
+
+		start = Sys_Milliseconds();
+		S_RegisterSoundInfo( &threaded );
+		if ( !threaded.defaultSound ) {
+			if ( S_SubmitDecodeJob( S_GetFreeDecodeJob(), &threaded ) ) {
+				S_WaitForDecode( &threaded );
+			}
+		}
+		threadMsec = Sys_Milliseconds() - start;
+
+		// the queue entry S_RegisterSoundInfo made points at the stack
+		if ( s_decodeHead != s_decodeTail && s_decodeQueue[( s_decodeHead - 1 ) & ( MAX_DECODE_QUEUE - 1 )] == &threaded ) {
+			s_decodeHead--;
+		}
+
+		if ( sync.defaultSound || threaded.defaultSound ) {
+			Com_Printf( "%s: couldn't load\n", sync.soundName );
+		} else if ( !threaded.inMemory ) {
+			Com_Printf( "%s: not enough sound memory\n", sync.soundName );
+		} else {
+			mismatches = 0;
+			if ( sync.soundLength != threaded.soundLength ) {
+				mismatches++;
+			}
+			a = sync.soundData;
+			b = threaded.soundData;
+			for ( j = 0 ; j < sync.soundLength && a && b ; j += SND_CHUNK_SIZE ) {
+				n = sync.soundLength - j;
+				if ( n > SND_CHUNK_SIZE ) {
+					n = SND_CHUNK_SIZE;
+				}
+				if ( memcmp( a->sndChunk, b->sndChunk, n * sizeof( short ) ) ) {
+					mismatches++;
+				}
+				a = a->next;
+				b = b->next;
+			}
+			Com_Printf( "%s: %i samples, %s, %i msec loading, %i msec decoding\n", sync.soundName,
+				sync.soundLength, mismatches ? S_COLOR_RED "MISMATCH" S_COLOR_WHITE : "match", syncMsec, threadMsec );
+		}
+
+		for ( a = sync.soundData ; a ; a = next ) {
+			next = a->next;
+			SND_free( a );
+		}
+		for ( b = threaded.soundData ; b ; b = next ) {
+			next = b->next;
+			SND_free( b );
+		}
+	}
+
+	if ( started ) {
+		S_StopDecoding();
+	}
+}
+
+/*
+================
+S_InitDecoding
+================
+*/
+void S_InitDecoding( void ) {
+	s_decodeThread = Cvar_Get( "s_decodeThread", "1", CVAR_ARCHIVE, "Register sounds without loading them and decode them on their own thread" );
+
+	Com_Memset( s_decodeJobs, 0, sizeof( s_decodeJobs ) );
+	s_decodeHead = s_decodeTail = 0;
+
+	Cmd_AddCommand( "s_decodeTest", S_DecodeTest_f, "Check that sounds decoded on the decoding thread match loading them directly" );
+}
+
+/*
+================
+S_ShutdownDecoding
+================
+*/
+void S_ShutdownDecoding( void ) {
+	S_StopDecoding();
+	Cmd_RemoveCommand( "s_decodeTest" );
+}
+
 void S_DisplayFreeMemory(void) {
 	Com_Printf("%d bytes free sound buffer memory, %d total used\n", inUse, totalInUse);
+	if ( s_decodeHead != s_decodeTail ) {
+		Com_Printf("%d sounds waiting to be decoded\n", s_decodeHead - s_decodeTail);
+	}
 }
@@ -40,35 +40,106 @@ Maryland 20850 USA.
 #include <altivec.h>
 #endif
 
+#if !defined(C_ONLY) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SND_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SND_SIMD_SSE2 0
+#endif
+
 static portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 static int snd_vol;
 
+convar_t		*s_mixSIMD;
+
+static qboolean	snd_haveSSE2;	// cpu and build support the SSE2 kernels
+static qboolean	snd_mixSSE2;	// use them for the current mix
+
 int*     snd_p;  
 int      snd_linear_count;
 short*   snd_out;
 
-void S_WriteLinearBlastStereo16 (void)
-{
+static void S_ClipSamples_scalar( const int *in, short *out, int count ) {
 	int		i;
 	int		val;
 
-	for (i=0 ; i<snd_linear_count ; i+=2)
+	for (i=0 ; i<count ; i++)
 	{
-		val = snd_p[i]>>8;
+		val = in[i]>>8;
 		if (val > 0x7fff)
-			snd_out[i] = 0x7fff;
+			out[i] = 0x7fff;
 		else if (val < -32768)
-			snd_out[i] = -32768;
+			out[i] = -32768;
 		else
-			snd_out[i] = val;
+			out[i] = val;
+	}
+}
 
-		val = snd_p[i+1]>>8;
-		if (val > 0x7fff)
-			snd_out[i+1] = 0x7fff;
-		else if (val < -32768)
-			snd_out[i+1] = -32768;
-		else
-			snd_out[i+1] = val;
+#if SND_SIMD_SSE2
+static void S_ClipSamples_sse2( const int *in, short *out, int count ) {
+	int		i;
+	__m128i	a, b;
+
+	// the signed saturating pack clamps exactly like the scalar code
+	for (i=0 ; i+8<=count ; i+=8)
+	{
+		a = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( in + i ) ), 8 );
+		b = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( in + i + 4 ) ), 8 );
+		_mm_storeu_si128( (__m128i *)( out + i ), _mm_packs_epi32( a, b ) );
+	}
+
+	S_ClipSamples_scalar( in + i, out + i, count - i );
+}
+#endif
+
+static void S_ClipSamples( const int *in, short *out, int count ) {
+#if SND_SIMD_SSE2
+	if (snd_mixSSE2) {
+		S_ClipSamples_sse2( in, out, count );
+		return;
+	}
+#endif
+	S_ClipSamples_scalar( in, out, count );
+}
+
+void S_WriteLinearBlastStereo16 (void)
+{
+	S_ClipSamples( snd_p, snd_out, snd_linear_count );
+}
+
+/*
+===================
+S_AddRawSamples
+
+Accumulates count stereo samples of a raw stream into the paint buffer
+===================
+*/
+static void S_AddRawSamples( portable_samplepair_t *dst, const portable_samplepair_t *src, int count ) {
+	int		i;
+
+#if SND_SIMD_SSE2
+	if (snd_mixSSE2) {
+		__m128i	a, b;
+
+		for (i=0 ; i+2<=count ; i+=2)
+		{
+			a = _mm_loadu_si128( (const __m128i *)( dst + i ) );
+			b = _mm_loadu_si128( (const __m128i *)( src + i ) );
+			_mm_storeu_si128( (__m128i *)( dst + i ), _mm_add_epi32( a, b ) );
+		}
+		for ( ; i<count ; i++)
+		{
+			dst[i].left += src[i].left;
+			dst[i].right += src[i].right;
+		}
+		return;
+	}
+#endif
+
+	for (i=0 ; i<count ; i++)
+	{
+		dst[i].left += src[i].left;
+		dst[i].right += src[i].right;
 	}
 }
 
@@ -430,6 +501,111 @@ static void S_PaintChannelFrom16_scalar( channel_t *ch, const sfx_t *sc, int cou
 	}
 }
 
+#if SND_SIMD_SSE2
+/*
+===================
+S_ScaleSamples_sse2
+
+Multiplies four mono samples, each duplicated into a left/right pair of
+16 bit lanes, by the channel volume and returns them as two vectors of
+(data * vol) >> 8 stereo pairs.  The volume is split as vol = hi * 256 + lo
+so that both factors fit a signed 16 bit lane and the result is exactly
+data * hi + ((data * lo) >> 8), which is what the scalar code computes
+===================
+*/
+static ID_INLINE void S_ScaleSamples_sse2( __m128i data, __m128i volHi, __m128i volLo, __m128i *r0, __m128i *r1 ) {
+	__m128i	hl, hh, ll, lh;
+
+	hl = _mm_mullo_epi16( data, volHi );
+	hh = _mm_mulhi_epi16( data, volHi );
+	ll = _mm_mullo_epi16( data, volLo );
+	lh = _mm_mulhi_epi16( data, volLo );
+
+	*r0 = _mm_add_epi32( _mm_unpacklo_epi16( hl, hh ), _mm_srai_epi32( _mm_unpacklo_epi16( ll, lh ), 8 ) );
+	*r1 = _mm_add_epi32( _mm_unpackhi_epi16( hl, hh ), _mm_srai_epi32( _mm_unpackhi_epi16( ll, lh ), 8 ) );
+}
+
+static void S_PaintChannelFrom16_sse2( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
+	int						data;
+	int						leftvol, rightvol;
+	int						i, j, n;
+	portable_samplepair_t	*samp, *dst;
+	sndBuffer				*chunk;
+	const short				*samples, *src;
+	__m128i					volHi, volLo, d, lo, hi, a, b;
+
+	leftvol = ch->leftvol*snd_vol;
+	rightvol = ch->rightvol*snd_vol;
+
+	// doppler resampling walks a float position per output sample and
+	// volumes that don't split into two 16 bit factors are left to the
+	// scalar code
+	if ((ch->doppler && ch->dopplerScale != 1.0f) ||
+		leftvol < 0 || leftvol > 0x7fffff || rightvol < 0 || rightvol > 0x7fffff) {
+		S_PaintChannelFrom16_scalar( ch, sc, count, sampleOffset, bufferOffset );
+		return;
+	}
+
+	samp = &paintbuffer[ bufferOffset ];
+
+	if (ch->doppler) {
+		sampleOffset = sampleOffset*ch->oldDopplerScale;
+	}
+
+	chunk = sc->soundData;
+	while (sampleOffset>=SND_CHUNK_SIZE) {
+		chunk = chunk->next;
+		sampleOffset -= SND_CHUNK_SIZE;
+		if (!chunk) {
+			chunk = sc->soundData;
+		}
+	}
+
+	volHi = _mm_set1_epi32( ((rightvol >> 8) << 16) | (leftvol >> 8) );
+	volLo = _mm_set1_epi32( ((rightvol & 255) << 16) | (leftvol & 255) );
+
+	samples = chunk->sndChunk;
+	for ( i=0 ; i<count ; i+=n ) {
+		if (sampleOffset == SND_CHUNK_SIZE) {
+			chunk = chunk->next;
+			samples = chunk->sndChunk;
+			sampleOffset = 0;
+		}
+
+		// mix up to the end of the current chunk
+		n = count - i;
+		if (n > SND_CHUNK_SIZE - sampleOffset) {
+			n = SND_CHUNK_SIZE - sampleOffset;
+		}
+		src = samples + sampleOffset;
+		dst = samp + i;
+
+		for ( j=0 ; j+8<=n ; j+=8 ) {
+			d = _mm_loadu_si128( (const __m128i *)( src + j ) );
+
+			S_ScaleSamples_sse2( _mm_unpacklo_epi16( d, d ), volHi, volLo, &lo, &hi );
+			a = _mm_loadu_si128( (const __m128i *)( dst + j ) );
+			b = _mm_loadu_si128( (const __m128i *)( dst + j + 2 ) );
+			_mm_storeu_si128( (__m128i *)( dst + j ), _mm_add_epi32( a, lo ) );
+			_mm_storeu_si128( (__m128i *)( dst + j + 2 ), _mm_add_epi32( b, hi ) );
+
+			S_ScaleSamples_sse2( _mm_unpackhi_epi16( d, d ), volHi, volLo, &lo, &hi );
+			a = _mm_loadu_si128( (const __m128i *)( dst + j + 4 ) );
+			b = _mm_loadu_si128( (const __m128i *)( dst + j + 6 ) );
+			_mm_storeu_si128( (__m128i *)( dst + j + 4 ), _mm_add_epi32( a, lo ) );
+			_mm_storeu_si128( (__m128i *)( dst + j + 6 ), _mm_add_epi32( b, hi ) );
+		}
+		for ( ; j<n ; j++ ) {
+			data = src[j];
+			dst[j].left += (data * leftvol)>>8;
+			dst[j].right += (data * rightvol)>>8;
+		}
+
+		sampleOffset += n;
+	}
+}
+#endif
+
 static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset ) {
 #if idppc_altivec
 	if (com_altivec->integer) {
@@ -437,6 +613,12 @@ static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sc, int count, int
 		S_PaintChannelFrom16_altivec( ch, sc, count, sampleOffset, bufferOffset );
 		return;
 	}
+#endif
+#if SND_SIMD_SSE2
+	if (snd_mixSSE2) {
+		S_PaintChannelFrom16_sse2( ch, sc, count, sampleOffset, bufferOffset );
+		return;
+	}
 #endif
 	S_PaintChannelFrom16_scalar( ch, sc, count, sampleOffset, bufferOffset );
 }
@@ -603,6 +785,8 @@ void S_PaintChannels( int endtime ) {
 	else
 		snd_vol = s_volume->value*255;
 
+	snd_mixSSE2 = (qboolean)(snd_haveSSE2 && s_mixSIMD->integer);
+
 //Com_Printf ("%i to %i\n", s_paintedtime, endtime);
 	while ( s_paintedtime < endtime ) {
 		// if paintbuffer is smaller than DMA buffer
@@ -617,12 +801,16 @@ void S_PaintChannels( int endtime ) {
 		for (stream = 0; stream < MAX_RAW_STREAMS; stream++) {
 			if ( s_rawend[stream] >= s_paintedtime ) {
 				// copy from the streaming sound source
+				// in linear runs up to the end of the ring buffer
 				const portable_samplepair_t *rawsamples = s_rawsamples[stream];
 				const int stop = (end < s_rawend[stream]) ? end : s_rawend[stream];
-				for ( i = s_paintedtime ; i < stop ; i++ ) {
+				for ( i = s_paintedtime ; i < stop ; i += count ) {
 					const int s = i&(MAX_RAW_SAMPLES-1);
-					paintbuffer[i-s_paintedtime].left += rawsamples[s].left;
-					paintbuffer[i-s_paintedtime].right += rawsamples[s].right;
+					count = stop - i;
+					if ( count > MAX_RAW_SAMPLES - s ) {
+						count = MAX_RAW_SAMPLES - s;
+					}
+					S_AddRawSamples( &paintbuffer[i-s_paintedtime], &rawsamples[s], count );
 				}
 			}
 		}
@@ -637,6 +825,10 @@ void S_PaintChannels( int endtime ) {
 			ltime = s_paintedtime;
 			sc = ch->thesfx;
 
+			if (sc->soundData==NULL) {
+				continue;
+			}
+
 			sampleOffset = ltime - ch->startSample;
 			count = end - ltime;
 			if ( sampleOffset + count > sc->soundLength ) {
@@ -701,6 +893,186 @@ void S_PaintChannels( int endtime ) {
 	}
 }
 
+/*
+===============================================================================
+
+MIXER BENCHMARK
+
+===============================================================================
+*/
+
+#define MIXBENCH_CHANNELS	32
+#define MIXBENCH_CHUNKS		8
+
+/*
+===================
+S_MixBenchPass
+
+Mixes the benchmark channels and raw stream into the paint buffer and
+clips them into out, returns the time taken in msec
+===================
+*/
+static int S_MixBenchPass( channel_t *chans, const sfx_t *sfx, const portable_samplepair_t *raw, short *out, int iterations ) {
+	int		i, n, start;
+	int		ltime, count, sampleOffset;
+
+	start = Sys_Milliseconds();
+
+	for ( n = 0; n < iterations; n++ ) {
+		Com_Memset(paintbuffer, 0, sizeof (paintbuffer));
+		S_AddRawSamples( paintbuffer, raw, PAINTBUFFER_SIZE );
+
+		// every channel loops the sound like the looped channels do
+		for ( i = 0; i < MIXBENCH_CHANNELS; i++ ) {
+			ltime = 0;
+			do {
+				sampleOffset = (ltime + i * 97) % sfx->soundLength;
+				count = PAINTBUFFER_SIZE - ltime;
+				if ( sampleOffset + count > sfx->soundLength ) {
+					count = sfx->soundLength - sampleOffset;
+				}
+				S_PaintChannelFrom16( &chans[i], sfx, count, sampleOffset, ltime );
+				ltime += count;
+			} while ( ltime < PAINTBUFFER_SIZE );
+		}
+
+		S_ClipSamples( (int *)paintbuffer, out, PAINTBUFFER_SIZE * 2 );
+	}
+
+	return Sys_Milliseconds() - start;
+}
+
+/*
+===================
+S_MixBench_f
+
+Mixes a fixed set of synthetic channels and a raw stream with the scalar
+and the SSE2 kernels into a scratch output buffer instead of the DMA
+buffer, reports the time taken and checks that both produce the same
+samples
+===================
+*/
+static void S_MixBench_f( void ) {
+	int						i, iterations, differ;
+	int						scalarTime, simdTime;
+	int						oldVol;
+	qboolean				oldMixSSE2;
+	unsigned int			seed;
+	sfx_t					sfx;
+	sndBuffer				*chunks;
+	channel_t				*chans;
+	portable_samplepair_t	*raw;
+	short					*out, *ref;
+
+	iterations = 200;
+	if ( Cmd_Argc() > 1 ) {
+		iterations = atoi( Cmd_Argv( 1 ) );
+		if ( iterations < 1 ) {
+			iterations = 1;
+		}
+	}
+
+	chunks = (sndBuffer *)Z_Malloc( sizeof( *chunks ) * MIXBENCH_CHUNKS );
+	chans = (channel_t *)Z_Malloc( sizeof( *chans ) * MIXBENCH_CHANNELS );
+	raw = (portable_samplepair_t *)Z_Malloc( sizeof( *raw ) * PAINTBUFFER_SIZE );
+	out = (short *)Z_Malloc( sizeof( *out ) * PAINTBUFFER_SIZE * 2 * 2 );
+	ref = out + PAINTBUFFER_SIZE * 2;
+
+	// full scale noise so the sum clips regularly
+	seed = 0x1234567;
+	for ( i = 0; i < MIXBENCH_CHUNKS * SND_CHUNK_SIZE; i++ ) {
+		seed = seed * 1664525 + 1013904223;
+		chunks[i / SND_CHUNK_SIZE].sndChunk[i % SND_CHUNK_SIZE] = (short)( seed >> 16 );
+	}
+	for ( i = 0; i < MIXBENCH_CHUNKS; i++ ) {
+		chunks[i].next = ( i < MIXBENCH_CHUNKS - 1 ) ? &chunks[i + 1] : NULL;
+		chunks[i].size = SND_CHUNK_SIZE;
+	}
+	for ( i = 0; i < PAINTBUFFER_SIZE; i++ ) {
+		seed = seed * 1664525 + 1013904223;
+		raw[i].left = (int)( seed >> 8 ) - 0x800000;
+		raw[i].right = -raw[i].left / 2;
+	}
+
+	Com_Memset( &sfx, 0, sizeof( sfx ) );
+	Q_strncpyz( sfx.soundName, "*mixbench", sizeof( sfx.soundName ) );
+	sfx.soundData = chunks;
+	sfx.inMemory = qtrue;
+	// not a multiple of the chunk or vector size so the tails get mixed
+	sfx.soundLength = MIXBENCH_CHUNKS * SND_CHUNK_SIZE - 333;
+
+	// every eighth channel is doppler shifted, which stays on the scalar path
+	for ( i = 0; i < MIXBENCH_CHANNELS; i++ ) {
+		chans[i].thesfx = &sfx;
+		chans[i].leftvol = 16 + ( i * 37 ) % 240;
+		chans[i].rightvol = 255 - ( i * 53 ) % 240;
+		chans[i].master_vol = 255;
+		chans[i].doppler = ( i & 7 ) == 7 ? qtrue : qfalse;
+		chans[i].dopplerScale = chans[i].doppler ? 1.5f : 1.0f;
+		chans[i].oldDopplerScale = 1.0f;
+	}
+
+	S_LockMixer();
+
+	oldVol = snd_vol;
+	oldMixSSE2 = snd_mixSSE2;
+	snd_vol = 255;
+
+	snd_mixSSE2 = qfalse;
+	scalarTime = S_MixBenchPass( chans, &sfx, raw, ref, iterations );
+
+	Com_Printf( "%i iterations of %i channels, %i samples each\n", iterations, MIXBENCH_CHANNELS, PAINTBUFFER_SIZE );
+	Com_Printf( "scalar: %i msec\n", scalarTime );
+
+	if ( snd_haveSSE2 ) {
+		snd_mixSSE2 = qtrue;
+		simdTime = S_MixBenchPass( chans, &sfx, raw, out, iterations );
+
+		differ = 0;
+		for ( i = 0; i < PAINTBUFFER_SIZE * 2; i++ ) {
+			if ( out[i] != ref[i] ) {
+				differ++;
+			}
+		}
+
+		Com_Printf( "SSE2:   %i msec\n", simdTime );
+		if ( differ ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: SSE2 mix differs from the scalar mix in %i samples\n", differ );
+		} else {
+			Com_Printf( "SSE2 mix matches the scalar mix\n" );
+		}
+	} else {
+		Com_Printf( "SSE2 mixing not available\n" );
+	}
+
+	snd_vol = oldVol;
+	snd_mixSSE2 = oldMixSSE2;
+
+	S_UnlockMixer();
+
+	Z_Free( out );
+	Z_Free( raw );
+	Z_Free( chans );
+	Z_Free( chunks );
+}
+
+/*
+===================
+S_InitMixer
+===================
+*/
+void S_InitMixer( void ) {
+	s_mixSIMD = Cvar_Get( "s_mixSIMD", "1", CVAR_ARCHIVE, "Mix sound with the SSE2 kernels when the cpu supports them" );
+
+#if SND_SIMD_SSE2
+	snd_haveSSE2 = ( Sys_GetProcessorFeatures() & CF_SSE2 ) ? qtrue : qfalse;
+#else
+	snd_haveSSE2 = qfalse;
+#endif
+
+	Cmd_AddCommand( "s_mixBench", S_MixBench_f, "Benchmark the scalar and SSE2 sound mixers, optional iteration count" );
+}
+
 /*
 ===================
 S_GetVoiceAmplitude
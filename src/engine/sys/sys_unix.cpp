@@ -49,6 +49,7 @@ Maryland 20850 USA.
 #include <libgen.h>
 #include <fcntl.h>
 #include <fenv.h>
+#include <pthread.h>
 
 qboolean stdinIsATTY;
 
@@ -208,6 +209,18 @@ qboolean Sys_LowPhysicalMemory( void )
 	return qfalse;
 }
 
+/*
+==================
+Sys_ProcessorCount
+==================
+*/
+unsigned int Sys_ProcessorCount( void )
+{
+	long count = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return count > 0 ? (unsigned int)count : 1;
+}
+
 /*
 ==================
 Sys_Basename
@@ -455,6 +468,166 @@ void Sys_FreeFileList( char **list )
 	Z_Free( list );
 }
 
+typedef struct {
+	pthread_t       thread;
+	sysThreadFunc_t function;
+	void           *data;
+} unixThread_t;
+
+/*
+==================
+Sys_ThreadMain
+==================
+*/
+static void *Sys_ThreadMain( void *arg )
+{
+	unixThread_t *t = (unixThread_t *)arg;
+
+	t->function( t->data );
+	return NULL;
+}
+
+/*
+==================
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==================
+*/
+void *Sys_CreateThread( sysThreadFunc_t function, void *data )
+{
+	unixThread_t *t;
+
+	t = (unixThread_t *)malloc( sizeof( *t ) );
+	t->function = function;
+	t->data = data;
+
+	if( pthread_create( &t->thread, NULL, Sys_ThreadMain, t ) != 0 )
+	{
+		free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+/*
+==================
+Sys_JoinThread
+
+Waits for the thread to finish and frees it
+==================
+*/
+void Sys_JoinThread( void *thread )
+{
+	unixThread_t *t = (unixThread_t *)thread;
+
+	pthread_join( t->thread, NULL );
+	free( t );
+}
+
+/*
+==================
+Sys_MemoryBarrier
+==================
+*/
+void Sys_MemoryBarrier( void )
+{
+	__sync_synchronize();
+}
+
+/*
+==================
+Sys_AtomicAdd
+==================
+*/
+int Sys_AtomicAdd( volatile int *value, int add )
+{
+	return __sync_add_and_fetch( value, add );
+}
+
+/*
+==================
+Sys_AtomicCompareExchange
+==================
+*/
+int Sys_AtomicCompareExchange( volatile int *value, int exchange, int comparand )
+{
+	return __sync_val_compare_and_swap( value, comparand, exchange );
+}
+
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;
+	int             count;
+} unixSemaphore_t;
+
+/*
+==================
+Sys_CreateSemaphore
+
+Built on a condition variable, unnamed sem_t isn't available everywhere
+==================
+*/
+void *Sys_CreateSemaphore( void )
+{
+	unixSemaphore_t *s;
+
+	s = (unixSemaphore_t *)malloc( sizeof( *s ) );
+	pthread_mutex_init( &s->mutex, NULL );
+	pthread_cond_init( &s->cond, NULL );
+	s->count = 0;
+
+	return s;
+}
+
+/*
+==================
+Sys_DestroySemaphore
+==================
+*/
+void Sys_DestroySemaphore( void *sem )
+{
+	unixSemaphore_t *s = (unixSemaphore_t *)sem;
+
+	pthread_cond_destroy( &s->cond );
+	pthread_mutex_destroy( &s->mutex );
+	free( s );
+}
+
+/*
+==================
+Sys_PostSemaphore
+==================
+*/
+void Sys_PostSemaphore( void *sem )
+{
+	unixSemaphore_t *s = (unixSemaphore_t *)sem;
+
+	pthread_mutex_lock( &s->mutex );
+	s->count++;
+	pthread_cond_signal( &s->cond );
+	pthread_mutex_unlock( &s->mutex );
+}
+
+/*
+==================
+Sys_WaitSemaphore
+==================
+*/
+void Sys_WaitSemaphore( void *sem )
+{
+	unixSemaphore_t *s = (unixSemaphore_t *)sem;
+
+	pthread_mutex_lock( &s->mutex );
+	while( s->count <= 0 )
+	{
+		pthread_cond_wait( &s->cond, &s->mutex );
+	}
+	s->count--;
+	pthread_mutex_unlock( &s->mutex );
+}
+
 /*
 ==================
 Sys_Sleep
@@ -263,6 +263,18 @@ qboolean Sys_LowPhysicalMemory( void ) {
 #endif
 }
 
+/*
+==================
+Sys_ProcessorCount
+==================
+*/
+unsigned int Sys_ProcessorCount( void ) {
+	SYSTEM_INFO info;
+
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
 /*
 ==============
 Sys_Basename
@@ -546,6 +558,124 @@ void Sys_FreeFileList( char **list ) {
 }
 
 
+typedef struct {
+	HANDLE          handle;
+	sysThreadFunc_t function;
+	void           *data;
+} win32Thread_t;
+
+/*
+==============
+Sys_ThreadMain
+==============
+*/
+static DWORD WINAPI Sys_ThreadMain( LPVOID arg ) {
+	win32Thread_t *t = (win32Thread_t *)arg;
+
+	return t->function( t->data );
+}
+
+/*
+==============
+Sys_CreateThread
+
+Returns NULL if the thread couldn't be started
+==============
+*/
+void *Sys_CreateThread( sysThreadFunc_t function, void *data ) {
+	win32Thread_t *t;
+
+	t = (win32Thread_t *)malloc( sizeof( *t ) );
+	t->function = function;
+	t->data = data;
+	t->handle = CreateThread( NULL, 0, Sys_ThreadMain, t, 0, NULL );
+
+	if( !t->handle ) {
+		free( t );
+		return NULL;
+	}
+
+	return t;
+}
+
+/*
+==============
+Sys_JoinThread
+
+Waits for the thread to finish and frees it
+==============
+*/
+void Sys_JoinThread( void *thread ) {
+	win32Thread_t *t = (win32Thread_t *)thread;
+
+	WaitForSingleObject( t->handle, INFINITE );
+	CloseHandle( t->handle );
+	free( t );
+}
+
+/*
+==============
+Sys_MemoryBarrier
+==============
+*/
+void Sys_MemoryBarrier( void ) {
+	MemoryBarrier();
+}
+
+/*
+==============
+Sys_AtomicAdd
+==============
+*/
+int Sys_AtomicAdd( volatile int *value, int add ) {
+	return InterlockedExchangeAdd( (volatile LONG *)value, add ) + add;
+}
+
+/*
+==============
+Sys_AtomicCompareExchange
+==============
+*/
+int Sys_AtomicCompareExchange( volatile int *value, int exchange, int comparand ) {
+	return InterlockedCompareExchange( (volatile LONG *)value, exchange, comparand );
+}
+
+/*
+==============
+Sys_CreateSemaphore
+==============
+*/
+void *Sys_CreateSemaphore( void ) {
+	return CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+}
+
+/*
+==============
+Sys_DestroySemaphore
+==============
+*/
+void Sys_DestroySemaphore( void *sem ) {
+	CloseHandle( (HANDLE)sem );
+}
+
+/*
+==============
+Sys_PostSemaphore
+==============
+*/
+void Sys_PostSemaphore( void *sem ) {
+	ReleaseSemaphore( (HANDLE)sem, 1, NULL );
+}
+
+/*
+==============
+Sys_WaitSemaphore
+==============
+*/
+void Sys_WaitSemaphore( void *sem ) {
+	WaitForSingleObject( (HANDLE)sem, INFINITE );
+}
+
 /*
 ==============
 Sys_Sleep
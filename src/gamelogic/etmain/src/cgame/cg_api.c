@@ -1079,4 +1079,10 @@ int trap_R_AnimFrameRate(qhandle_t hAnim) {
 //172.
 void trap_CompleteCallback( const char *complete ) {
 	syscall( CG_COMPLETE_CALLBACK, complete );
+}
+
+//173.
+//CM_ModelBounds(args[1], VMA(2), VMA(3));
+void trap_CM_ModelBounds(clipHandle_t model, vec3_t mins, vec3_t maxs) {
+	syscall(CG_CM_MODELBOUNDS, model, mins, maxs);
 }
\ No newline at end of file
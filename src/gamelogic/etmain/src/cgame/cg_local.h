@@ -1192,7 +1192,8 @@ typedef struct
 
 	centity_t      *satchelCharge;
 
-	playerState_t   backupStates[MAX_BACKUP_STATES];
+	playerState_t   backupStates[MAX_BACKUP_STATES];	// predicted states, oldest at backupStateTop
+	pmoveExt_t      backupPmext[MAX_BACKUP_STATES];
 	int             backupStateTop;
 	int             backupStateTail;
 	int             lastPredictedCommand;
@@ -1916,6 +1917,8 @@ typedef struct
 	int             numInlineModels;
 	qhandle_t       inlineDrawModel[MAX_MODELS];
 	vec3_t          inlineModelMidpoints[MAX_MODELS];
+	vec3_t          inlineModelMins[MAX_MODELS];
+	vec3_t          inlineModelMaxs[MAX_MODELS];
 
 	clientInfo_t    clientinfo[MAX_CLIENTS];
 
@@ -2129,6 +2132,7 @@ extern vmCvar_t cg_errorDecay;
 extern vmCvar_t cg_nopredict;
 extern vmCvar_t cg_noPlayerAnims;
 extern vmCvar_t cg_showmiss;
+extern vmCvar_t cg_optimizePrediction;
 extern vmCvar_t cg_footsteps;
 extern vmCvar_t cg_markTime;
 extern vmCvar_t cg_brassTime;
@@ -166,6 +166,7 @@ vmCvar_t        cg_errorDecay;
 vmCvar_t        cg_nopredict;
 vmCvar_t        cg_noPlayerAnims;
 vmCvar_t        cg_showmiss;
+vmCvar_t        cg_optimizePrediction;
 vmCvar_t        cg_footsteps;
 vmCvar_t        cg_markTime;
 vmCvar_t        cg_brassTime;
@@ -424,6 +425,7 @@ cvarTable_t     cvarTable[] = {
 	{&cg_nopredict, "cg_nopredict", "0", CVAR_CHEAT},
 	{&cg_noPlayerAnims, "cg_noplayeranims", "0", CVAR_CHEAT},
 	{&cg_showmiss, "cg_showmiss", "0", 0},
+	{&cg_optimizePrediction, "cg_optimizePrediction", "1", CVAR_ARCHIVE},
 	{&cg_footsteps, "cg_footsteps", "1", CVAR_CHEAT},
 	{&cg_tracerChance, "cg_tracerchance", "0.4", CVAR_CHEAT},
 	{&cg_tracerWidth, "cg_tracerwidth", "0.8", CVAR_CHEAT},
@@ -1964,6 +1966,9 @@ static void CG_RegisterGraphics(void)
 		{
 			cgs.inlineModelMidpoints[i][j] = mins[j] + 0.5 * (maxs[j] - mins[j]);
 		}
+
+		// collision bounds, used to cull traces against the model
+		trap_CM_ModelBounds(trap_CM_InlineModel(i), cgs.inlineModelMins[i], cgs.inlineModelMaxs[i]);
 	}
 
 	CG_LoadingString(" - server models");
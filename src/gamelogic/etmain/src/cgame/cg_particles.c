@@ -151,6 +151,163 @@ vec3_t          rforward, rright, rup;
 
 float           oldtime;
 
+/*
+** Particle poly batches
+**
+** Polys are collected for the whole frame and handed to the renderer with
+** one trap_R_AddPolysToScene per shader and vertex count.  The renderer
+** sorts and fogs each poly on its own, so the submission order is free.
+*/
+#define MAX_PARTICLE_BATCHES	64
+
+typedef struct
+{
+	qhandle_t       shader;
+	int             numVerts;
+	int             numPolys;
+	int             firstVert;		// next free vert in particleBatchVerts while flushing
+} particleBatch_t;
+
+static particleBatch_t particleBatches[MAX_PARTICLE_BATCHES];
+static int      numParticleBatches;
+static int      lastParticleBatch;
+
+static polyVert_t particlePolyVerts[MAX_PARTICLES * 4];	// in the order they were added
+static int      particlePolyFirstVert[MAX_PARTICLES];
+static byte     particlePolyBatch[MAX_PARTICLES];
+static int      numParticlePolys;
+static int      numParticlePolyVerts;
+
+static polyVert_t particleBatchVerts[MAX_PARTICLES * 4];	// grouped by batch
+
+/*
+** Hot particle state
+**
+** The motion of the surviving particles is gathered into flat arrays each
+** frame so it is evaluated in straight loops the compiler can vectorize,
+** rather than while chasing the list.
+*/
+static cparticle_t *liveParticles[MAX_PARTICLES];
+static float    liveTime[MAX_PARTICLES];
+static float    liveTime2[MAX_PARTICLES];
+static float    liveAlpha[MAX_PARTICLES];
+static float    liveOrg[3][MAX_PARTICLES];
+static float    liveVel[3][MAX_PARTICLES];
+static float    liveAccel[3][MAX_PARTICLES];
+static int      numLiveParticles;
+
+/*
+===============
+CG_ClearParticlePolys
+===============
+*/
+static void CG_ClearParticlePolys(void)
+{
+	numParticleBatches = 0;
+	lastParticleBatch = 0;
+	numParticlePolys = 0;
+	numParticlePolyVerts = 0;
+}
+
+/*
+===============
+CG_AddParticlePoly
+===============
+*/
+static void CG_AddParticlePoly(qhandle_t shader, int numVerts, const polyVert_t * verts)
+{
+	particleBatch_t *batch;
+	int             i;
+
+	if(numParticlePolys == MAX_PARTICLES || numParticlePolyVerts + numVerts > MAX_PARTICLES * 4)
+	{
+		trap_R_AddPolyToScene(shader, numVerts, verts);
+		return;
+	}
+
+	// consecutive particles usually share a shader
+	batch = &particleBatches[lastParticleBatch];
+	if(lastParticleBatch >= numParticleBatches || batch->shader != shader || batch->numVerts != numVerts)
+	{
+		for(i = 0, batch = particleBatches; i < numParticleBatches; i++, batch++)
+		{
+			if(batch->shader == shader && batch->numVerts == numVerts)
+			{
+				break;
+			}
+		}
+
+		if(i == numParticleBatches)
+		{
+			if(numParticleBatches == MAX_PARTICLE_BATCHES)
+			{
+				trap_R_AddPolyToScene(shader, numVerts, verts);
+				return;
+			}
+
+			batch->shader = shader;
+			batch->numVerts = numVerts;
+			batch->numPolys = 0;
+			numParticleBatches++;
+		}
+
+		lastParticleBatch = i;
+	}
+
+	memcpy(&particlePolyVerts[numParticlePolyVerts], verts, numVerts * sizeof(polyVert_t));
+	particlePolyFirstVert[numParticlePolys] = numParticlePolyVerts;
+	particlePolyBatch[numParticlePolys] = lastParticleBatch;
+	numParticlePolys++;
+	numParticlePolyVerts += numVerts;
+
+	batch->numPolys++;
+}
+
+/*
+===============
+CG_FlushParticlePolys
+===============
+*/
+static void CG_FlushParticlePolys(void)
+{
+	particleBatch_t *batch;
+	int             i, numVerts;
+
+	if(numParticleBatches == 1)
+	{
+		// nothing to group
+		batch = &particleBatches[0];
+		trap_R_AddPolysToScene(batch->shader, batch->numVerts, particlePolyVerts, batch->numPolys);
+		CG_ClearParticlePolys();
+		return;
+	}
+
+	numVerts = 0;
+	for(i = 0, batch = particleBatches; i < numParticleBatches; i++, batch++)
+	{
+		batch->firstVert = numVerts;
+		numVerts += batch->numPolys * batch->numVerts;
+	}
+
+	for(i = 0; i < numParticlePolys; i++)
+	{
+		batch = &particleBatches[particlePolyBatch[i]];
+
+		memcpy(&particleBatchVerts[batch->firstVert], &particlePolyVerts[particlePolyFirstVert[i]],
+			   batch->numVerts * sizeof(polyVert_t));
+		batch->firstVert += batch->numVerts;
+	}
+
+	numVerts = 0;
+	for(i = 0, batch = particleBatches; i < numParticleBatches; i++, batch++)
+	{
+		trap_R_AddPolysToScene(batch->shader, batch->numVerts, &particleBatchVerts[numVerts], batch->numPolys);
+		numVerts += batch->numPolys * batch->numVerts;
+	}
+
+	CG_ClearParticlePolys();
+}
+
 /*
 ===============
 CL_ClearParticles
@@ -935,11 +1092,11 @@ void CG_AddParticleToScene(cparticle_t * p, vec3_t org, float alpha)
 
 	if(p->type == P_WEATHER || p->type == P_WEATHER_TURBULENT || p->type == P_WEATHER_FLURRY)
 	{
-		trap_R_AddPolyToScene(p->pshader, 3, TRIverts);
+		CG_AddParticlePoly(p->pshader, 3, TRIverts);
 	}
 	else
 	{
-		trap_R_AddPolyToScene(p->pshader, 4, verts);
+		CG_AddParticlePoly(p->pshader, 4, verts);
 	}
 
 }
@@ -956,12 +1113,11 @@ void CG_AddParticles(void)
 {
 	cparticle_t    *p, *next;
 	float           alpha;
-	float           time, time2;
+	float           time;
 	vec3_t          org;
-	int             color;
 	cparticle_t    *active, *tail;
-	int             type;
 	vec3_t          rotate_ang;
+	int             i, j;
 
 	if(!initparticles)
 	{
@@ -982,6 +1138,9 @@ void CG_AddParticles(void)
 	active = NULL;
 	tail = NULL;
 
+	CG_ClearParticlePolys();
+	numLiveParticles = 0;
+
 	for(p = active_particles; p; p = next)
 	{
 
@@ -1072,20 +1231,47 @@ void CG_AddParticles(void)
 			alpha = 1;
 		}
 
-		color = p->color;
+		liveParticles[numLiveParticles] = p;
+		liveTime[numLiveParticles] = time;
+		liveAlpha[numLiveParticles] = alpha;
+		for(j = 0; j < 3; j++)
+		{
+			liveOrg[j][numLiveParticles] = p->org[j];
+			liveVel[j][numLiveParticles] = p->vel[j];
+			liveAccel[j][numLiveParticles] = p->accel[j];
+		}
+		numLiveParticles++;
+	}
+
+	active_particles = active;
 
-		time2 = time * time;
+	// move everything that survived
+	for(i = 0; i < numLiveParticles; i++)
+	{
+		liveTime2[i] = liveTime[i] * liveTime[i];
+	}
 
-		org[0] = p->org[0] + p->vel[0] * time + p->accel[0] * time2;
-		org[1] = p->org[1] + p->vel[1] * time + p->accel[1] * time2;
-		org[2] = p->org[2] + p->vel[2] * time + p->accel[2] * time2;
+	for(j = 0; j < 3; j++)
+	{
+		for(i = 0; i < numLiveParticles; i++)
+		{
+			liveOrg[j][i] = liveOrg[j][i] + liveVel[j][i] * liveTime[i] + liveAccel[j][i] * liveTime2[i];
+		}
+	}
 
-		type = p->type;
+	for(i = 0; i < numLiveParticles; i++)
+	{
+		org[0] = liveOrg[0][i];
+		org[1] = liveOrg[1][i];
+		org[2] = liveOrg[2][i];
 
-		CG_AddParticleToScene(p, org, alpha);
+		CG_AddParticleToScene(liveParticles[i], org, liveAlpha[i]);
 	}
 
-	active_particles = active;
+	if(numParticlePolys)
+	{
+		CG_FlushParticlePolys();
+	}
 }
 
 /*
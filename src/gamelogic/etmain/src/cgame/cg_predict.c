@@ -50,6 +50,28 @@ static centity_t *cg_solidFTEntities[MAX_ENTITIES_IN_SNAPSHOT];
 static int      cg_numTriggerEntities;
 static centity_t *cg_triggerEntities[MAX_ENTITIES_IN_SNAPSHOT];
 
+// solid entities whose bmodel doesn't move are binned into a coarse grid on
+// the xy plane, so a trace only looks at the ones in the cells its swept box
+// covers.  Cells wrap around, which only adds candidates.  Everything that
+// does get looked at is still culled by its bounds before it is traced.
+#define SOLIDGRID_SIZE		32			// cells on each axis, power of two
+#define SOLIDGRID_CELL		512			// cell size in world units
+#define SOLIDGRID_MAXCELLS	64			// more than this and all cells are used
+#define SOLIDGRID_WORDS		( MAX_ENTITIES_IN_SNAPSHOT / 32 )
+#define SOLID_CULL_EPSILON	1.0f		// covers the collision epsilons
+
+typedef struct
+{
+	qboolean        valid;
+	snapshot_t     *snap;				// cg.snap the grid was built for
+	int             serverTime;
+	int             dynamic[SOLIDGRID_WORDS];	// always tested
+	int             cells[SOLIDGRID_SIZE * SOLIDGRID_SIZE][SOLIDGRID_WORDS];
+} solidGrid_t;
+
+static solidGrid_t cg_solidGrid;
+static solidGrid_t cg_solidFTGrid;
+
 /*
 ====================
 CG_BuildSolidList
@@ -70,6 +92,9 @@ void CG_BuildSolidList(void)
 	cg_numSolidFTEntities = 0;
 	cg_numTriggerEntities = 0;
 
+	cg_solidGrid.valid = qfalse;
+	cg_solidFTGrid.valid = qfalse;
+
 	if(cg.nextSnap && !cg.nextFrameTeleport && !cg.thisFrameTeleport)
 	{
 		snap = cg.nextSnap;
@@ -145,6 +170,231 @@ void CG_BuildSolidList(void)
 	}
 }
 
+/*
+====================
+CG_SolidEntityPosition
+
+Where the entity is for collision at cg.physicsTime
+====================
+*/
+static void CG_SolidEntityPosition(centity_t * cent, vec3_t origin, vec3_t angles)
+{
+	if(cent->currentState.solid == SOLID_BMODEL)
+	{
+		BG_EvaluateTrajectory(&cent->currentState.apos, cg.physicsTime, angles, qtrue, cent->currentState.effect2Time);
+		BG_EvaluateTrajectory(&cent->currentState.pos, cg.physicsTime, origin, qfalse, cent->currentState.effect2Time);
+	}
+	else
+	{
+		VectorCopy(vec3_origin, angles);
+		VectorCopy(cent->lerpOrigin, origin);
+	}
+}
+
+/*
+====================
+CG_SolidEntityBounds
+
+Conservative world bounds of what CG_ClipMoveToEntities traces against
+====================
+*/
+static void CG_SolidEntityBounds(centity_t * cent, const vec3_t origin, const vec3_t angles, vec3_t absmin, vec3_t absmax)
+{
+	entityState_t  *ent = &cent->currentState;
+	float           radius;
+	int             x, zd, zu;
+
+	if(ent->solid == SOLID_BMODEL)
+	{
+		if(angles[0] || angles[1] || angles[2])
+		{
+			// rotated around the origin
+			radius = RadiusFromBounds(cgs.inlineModelMins[ent->modelindex], cgs.inlineModelMaxs[ent->modelindex]);
+			absmin[0] = origin[0] - radius;
+			absmin[1] = origin[1] - radius;
+			absmin[2] = origin[2] - radius;
+			absmax[0] = origin[0] + radius;
+			absmax[1] = origin[1] + radius;
+			absmax[2] = origin[2] + radius;
+		}
+		else
+		{
+			VectorAdd(origin, cgs.inlineModelMins[ent->modelindex], absmin);
+			VectorAdd(origin, cgs.inlineModelMaxs[ent->modelindex], absmax);
+		}
+	}
+	else
+	{
+		// encoded bbox
+		x = (ent->solid & 255);
+		zd = ((ent->solid >> 8) & 255);
+		zu = ((ent->solid >> 16) & 255) - 32;
+
+		absmin[0] = origin[0] - x;
+		absmin[1] = origin[1] - x;
+		absmin[2] = origin[2] - zd;
+		absmax[0] = origin[0] + x;
+		absmax[1] = origin[1] + x;
+		absmax[2] = origin[2] + zu;
+	}
+
+	absmin[0] -= SOLID_CULL_EPSILON;
+	absmin[1] -= SOLID_CULL_EPSILON;
+	absmin[2] -= SOLID_CULL_EPSILON;
+	absmax[0] += SOLID_CULL_EPSILON;
+	absmax[1] += SOLID_CULL_EPSILON;
+	absmax[2] += SOLID_CULL_EPSILON;
+}
+
+/*
+====================
+CG_SolidGridCellRange
+
+Returns qfalse if the bounds cover too many cells to be worth binning
+====================
+*/
+static qboolean CG_SolidGridCellRange(const vec3_t absmin, const vec3_t absmax, int *x0, int *y0, int *x1, int *y1)
+{
+	*x0 = (int)floor(absmin[0] / SOLIDGRID_CELL);
+	*y0 = (int)floor(absmin[1] / SOLIDGRID_CELL);
+	*x1 = (int)floor(absmax[0] / SOLIDGRID_CELL);
+	*y1 = (int)floor(absmax[1] / SOLIDGRID_CELL);
+
+	return (*x1 - *x0 + 1) * (*y1 - *y0 + 1) <= SOLIDGRID_MAXCELLS;
+}
+
+/*
+====================
+CG_BuildSolidGrid
+
+Bins the entities of a solid list, rebuilt whenever cg.snap has moved on
+since the currentState of the entities changes with it
+====================
+*/
+static void CG_BuildSolidGrid(solidGrid_t * grid, centity_t ** entities, int numEntities)
+{
+	int             i, x, y, x0, y0, x1, y1;
+	int            *cell;
+	centity_t      *cent;
+	vec3_t          origin, angles, absmin, absmax;
+
+	memset(grid->dynamic, 0, sizeof(grid->dynamic));
+	memset(grid->cells, 0, sizeof(grid->cells));
+
+	for(i = 0; i < numEntities; i++)
+	{
+		cent = entities[i];
+
+		// only bmodels that stay put, everything else moves between snapshots
+		if(cent->currentState.solid != SOLID_BMODEL ||
+		   cent->currentState.pos.trType != TR_STATIONARY || cent->currentState.apos.trType != TR_STATIONARY)
+		{
+			grid->dynamic[i >> 5] |= 1 << (i & 31);
+			continue;
+		}
+
+		CG_SolidEntityPosition(cent, origin, angles);
+		CG_SolidEntityBounds(cent, origin, angles, absmin, absmax);
+
+		if(!CG_SolidGridCellRange(absmin, absmax, &x0, &y0, &x1, &y1))
+		{
+			grid->dynamic[i >> 5] |= 1 << (i & 31);
+			continue;
+		}
+
+		for(y = y0; y <= y1; y++)
+		{
+			for(x = x0; x <= x1; x++)
+			{
+				cell = grid->cells[(y & (SOLIDGRID_SIZE - 1)) * SOLIDGRID_SIZE + (x & (SOLIDGRID_SIZE - 1))];
+				cell[i >> 5] |= 1 << (i & 31);
+			}
+		}
+	}
+
+	grid->valid = qtrue;
+	grid->snap = cg.snap;
+	grid->serverTime = cg.snap->serverTime;
+}
+
+/*
+====================
+CG_SolidGridCandidates
+
+Sets the bit of every entry in the solid list a trace through the swept box
+could touch
+====================
+*/
+static void CG_SolidGridCandidates(solidGrid_t * grid, centity_t ** entities, int numEntities,
+								   const vec3_t absmin, const vec3_t absmax, int *bits)
+{
+	int             i, x, y, x0, y0, x1, y1;
+	int            *cell;
+
+	if(!cg.snap)
+	{
+		memset(bits, 0xff, SOLIDGRID_WORDS * sizeof(int));
+		return;
+	}
+
+	if(!grid->valid || grid->snap != cg.snap || grid->serverTime != cg.snap->serverTime)
+	{
+		CG_BuildSolidGrid(grid, entities, numEntities);
+	}
+
+	if(!CG_SolidGridCellRange(absmin, absmax, &x0, &y0, &x1, &y1))
+	{
+		memset(bits, 0xff, SOLIDGRID_WORDS * sizeof(int));
+		return;
+	}
+
+	memcpy(bits, grid->dynamic, SOLIDGRID_WORDS * sizeof(int));
+	for(y = y0; y <= y1; y++)
+	{
+		for(x = x0; x <= x1; x++)
+		{
+			cell = grid->cells[(y & (SOLIDGRID_SIZE - 1)) * SOLIDGRID_SIZE + (x & (SOLIDGRID_SIZE - 1))];
+			for(i = 0; i < SOLIDGRID_WORDS; i++)
+			{
+				bits[i] |= cell[i];
+			}
+		}
+	}
+}
+
+/*
+====================
+CG_SweptBounds
+====================
+*/
+static void CG_SweptBounds(const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, vec3_t absmin, vec3_t absmax)
+{
+	int             i;
+
+	if(!mins)
+	{
+		mins = vec3_origin;
+	}
+	if(!maxs)
+	{
+		maxs = vec3_origin;
+	}
+
+	for(i = 0; i < 3; i++)
+	{
+		if(start[i] < end[i])
+		{
+			absmin[i] = start[i] + mins[i];
+			absmax[i] = end[i] + maxs[i];
+		}
+		else
+		{
+			absmin[i] = end[i] + mins[i];
+			absmax[i] = start[i] + maxs[i];
+		}
+	}
+}
+
 /*
 ====================
 CG_ClipMoveToEntities
@@ -160,10 +410,20 @@ static void CG_ClipMoveToEntities(const vec3_t start, const vec3_t mins, const v
 	clipHandle_t    cmodel;
 	vec3_t          bmins, bmaxs;
 	vec3_t          origin, angles;
+	vec3_t          tmins, tmaxs, absmin, absmax;
+	int             candidates[SOLIDGRID_WORDS];
 	centity_t      *cent;
 
+	CG_SweptBounds(start, mins, maxs, end, tmins, tmaxs);
+	CG_SolidGridCandidates(&cg_solidGrid, cg_solidEntities, cg_numSolidEntities, tmins, tmaxs, candidates);
+
 	for(i = 0; i < cg_numSolidEntities; i++)
 	{
+		if(!(candidates[i >> 5] & (1 << (i & 31))))
+		{
+			continue;
+		}
+
 		cent = cg_solidEntities[i];
 		ent = &cent->currentState;
 
@@ -172,14 +432,21 @@ static void CG_ClipMoveToEntities(const vec3_t start, const vec3_t mins, const v
 			continue;
 		}
 
+		// a trace that doesn't reach the bounds can't change the result
+		CG_SolidEntityPosition(cent, origin, angles);
+		CG_SolidEntityBounds(cent, origin, angles, absmin, absmax);
+		if(absmin[0] > tmaxs[0] || absmin[1] > tmaxs[1] || absmin[2] > tmaxs[2] ||
+		   absmax[0] < tmins[0] || absmax[1] < tmins[1] || absmax[2] < tmins[2])
+		{
+			continue;
+		}
+
 		if(ent->solid == SOLID_BMODEL)
 		{
 			// special value for bmodel
 			cmodel = trap_CM_InlineModel(ent->modelindex);
 //          VectorCopy( cent->lerpAngles, angles );
 //          VectorCopy( cent->lerpOrigin, origin );
-			BG_EvaluateTrajectory(&cent->currentState.apos, cg.physicsTime, angles, qtrue, cent->currentState.effect2Time);
-			BG_EvaluateTrajectory(&cent->currentState.pos, cg.physicsTime, origin, qfalse, cent->currentState.effect2Time);
 		}
 		else
 		{
@@ -195,9 +462,6 @@ static void CG_ClipMoveToEntities(const vec3_t start, const vec3_t mins, const v
 
 			//cmodel = trap_CM_TempCapsuleModel( bmins, bmaxs );
 			cmodel = trap_CM_TempBoxModel(bmins, bmaxs);
-
-			VectorCopy(vec3_origin, angles);
-			VectorCopy(cent->lerpOrigin, origin);
 		}
 		// MrE: use bbox of capsule
 		if(capsule)
@@ -234,10 +498,20 @@ static void CG_ClipMoveToEntities_FT(const vec3_t start, const vec3_t mins, cons
 	clipHandle_t    cmodel;
 	vec3_t          bmins, bmaxs;
 	vec3_t          origin, angles;
+	vec3_t          tmins, tmaxs, absmin, absmax;
+	int             candidates[SOLIDGRID_WORDS];
 	centity_t      *cent;
 
+	CG_SweptBounds(start, mins, maxs, end, tmins, tmaxs);
+	CG_SolidGridCandidates(&cg_solidFTGrid, cg_solidFTEntities, cg_numSolidFTEntities, tmins, tmaxs, candidates);
+
 	for(i = 0; i < cg_numSolidFTEntities; i++)
 	{
+		if(!(candidates[i >> 5] & (1 << (i & 31))))
+		{
+			continue;
+		}
+
 		cent = cg_solidFTEntities[i];
 		ent = &cent->currentState;
 
@@ -246,14 +520,21 @@ static void CG_ClipMoveToEntities_FT(const vec3_t start, const vec3_t mins, cons
 			continue;
 		}
 
+		// a trace that doesn't reach the bounds can't change the result
+		CG_SolidEntityPosition(cent, origin, angles);
+		CG_SolidEntityBounds(cent, origin, angles, absmin, absmax);
+		if(absmin[0] > tmaxs[0] || absmin[1] > tmaxs[1] || absmin[2] > tmaxs[2] ||
+		   absmax[0] < tmins[0] || absmax[1] < tmins[1] || absmax[2] < tmins[2])
+		{
+			continue;
+		}
+
 		if(ent->solid == SOLID_BMODEL)
 		{
 			// special value for bmodel
 			cmodel = trap_CM_InlineModel(ent->modelindex);
 //          VectorCopy( cent->lerpAngles, angles );
 //          VectorCopy( cent->lerpOrigin, origin );
-			BG_EvaluateTrajectory(&cent->currentState.apos, cg.physicsTime, angles, qtrue, cent->currentState.effect2Time);
-			BG_EvaluateTrajectory(&cent->currentState.pos, cg.physicsTime, origin, qfalse, cent->currentState.effect2Time);
 		}
 		else
 		{
@@ -268,9 +549,6 @@ static void CG_ClipMoveToEntities_FT(const vec3_t start, const vec3_t mins, cons
 			bmaxs[2] = zu;
 
 			cmodel = trap_CM_TempCapsuleModel(bmins, bmaxs);
-
-			VectorCopy(vec3_origin, angles);
-			VectorCopy(cent->lerpOrigin, origin);
 		}
 		// MrE: use bbox of capsule
 		if(capsule)
@@ -770,8 +1048,8 @@ qboolean CG_PredictionOk(playerState_t * ps1, playerState_t * ps2)
 		return qfalse;
 	}
 
-	if(ps1->groundEntityNum != ENTITYNUM_WORLD || ps1->groundEntityNum != ENTITYNUM_NONE ||
-	   ps2->groundEntityNum != ENTITYNUM_WORLD || ps2->groundEntityNum != ENTITYNUM_NONE)
+	// movers keep moving after the state was saved
+	if(ps1->groundEntityNum != ENTITYNUM_WORLD && ps1->groundEntityNum != ENTITYNUM_NONE)
 	{
 		return qfalse;
 	}
@@ -823,7 +1101,7 @@ qboolean CG_PredictionOk(playerState_t * ps1, playerState_t * ps2)
 
 	for(i = 0; i < 3; i++)
 	{
-		if(abs(ps2->viewangles[i] - ps1->viewangles[i]) > MAX_PREDICT_VIEWANGLES_DELTA)
+		if(fabs(ps2->viewangles[i] - ps1->viewangles[i]) > MAX_PREDICT_VIEWANGLES_DELTA)
 		{
 			return qfalse;
 		}
@@ -904,15 +1182,13 @@ playerState_t.
 For normal gameplay, it will be the result of predicted usercmd_t on
 top of the most recent playerState_t received from the server.
 
-Each new snapshot will usually have one or more new usercmd over the last,
-but we simulate all unacknowledged commands each time, not just the new ones.
-This means that on an internet connection, quite a few pmoves may be issued
-each frame.
-
-OPTIMIZE: don't re-simulate unless the newly arrived snapshot playerState_t
-differs from the predicted one.  Would require saving all intermediate
-playerState_t during prediction. (this is "dead reckoning" and would definately
-be nice to have in there (SA))
+Each new snapshot will usually have one or more new usercmd over the last.
+With cg_optimizePrediction the playerState_t after every predicted command is
+saved in cg.backupStates.  When a new snapshot agrees with the state saved for
+the command it acknowledged (CG_PredictionOk), the commands after it are played
+back from the saved states and only the commands that were never predicted
+run Pmove.  Otherwise all unacknowledged commands are simulated again, which
+on an internet connection means quite a few pmoves each frame.
 
 We detect prediction errors and allow them to be decayed off over several frames
 to ease the jerk.
@@ -937,7 +1213,10 @@ void CG_PredictPlayerState( void ) {
 	usercmd_t latestCmd;
 	vec3_t deltaAngles;
 	pmoveExt_t pmext;
-//	int useCommand = 0;
+	int useCommand;
+	int stateIndex;
+	int numPredicted, numPlayedBack;
+	int i;
 
 	cg.hyperspace = qfalse; // will be set if touching a trigger_teleport
 
@@ -1086,6 +1365,46 @@ void CG_PredictPlayerState( void ) {
 	cg_pmove.pmove_fixed = pmove_fixed.integer; // | cg_pmove_fixed.integer;
 	cg_pmove.pmove_msec = pmove_msec.integer;
 
+	// find the first command that has to be run through Pmove, the ones
+	// before it are played back from the saved states
+	if ( !cg_optimizePrediction.integer || cg_pmove.pmove_fixed ) {
+		RESET_PREDICTION
+	} else if ( cg.nextFrameTeleport || cg.thisFrameTeleport ) {
+		RESET_PREDICTION
+	} else if ( cg.physicsTime != cg.lastPhysicsTime ) {
+		// a new snapshot, check it against the state saved for the
+		// last command it acknowledged
+		useCommand = 0;
+		for ( i = cg.backupStateTop; i != cg.backupStateTail; i = ( i + 1 ) % MAX_BACKUP_STATES ) {
+			if ( cg.backupStates[i].commandTime == cg.predictedPlayerState.commandTime ) {
+				if ( CG_PredictionOk( &cg.predictedPlayerState, &cg.backupStates[i] ) ) {
+					// drop the states the server has caught up with
+					cg.backupStateTop = ( i + 1 ) % MAX_BACKUP_STATES;
+					useCommand = cg.lastPredictedCommand + 1;
+				} else if ( cg_showmiss.integer ) {
+					CG_Printf( "saved state mismatch\n" );
+				}
+				break;
+			}
+		}
+		if ( !useCommand ) {
+			RESET_PREDICTION
+		}
+	} else {
+		// same snapshot as last frame, only new commands need predicting
+		useCommand = cg.lastPredictedCommand + 1;
+	}
+
+	if ( useCommand < current - CMD_BACKUP + 1 || useCommand > current + 1 ) {
+		// the saved states are too old or from before a map_restart
+		RESET_PREDICTION
+	}
+
+	cg.lastPhysicsTime = cg.physicsTime;
+	stateIndex = cg.backupStateTop;
+	numPredicted = 0;
+	numPlayedBack = 0;
+
 	// run cmds
 	moved = qfalse;
 	for ( cmdNum = current - CMD_BACKUP + 1 ; cmdNum <= current ; cmdNum++ ) {
@@ -1194,15 +1513,37 @@ void CG_PredictPlayerState( void ) {
 			cg_pmove.covertopsChargeTime =  cg.covertopsChargeTime[cg.snap->ps.persistant[PERS_TEAM] - 1];
 		}
 
-//		memcpy( &pmext, &cg.pmext, sizeof(pmoveExt_t) );	// grab data, we only want the final result
-		// rain - copy the pmext as it was just before we
-		// previously ran this cmd (or, this will be the
-		// current predicted data if this is the current cmd)  (#166)
-		memcpy( &pmext, &oldpmext[cmdNum & CMD_MASK], sizeof( pmoveExt_t ) );
-
-		fflush( stdout );
-
-		Pmove( &cg_pmove );
+		if ( cmdNum < useCommand && stateIndex != cg.backupStateTail &&
+			 cg.backupStates[stateIndex].commandTime == cg_pmove.cmd.serverTime ) {
+			// predicted in an earlier frame and still valid
+			*cg_pmove.ps = cg.backupStates[stateIndex];
+			memcpy( &pmext, &cg.backupPmext[stateIndex], sizeof( pmoveExt_t ) );
+			stateIndex = ( stateIndex + 1 ) % MAX_BACKUP_STATES;
+			numPlayedBack++;
+		} else {
+			// everything after this command has to be predicted again
+			useCommand = cmdNum;
+			cg.backupStateTail = stateIndex;
+
+//			memcpy( &pmext, &cg.pmext, sizeof(pmoveExt_t) );	// grab data, we only want the final result
+			// rain - copy the pmext as it was just before we
+			// previously ran this cmd (or, this will be the
+			// current predicted data if this is the current cmd)  (#166)
+			memcpy( &pmext, &oldpmext[cmdNum & CMD_MASK], sizeof( pmoveExt_t ) );
+
+			Pmove( &cg_pmove );
+			numPredicted++;
+
+			// save the result for the following frames, unless the queue
+			// is full, in which case the next frame falls back to Pmove
+			if ( ( stateIndex + 1 ) % MAX_BACKUP_STATES != cg.backupStateTop ) {
+				cg.backupStates[stateIndex] = *cg_pmove.ps;
+				memcpy( &cg.backupPmext[stateIndex], &pmext, sizeof( pmoveExt_t ) );
+				stateIndex = ( stateIndex + 1 ) % MAX_BACKUP_STATES;
+				cg.backupStateTail = stateIndex;
+			}
+			cg.lastPredictedCommand = cmdNum;
+		}
 
 		moved = qtrue;
 
@@ -1211,7 +1552,7 @@ void CG_PredictPlayerState( void ) {
 	}
 
 	if ( cg_showmiss.integer > 1 ) {
-		CG_Printf( "[%i : %i] ", cg_pmove.cmd.serverTime, cg.time );
+		CG_Printf( "[%i : %i] %i pmove, %i played back\n", cg_pmove.cmd.serverTime, cg.time, numPredicted, numPlayedBack );
 	}
 
 	if ( !moved ) {
@@ -85,6 +85,7 @@ int             modalMenuCount = 0;
 static qboolean debugMode = qfalse;
 
 #define DOUBLE_CLICK_DELAY 300
+#define KEYWORDHASH_SIZE    512
 static int      lastListBoxClickTime = 0;
 
 void            Item_MouseLeave(itemDef_t * item);
@@ -93,6 +94,9 @@ void            Item_Paint(itemDef_t * item);
 void            Item_RunScript(itemDef_t * item, qboolean * bAbort, const char *s);
 void            Item_SetupKeywordHash(void);
 void            Menu_SetupKeywordHash(void);
+static void     Script_SetupCommandHash(void);
+static void     Script_ClearCache(void);
+int             KeywordHash_Key(char *keyword);
 int             BindingIDFromName(const char *name);
 qboolean        Item_Bind_HandleKey(itemDef_t * item, int key, qboolean down);
 itemDef_t      *Menu_SetPrevCursorItem(menuDef_t * menu);
@@ -332,6 +336,8 @@ void String_Init()
 	UI_InitMemory();
 	Item_SetupKeywordHash();
 	Menu_SetupKeywordHash();
+	Script_SetupCommandHash();
+	Script_ClearCache();
 	if(DC && DC->getBindingBuf)
 	{
 		Controls_GetConfig();
@@ -362,6 +368,162 @@ void LerpColor(vec4_t a, vec4_t b, vec4_t c, float t)
 	}
 }
 
+/*
+===============
+Compiled scripts
+
+Item scripts and enableCvar lists are split into tokens once and kept as a
+run of SCRIPT_TOKEN prefixed strings, so running them again only walks the
+tokens.  The parse helpers below accept both forms, which keeps the script
+handlers unchanged.  Strings from the string pool don't change until the
+next String_Init, so those are cached by pointer.
+===============
+*/
+
+#define SCRIPT_TOKEN			'\x01'
+#define SCRIPT_HASH_SIZE		512
+#ifdef CGAME
+#define SCRIPT_CACHE_SIZE		32 * 1024
+#else
+#define SCRIPT_CACHE_SIZE		128 * 1024
+#endif
+
+typedef struct compiledScript_s
+{
+	struct compiledScript_s *next;
+	const char     *source;
+	int             maxLength;
+	char           *tokens;
+} compiledScript_t;
+
+static char     scriptCache[SCRIPT_CACHE_SIZE];
+static int      scriptCachePoint;
+static compiledScript_t *compiledScriptHash[SCRIPT_HASH_SIZE];
+
+/*
+=================
+Script_ClearCache
+=================
+*/
+static void Script_ClearCache(void)
+{
+	scriptCachePoint = 0;
+	memset(compiledScriptHash, 0, sizeof(compiledScriptHash));
+}
+
+/*
+=================
+Script_ParseToken
+
+Next token of either a compiled or a plain text script
+=================
+*/
+static char    *Script_ParseToken(char **p)
+{
+	char           *token;
+
+	if(*p && **p == SCRIPT_TOKEN)
+	{
+		token = *p + 1;
+		*p = token + strlen(token) + 1;
+		return token;
+	}
+
+	return COM_ParseExt(p, qfalse);
+}
+
+/*
+=================
+Script_Compile
+
+Returns the size of the compiled script, 0 if it didn't fit
+=================
+*/
+static int Script_Compile(const char *s, int maxLength, char *out, int outSize)
+{
+	char            script[4096], *p, *token;
+	int             len, used;
+
+	// scripts used to be run from a buffer this size
+	Q_strncpyz(script, s, maxLength < sizeof(script) ? maxLength : sizeof(script));
+	p = script;
+	used = 0;
+
+	while(1)
+	{
+		// empty tokens are kept, a failed argument doesn't end the script
+		token = COM_ParseExt(&p, qfalse);
+		if(!p)
+		{
+			break;
+		}
+
+		len = strlen(token);
+		if(used + len + 3 > outSize)
+		{
+			return 0;
+		}
+
+		out[used++] = SCRIPT_TOKEN;
+		memcpy(&out[used], token, len + 1);
+		used += len + 1;
+	}
+
+	out[used++] = '\0';
+	return used;
+}
+
+/*
+=================
+Script_Compiled
+
+Returns the compiled form of s, from the cache when possible or built in buffer
+=================
+*/
+static char    *Script_Compiled(const char *s, int maxLength, char *buffer, int bufferSize)
+{
+	compiledScript_t    *script;
+	int             hash, size;
+
+	if(s < strPool || s >= strPool + STRING_POOL_SIZE)
+	{
+		return Script_Compile(s, maxLength, buffer, bufferSize) ? buffer : NULL;
+	}
+
+	hash = ((intptr_t) s >> 2) & (SCRIPT_HASH_SIZE - 1);
+	for(script = compiledScriptHash[hash]; script; script = script->next)
+	{
+		if(script->source == s && script->maxLength == maxLength)
+		{
+			return script->tokens;
+		}
+	}
+
+	size = Script_Compile(s, maxLength, buffer, bufferSize);
+	if(!size)
+	{
+		return NULL;
+	}
+
+	if(scriptCachePoint + sizeof(compiledScript_t) + size > SCRIPT_CACHE_SIZE)
+	{
+		// cache full, run it from the buffer
+		return buffer;
+	}
+
+	script = (compiledScript_t *) & scriptCache[scriptCachePoint];
+	scriptCachePoint += (sizeof(compiledScript_t) + size + 15) & ~15;
+
+	script->tokens = (char *)(script + 1);
+	memcpy(script->tokens, buffer, size);
+	script->source = s;
+	script->maxLength = maxLength;
+	script->next = compiledScriptHash[hash];
+	compiledScriptHash[hash] = script;
+
+	return script->tokens;
+}
+
 /*
 =================
 Float_Parse
@@ -371,7 +533,7 @@ qboolean Float_Parse(char **p, float *f)
 {
 	char           *token;
 
-	token = COM_ParseExt(p, qfalse);
+	token = Script_ParseToken(p);
 	if(token && token[0] != 0)
 	{
 		*f = atof(token);
@@ -413,7 +575,7 @@ qboolean Int_Parse(char **p, int *i)
 {
 	char           *token;
 
-	token = COM_ParseExt(p, qfalse);
+	token = Script_ParseToken(p);
 
 	if(token && token[0] != 0)
 	{
@@ -458,7 +620,7 @@ qboolean String_Parse(char **p, const char **out)
 {
 	char           *token;
 
-	token = COM_ParseExt(p, qfalse);
+	token = Script_ParseToken(p);
 	if(token && token[0] != 0)
 	{
 		*(out) = String_Alloc(token);
@@ -2348,55 +2510,97 @@ commandDef_t    commandList[] = {
 
 int             scriptCommandCount = sizeof(commandList) / sizeof(commandDef_t);
 
+static int      scriptCommandHash[KEYWORDHASH_SIZE];
+static int      scriptCommandNext[sizeof(commandList) / sizeof(commandDef_t)];
+
+/*
+=================
+Script_SetupCommandHash
+=================
+*/
+static void Script_SetupCommandHash(void)
+{
+	int             i, hash;
+
+	for(i = 0; i < KEYWORDHASH_SIZE; i++)
+	{
+		scriptCommandHash[i] = -1;
+	}
+
+	// added backwards so the first of any duplicates is found first
+	for(i = scriptCommandCount - 1; i >= 0; i--)
+	{
+		hash = KeywordHash_Key((char *)commandList[i].name);
+		scriptCommandNext[i] = scriptCommandHash[hash];
+		scriptCommandHash[hash] = i;
+	}
+}
+
+/*
+=================
+Script_FindCommand
+=================
+*/
+static commandDef_t *Script_FindCommand(const char *name)
+{
+	int             i;
+
+	for(i = scriptCommandHash[KeywordHash_Key((char *)name)]; i >= 0; i = scriptCommandNext[i])
+	{
+		if(Q_stricmp(name, commandList[i].name) == 0)
+		{
+			return &commandList[i];
+		}
+	}
+
+	return NULL;
+}
 
 void Item_RunScript(itemDef_t * item, qboolean * bAbort, const char *s)
 {
 	char            script[4096], *p;
-	int             i;
-	qboolean        bRan;
+	commandDef_t   *command;
 	qboolean        b_localAbort = qfalse;
 
-	memset(script, 0, sizeof(script));
 	if(item && s && s[0])
 	{
-		Q_strcat(script, 4096, s);
-		p = script;
+		p = Script_Compiled(s, 4096, script, sizeof(script));
+		if(!p)
+		{
+			return;
+		}
+
 		while(1)
 		{
-			const char     *command = NULL;
+			const char     *name = NULL;
 
 			// expect command then arguments, ; ends command, NULL ends script
-			if(!String_Parse(&p, &command))
+			if(!String_Parse(&p, &name))
 			{
 				return;
 			}
 
-			if(command[0] == ';' && command[1] == '\0')
+			if(name[0] == ';' && name[1] == '\0')
 			{
 				continue;
 			}
 
-			bRan = qfalse;
-			for(i = 0; i < scriptCommandCount; i++)
+			command = Script_FindCommand(name);
+			if(command)
 			{
-				if(Q_stricmp(command, commandList[i].name) == 0)
-				{
-					(commandList[i].handler(item, &b_localAbort, &p));
-					bRan = qtrue;
+				command->handler(item, &b_localAbort, &p);
 
-					if(b_localAbort)
+				if(b_localAbort)
+				{
+					if(bAbort)
 					{
-						if(bAbort)
-						{
-							*bAbort = b_localAbort;
-						}
-						return;
+						*bAbort = b_localAbort;
 					}
-					break;
+					return;
 				}
 			}
 			// not in our auto list, pass to handler
-			if(!bRan)
+			else
 			{
 				DC->runScript(&p);
 			}
@@ -2409,15 +2613,18 @@ qboolean Item_EnableShowViaCvar(itemDef_t * item, int flag)
 {
 	char            script[1024], *p;
 
-	memset(script, 0, sizeof(script));
 	if(item && item->enableCvar && *item->enableCvar && item->cvarTest && *item->cvarTest)
 	{
 		char            buff[1024];
 
 		DC->getCVarString(item->cvarTest, buff, sizeof(buff));
 
-		Q_strcat(script, 1024, item->enableCvar);
-		p = script;
+		p = Script_Compiled(item->enableCvar, 1024, script, sizeof(script));
+		if(!p)
+		{
+			return (item->cvarFlags & flag) ? qfalse : qtrue;
+		}
+
 		while(1)
 		{
 			const char     *val = NULL;
@@ -6933,8 +7140,6 @@ Keyword Hash
 ===============
 */
 
-#define KEYWORDHASH_SIZE    512
-
 typedef struct keywordHash_s
 {
 	char           *keyword;